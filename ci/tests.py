@@ -64,6 +64,7 @@ from gvtest import (  # pylint: disable=wrong-import-position
         "prune",
         "sccmap",
         "sfdp",
+        "sfdpstream",
         "smyrna",
         "tred",
         "twopi",
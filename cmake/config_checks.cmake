@@ -53,6 +53,9 @@ endif()
 set(HAVE_LASI       ${LASI_FOUND}      )
 set(HAVE_PANGOCAIRO ${PANGOCAIRO_FOUND})
 set(HAVE_POPPLER    ${POPPLER_FOUND}   )
+if(CMAKE_USE_PTHREADS_INIT)
+  set(HAVE_PTHREAD 1)
+endif()
 set(HAVE_WEBP       ${WEBP_FOUND}      )
 set(HAVE_X11        ${X11_FOUND}       )
 set(HAVE_XRENDER    ${XRENDER_FOUND}   )
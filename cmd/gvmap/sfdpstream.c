@@ -0,0 +1,206 @@
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * https://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+/// @file
+/// @brief sfdp layout of large graphs, read without building a cgraph
+///
+/// The input is streamed straight into a sparse matrix, so memory use is
+/// proportional to the adjacency matrix rather than to a full `Agraph_t`.
+
+#include "config.h"
+#include "../tools/openFile.h"
+#include <getopt.h>
+#include <limits.h>
+#include <sfdpgen/spring_electrical.h>
+#include <sparse/SparseMatrix.h>
+#include <sparse/StreamIO.h>
+#define STANDALONE
+#include <sparse/general.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/alloc.h>
+#include <util/exit.h>
+#include <util/unreachable.h>
+
+typedef struct {
+  FILE *outfp;
+  char **infiles;
+  int tscheme;
+  int seed;
+  bool positions_only;
+} opts_t;
+
+static const char usestr[] =
+"    -o <outfile> - output file (stdout)\n\
+    -p   - only output node positions, one \"name x y\" per line\n\
+    -q <scheme> - quadtree scheme (hybrid)\n\
+       none, normal, fast, fmm or hybrid\n\
+    -s k - random seed (123)\n\
+    -v   - verbose mode\n\
+    -?   - print usage\n";
+
+static void usage(char *cmd, int eval) {
+  fprintf(stderr, "Usage: %s <options> graphfile\n", cmd);
+  fputs(usestr, stderr);
+  graphviz_exit(eval);
+}
+
+static int quadtree_scheme(const char *arg) {
+  static const struct {
+    const char *name;
+    int scheme;
+  } schemes[] = {
+      {"none", QUAD_TREE_NONE},     {"normal", QUAD_TREE_NORMAL},
+      {"fast", QUAD_TREE_FAST},     {"fmm", QUAD_TREE_FMM},
+      {"hybrid", QUAD_TREE_HYBRID},
+  };
+  for (size_t i = 0; i < sizeof(schemes) / sizeof(schemes[0]); ++i) {
+    if (strcmp(arg, schemes[i].name) == 0) return schemes[i].scheme;
+  }
+  return -1;
+}
+
+static void init(int argc, char *argv[], opts_t *opts) {
+  char *cmd = argv[0];
+  int c;
+  int v;
+
+  *opts = (opts_t){.outfp = stdout, .tscheme = QUAD_TREE_HYBRID, .seed = 123};
+  Verbose = 0;
+
+  while ((c = getopt(argc, argv, ":o:pq:s:v?")) != -1) {
+    switch (c) {
+    case 'o':
+      opts->outfp = openFile(cmd, optarg, "w");
+      break;
+    case 'p':
+      opts->positions_only = true;
+      break;
+    case 'q':
+      if ((v = quadtree_scheme(optarg)) < 0) {
+        fprintf(stderr, "unknown quadtree scheme %s\n", optarg);
+        usage(cmd, 1);
+      }
+      opts->tscheme = v;
+      break;
+    case 's':
+      if (sscanf(optarg, "%d", &v) != 1) usage(cmd, 1);
+      opts->seed = v;
+      break;
+    case 'v':
+      Verbose = 1;
+      break;
+    case ':':
+      fprintf(stderr, "option -%c requires an argument\n", optopt);
+      usage(cmd, 1);
+      break;
+    case '?':
+      if (optopt == '\0' || optopt == '?')
+        usage(cmd, 0);
+      else {
+        fprintf(stderr, " option -%c unrecognized\n", optopt);
+        usage(cmd, 1);
+      }
+      break;
+    default:
+      UNREACHABLE();
+    }
+  }
+
+  argv += optind;
+  argc -= optind;
+  if (argc > 1) {
+    fprintf(stderr, "at most one input file may be given\n");
+    usage(cmd, 1);
+  }
+  opts->infiles = argc ? argv : NULL;
+}
+
+/// write a node name as a quoted DOT string
+static void put_name(FILE *fp, const char *name) {
+  putc('"', fp);
+  for (const char *s = name; *s != '\0'; ++s) {
+    if (*s == '"' || *s == '\\') putc('\\', fp);
+    putc(*s, fp);
+  }
+  putc('"', fp);
+}
+
+static void write_dot(FILE *fp, SparseMatrix A, const stream_names_t *names,
+                      const double *x) {
+  const char *edgeop = names->directed ? "->" : "--";
+  fprintf(fp, "%s {\n", names->directed ? "digraph" : "graph");
+  fputs("  node [shape=point];\n", fp);
+  for (int i = 0; i < names->n; ++i) {
+    fputs("  ", fp);
+    put_name(fp, stream_names_get(names, i));
+    fprintf(fp, " [pos=\"%.5g,%.5g\"];\n", 72 * x[2 * i], 72 * x[2 * i + 1]);
+  }
+  const double *val = A->a;
+  for (int i = 0; i < A->m; ++i) {
+    for (int j = A->ia[i]; j < A->ia[i + 1]; ++j) {
+      fputs("  ", fp);
+      put_name(fp, stream_names_get(names, i));
+      fprintf(fp, " %s ", edgeop);
+      put_name(fp, stream_names_get(names, A->ja[j]));
+      if (val[j] != 1) fprintf(fp, " [weight=%.5g]", val[j]);
+      fputs(";\n", fp);
+    }
+  }
+  fputs("}\n", fp);
+}
+
+static void write_positions(FILE *fp, const stream_names_t *names,
+                            const double *x) {
+  for (int i = 0; i < names->n; ++i)
+    fprintf(fp, "%s %.5g %.5g\n", stream_names_get(names, i), 72 * x[2 * i],
+            72 * x[2 * i + 1]);
+}
+
+int main(int argc, char *argv[]) {
+  opts_t opts;
+  init(argc, argv, &opts);
+
+  FILE *fp = stdin;
+  if (opts.infiles != NULL) fp = openFile(argv[0], opts.infiles[0], "r");
+
+  stream_names_t names;
+  SparseMatrix A = SparseMatrix_import_stream(fp, &names);
+  if (fp != stdin) fclose(fp);
+  if (A == NULL) graphviz_exit(1);
+
+  double *x = gv_calloc((size_t)names.n * 2, sizeof(double));
+  if (names.n > 0) {
+    spring_electrical_control ctrl = spring_electrical_control_new();
+    ctrl.tscheme = opts.tscheme;
+    ctrl.random_seed = opts.seed;
+    if (Verbose) spring_electrical_control_print(ctrl);
+
+    int flag = 0;
+    multilevel_spring_electrical_embedding(2, A, &ctrl, NULL, x, 0, NULL,
+                                           &flag);
+    if (flag != 0) {
+      fprintf(stderr, "layout failed with error %d\n", flag);
+      graphviz_exit(1);
+    }
+  }
+
+  if (opts.positions_only)
+    write_positions(opts.outfp, &names, x);
+  else
+    write_dot(opts.outfp, A, &names, x);
+
+  free(x);
+  stream_names_free(&names);
+  SparseMatrix_delete(A);
+  graphviz_exit(0);
+}
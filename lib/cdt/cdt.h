@@ -111,13 +111,14 @@ struct dt_s_
 typedef struct
 {	int	dt_meth;	/* method type				*/
 	int	dt_size;	/* number of elements			*/
-	size_t dt_n; // number of chains or levels
-	size_t dt_max; // max size of a chain or a level
-	size_t* dt_count; // counts of chains or levels by size
+	size_t dt_n; // number of chains, levels or probe distances
+	size_t dt_max; // max size of a chain, a level or a probe distance
+	size_t* dt_count; // counts of chains by size, or of levels or probe distances
 } Dtstat_t;
 
 /* supported storage methods */
 #define DT_SET		0000001	/* set with unique elements		*/
+#define DT_PROBE	0000002	/* set in an open-addressing hash table	*/
 #define DT_OSET		0000004	/* ordered set (self-adjusting tree)	*/
 #define DT_OBAG		0000010	/* ordered multiset			*/
 #define DT_METHODS	0000377	/* all currently supported methods	*/
@@ -137,6 +138,7 @@ typedef struct
 #define DT_DETACH	0010000	/* detach an object from the dictionary	*/
 
 CDT_API extern Dtmethod_t* 	Dtset; ///< set with unique elements
+CDT_API extern Dtmethod_t* 	Dtprobe; ///< set in an open-addressing hash table
 CDT_API extern Dtmethod_t* 	Dtoset; ///< ordered set (self-adjusting tree)
 CDT_API extern Dtmethod_t* 	Dtobag; ///< ordered multiset
 
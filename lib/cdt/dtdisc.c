@@ -33,7 +33,7 @@ Dtdisc_t *dtdisc(Dt_t *dt, Dtdisc_t *disc) {
 	dt->data.here = NULL;
 	dt->data.size = 0;
 
-	if (dt->data.type & DT_SET)
+	if (dt->data.type & (DT_SET|DT_PROBE))
 	{	Dtlink_t	**s, **ends;
 		ends = (s = dt->data.htab) + dt->data.ntab;
 		while(s < ends)
@@ -12,7 +12,7 @@ Dtlink_t* dtextract(Dt_t* dt)
 
 	if (dt->data.type & (DT_OSET|DT_OBAG))
 		list = dt->data.here;
-	else if (dt->data.type & DT_SET)
+	else if (dt->data.type & (DT_SET|DT_PROBE))
 	{	list = dtflatten(dt);
 		for (ends = (s = dt->data.htab) + dt->data.ntab; s < ends; ++s)
 			*s = NULL;
@@ -24,6 +24,12 @@
 #define HLOAD(s)	((s) << 1)
 #define HINDEX(n,h)	((h)&((n)-1))
 
+/* home slots of a Dtprobe table of n slots */
+#define PHOME(n)	((n) / 3 * 2)
+
+/* take an object out of the table of a Dtprobe dictionary */
+extern void dtprobedetach(Dt_t*, Dtlink_t*);
+
 #define UNFLATTEN(dt) ((dt->data.type & DT_FLATTEN) ? dtrestore(dt, NULL) : 0)
 
 /* tree rotation/linking functions */
@@ -18,7 +18,7 @@ Dtmethod_t* dtmethod(Dt_t* dt, Dtmethod_t* meth)
 	/* get the list of elements */
 	list = dtflatten(dt);
 
-	if (dt->data.type & DT_SET)
+	if (dt->data.type & (DT_SET|DT_PROBE))
 	{	if (dt->data.ntab > 0)
 			free(dt->data.htab);
 		dt->data.ntab = 0;
@@ -31,7 +31,7 @@ Dtmethod_t* dtmethod(Dt_t* dt, Dtmethod_t* meth)
 	if(dt->searchf == oldmeth->searchf)
 		dt->searchf = meth->searchf;
 
-	if(meth->type&(DT_OSET|DT_OBAG))
+	if(meth->type&(DT_OSET|DT_OBAG|DT_PROBE))
 	{	dt->data.size = 0;
 		while(list)
 		{	r = list->right;
@@ -39,7 +39,7 @@ Dtmethod_t* dtmethod(Dt_t* dt, Dtmethod_t* meth)
 			list = r;
 		}
 	}
-	else if(oldmeth->type&DT_SET)
+	else if(oldmeth->type&(DT_SET|DT_PROBE))
 	{	int	rehash;
 		if((meth->type&DT_SET) && !(oldmeth->type&DT_SET))
 			rehash = 1;
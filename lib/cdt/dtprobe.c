@@ -0,0 +1,299 @@
+/// @file
+/// @brief hash table with open addressing
+///
+/// Objects sit directly in a table of slots and are found by probing linearly
+/// from the home slot given by their hash value. Probes never wrap around:
+/// past the `PHOME(n)` home slots of a table of `n` slots there are enough
+/// spare slots to hold the longest run of objects the load limit allows.
+/// Deleting an object shifts later objects of its run back rather than leaving
+/// a tombstone, so every slot is either empty or holds one object and the
+/// table can be flattened, extracted and restored like the chains of `Dtset`.
+
+#include <cdt/dthdr.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PSLOTS(m) ((m) + (m) / 2) ///< table slots for m home slots
+#define PLOAD(m) ((m) / 2)        ///< most objects for m home slots
+
+#define PMIX UINT64_C(0x9e3779b97f4a7c15)
+
+/// mix a word into a hash value
+static uint64_t mix(uint64_t h, uint64_t w) {
+  h = (h ^ w) * PMIX;
+  return h ^ (h >> 32);
+}
+
+/// hash a key
+///
+/// Integer and pointer keys are mixed in a single step here, and other
+/// fixed-size keys a word at a time, rather than going byte by byte through
+/// `dtstrhash`.
+static unsigned probehash(void *key, int sz) {
+  uint64_t h;
+
+  if (sz == sizeof(uint32_t)) {
+    uint32_t v;
+    memcpy(&v, key, sizeof(v));
+    h = v;
+  } else if (sz == sizeof(uint64_t)) {
+    memcpy(&h, key, sizeof(h));
+  } else if (sz <= 0) {
+    h = dtstrhash(key, sz);
+  } else {
+    const unsigned char *s = key;
+    for (h = (uint64_t)sz; sz >= 8; s += 8, sz -= 8) {
+      uint64_t w;
+      memcpy(&w, s, sizeof(w));
+      h = mix(h, w);
+    }
+    uint64_t w = 0;
+    for (; sz > 0; --sz) {
+      w = (w << 8) | s[sz - 1];
+    }
+    h = mix(h, w);
+  }
+
+  // the slot index comes from the low bits, so fold in the high ones
+  h *= PMIX;
+  return (unsigned)(h >> 32);
+}
+
+/// find the slot holding the object with a given key, or else the empty slot
+/// ending its probe sequence
+static Dtlink_t **find(Dt_t *dt, void *key, unsigned hsh) {
+  Dtdisc_t *disc = dt->disc;
+  int ky, sz, lk;
+  Dtcompar_f cmpf;
+  _DTDSC(disc, ky, sz, lk, cmpf);
+
+  Dtlink_t **s = dt->data.htab + HINDEX(PHOME(dt->data.ntab), hsh);
+  for (Dtlink_t *t; (t = *s); ++s) {
+    if (hsh == t->hash) {
+      void *k = _DTOBJ(t, lk);
+      k = _DTKEY(k, ky, sz);
+      if (_DTCMP(key, k, cmpf, sz) == 0) {
+        break;
+      }
+    }
+  }
+  return s;
+}
+
+/// find the slot of an object known to be in the table
+static Dtlink_t **slot(Dt_t *dt, Dtlink_t *e) {
+  Dtlink_t **s = dt->data.htab + HINDEX(PHOME(dt->data.ntab), e->hash);
+  while (*s != e) {
+    ++s;
+  }
+  return s;
+}
+
+/// empty a slot, moving back the later objects of its run that could no
+/// longer be reached from their home slots
+static void clear(Dt_t *dt, Dtlink_t **s) {
+  const int m = PHOME(dt->data.ntab);
+  Dtlink_t **const ends = dt->data.htab + dt->data.ntab;
+
+  Dtlink_t *t;
+  for (Dtlink_t **p = s + 1; p < ends && (t = *p); ++p) {
+    if (dt->data.htab + HINDEX(m, t->hash) <= s) {
+      *s = t;
+      s = p;
+    }
+  }
+  *s = NULL;
+}
+
+/// double the number of home slots
+static int grow(Dt_t *dt) {
+  const int m = dt->data.ntab == 0 ? HSLOT : HRESIZE(PHOME(dt->data.ntab));
+  Dtlink_t **table = calloc((size_t)PSLOTS(m), sizeof(Dtlink_t *));
+  if (table == NULL) {
+    return -1;
+  }
+
+  Dtlink_t **const olds = dt->data.htab;
+  Dtlink_t **const ends = olds + dt->data.ntab;
+  dt->data.htab = table;
+  dt->data.ntab = PSLOTS(m);
+
+  // keys are distinct, so each object goes into the first empty slot from its
+  // home slot without any comparisons
+  for (Dtlink_t **p = olds; p < ends; ++p) {
+    if (*p != NULL) {
+      Dtlink_t **s = table + HINDEX(m, (*p)->hash);
+      while (*s != NULL) {
+        ++s;
+      }
+      *s = *p;
+    }
+  }
+  free(olds);
+  return 0;
+}
+
+void dtprobedetach(Dt_t *dt, Dtlink_t *e) { clear(dt, slot(dt, e)); }
+
+static void *dtprobe(Dt_t *dt, void *obj, int type) {
+  UNFLATTEN(dt);
+
+  Dtdisc_t *disc = dt->disc;
+  int ky, sz, lk;
+  Dtcompar_f cmpf;
+  _DTDSC(disc, ky, sz, lk, cmpf);
+  (void)cmpf;
+
+  Dtlink_t *t, *r = NULL, **s = NULL;
+
+  if (!obj) {
+    if (dt->data.size <= 0 || !(type & (DT_CLEAR | DT_FIRST | DT_LAST))) {
+      return NULL;
+    }
+
+    Dtlink_t **const table = dt->data.htab;
+    const int ntab = dt->data.ntab;
+
+    if (type & DT_CLEAR) {
+      for (int i = 0; i < ntab; ++i) {
+        if ((t = table[i]) == NULL) {
+          continue;
+        }
+        table[i] = NULL;
+        if (disc->freef) {
+          disc->freef(_DTOBJ(t, lk));
+        }
+        if (disc->link < 0) {
+          free(t);
+        }
+      }
+      dt->data.here = NULL;
+      dt->data.size = 0;
+      return NULL;
+    }
+
+    // walks go down the table, see `DT_NEXT` below
+    t = NULL;
+    if (type & DT_FIRST) {
+      for (int i = ntab - 1; i >= 0 && !(t = table[i]); --i) {
+      }
+    } else {
+      for (int i = 0; i < ntab && !(t = table[i]); ++i) {
+      }
+    }
+    dt->data.here = t;
+    return t ? _DTOBJ(t, lk) : NULL;
+  }
+
+  void *key = NULL;
+  unsigned hsh = 0;
+  if ((type & (DT_DELETE | DT_DETACH | DT_NEXT | DT_PREV)) &&
+      (t = dt->data.here) && _DTOBJ(t, lk) == obj) {
+    s = slot(dt, t);
+  } else {
+    if (type & (DT_RENEW | DT_VSEARCH)) {
+      r = obj;
+      obj = _DTOBJ(r, lk);
+    }
+    key = (type & DT_MATCH) ? obj : _DTKEY(obj, ky, sz);
+    hsh = probehash(key, sz);
+    t = dt->data.ntab <= 0 ? NULL : *(s = find(dt, key, hsh));
+  }
+
+  if (type & (DT_MATCH | DT_SEARCH | DT_VSEARCH)) {
+    if (!t) {
+      return NULL;
+    }
+    dt->data.here = t;
+    return _DTOBJ(t, lk);
+  }
+
+  if (type & (DT_INSERT | DT_RENEW)) {
+    if (t) {
+      if (type & DT_INSERT) {
+        dt->data.here = t;
+      } else {
+        if (disc->freef) {
+          disc->freef(obj);
+        }
+        if (disc->link < 0) {
+          free(r);
+        }
+      }
+      return _DTOBJ(t, lk);
+    }
+
+    if (type & DT_INSERT) {
+      if (disc->makef && !(obj = disc->makef(obj, disc))) {
+        return NULL;
+      }
+      if (lk >= 0) {
+        r = _DTLNK(obj, lk);
+      } else if ((r = malloc(sizeof(Dthold_t)))) {
+        ((Dthold_t *)r)->obj = obj;
+      } else {
+        if (disc->makef && disc->freef) {
+          disc->freef(obj);
+        }
+        return NULL;
+      }
+    }
+    r->hash = hsh;
+    r->right = NULL;
+
+    if (dt->data.size >= PLOAD(PHOME(dt->data.ntab))) {
+      if (grow(dt) != 0) {
+        if (disc->freef && (type & DT_INSERT)) {
+          disc->freef(obj);
+        }
+        if (disc->link < 0) {
+          free(r);
+        }
+        return NULL;
+      }
+      s = find(dt, key, hsh);
+    }
+    *s = r;
+    ++dt->data.size;
+    dt->data.here = r;
+    return obj;
+  }
+
+  if (type & (DT_NEXT | DT_PREV)) {
+    // Walking down the table means deleting the current object only ever
+    // shifts objects that were already visited into its slot.
+    r = NULL;
+    if (t) {
+      if (type & DT_NEXT) {
+        while (s > dt->data.htab && !(r = *--s)) {
+        }
+      } else {
+        Dtlink_t **const ends = dt->data.htab + dt->data.ntab;
+        while (++s < ends && !(r = *s)) {
+        }
+      }
+    }
+    dt->data.here = r;
+    return r ? _DTOBJ(r, lk) : NULL;
+  }
+
+  // DT_DELETE or DT_DETACH: take an object out of the dictionary
+  if (!t) {
+    return NULL;
+  }
+  clear(dt, s);
+  --dt->data.size;
+  dt->data.here = NULL;
+  obj = _DTOBJ(t, lk);
+  if (disc->freef && (type & DT_DELETE)) {
+    disc->freef(obj);
+  }
+  if (disc->link < 0) {
+    free(t);
+  }
+  return obj;
+}
+
+static Dtmethod_t _Dtprobe = {dtprobe, DT_PROBE};
+Dtmethod_t *Dtprobe = &_Dtprobe;
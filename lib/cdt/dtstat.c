@@ -35,6 +35,22 @@ static void dthstat(Dtdata_t data, Dtstat_t *ds, size_t *count) {
 	}
 }
 
+/* count objects by their distance from their home slot in a Dtprobe table */
+static void dtpstat(Dtdata_t data, Dtstat_t *ds, size_t *count) {
+	const int m = PHOME(data.ntab);
+
+	for (int s = 0; s < data.ntab; ++s)
+	{	Dtlink_t *t = data.htab[s];
+		if (!t)
+			continue;
+		const size_t d = (size_t)(s - (int)HINDEX(m, t->hash));
+		if(count)
+			count[d] += 1;
+		else if(d > ds->dt_n)
+			ds->dt_n = d;
+	}
+}
+
 int dtstat(Dt_t* dt, Dtstat_t* ds, int all)
 {
 	static size_t *Count;
@@ -55,7 +71,7 @@ int dtstat(Dt_t* dt, Dtstat_t* ds, int all)
 		if(ds->dt_max+1 > Size)
 		{	if(Size > 0)
 				free(Count);
-			if(!(Count = malloc((ds->dt_max+1)*sizeof(int))) )
+			if(!(Count = malloc((ds->dt_max+1)*sizeof(size_t))) )
 				return -1;
 			Size = ds->dt_max+1;
 		}
@@ -63,13 +79,29 @@ int dtstat(Dt_t* dt, Dtstat_t* ds, int all)
 			Count[i] = 0;
 		dthstat(dt->data,ds,Count);
 	}
+	else if (dt->data.type & DT_PROBE)
+	{	dtpstat(dt->data,ds,NULL);
+		if(ds->dt_n+1 > Size)
+		{	if(Size > 0)
+				free(Count);
+			if(!(Count = malloc((ds->dt_n+1)*sizeof(size_t))) )
+				return -1;
+			Size = ds->dt_n+1;
+		}
+		for (size_t i = 0; i <= ds->dt_n; ++i)
+			Count[i] = 0;
+		dtpstat(dt->data,ds,Count);
+		for(size_t i = 0; i <= ds->dt_n; ++i)
+			if(Count[i] > ds->dt_max)
+				ds->dt_max = Count[i];
+	}
 	else if (dt->data.type & (DT_OSET|DT_OBAG))
 	{	if (dt->data.here)
 		{	dttstat(ds, dt->data.here, 0, NULL);
 			if(ds->dt_n+1 > Size)
 			{	if(Size > 0)
 					free(Count);
-				if(!(Count = malloc((ds->dt_n+1)*sizeof(int))) )
+				if(!(Count = malloc((ds->dt_n+1)*sizeof(size_t))) )
 					return -1;
 				Size = ds->dt_n+1;
 			}
@@ -0,0 +1,53 @@
+/// @file
+/// @brief implementation of arena.h
+/// @ingroup cgraph_core
+
+#include <assert.h>
+#include <cgraph/arena.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/alloc.h>
+#include <util/exit.h>
+#include <util/prisize_t.h>
+#include <vmalloc/vmalloc.h>
+
+struct graphviz_arena {
+  Vmalloc_t vm; ///< the region blocks are carved from
+};
+
+arena_t *arena_new(void) {
+  // a zeroed region is an empty one, as from `vmopen`
+  return gv_alloc(sizeof(arena_t));
+}
+
+void *arena_alloc(arena_t *self, size_t size) {
+  assert(self != NULL);
+
+  void *const p = vmalloc(&self->vm, size);
+  if (p == NULL) {
+    fprintf(stderr,
+            "out of memory when trying to allocate %" PRISIZE_T " bytes\n",
+            size);
+    graphviz_exit(EXIT_FAILURE);
+  }
+  memset(p, 0, size);
+  return p;
+}
+
+void arena_free(arena_t *self, void *ptr) {
+  assert(self != NULL);
+  vmfree(&self->vm, ptr);
+}
+
+void arena_release(arena_t **self) {
+  assert(self != NULL);
+
+  if (*self == NULL) {
+    return;
+  }
+
+  vmclear(&(*self)->vm);
+  free(*self);
+  *self = NULL;
+}
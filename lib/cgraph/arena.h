@@ -0,0 +1,47 @@
+/// @file
+/// @brief region allocator for the objects of a root graph
+///
+/// Nodes, subnodes, edge pairs and records of a root graph and its subgraphs
+/// are allocated from a vmalloc region owned by the graph, so that closing the
+/// graph can release them all at once rather than freeing each object. This is
+/// a thin layer over @ref vmalloc that zeroes blocks and exits when out of
+/// memory, like the rest of cgraph's allocations.
+///
+/// The arena is internal to cgraph. It is not a discipline that clients can
+/// replace through `Agdisc_t`.
+
+#pragma once
+
+#include <stddef.h>
+
+/// a region of memory blocks
+typedef struct graphviz_arena arena_t;
+
+/// construct a new arena
+///
+/// Calls `exit` on failure (out-of-memory).
+///
+/// @return A constructed arena
+arena_t *arena_new(void);
+
+/// allocate a zeroed block
+///
+/// Calls `exit` on failure (out-of-memory).
+///
+/// @param self Arena to allocate from
+/// @param size Number of bytes needed
+/// @return A block suitably aligned for any object type
+void *arena_alloc(arena_t *self, size_t size);
+
+/// return a block to an arena for reuse
+///
+/// @param self Arena the block was allocated from
+/// @param ptr Block to free or `NULL`
+void arena_free(arena_t *self, void *ptr);
+
+/// release all blocks and destruct an arena
+///
+/// `*self` is `NULL` on return.
+///
+/// @param self Arena to destroy
+void arena_release(arena_t **self);
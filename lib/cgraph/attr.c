@@ -16,15 +16,225 @@
 
 #include	<cgraph/cghdr.h>
 #include	<stdbool.h>
+#include	<stddef.h>
 #include	<stdlib.h>
 #include	<util/alloc.h>
+#include	<util/list.h>
 #include	<util/streq.h>
-#include	<util/unreachable.h>
 
 /*
  * dynamic attributes
  */
 
+/*
+ * Attribute values are not kept with the objects. Every object gets a slot
+ * number at creation time, and each attribute of each object kind has a
+ * column in the root graph's store, holding the values explicitly set on
+ * objects indexed by slot. An object whose entry is unset has the default
+ * that was in force in the root graph when the object was created: a column
+ * records each change of default together with the first slot it applies to.
+ * Declaring an attribute thus costs nothing per existing object, and an
+ * object only pays for the attributes set on it. Reading an unset value is
+ * constant time for objects created under the current defaults, and otherwise
+ * logarithmic in the number of times the default has changed.
+ *
+ * The slots of deleted objects are reused. An object given a reused slot
+ * stores explicitly any current default that differs from the one the slot
+ * would otherwise resolve to.
+ */
+
+/// a default of an attribute, for objects created after it was set
+typedef struct {
+  size_t start; ///< slot of the first object given this default
+  char *value;
+  Agparsed_t parsed; ///< parsed form of `value`
+} attr_epoch_t;
+
+DEFINE_LIST(attr_epochs, attr_epoch_t)
+DEFINE_LIST(attr_slots, size_t)
+
+/// values of one attribute over all objects of one kind
+typedef struct {
+  char **values;          ///< explicitly set values by slot, NULL if unset
+  Agparsed_t *parsed;     ///< parsed forms of `values`, made on first use
+  size_t size;            ///< number of entries in `values` and `parsed`
+  attr_epochs_t defaults; ///< defaults in increasing `start` order
+} attr_column_t;
+
+/// attribute values of all objects of one kind
+typedef struct {
+  attr_column_t *columns; ///< columns indexed by `Agsym_t.id`
+  size_t n_columns;
+  size_t next_slot;       ///< slot to give the next object created
+  attr_slots_t free_slots; ///< slots of deleted objects, to reuse first
+} attr_table_t;
+
+struct graphviz_attr_store {
+  attr_table_t kinds[3]; ///< indexed by `AGRAPH`, `AGNODE`, `AGEDGE`
+};
+
+static char *attr_strdup(Agraph_t *g, const char *value, bool is_html) {
+  return is_html ? agstrdup_html(g, value) : agstrdup(g, value);
+}
+
+static void attr_strfree(Agraph_t *g, char *value) {
+  agstrfree(g, value, aghtmlstr(value));
+}
+
+static attr_table_t *attr_table(Agraph_t *g, int kind) {
+  if (g->clos->attrs == NULL) {
+    g->clos->attrs = gv_alloc(sizeof(struct graphviz_attr_store));
+  }
+  return &g->clos->attrs->kinds[kind == AGINEDGE ? AGOUTEDGE : kind];
+}
+
+static attr_column_t *attr_column(Agraph_t *g, int kind, int id) {
+  attr_table_t *const table = attr_table(g, kind);
+  assert(id >= 0 && (size_t)id < table->n_columns);
+  return &table->columns[id];
+}
+
+/// add the column of a new attribute, all objects having its default
+static void attr_declare(Agraph_t *g, Agsym_t *sym) {
+  attr_table_t *const table = attr_table(g, sym->kind);
+  assert(sym->id >= 0);
+  const size_t id = (size_t)sym->id;
+  if (id >= table->n_columns) {
+    table->columns = gv_recalloc(table->columns, table->n_columns, id + 1,
+                                 sizeof(table->columns[0]));
+    table->n_columns = id + 1;
+  }
+  attr_column_t *const column = &table->columns[id];
+  assert(attr_epochs_is_empty(&column->defaults));
+  const attr_epoch_t epoch = {
+      .value = attr_strdup(g, sym->defval, aghtmlstr(sym->defval))};
+  attr_epochs_append(&column->defaults, epoch);
+}
+
+/// make a root graph’s new default of an attribute apply from now on
+static void attr_redefault(Agraph_t *g, Agsym_t *sym) {
+  const size_t next_slot = attr_table(g, sym->kind)->next_slot;
+  attr_column_t *const column = attr_column(g, sym->kind, sym->id);
+  char *const value = attr_strdup(g, sym->defval, aghtmlstr(sym->defval));
+  attr_epoch_t *const last = attr_epochs_back(&column->defaults);
+  if (last->start == next_slot) { // no object was created since
+    attr_strfree(g, last->value);
+    last->value = value;
+    last->parsed = (Agparsed_t){0};
+  } else {
+    const attr_epoch_t epoch = {.start = next_slot, .value = value};
+    attr_epochs_append(&column->defaults, epoch);
+  }
+}
+
+/// the default an object got from the column when it was created
+///
+/// This is constant time for the current default, and a binary search over
+/// the column’s changes of default otherwise.
+static attr_epoch_t *attr_epoch(attr_column_t *column, size_t slot) {
+  size_t hi = attr_epochs_size(&column->defaults);
+  assert(hi > 0);
+  attr_epoch_t *const last = attr_epochs_at(&column->defaults, hi - 1);
+  if (last->start <= slot) {
+    return last;
+  }
+  // find the last epoch starting at or before `slot`
+  size_t lo = 0;
+  --hi;
+  while (lo + 1 < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if (attr_epochs_get(&column->defaults, mid).start <= slot) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return attr_epochs_at(&column->defaults, lo);
+}
+
+static char *attr_default(attr_column_t *column, size_t slot) {
+  return attr_epoch(column, slot)->value;
+}
+
+static char *attr_value(attr_column_t *column, size_t slot) {
+  if (slot < column->size && column->values[slot] != NULL) {
+    return column->values[slot];
+  }
+  return attr_default(column, slot);
+}
+
+/// the entry of an object in a column, making room for it if needed
+///
+/// The entry is taken to be about to change, so its parsed form is cleared.
+static char **attr_entry(attr_column_t *column, size_t slot) {
+  if (slot >= column->size) {
+    size_t size = column->size == 0 ? 16 : column->size;
+    while (size <= slot) {
+      size *= 2;
+    }
+    column->values = gv_recalloc(column->values, column->size, size,
+                                 sizeof(column->values[0]));
+    if (column->parsed != NULL) {
+      column->parsed = gv_recalloc(column->parsed, column->size, size,
+                                   sizeof(column->parsed[0]));
+    }
+    column->size = size;
+  }
+  if (column->parsed != NULL) {
+    column->parsed[slot] = (Agparsed_t){0};
+  }
+  return &column->values[slot];
+}
+
+/// a slot for a new object, reusing that of a deleted object if possible
+static size_t attr_new_slot(Agraph_t *root, int kind) {
+  attr_table_t *const table = attr_table(root, kind);
+  if (attr_slots_is_empty(&table->free_slots)) {
+    return table->next_slot++;
+  }
+  const size_t slot = attr_slots_pop_back(&table->free_slots);
+  // the slot resolves to the defaults of its first owner’s time
+  for (size_t i = 0; i < table->n_columns; ++i) {
+    attr_column_t *const column = &table->columns[i];
+    assert(column->size <= slot || column->values[slot] == NULL);
+    char *const current = attr_epochs_back(&column->defaults)->value;
+    if (attr_default(column, slot) != current) {
+      *attr_entry(column, slot) =
+          attr_strdup(root, current, aghtmlstr(current));
+    }
+  }
+  return slot;
+}
+
+static void attr_store_free(Agraph_t *g) {
+  struct graphviz_attr_store *const store = g->clos->attrs;
+  if (store == NULL) {
+    return;
+  }
+  for (size_t kind = 0; kind < sizeof(store->kinds) / sizeof(store->kinds[0]);
+       ++kind) {
+    attr_table_t *const table = &store->kinds[kind];
+    for (size_t i = 0; i < table->n_columns; ++i) {
+      attr_column_t *const column = &table->columns[i];
+      for (size_t j = 0; j < column->size; ++j) {
+        if (column->values[j] != NULL) {
+          attr_strfree(g, column->values[j]);
+        }
+      }
+      free(column->values);
+      free(column->parsed);
+      for (size_t j = 0; j < attr_epochs_size(&column->defaults); ++j) {
+        attr_strfree(g, attr_epochs_get(&column->defaults, j).value);
+      }
+      attr_epochs_free(&column->defaults);
+    }
+    free(table->columns);
+    attr_slots_free(&table->free_slots);
+  }
+  free(store);
+  g->clos->attrs = NULL;
+}
+
 /* to create a graph's data dictionary */
 
 static void freesym(void *obj);
@@ -94,6 +304,7 @@ static void agcopydict(Dict_t * src, Dict_t * dest, Agraph_t * g, int kind)
 	newsym->print = sym->print;
 	newsym->fixed = sym->fixed;
 	dtinsert(dest, newsym);
+	attr_declare(g, newsym);
     }
 }
 
@@ -153,12 +364,6 @@ Agsym_t *agattrsym(void *obj, char *name)
 
 const char AgDataRecName[] = "_AG_strdata";
 
-static int topdictsize(Agobj_t * obj)
-{
-    Dict_t *const d = agdictof(agroot(agraphof(obj)), AGTYPE(obj));
-    return d ? dtsize(d) : 0;
-}
-
 /* g can be either the enclosing graph, or ProtoGraph */
 static Agrec_t *agmakeattrs(Agraph_t * context, void *obj)
 {
@@ -167,15 +372,23 @@ static Agrec_t *agmakeattrs(Agraph_t * context, void *obj)
     Dict_t *const datadict = agdictof(context, AGTYPE(obj));
     assert(datadict);
     if (rec->dict == NULL) {
-	rec->dict = agdictof(agroot(context), AGTYPE(obj));
-	const int sz = topdictsize(obj);
-	rec->str = gv_calloc((size_t)sz, sizeof(char *));
-	/* doesn't call agxset() so no obj-modified callbacks occur */
-	for (Agsym_t *sym = dtfirst(datadict); sym; sym = dtnext(datadict, sym)) {
-	    if (aghtmlstr(sym->defval)) {
-	        rec->str[sym->id] = agstrdup_html(agraphof(obj), sym->defval);
-	    } else {
-	        rec->str[sym->id] = agstrdup(agraphof(obj), sym->defval);
+	Agraph_t *const root = agroot(context);
+	rec->dict = agdictof(root, AGTYPE(obj));
+	rec->slot = attr_new_slot(root, AGTYPE(obj));
+	/* Objects get the root graph's defaults from their columns. Only
+	 * the definitions local to subgraphs need storing.
+	 * doesn't call agxset() so no obj-modified callbacks occur */
+	if (context != root) {
+	    for (Agsym_t *sym = dtfirst(datadict); sym;
+	         sym = dtnext(datadict, sym)) {
+		attr_column_t *const column =
+		    attr_column(root, AGTYPE(obj), sym->id);
+		if (sym->defval == attr_value(column, rec->slot))
+		    continue;
+		char **const entry = attr_entry(column, rec->slot);
+		if (*entry != NULL)
+		    attr_strfree(root, *entry);
+		*entry = attr_strdup(root, sym->defval, aghtmlstr(sym->defval));
 	    }
 	}
     } else {
@@ -186,14 +399,18 @@ static Agrec_t *agmakeattrs(Agraph_t * context, void *obj)
 
 static void freeattr(Agobj_t * obj, Agattr_t * attr)
 {
-    int i, sz;
-    Agraph_t *g;
-
-    g = agraphof(obj);
-    sz = topdictsize(obj);
-    for (i = 0; i < sz; i++)
-	agstrfree(g, attr->str[i], aghtmlstr(attr->str[i]));
-    free(attr->str);
+    Agraph_t *const g = agraphof(obj);
+    attr_table_t *const table = attr_table(g, AGTYPE(obj));
+    for (size_t i = 0; i < table->n_columns; i++) {
+	attr_column_t *const column = &table->columns[i];
+	if (attr->slot < column->size && column->values[attr->slot]) {
+	    attr_strfree(g, column->values[attr->slot]);
+	    column->values[attr->slot] = NULL;
+	    if (column->parsed != NULL)
+		column->parsed[attr->slot] = (Agparsed_t){0};
+	}
+    }
+    attr_slots_append(&table->free_slots, attr->slot);
 }
 
 static void freesym(void *obj) {
@@ -208,19 +425,6 @@ Agattr_t *agattrrec(void *obj)
   return (Agattr_t *)aggetrec(obj, AgDataRecName, 0);
 }
 
-static void addattr(Agraph_t *g, Agobj_t *obj, void *symbol) {
-    Agsym_t *const sym = symbol;
-    Agattr_t *attr = agattrrec(obj);
-    assert(attr != NULL);
-    attr->str = gv_recalloc(attr->str, (size_t)sym->id, (size_t)sym->id + 1,
-                            sizeof(char *));
-    if (aghtmlstr(sym->defval)) {
-	attr->str[sym->id] = agstrdup_html(g, sym->defval);
-    } else {
-	attr->str[sym->id] = agstrdup(g, sym->defval);
-    }
-}
-
 static Agsym_t *getattr(Agraph_t *g, int kind, char *name) {
   Agsym_t *rv = 0;
   Dict_t *dict = agdictof(g, kind);
@@ -272,6 +476,8 @@ static Agsym_t *setattr(Agraph_t * g, int kind, char *name, const char *value,
         }
 	agstrfree(g, lsym->defval, aghtmlstr(lsym->defval));
 	lsym->defval = is_html ? agstrdup_html(g, value) : agstrdup(g, value);
+	if (g == root)
+	    attr_redefault(root, lsym);
 	rv = lsym;
     } else {
 	Agsym_t *psym = agdictsym(ldict, name); // search with viewpath up to root
@@ -283,23 +489,8 @@ static Agsym_t *setattr(Agraph_t * g, int kind, char *name, const char *value,
 	    Dict_t *rdict = agdictof(root, kind);
 	    Agsym_t *rsym = agnewsym(root, name, value, is_html, dtsize(rdict), kind);
 	    dtinsert(rdict, rsym);
-	    switch (kind) {
-	    case AGRAPH:
-		agapply(root, &root->base, addattr, rsym, true);
-		break;
-	    case AGNODE:
-		for (Agnode_t *n = agfstnode(root); n; n = agnxtnode(root, n))
-		    addattr(g, &n->base, rsym);
-		break;
-	    case AGINEDGE:
-	    case AGOUTEDGE:
-		for (Agnode_t *n = agfstnode(root); n; n = agnxtnode(root, n))
-		    for (Agedge_t *e = agfstout(root, n); e; e = agnxtout(root, e))
-			addattr(g, &e->base, rsym);
-		break;
-	    default:
-		UNREACHABLE();
-	    }
+	    // existing objects get the default without being visited
+	    attr_declare(root, rsym);
 	    rv = rsym;
 	}
     }
@@ -397,6 +588,8 @@ int agraphattr_delete(Agraph_t * g)
 	freeattr(&g->base, attr);
 	agdelrec(g, attr->h.name);
     }
+    if (agparent(g) == NULL)
+	attr_store_free(g);
 
     if ((dd = agdatadict(g, false))) {
 	if (agdtclose(g, dd->dict.n)) return 1;
@@ -451,15 +644,30 @@ char *agget(void *obj, char *name)
     if (sym == NULL) {
 	return NULL; // note was "", but this provides more info
     }
-    Agattr_t *const data = agattrrec(obj);
-    return data->str[sym->id];
+    return agxget(obj, sym);
 }
 
 char *agxget(void *obj, Agsym_t * sym)
 {
     Agattr_t *const data = agattrrec(obj);
-    assert(sym->id >= 0 && sym->id < topdictsize(obj));
-    return data->str[sym->id];
+    return attr_value(attr_column(agraphof(obj), AGTYPE(obj), sym->id),
+                      data->slot);
+}
+
+Agparsed_t *agxparsed(void *obj, Agsym_t *sym, char **value)
+{
+    Agattr_t *const data = agattrrec(obj);
+    attr_column_t *const column =
+	attr_column(agraphof(obj), AGTYPE(obj), sym->id);
+    if (data->slot < column->size && column->values[data->slot] != NULL) {
+	if (column->parsed == NULL)
+	    column->parsed = gv_calloc(column->size, sizeof(column->parsed[0]));
+	*value = column->values[data->slot];
+	return &column->parsed[data->slot];
+    }
+    attr_epoch_t *const epoch = attr_epoch(column, data->slot);
+    *value = epoch->value;
+    return &epoch->parsed;
 }
 
 static int agset_(void *obj, char *name, const char *value, bool is_html) {
@@ -501,15 +709,19 @@ static int agxset_(void *obj, Agsym_t *sym, const char *value, bool is_html) {
     Agraph_t *g = agraphof(obj);
     Agobj_t *hdr = obj;
     Agattr_t *data = agattrrec(hdr);
-    assert(sym->id >= 0 && sym->id < topdictsize(obj));
-    agstrfree(g, data->str[sym->id], aghtmlstr(data->str[sym->id]));
-    data->str[sym->id] = is_html ? agstrdup_html(g, value) : agstrdup(g, value);
+    char **const entry =
+	attr_entry(attr_column(g, AGTYPE(hdr), sym->id), data->slot);
+    if (*entry)
+	attr_strfree(g, *entry);
+    *entry = attr_strdup(g, value, is_html);
     if (hdr->tag.objtype == AGRAPH) {
 	/* also update dict default */
 	Dict_t *dict = agdatadict(g, false)->dict.g;
 	if ((lsym = aglocaldictsym(dict, sym->name))) {
 	    agstrfree(g, lsym->defval, aghtmlstr(lsym->defval));
 	    lsym->defval = is_html ? agstrdup_html(g, value) : agstrdup(g, value);
+	    if (g == agroot(g))
+		attr_redefault(g, lsym);
 	} else {
 	    lsym = agnewsym(g, sym->name, value, is_html, sym->id, AGTYPE(hdr));
 	    dtinsert(dict, lsym);
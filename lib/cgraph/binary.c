@@ -0,0 +1,711 @@
+/// @file
+/// @brief binary graph format
+/// @ingroup cgraph_core
+///
+/// A binary graph holds, after a fixed header, a table of the distinct strings
+/// it uses followed by flat arrays that refer to them by index: attribute
+/// declarations, nodes, edges, subgraphs with their members, and finally one
+/// column of values per attribute with a row per graph, node or edge. Layout
+/// geometry travels in its attributes (`pos`, `bb`, `_draw_`, …), so a graph
+/// written after layout can be rendered again without a new layout. Reading
+/// it back is a series of lookups in these arrays, with no lexing, and edges
+/// are loaded in bulk.
+///
+/// All integers are little-endian. A value of `NONE` stands for a missing
+/// string, such as the name of an anonymous node.
+
+#include "config.h"
+
+#include <assert.h>
+#include <cgraph/cghdr.h>
+#include <cgraph/rdr.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/agxbuf.h>
+#include <util/alloc.h>
+#include <util/list.h>
+
+/// leading bytes of a binary graph, which no DOT file starts with
+static const char Magic[8] = "\x89GVB\r\n\x1a\n";
+
+enum {
+  VERSION = 1,     ///< revision of the format written
+  HEADER_SIZE = 24 ///< bytes of magic, version, flags and total size
+};
+
+enum {
+  FLAG_DIRECTED = 1 << 0,
+  FLAG_STRICT = 1 << 1,
+};
+
+enum {
+  SYM_PRINT = 1 << 0,
+  SYM_FIXED = 1 << 1,
+};
+
+/// marks an HTML-like string in the length of a string table entry
+#define HTML_BIT UINT32_C(0x80000000)
+
+#define NONE UINT32_MAX ///< index of a missing string
+
+/// kinds of object, in the order their declarations and columns are stored
+static const int Kinds[] = {AGRAPH, AGNODE, AGEDGE};
+#define KINDS (sizeof(Kinds) / sizeof(Kinds[0]))
+
+bool agisbin(const char *data, size_t size) {
+  return size >= sizeof(Magic) && memcmp(data, Magic, sizeof(Magic)) == 0;
+}
+
+// writing
+
+/// a string in the table
+///
+/// Strings of the graph are bound to it by `agstrdup`, so the table can tell
+/// them apart by address.
+typedef struct {
+  Dtlink_t link;
+  const char *str;
+  uint32_t index;
+} entry_t;
+
+static Dtdisc_t Entries = {
+    .key = offsetof(entry_t, str),
+    .size = sizeof(const char *),
+    .link = offsetof(entry_t, link),
+    .freef = free,
+};
+
+DEFINE_LIST(graphs, Agraph_t *)
+DEFINE_LIST(nodes, Agnode_t *)
+DEFINE_LIST(edges, Agedge_t *)
+
+typedef struct {
+  Agraph_t *g;
+  agxbuf strings; ///< string table entries
+  uint32_t count; ///< number of strings in the table
+  Dt_t *table;    ///< strings in the table, by address
+  const char *last; ///< most recently interned string
+  uint32_t last_index;
+  agxbuf body;     ///< everything after the string table
+  graphs_t graphs; ///< root graph, then subgraphs in preorder
+  nodes_t nodes;   ///< nodes, by sequence number
+  edges_t edges;   ///< edges, by sequence number
+} writer_t;
+
+static void put_u8(agxbuf *xb, uint8_t v) { agxbputc(xb, (char)v); }
+
+static void put_u32(agxbuf *xb, uint32_t v) {
+  const char bytes[] = {(char)v, (char)(v >> 8), (char)(v >> 16),
+                        (char)(v >> 24)};
+  agxbput_n(xb, bytes, sizeof(bytes));
+}
+
+static void put_u64(agxbuf *xb, uint64_t v) {
+  put_u32(xb, (uint32_t)v);
+  put_u32(xb, (uint32_t)(v >> 32));
+}
+
+/// append a string to the table
+static uint32_t append(writer_t *w, const char *s, bool html) {
+  const size_t len = strlen(s);
+  put_u32(&w->strings, (uint32_t)len | (html ? HTML_BIT : 0));
+  agxbput_n(&w->strings, s, len + 1);
+  return w->count++;
+}
+
+/// add a string of the graph to the table if it is not there yet
+///
+/// @return Index of the string in the table
+static uint32_t intern(writer_t *w, const char *s) {
+  if (s == NULL) {
+    return NONE;
+  }
+  // runs of equal attribute values are common
+  if (s == w->last) {
+    return w->last_index;
+  }
+
+  entry_t *e = dtmatch(w->table, &s);
+  if (e == NULL) {
+    e = gv_alloc(sizeof(entry_t));
+    e->str = s;
+    e->index = append(w, s, aghtmlstr(s));
+    dtinsert(w->table, e);
+  }
+  w->last = s;
+  w->last_index = e->index;
+  return e->index;
+}
+
+/// add the name of an object to the table
+///
+/// A name need not be a string of the graph, as an ID discipline may make it
+/// up, so look for the string of the graph that it matches.
+static uint32_t intern_name(writer_t *w, void *obj) {
+  const char *const name = agnameof(obj);
+  if (name == NULL || name[0] == LOCALNAMEPREFIX) {
+    return NONE;
+  }
+  // mirror `agxset`, which treats a name as HTML-like only if it is bound as
+  // such
+  const char *bound = agstrbind_html(w->g, name);
+  if (bound != name) {
+    bound = agstrbind_text(w->g, name);
+  }
+  return bound == NULL ? append(w, name, false) : intern(w, bound);
+}
+
+static int cmpseq(const void *a, const void *b) {
+  const Agobj_t *const *x = a;
+  const Agobj_t *const *y = b;
+  return AGSEQ(*x) < AGSEQ(*y) ? -1 : AGSEQ(*x) > AGSEQ(*y);
+}
+
+static int cmpedges(const Agedge_t **a, const Agedge_t **b) {
+  return cmpseq(a, b);
+}
+
+/// find the index of an object in a list sorted by sequence number
+static uint32_t index_of(void *const *objs, size_t n, void *obj) {
+  void *const *const found = bsearch(&obj, objs, n, sizeof(obj), cmpseq);
+  assert(found != NULL);
+  return (uint32_t)(found - objs);
+}
+
+/// attribute declarations of the root graph, by ID
+static Agsym_t **declarations(Agraph_t *g, int kind, uint32_t *count) {
+  Agdatadict_t *const dd = agdatadict(g, false);
+  Dict_t *const dict =
+      dd == NULL ? NULL : kind == AGRAPH ? dd->dict.g
+                        : kind == AGNODE ? dd->dict.n
+                                         : dd->dict.e;
+  *count = dict == NULL ? 0 : (uint32_t)dtsize(dict);
+  Agsym_t **const syms = gv_calloc(*count, sizeof(Agsym_t *));
+  for (Agsym_t *sym = dict == NULL ? NULL : dtfirst(dict); sym != NULL;
+       sym = dtnext(dict, sym)) {
+    assert(sym->id >= 0 && (uint32_t)sym->id < *count);
+    syms[sym->id] = sym;
+  }
+  return syms;
+}
+
+/// write a subgraph and then its own subgraphs
+static void write_subgraph(writer_t *w, Agraph_t *subg, uint32_t parent) {
+  const uint32_t self = (uint32_t)graphs_size(&w->graphs);
+  graphs_append(&w->graphs, subg);
+  agxbuf *const b = &w->body;
+
+  put_u32(b, parent);
+  put_u32(b, intern_name(w, subg));
+
+  // attribute defaults set in this subgraph
+  Agdatadict_t *const dd = agdatadict(subg, false);
+  Dict_t *const dicts[] = {dd ? dd->dict.g : NULL, dd ? dd->dict.n : NULL,
+                           dd ? dd->dict.e : NULL};
+  uint32_t defaults = 0;
+  for (size_t k = 0; k < KINDS; ++k) {
+    if (dicts[k] != NULL) {
+      Dict_t *const view = dtview(dicts[k], NULL);
+      defaults += (uint32_t)dtsize(dicts[k]);
+      dtview(dicts[k], view);
+    }
+  }
+  put_u32(b, defaults);
+  for (size_t k = 0; k < KINDS; ++k) {
+    if (dicts[k] == NULL) {
+      continue;
+    }
+    Dict_t *const view = dtview(dicts[k], NULL);
+    for (Agsym_t *sym = dtfirst(dicts[k]); sym != NULL;
+         sym = dtnext(dicts[k], sym)) {
+      put_u8(b, (uint8_t)k);
+      put_u32(b, (uint32_t)sym->id);
+      put_u32(b, intern(w, sym->defval));
+    }
+    dtview(dicts[k], view);
+  }
+
+  put_u32(b, (uint32_t)agnnodes(subg));
+  for (Agnode_t *n = agfstnode(subg); n != NULL; n = agnxtnode(subg, n)) {
+    put_u32(b, index_of((void *const *)nodes_at(&w->nodes, 0),
+                        nodes_size(&w->nodes), n));
+  }
+  put_u32(b, (uint32_t)agnedges(subg));
+  for (Agnode_t *n = agfstnode(subg); n != NULL; n = agnxtnode(subg, n)) {
+    for (Agedge_t *e = agfstout(subg, n); e != NULL; e = agnxtout(subg, e)) {
+      put_u32(b, index_of((void *const *)edges_at(&w->edges, 0),
+                          edges_size(&w->edges), e));
+    }
+  }
+
+  for (Agraph_t *s = agfstsubg(subg); s != NULL; s = agnxtsubg(s)) {
+    write_subgraph(w, s, self);
+  }
+}
+
+/// count the subgraphs below a graph
+static uint32_t count_subgraphs(Agraph_t *g) {
+  uint32_t count = 0;
+  for (Agraph_t *s = agfstsubg(g); s != NULL; s = agnxtsubg(s)) {
+    count += 1 + count_subgraphs(s);
+  }
+  return count;
+}
+
+int agwritebin(Agraph_t *g, void *chan, agwritebin_f fn) {
+  writer_t w = {.g = g};
+  w.table = dtopen(&Entries, Dtprobe);
+  agxbuf *const b = &w.body;
+
+  put_u32(b, intern_name(&w, g));
+
+  Agsym_t **syms[KINDS];
+  uint32_t nsyms[KINDS];
+  for (size_t k = 0; k < KINDS; ++k) {
+    syms[k] = declarations(g, Kinds[k], &nsyms[k]);
+    put_u32(b, nsyms[k]);
+    for (uint32_t i = 0; i < nsyms[k]; ++i) {
+      put_u32(b, intern(&w, syms[k][i]->name));
+      put_u32(b, intern(&w, syms[k][i]->defval));
+      put_u8(b, (uint8_t)((syms[k][i]->print ? SYM_PRINT : 0) |
+                          (syms[k][i]->fixed ? SYM_FIXED : 0)));
+    }
+  }
+
+  // nodes come out of the root graph in sequence order already
+  put_u32(b, (uint32_t)agnnodes(g));
+  for (Agnode_t *n = agfstnode(g); n != NULL; n = agnxtnode(g, n)) {
+    nodes_append(&w.nodes, n);
+    put_u32(b, intern_name(&w, n));
+  }
+
+  // edges are grouped by tail, so sort them back into creation order
+  for (Agnode_t *n = agfstnode(g); n != NULL; n = agnxtnode(g, n)) {
+    for (Agedge_t *e = agfstout(g, n); e != NULL; e = agnxtout(g, e)) {
+      edges_append(&w.edges, e);
+    }
+  }
+  edges_sort(&w.edges, cmpedges);
+  put_u32(b, (uint32_t)edges_size(&w.edges));
+  for (size_t i = 0; i < edges_size(&w.edges); ++i) {
+    Agedge_t *const e = edges_get(&w.edges, i);
+    put_u32(b, index_of((void *const *)nodes_at(&w.nodes, 0),
+                        nodes_size(&w.nodes), agtail(e)));
+    put_u32(b, index_of((void *const *)nodes_at(&w.nodes, 0),
+                        nodes_size(&w.nodes), aghead(e)));
+    put_u32(b, intern_name(&w, e));
+  }
+
+  graphs_append(&w.graphs, g);
+  put_u32(b, count_subgraphs(g));
+  for (Agraph_t *s = agfstsubg(g); s != NULL; s = agnxtsubg(s)) {
+    write_subgraph(&w, s, 0);
+  }
+
+  // one column of values per attribute
+  for (size_t k = 0; k < KINDS; ++k) {
+    for (uint32_t i = 0; i < nsyms[k]; ++i) {
+      Agsym_t *const sym = syms[k][i];
+      if (Kinds[k] == AGRAPH) {
+        for (size_t j = 0; j < graphs_size(&w.graphs); ++j) {
+          put_u32(b, intern(&w, agxget(graphs_get(&w.graphs, j), sym)));
+        }
+      } else if (Kinds[k] == AGNODE) {
+        for (size_t j = 0; j < nodes_size(&w.nodes); ++j) {
+          put_u32(b, intern(&w, agxget(nodes_get(&w.nodes, j), sym)));
+        }
+      } else {
+        for (size_t j = 0; j < edges_size(&w.edges); ++j) {
+          put_u32(b, intern(&w, agxget(edges_get(&w.edges, j), sym)));
+        }
+      }
+    }
+    free(syms[k]);
+  }
+
+  agxbuf header = {0};
+  agxbput_n(&header, Magic, sizeof(Magic));
+  put_u32(&header, VERSION);
+  put_u32(&header, (agisdirected(g) ? FLAG_DIRECTED : 0) |
+                       (agisstrict(g) ? FLAG_STRICT : 0));
+  const size_t strings = agxblen(&w.strings);
+  const size_t body = agxblen(&w.body);
+  put_u64(&header, HEADER_SIZE + sizeof(uint32_t) + strings + body);
+  put_u32(&header, w.count);
+
+  const size_t hsize = agxblen(&header);
+  int rc = 0;
+  if (fn(chan, agxbuse(&header), hsize) != hsize ||
+      fn(chan, agxbuse(&w.strings), strings) != strings ||
+      fn(chan, agxbuse(&w.body), body) != body) {
+    rc = EOF;
+  }
+
+  agxbfree(&header);
+  agxbfree(&w.strings);
+  agxbfree(&w.body);
+  dtclose(w.table);
+  graphs_free(&w.graphs);
+  nodes_free(&w.nodes);
+  edges_free(&w.edges);
+  return rc;
+}
+
+// reading
+
+typedef struct {
+  const char *p;
+  const char *end;
+  bool ok; ///< has every read so far been in bounds?
+} cursor_t;
+
+static const unsigned char *take(cursor_t *c, size_t n) {
+  if (!c->ok || (size_t)(c->end - c->p) < n) {
+    c->ok = false;
+    return NULL;
+  }
+  const unsigned char *const p = (const unsigned char *)c->p;
+  c->p += n;
+  return p;
+}
+
+static uint8_t get_u8(cursor_t *c) {
+  const unsigned char *const p = take(c, 1);
+  return p == NULL ? 0 : p[0];
+}
+
+static uint32_t get_u32(cursor_t *c) {
+  const unsigned char *const p = take(c, 4);
+  if (p == NULL) {
+    return 0;
+  }
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+         (uint32_t)p[3] << 24;
+}
+
+static uint64_t get_u64(cursor_t *c) {
+  const uint64_t lo = get_u32(c);
+  return lo | (uint64_t)get_u32(c) << 32;
+}
+
+/// read a count of items of at least the given size each
+///
+/// Checking the count against the bytes left bounds allocations by the size
+/// of the input.
+static uint32_t get_count(cursor_t *c, size_t item) {
+  const uint32_t n = get_u32(c);
+  if ((size_t)(c->end - c->p) / item < n) {
+    c->ok = false;
+    return 0;
+  }
+  return n;
+}
+
+typedef struct {
+  Agraph_t *g;
+  cursor_t c;
+  uint32_t count;  ///< number of strings
+  char **strings;  ///< strings, in place or bound to the graph if HTML-like
+  bool *html;      ///< which strings are HTML-like
+  Agsym_t **syms[KINDS]; ///< symbols, by their index in the file
+  uint32_t nsyms[KINDS];
+  Agraph_t **graphs;
+  uint32_t ngraphs;
+  Agnode_t **nodes;
+  uint32_t nnodes;
+  Agedge_t **edges;
+  uint32_t nedges;
+} reader_t;
+
+/// read a string index, which may be `NONE`
+static char *get_string(reader_t *r) {
+  const uint32_t i = get_u32(&r->c);
+  if (i == NONE) {
+    return NULL;
+  }
+  if (i >= r->count) {
+    r->c.ok = false;
+    return NULL;
+  }
+  return r->strings[i];
+}
+
+/// read a string index, which must not be `NONE`
+static char *get_value(reader_t *r, bool *html) {
+  const uint32_t i = get_u32(&r->c);
+  if (i >= r->count) {
+    r->c.ok = false;
+    *html = false;
+    return NULL;
+  }
+  *html = r->html[i];
+  return r->strings[i];
+}
+
+/// read an index into an array
+static uint32_t get_index(reader_t *r, uint32_t size) {
+  const uint32_t i = get_u32(&r->c);
+  if (i >= size) {
+    r->c.ok = false;
+    return 0;
+  }
+  return i;
+}
+
+static bool read_declarations(reader_t *r) {
+  for (size_t k = 0; k < KINDS; ++k) {
+    r->nsyms[k] = get_count(&r->c, 9);
+    r->syms[k] = gv_calloc(r->nsyms[k], sizeof(Agsym_t *));
+    for (uint32_t i = 0; i < r->nsyms[k] && r->c.ok; ++i) {
+      char *const name = get_string(r);
+      bool html;
+      char *const def = get_value(r, &html);
+      const uint8_t flags = get_u8(&r->c);
+      if (!r->c.ok || name == NULL) {
+        return false;
+      }
+      Agsym_t *const sym = html ? agattr_html(r->g, Kinds[k], name, def)
+                                : agattr_text(r->g, Kinds[k], name, def);
+      // the graph may already hold declarations of its own, from the
+      // discipline or the command line, so a symbol need not have the index
+      // it had in the file
+      if (sym == NULL) {
+        return false;
+      }
+      sym->print = (flags & SYM_PRINT) != 0;
+      sym->fixed = (flags & SYM_FIXED) != 0;
+      r->syms[k][i] = sym;
+    }
+  }
+  return r->c.ok;
+}
+
+static bool read_objects(reader_t *r) {
+  r->nnodes = get_count(&r->c, 4);
+  r->nodes = gv_calloc(r->nnodes, sizeof(Agnode_t *));
+  for (uint32_t i = 0; i < r->nnodes && r->c.ok; ++i) {
+    if ((r->nodes[i] = agnode(r->g, get_string(r), 1)) == NULL) {
+      return false;
+    }
+  }
+
+  r->nedges = get_count(&r->c, 12);
+  r->edges = gv_calloc(r->nedges, sizeof(Agedge_t *));
+  agbulkbegin(r->g);
+  for (uint32_t i = 0; i < r->nedges && r->c.ok; ++i) {
+    const uint32_t t = get_index(r, r->nnodes);
+    const uint32_t h = get_index(r, r->nnodes);
+    char *const key = get_string(r);
+    if (!r->c.ok ||
+        (r->edges[i] = agedge(r->g, r->nodes[t], r->nodes[h], key, 1)) ==
+            NULL) {
+      agbulkcommit(r->g);
+      return false;
+    }
+  }
+  agbulkcommit(r->g);
+  return r->c.ok;
+}
+
+static bool read_subgraphs(reader_t *r) {
+  r->ngraphs = get_count(&r->c, 20);
+  r->graphs = gv_calloc((size_t)r->ngraphs + 1, sizeof(Agraph_t *));
+  r->graphs[0] = r->g;
+  for (uint32_t i = 1; i <= r->ngraphs && r->c.ok; ++i) {
+    // parents precede their subgraphs
+    const uint32_t parent = get_index(r, i);
+    char *const name = get_string(r);
+    if (!r->c.ok ||
+        (r->graphs[i] = agsubg(r->graphs[parent], name, 1)) == NULL) {
+      return false;
+    }
+    Agraph_t *const subg = r->graphs[i];
+
+    const uint32_t defaults = get_count(&r->c, 9);
+    for (uint32_t j = 0; j < defaults && r->c.ok; ++j) {
+      const uint8_t k = get_u8(&r->c);
+      if (k >= KINDS) {
+        return false;
+      }
+      const uint32_t id = get_index(r, r->nsyms[k]);
+      bool html;
+      char *const value = get_value(r, &html);
+      if (!r->c.ok) {
+        return false;
+      }
+      Agsym_t *const sym = r->syms[k][id];
+      if (html) {
+        agattr_html(subg, Kinds[k], sym->name, value);
+      } else {
+        agattr_text(subg, Kinds[k], sym->name, value);
+      }
+    }
+
+    const uint32_t nnodes = get_count(&r->c, 4);
+    for (uint32_t j = 0; j < nnodes && r->c.ok; ++j) {
+      const uint32_t n = get_index(r, r->nnodes);
+      if (r->c.ok) {
+        agsubnode(subg, r->nodes[n], 1);
+      }
+    }
+    const uint32_t nedges = get_count(&r->c, 4);
+    for (uint32_t j = 0; j < nedges && r->c.ok; ++j) {
+      const uint32_t e = get_index(r, r->nedges);
+      if (r->c.ok) {
+        agsubedge(subg, r->edges[e], 1);
+      }
+    }
+  }
+  return r->c.ok;
+}
+
+/// set one column of attribute values
+static bool read_column(reader_t *r, Agsym_t *sym, void **objs, uint32_t n) {
+  for (uint32_t i = 0; i < n; ++i) {
+    bool html;
+    char *const value = get_value(r, &html);
+    if (!r->c.ok) {
+      return false;
+    }
+    const char *const current = agxget(objs[i], sym);
+    if (strcmp(current, value) != 0 || !aghtmlstr(current) != !html) {
+      if (html) {
+        agxset_html(objs[i], sym, value);
+      } else {
+        agxset_text(objs[i], sym, value);
+      }
+    }
+  }
+  return true;
+}
+
+static bool read_columns(reader_t *r) {
+  for (size_t k = 0; k < KINDS; ++k) {
+    void **const objs = Kinds[k] == AGRAPH   ? (void **)r->graphs
+                        : Kinds[k] == AGNODE ? (void **)r->nodes
+                                             : (void **)r->edges;
+    const uint32_t n = Kinds[k] == AGRAPH   ? r->ngraphs + 1
+                       : Kinds[k] == AGNODE ? r->nnodes
+                                            : r->nedges;
+    for (uint32_t i = 0; i < r->nsyms[k]; ++i) {
+      if (!read_column(r, r->syms[k][i], objs, n)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/// read the header of a binary graph
+///
+/// @return Total size of the graph, or 0 if the header is malformed
+static uint64_t read_header(cursor_t *c, uint32_t *flags) {
+  if (!agisbin(c->p, (size_t)(c->end - c->p))) {
+    return 0;
+  }
+  (void)take(c, sizeof(Magic));
+  const uint32_t version = get_u32(c);
+  *flags = get_u32(c);
+  const uint64_t size = get_u64(c);
+  if (!c->ok || version != VERSION || size < HEADER_SIZE ||
+      size > (uint64_t)(c->end - c->p) + HEADER_SIZE) {
+    return 0;
+  }
+  c->end = c->p + (size - HEADER_SIZE);
+  return size;
+}
+
+Agraph_t *agmemreadbin(const char *data, size_t size, size_t *used,
+                       Agdisc_t *disc) {
+  reader_t r = {.c = {.p = data, .end = data + size, .ok = true}};
+  uint32_t flags = 0;
+  const uint64_t total = read_header(&r.c, &flags);
+  if (total == 0) {
+    agerrorf("malformed binary graph header\n");
+    return NULL;
+  }
+  if (used != NULL) {
+    *used = (size_t)total;
+  }
+
+  // find the strings, each of which is NUL-terminated in place
+  r.count = get_count(&r.c, 5);
+  r.strings = gv_calloc(r.count, sizeof(char *));
+  r.html = gv_calloc(r.count, sizeof(bool));
+  for (uint32_t i = 0; i < r.count && r.c.ok; ++i) {
+    const uint32_t len = get_u32(&r.c);
+    r.html[i] = (len & HTML_BIT) != 0;
+    const size_t n = len & ~HTML_BIT;
+    r.strings[i] = (char *)take(&r.c, n + 1);
+    if (r.strings[i] != NULL && r.strings[i][n] != '\0') {
+      r.c.ok = false;
+    }
+  }
+  const uint32_t root = get_u32(&r.c);
+  if (!r.c.ok || (root != NONE && root >= r.count)) {
+    free(r.strings);
+    free(r.html);
+    agerrorf("malformed binary graph\n");
+    return NULL;
+  }
+
+  Agdesc_t desc = {.directed = (flags & FLAG_DIRECTED) != 0,
+                   .strict = (flags & FLAG_STRICT) != 0,
+                   .maingraph = true};
+  r.g = agopen(root == NONE ? NULL : r.strings[root], desc,
+               disc ? disc : &AgDefaultDisc);
+
+  // Other strings are copied into the graph as they are used. HTML-like ones
+  // are bound up front, so names taken from them stay HTML-like.
+  for (uint32_t i = 0; r.g != NULL && i < r.count; ++i) {
+    if (r.html[i]) {
+      r.strings[i] = agstrdup_html(r.g, r.strings[i]);
+    }
+  }
+
+  const bool ok = r.g != NULL && read_declarations(&r) && read_objects(&r) &&
+                  read_subgraphs(&r) && read_columns(&r);
+
+  if (r.g != NULL) {
+    aginternalmapclearlocalnames(r.g);
+    for (uint32_t i = 0; i < r.count; ++i) {
+      if (r.html[i]) {
+        agstrfree(r.g, r.strings[i], true);
+      }
+    }
+  }
+  free(r.strings);
+  free(r.html);
+  for (size_t k = 0; k < KINDS; ++k) {
+    free(r.syms[k]);
+  }
+  free(r.graphs);
+  free(r.nodes);
+  free(r.edges);
+
+  if (!ok) {
+    if (r.g != NULL) {
+      agclose(r.g);
+      agerrorf("malformed binary graph\n");
+    }
+    return NULL;
+  }
+  return r.g;
+}
+
+Agraph_t *agbinread(rdr_t *rdr, Agdisc_t *disc) {
+  const char *const data = rdr->data + rdr->cur;
+  const size_t size = rdr->len - rdr->cur;
+  if (!agisbin(data, size)) {
+    return NULL;
+  }
+  size_t used = 0;
+  Agraph_t *const g = agmemreadbin(data, size, &used, disc);
+  // skip a malformed graph, or the rest of the input if it is cut short
+  rdr->cur += used == 0 ? size : used;
+  return g;
+}
@@ -116,6 +116,16 @@ int aagparse(aagscan_t scanner);
 void aglexeof(aagscan_t yyscanner);
 void aglexbad(aagscan_t yyscanner);
 
+/// parse a flat graph held in memory, see flatread.c
+///
+/// @param data Input, which need not be NUL-terminated
+/// @param size Number of bytes of input
+/// @param used [out] Number of bytes read, through the line closing the graph
+/// @param disc Discipline for the new graph, or `NULL` for the default
+/// @return The new graph, or `NULL` if the input is not a flat graph
+CGHDR_API Agraph_t *agflatparse(const char *data, size_t size, size_t *used,
+                                Agdisc_t *disc);
+
 	/* ID management */
 int agmapnametoid(Agraph_t *g, int objtype, char *str, IDTYPE *result,
                   bool createflag);
@@ -133,6 +143,20 @@ void agregister(Agraph_t * g, int objtype, void *obj);
 void agedgesetop(Agraph_t * g, Agedge_t * e, int insertion);
 void agdelnodeimage(Agraph_t *g, Agobj_t *node, void *ignored);
 void agdeledgeimage(Agraph_t *g, Agobj_t *edge, void *ignored);
+/// index edges deferred by @ref agbulkbegin into the root graph’s edge sets
+void agbulkflush(Agraph_t *g);
+/// release bulk load state, on closing the root graph
+///
+/// Edges still deferred are forgotten, not indexed. They stay allocated in the
+/// graph's arena until it is released.
+void agbulkfree(Agraph_t *g);
+/// discard the arrays of a graph frozen by @ref agfreeze without restoring its
+/// edge sets, on closing the graph
+void agfrozenclose(Agraph_t *g);
+/// number of out- or in-edges of a node in a frozen graph
+int agfrozendegree(Agraph_t *g, Agnode_t *n, bool out);
+/// empty the edge sets of a subgraph, freeing the holders of its edges
+void agsubedgesfree(Agraph_t *g);
 /// rename an object
 ///
 /// @param obj Target to rename
@@ -403,6 +403,15 @@ CGRAPH_API int agpopdisc(Agraph_t *g, Agcbdisc_t *disc);
 
 /// @}
 
+/// opaque type; the definition of this is internal to Graphviz
+struct graphviz_edge_bulk;
+
+/// opaque type; the definition of this is internal to Graphviz
+struct graphviz_attr_store;
+
+/// opaque type; the definition of this is internal to Graphviz
+struct graphviz_arena;
+
 /// shared resources for Agraph_s
 struct Agclos_s {
   Agdisc_t disc;    /* resource discipline functions */
@@ -412,11 +421,17 @@ struct Agclos_s {
   Agcbstack_t *cb;  /* user and system callback function stacks */
   Dict_t *lookup_by_name[3];
   Dict_t *lookup_by_id[3];
+  struct graphviz_edge_bulk *bulk; ///< pending bulk load, see @ref agbulkbegin
+  struct graphviz_attr_store *attrs; ///< attribute values of all objects
+  struct graphviz_arena *arena; ///< memory of nodes, edges and records
 };
 
 /// opaque type; the definition of this is internal to Graphviz
 struct graphviz_node_set;
 
+/// opaque type; the definition of this is internal to Graphviz
+struct graphviz_frozen_edges;
+
 /// graph or subgraph
 struct Agraph_s {
   Agobj_t base;
@@ -429,6 +444,8 @@ struct Agraph_s {
   Dict_t *g_seq, *g_id;           ///< subgraphs - descendants
   Agraph_t *parent, *root;        ///< subgraphs - ancestors
   Agclos_t *clos;                 ///< shared resources
+  struct graphviz_frozen_edges *e_frozen; ///< compact edge sets, see
+                                          ///< @ref agfreeze
 };
 
 /* graphs */
@@ -468,6 +485,39 @@ CGRAPH_API Agraph_t *agconcat(Agraph_t *g, const char *filename, void *chan,
  */
 
 CGRAPH_API int agwrite(Agraph_t *g, void *chan);
+
+/// writes **size** bytes of a binary graph to **chan**, returning how many were
+/// written
+typedef size_t (*agwritebin_f)(void *chan, const char *data, size_t size);
+
+/** @brief writes **g** in the binary graph format
+ *
+ * The binary format holds everything @ref agwrite would: attribute
+ * declarations and values, nodes, edges with their keys, and subgraphs with
+ * their members and attribute defaults. Strings are stored once each and
+ * referred to by index, and reading the result back with @ref agmemreadbin
+ * or @ref agread involves no parsing, so it suits caching graphs, including
+ * laid-out ones, that are to be reloaded many times.
+ *
+ * @param chan Channel passed on to **write**
+ * @param write Callback taking the output
+ * @return 0 on success, `EOF` on failure
+ */
+CGRAPH_API int agwritebin(Agraph_t *g, void *chan, agwritebin_f write);
+
+/** @brief reads a graph written by @ref agwritebin from memory
+ *
+ * @ref agread also recognizes the binary format, when reading a seekable file
+ * through the default I/O discipline.
+ *
+ * @param data Start of the graph
+ * @param size Number of bytes available at **data**
+ * @param used [out] Optional number of bytes the graph took up
+ * @param disc Discipline for the new graph, or `NULL` for the default
+ * @return The new graph, or `NULL` if **data** is not a well-formed graph
+ */
+CGRAPH_API Agraph_t *agmemreadbin(const char *data, size_t size, size_t *used,
+                                  Agdisc_t *disc);
 CGRAPH_API int agisdirected(Agraph_t *g);
 CGRAPH_API int agisundirected(Agraph_t *g);
 CGRAPH_API int agisstrict(Agraph_t *g);
@@ -524,6 +574,46 @@ CGRAPH_API Agedge_t *agnxtout(Agraph_t *g, Agedge_t *e);
 CGRAPH_API Agedge_t *agfstedge(Agraph_t *g, Agnode_t *n);
 CGRAPH_API Agedge_t *agnxtedge(Agraph_t *g, Agedge_t *e, Agnode_t *n);
 CGRAPH_API int agdeledge(Agraph_t *g, Agedge_t *arg_e);
+
+/** @brief starts a bulk load of edges into the root graph of **g**
+ *
+ * Until the matching @ref agbulkcommit, anonymous edges created by @ref agedge
+ * in a non-strict root graph are appended to a pending list instead of being
+ * inserted one at a time into the per-node edge sets. The pending edges are
+ * sorted and indexed in one pass when the load is committed.
+ *
+ * Deferral is transparent: any operation that looks at the edge sets (edge
+ * traversal, lookup, degree, deletion, subgraph edges) indexes pending edges
+ * first. Loads nest; only the outermost @ref agbulkcommit ends deferral.
+ */
+CGRAPH_API void agbulkbegin(Agraph_t *g);
+
+/// indexes edges appended since @ref agbulkbegin and ends one level of bulk
+/// load
+CGRAPH_API void agbulkcommit(Agraph_t *g);
+
+/** @brief freezes the edge sets of **g** into compact arrays
+ *
+ * While a graph is frozen, @ref agfstout, @ref agnxtout, @ref agfstin,
+ * @ref agnxtin, edge lookup and degree queries read per-node arrays of edges
+ * instead of walking the edge dictionaries, so visiting edges is a linear scan.
+ * For a subgraph, the dictionaries themselves are released while it is frozen,
+ * which saves several words per edge. A root graph's edge sets are threaded
+ * through the edges themselves and stay in place, so freezing a root graph
+ * costs the memory of the arrays on top of them and saves none.
+ *
+ * Traversing a frozen graph does not modify it, so several threads may read
+ * one frozen graph at the same time as long as none of them changes it.
+ *
+ * Freezing suits graphs that are read far more than they are changed. Adding
+ * or deleting an edge of a frozen graph, or reordering its nodes with
+ * @ref agnodebefore, implicitly thaws it. Freezing a graph does not freeze its
+ * subgraphs.
+ */
+CGRAPH_API void agfreeze(Agraph_t *g);
+
+/// restores the edge sets of a graph frozen by @ref agfreeze
+CGRAPH_API void agthaw(Agraph_t *g);
 /// @}
 
 /// @addtogroup cgraph_object
@@ -639,8 +729,9 @@ CGRAPH_API char *agcanonStr(char *str); /* manages its own buf */
 /// string attribute container
 struct Agattr_s { /* dynamic string attributes */
   Agrec_t h;      /* common data header */
-  Dict_t *dict;   ///< shared dict of Agsym_s to interpret Agattr_s.str
-  char **str;     ///< the attribute string values indexed by Agsym_s.id
+  Dict_t *dict;   ///< shared dict of Agsym_s describing the object’s values
+  size_t slot;    ///< index of the object’s values in the root graph’s
+                  ///< attribute columns
 };
 
 /// @brief string attribute descriptor
@@ -649,7 +740,7 @@ struct Agsym_s {
   Dtlink_t link;
   char *name;          /* attribute's name */
   char *defval;        /* its default value for initialization */
-  int id;              ///< index in Agattr_s.str
+  int id;              ///< index of the attribute’s column
   unsigned char kind;  /* referent object type */
   unsigned char fixed; /* immutable value */
   unsigned char print; /* always print */
@@ -776,6 +867,28 @@ CGRAPH_API int agxset(void *obj, Agsym_t *sym, const char *value);
 CGRAPH_API int agxset_text(void *obj, Agsym_t *sym, const char *value);
 CGRAPH_API int agxset_html(void *obj, Agsym_t *sym, const char *value);
 
+/// @brief a parsed form of an attribute value, kept alongside the value
+///
+/// cgraph zeroes it whenever the value it belongs to changes. Code that parses
+/// values, like numbers read during layout, can keep its result here and so
+/// parse each value of each object once.
+typedef struct {
+  double number;     ///< the value, as parsed
+  unsigned char how; ///< caller’s code for how it was parsed, 0 if unparsed
+  char radix;        ///< decimal point of the locale it was parsed in
+} Agparsed_t;
+
+CGRAPH_API Agparsed_t *agxparsed(void *obj, Agsym_t *sym, char **value);
+///< @brief the parsed form kept with an object’s value of an attribute
+///
+/// Objects that have the default of the attribute share the parsed form of
+/// that default. The pointer is valid until attributes of the graph are next
+/// declared or set, or objects are next created.
+///
+/// @param obj Object whose value to find
+/// @param sym Attribute of the value
+/// @param value [out] The value, as @ref agxget would return it
+
 CGRAPH_API int agsafeset_text(void *obj, char *name, const char *value,
                               const char *def);
 ///< @brief set an attribute’s value and default, ensuring it is declared before
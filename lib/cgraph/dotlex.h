@@ -0,0 +1,305 @@
+/// @file
+/// @brief lexer for flat DOT graphs held in memory
+/// @ingroup cgraph_core
+///
+/// This reads the subset of DOT that @ref agflatparse accepts, without calling
+/// into cgraph: names, numbers, quoted and HTML-like strings, edge operators,
+/// keywords and punctuation, between white space and comments. Tokens are lexed
+/// the way scan.l lexes them. It is shared by cgraph's fast path and by
+/// readers, like `SparseMatrix_import_stream`, that never build a graph.
+///
+/// Lexing stops at the end of the buffer given. A token that runs into the end
+/// may have been cut short, which `dotlex_t.cut` tells, so a caller reading
+/// input a window at a time should lex such a token again once more input is
+/// in the window.
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <util/alloc.h>
+#include <util/gv_ctype.h>
+
+/// tokens of the flat subset, besides punctuation characters
+enum {
+  TOK_ERROR = 256, ///< anything outside the flat subset
+  TOK_EOF,
+  TOK_ID,     ///< name or number
+  TOK_QID,    ///< quoted or HTML-like string
+  TOK_EDGEOP, ///< `->` in a directed graph, `--` in an undirected one
+  TOK_STRICT,
+  TOK_GRAPH,
+  TOK_DIGRAPH,
+  TOK_NODE,
+  TOK_EDGE,
+};
+
+/// NUL-terminated strings of tokens, back to back
+typedef struct {
+  char *data;
+  size_t size;
+  size_t capacity;
+} dotlex_strings_t;
+
+static inline void dotlex_strings_put(dotlex_strings_t *s, const char *src,
+                                      size_t n) {
+  if (s->capacity - s->size < n) {
+    size_t c = s->capacity == 0 ? 4096 : s->capacity * 2;
+    if (c - s->size < n) {
+      c = s->size + n;
+    }
+    s->data = gv_realloc(s->data, s->capacity, c);
+    s->capacity = c;
+  }
+  memcpy(s->data + s->size, src, n);
+  s->size += n;
+}
+
+static inline void dotlex_strings_putc(dotlex_strings_t *s, char c) {
+  dotlex_strings_put(s, &c, 1);
+}
+
+/// lexer state
+typedef struct {
+  const char *data;
+  size_t size;
+  size_t pos;               ///< read position
+  size_t start;             ///< start of the last token
+  bool directed;            ///< which edge operator is valid
+  dotlex_strings_t strings; ///< strings of the tokens read so far
+  size_t str;               ///< string of the last `TOK_ID` or `TOK_QID`
+  bool html;                ///< is it an HTML-like string?
+  bool cut;                 ///< might more input change the last token?
+} dotlex_t;
+
+/// a byte of input, or NUL past the end
+static inline int dotlex_peek(const dotlex_t *s, size_t pos) {
+  return pos < s->size ? (unsigned char)s->data[pos] : '\0';
+}
+
+/// can a name start with this byte?
+static inline bool dotlex_is_letter(int c) {
+  return gv_isalpha(c) || c == '_' || c >= 0200;
+}
+
+static inline bool dotlex_is_namechar(int c) {
+  return dotlex_is_letter(c) || gv_isdigit(c);
+}
+
+/// skip whitespace and comments
+///
+/// An unterminated `/*` comment is left for @ref dotlex to reject.
+static inline void dotlex_skip(dotlex_t *s) {
+  const char *const d = s->data;
+  while (s->pos < s->size) {
+    const int c = dotlex_peek(s, s->pos);
+    const int n = dotlex_peek(s, s->pos + 1);
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+      ++s->pos;
+    } else if (c == '/' && n == '*') {
+      size_t p = s->pos + 2;
+      while (p < s->size && !(d[p] == '*' && dotlex_peek(s, p + 1) == '/')) {
+        ++p;
+      }
+      if (p >= s->size) {
+        s->cut = true;
+        return;
+      }
+      s->pos = p + 2;
+    } else if ((c == '/' && n == '/') || c == '#') {
+      // `#` lines may also be line directives, which only affect messages
+      const char *const nl = memchr(d + s->pos, '\n', s->size - s->pos);
+      s->pos = nl == NULL ? s->size : (size_t)(nl - d);
+    } else if (c == 0xef && n == 0xbb && dotlex_peek(s, s->pos + 2) == 0xbf &&
+               !dotlex_is_namechar(dotlex_peek(s, s->pos + 3))) {
+      // a byte order mark, unless it starts a longer name
+      s->pos += 3;
+    } else {
+      return;
+    }
+  }
+}
+
+/// does the input from `p` of length `n` match a keyword, in any case?
+static inline bool dotlex_keyword(const char *p, size_t n, const char *word) {
+  if (strlen(word) != n) {
+    return false;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    if (gv_tolower(p[i]) != word[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// store the string of a token, terminated by a NUL
+static inline void dotlex_store(dotlex_t *s, const char *src, size_t n,
+                                bool html) {
+  s->str = s->strings.size;
+  s->html = html;
+  dotlex_strings_put(&s->strings, src, n);
+  dotlex_strings_putc(&s->strings, '\0');
+}
+
+/// lex the body of a quoted string, the way scan.l does
+static inline int dotlex_quoted(dotlex_t *s) {
+  const char *const d = s->data;
+  s->str = s->strings.size;
+  s->html = false;
+  for (size_t p = s->pos + 1;;) {
+    size_t q = p;
+    while (q < s->size && d[q] != '"' && d[q] != '\\') {
+      ++q;
+    }
+    dotlex_strings_put(&s->strings, d + p, q - p);
+    if (q >= s->size) {
+      s->cut = true;
+      return TOK_ERROR;
+    }
+    if (d[q] == '"') {
+      s->pos = q + 1;
+      break;
+    }
+    const int n = dotlex_peek(s, q + 1);
+    if (n == '"') {
+      dotlex_strings_putc(&s->strings, '"');
+      p = q + 2;
+    } else if (n == '\\') {
+      dotlex_strings_put(&s->strings, "\\\\", 2);
+      p = q + 2;
+    } else if (n == '\n') {
+      p = q + 2;
+    } else {
+      dotlex_strings_putc(&s->strings, '\\');
+      p = q + 1;
+    }
+  }
+  dotlex_strings_putc(&s->strings, '\0');
+  return TOK_QID;
+}
+
+/// lex the body of an HTML-like string, which may nest `<` and `>`
+static inline int dotlex_html(dotlex_t *s) {
+  const char *const d = s->data;
+  int nest = 1;
+  size_t p = s->pos + 1;
+  for (; p < s->size; ++p) {
+    if (d[p] == '<') {
+      ++nest;
+    } else if (d[p] == '>' && --nest == 0) {
+      break;
+    }
+  }
+  if (p >= s->size) {
+    s->cut = true;
+    return TOK_ERROR;
+  }
+  dotlex_store(s, d + s->pos + 1, p - s->pos - 1, true);
+  s->pos = p + 1;
+  return TOK_QID;
+}
+
+/// lex a number, rejecting any the grammar would warn is badly delimited
+static inline int dotlex_number(dotlex_t *s) {
+  size_t p = s->pos;
+  if (dotlex_peek(s, p) == '-') {
+    ++p;
+  }
+  if (gv_isdigit(dotlex_peek(s, p))) {
+    while (gv_isdigit(dotlex_peek(s, p))) {
+      ++p;
+    }
+    if (dotlex_peek(s, p) == '.') {
+      ++p;
+      while (gv_isdigit(dotlex_peek(s, p))) {
+        ++p;
+      }
+    }
+  } else if (dotlex_peek(s, p) == '.' && gv_isdigit(dotlex_peek(s, p + 1))) {
+    p += 2;
+    while (gv_isdigit(dotlex_peek(s, p))) {
+      ++p;
+    }
+  } else {
+    s->cut = p + 1 >= s->size;
+    return TOK_ERROR;
+  }
+  if (dotlex_peek(s, p) == '.' || dotlex_is_letter(dotlex_peek(s, p))) {
+    return TOK_ERROR;
+  }
+  dotlex_store(s, s->data + s->pos, p - s->pos, false);
+  s->pos = p;
+  s->cut = p >= s->size;
+  return TOK_ID;
+}
+
+/// read the next token
+///
+/// @return A `TOK_*` value, or the character of a punctuation token
+static inline int dotlex(dotlex_t *s) {
+  s->cut = false;
+  dotlex_skip(s);
+  s->start = s->pos;
+  if (s->pos >= s->size) {
+    s->cut = true;
+    return TOK_EOF;
+  }
+
+  const char *const d = s->data;
+  const int c = dotlex_peek(s, s->pos);
+  const int n = dotlex_peek(s, s->pos + 1);
+
+  if (dotlex_is_letter(c)) {
+    size_t p = s->pos + 1;
+    while (dotlex_is_namechar(dotlex_peek(s, p))) {
+      ++p;
+    }
+    const char *const name = d + s->pos;
+    const size_t len = p - s->pos;
+    s->pos = p;
+    s->cut = p >= s->size;
+    if (dotlex_keyword(name, len, "node")) {
+      return TOK_NODE;
+    }
+    if (dotlex_keyword(name, len, "edge")) {
+      return TOK_EDGE;
+    }
+    if (dotlex_keyword(name, len, "graph")) {
+      return TOK_GRAPH;
+    }
+    if (dotlex_keyword(name, len, "digraph")) {
+      return TOK_DIGRAPH;
+    }
+    if (dotlex_keyword(name, len, "strict")) {
+      return TOK_STRICT;
+    }
+    if (dotlex_keyword(name, len, "subgraph")) {
+      return TOK_ERROR;
+    }
+    dotlex_store(s, name, len, false);
+    return TOK_ID;
+  }
+
+  if (c == '-' && (n == '>' || n == '-')) {
+    s->pos += 2;
+    return (n == '>') == s->directed ? TOK_EDGEOP : TOK_ERROR;
+  }
+  if (c == '-' || c == '.' || gv_isdigit(c)) {
+    return dotlex_number(s);
+  }
+  if (c == '"') {
+    return dotlex_quoted(s);
+  }
+  if (c == '<') {
+    return dotlex_html(s);
+  }
+  if (strchr("{}[]=;,:+", c) != NULL && c != '\0') {
+    ++s->pos;
+    return c;
+  }
+  // a `/` may start a comment, which may have run into the end
+  s->cut = s->cut || s->pos + 1 >= s->size;
+  return TOK_ERROR;
+}
@@ -14,20 +14,179 @@
  *************************************************************************/
 
 #include <assert.h>
+#include <cgraph/arena.h>
 #include <cgraph/cghdr.h>
 #include <cgraph/node_set.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <util/alloc.h>
+#include <util/list.h>
 #include <util/unused.h>
 
+/// an edge whose insertion into the root graph’s edge sets is deferred
+///
+/// The endpoint keys are copied while the endpoints are still in cache, so
+/// sorting at commit time does not have to revisit every node.
+typedef struct {
+  Agedge_t *e;     ///< out-edge half
+  uint64_t seq[2]; ///< sequence numbers of tail and head
+  IDTYPE id[2];    ///< IDs of tail and head
+} bulk_edge_t;
+
+DEFINE_LIST(bulk_edges, bulk_edge_t)
+
+/// state of a bulk load, see @ref agbulkbegin
+struct graphviz_edge_bulk {
+  bulk_edges_t pending; ///< edges not yet in the root graph’s edge sets
+  size_t depth;         ///< nesting level of @ref agbulkbegin calls
+};
+
+/// compact, read-only edge sets of a graph, see @ref agfreeze
+///
+/// Every node of the graph has a slot. The out-edges of slot `i` are
+/// `out[out_start[i]]` … `out[out_start[i + 1] - 1]`, in the same order as
+/// the edge set they replace, and likewise for in-edges.
+struct graphviz_frozen_edges {
+  size_t n;          ///< number of slots
+  uint64_t *seqs;    ///< sorted node sequence numbers, or `NULL` if slots are
+                     ///< sequence numbers themselves (root graphs)
+  size_t *out_start; ///< `n + 1` offsets into `out`
+  size_t *in_start;  ///< `n + 1` offsets into `in`
+  Agedge_t **out;    ///< out-edge halves
+  Agedge_t **in;     ///< in-edge halves
+};
+typedef struct graphviz_frozen_edges frozen_t;
+
+/// find the slot of a node
+static bool frozen_slot(const frozen_t *f, const Agnode_t *n, size_t *slot) {
+  const uint64_t seq = AGSEQ(n);
+  if (f->seqs == NULL) {
+    *slot = (size_t)seq;
+    return seq < f->n;
+  }
+  size_t lo = 0, hi = f->n;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if (f->seqs[mid] < seq) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  *slot = lo;
+  return lo < f->n && f->seqs[lo] == seq;
+}
+
+/// find the range of out- or in-edges of a node
+static bool frozen_range(const frozen_t *f, const Agnode_t *n, bool out,
+                         size_t *begin, size_t *end) {
+  size_t slot;
+  if (!frozen_slot(f, n, &slot))
+    return false;
+  const size_t *start = out ? f->out_start : f->in_start;
+  *begin = start[slot];
+  *end = start[slot + 1];
+  return *begin < *end;
+}
+
+/// first index in `[begin, end)` not ordered before the given key
+static size_t frozen_lower_bound(Agedge_t **edges, size_t begin, size_t end,
+                                 uint64_t node_seq, uint64_t edge_seq) {
+  while (begin < end) {
+    const size_t mid = begin + (end - begin) / 2;
+    const uint64_t s = AGSEQ(edges[mid]->node);
+    if (s < node_seq || (s == node_seq && AGSEQ(edges[mid]) < edge_seq)) {
+      begin = mid + 1;
+    } else {
+      end = mid;
+    }
+  }
+  return begin;
+}
+
+/// where the calling thread last stepped through a frozen edge array
+///
+/// Frozen graphs are only read, so several threads may walk one at once. Each
+/// keeps its own hint, and a hint that does not name the edge being stepped
+/// from is ignored in favour of looking the edge up.
+static _Thread_local struct {
+  Agedge_t *const *edges; ///< `out` or `in` of the frozen graph last walked
+  size_t size;            ///< length of `edges`
+  size_t at;              ///< index of the edge last returned
+} frozen_hint;
+
+static Agedge_t *frozen_first(const frozen_t *f, Agnode_t *n, bool out) {
+  size_t begin, end;
+  if (!frozen_range(f, n, out, &begin, &end))
+    return NULL;
+  Agedge_t **edges = out ? f->out : f->in;
+  frozen_hint.edges = edges;
+  frozen_hint.size = (out ? f->out_start : f->in_start)[f->n];
+  frozen_hint.at = begin;
+  return edges[begin];
+}
+
+static Agedge_t *frozen_next(const frozen_t *f, Agedge_t *e, bool out) {
+  Agedge_t **edges = out ? f->out : f->in;
+  const size_t size = (out ? f->out_start : f->in_start)[f->n];
+  size_t at = frozen_hint.at;
+  // the common case is stepping on from the edge this thread last visited
+  if (frozen_hint.edges != edges || frozen_hint.size != size || at >= size ||
+      edges[at] != e) {
+    size_t begin, end;
+    if (!frozen_range(f, out ? AGTAIL(e) : AGHEAD(e), out, &begin, &end))
+      return NULL;
+    at = frozen_lower_bound(edges, begin, end, AGSEQ(e->node), AGSEQ(e));
+  }
+  // ranges are contiguous, so the next edge is in this range if it shares the
+  // node this one is an out- or in-edge of
+  if (at + 1 >= size)
+    return NULL;
+  Agedge_t *next = edges[at + 1];
+  if (out ? AGTAIL(next) != AGTAIL(e) : AGHEAD(next) != AGHEAD(e))
+    return NULL;
+  frozen_hint.edges = edges;
+  frozen_hint.size = size;
+  frozen_hint.at = at + 1;
+  return next;
+}
+
+/// search the in-edges of `h` for one from `t` matching `key`
+static Agedge_t *frozen_find(const frozen_t *f, Agnode_t *t, Agnode_t *h,
+                             Agtag_t key) {
+  size_t begin, end;
+  if (!frozen_range(f, h, false, &begin, &end))
+    return NULL;
+  for (size_t i = frozen_lower_bound(f->in, begin, end, AGSEQ(t), 0);
+       i < end && f->in[i]->node == t; ++i) {
+    if (key.objtype == 0 || AGID(f->in[i]) == key.id)
+      return f->in[i];
+  }
+  return NULL;
+}
+
+static void frozen_free(frozen_t *f) {
+  if (f == NULL)
+    return;
+  free(f->seqs);
+  free(f->out_start);
+  free(f->in_start);
+  free(f->out);
+  free(f->in);
+  free(f);
+}
+
 /* return first outedge of <n> */
 Agedge_t *agfstout(Agraph_t * g, Agnode_t * n)
 {
     Agsubnode_t *sn;
     Agedge_t *e = NULL;
 
+    agbulkflush(g);
+    if (g->e_frozen != NULL)
+	return frozen_first(g->e_frozen, n, true);
     sn = agsubrep(g, n);
     if (sn) {
 		dtrestore(g->e_seq, sn->out_seq);
@@ -44,6 +203,9 @@ Agedge_t *agnxtout(Agraph_t * g, Agedge_t * e)
     Agsubnode_t *sn;
     Agedge_t *f = NULL;
 
+    agbulkflush(g);
+    if (g->e_frozen != NULL)
+	return frozen_next(g->e_frozen, e, true);
     n = AGTAIL(e);
     sn = agsubrep(g, n);
     if (sn) {
@@ -59,6 +221,9 @@ Agedge_t *agfstin(Agraph_t * g, Agnode_t * n)
     Agsubnode_t *sn;
     Agedge_t *e = NULL;
 
+    agbulkflush(g);
+    if (g->e_frozen != NULL)
+	return frozen_first(g->e_frozen, n, false);
     sn = agsubrep(g, n);
 	if (sn) {
 		dtrestore(g->e_seq, sn->in_seq);
@@ -74,6 +239,9 @@ Agedge_t *agnxtin(Agraph_t * g, Agedge_t * e)
     Agsubnode_t *sn;
     Agedge_t *f = NULL;
 
+    agbulkflush(g);
+    if (g->e_frozen != NULL)
+	return frozen_next(g->e_frozen, e, false);
     n = AGHEAD(e);
     sn = agsubrep(g, n);
 	if (sn) {
@@ -122,6 +290,9 @@ static Agedge_t *agfindedge_by_key(Agraph_t * g, Agnode_t * t, Agnode_t * h,
 
     if (t == NULL || h == NULL)
 	return NULL;
+    agbulkflush(g);
+    if (g->e_frozen != NULL)
+	return frozen_find(g->e_frozen, t, h, key);
     template.base.tag = key;
     template.node = t;		/* guess that fan-in < fan-out */
     sn = agsubrep(g, h);
@@ -173,6 +344,7 @@ static void installedge(Agraph_t * g, Agedge_t * e)
     h = aghead(e);
     while (g) {
 	if (agfindedge_by_key(g, t, h, AGTAG(e))) break;
+	agthaw(g);
 	sn = agsubrep(g, t);
 	ins(g->e_seq, &sn->out_seq, out);
 	ins(g->e_id, &sn->out_id, out);
@@ -183,6 +355,253 @@ static void installedge(Agraph_t * g, Agedge_t * e)
     }
 }
 
+/// an edge half awaiting insertion into its owner’s edge sets
+typedef struct {
+    uint64_t owner;   ///< sequence number of the node whose sets receive `e`
+    uint64_t other;   ///< sequence number or ID of `e->node`
+    uint64_t self;    ///< sequence number or ID of `e`
+    IDTYPE other_id;  ///< ID of `e->node`
+    Agedge_t *e;
+} bulk_key_t;
+
+static int bulk_key_cmp(const void *a, const void *b) {
+    const bulk_key_t *x = a;
+    const bulk_key_t *y = b;
+    if (x->owner != y->owner) return x->owner < y->owner ? -1 : 1;
+    if (x->other != y->other) return x->other < y->other ? -1 : 1;
+    if (x->self != y->self) return x->self < y->self ? -1 : 1;
+    return 0;
+}
+
+/// chain sorted edges into a right-leaning vine, which cdt accepts as a tree
+static Dtlink_t *bulk_vine(const bulk_key_t *keys, size_t n, bool by_id) {
+    Dtlink_t *head = NULL;
+    for (size_t i = n; i-- > 0; ) {
+	Dtlink_t *link = by_id ? &keys[i].e->id_link : &keys[i].e->seq_link;
+	link->right = head;
+	link->hl._left = NULL;
+	head = link;
+    }
+    return head;
+}
+
+/// add a sorted run of edge halves to one of a node’s edge sets
+static void bulk_insert(Dict_t *d, Dtlink_t **set, const bulk_key_t *keys,
+                        size_t n, bool by_id) {
+    if (*set == NULL) {
+	*set = bulk_vine(keys, n, by_id);
+	return;
+    }
+    for (size_t i = 0; i < n; ++i)
+	ins(d, set, keys[i].e);
+}
+
+/// group edge halves by owner, keeping their order within each group
+///
+/// Owners are node sequence numbers, so when the batch is large relative to
+/// the number of nodes a counting sort replaces a full comparison sort.
+static void bulk_group(bulk_key_t **keys, bulk_key_t **scratch, size_t n,
+                       uint64_t max_owner) {
+    if (max_owner / 4 > n) {
+	qsort(*keys, n, sizeof((*keys)[0]), bulk_key_cmp);
+	return;
+    }
+    size_t *start = gv_calloc(max_owner + 2, sizeof(start[0]));
+    for (size_t i = 0; i < n; ++i)
+	++start[(*keys)[i].owner + 1];
+    for (uint64_t i = 1; i <= max_owner + 1; ++i)
+	start[i] += start[i - 1];
+    for (size_t i = 0; i < n; ++i)
+	(*scratch)[start[(*keys)[i].owner]++] = (*keys)[i];
+    free(start);
+    bulk_key_t *t = *keys;
+    *keys = *scratch;
+    *scratch = t;
+}
+
+/// index one half (out or in) of every pending edge in the root graph
+static void bulk_install(Agraph_t *root, const bulk_edges_t *pending,
+                         bulk_key_t **keys, bulk_key_t **scratch, bool out) {
+    const size_t n = bulk_edges_size(pending);
+    const int side = out ? 0 : 1; // index of the owning endpoint
+    // agnodebefore can number nodes past the sequence counter, so the largest
+    // owner is taken from the keys
+    uint64_t max_owner = 0;
+    for (size_t i = 0; i < n; ++i) {
+	const bulk_edge_t p = bulk_edges_get(pending, i);
+	Agedge_t *e = out ? p.e : AGOUT2IN(p.e);
+	(*keys)[i] = (bulk_key_t){.owner = p.seq[side],
+	                          .other = p.seq[1 - side], .self = AGSEQ(e),
+	                          .other_id = p.id[1 - side], .e = e};
+	if (p.seq[side] > max_owner)
+	    max_owner = p.seq[side];
+    }
+    bulk_group(keys, scratch, n, max_owner);
+
+    bulk_key_t *k = *keys;
+    for (size_t i = 0, j; i < n; i = j) {
+	for (j = i + 1; j < n && k[j].owner == k[i].owner; ++j);
+	Agsubnode_t *sn = &AGOPP(k[i].e)->node->mainsub;
+	qsort(&k[i], j - i, sizeof(k[0]), bulk_key_cmp);
+	bulk_insert(root->e_seq, out ? &sn->out_seq : &sn->in_seq, &k[i], j - i,
+	            false);
+	for (size_t l = i; l < j; ++l) {
+	    k[l].other = k[l].other_id;
+	    k[l].self = AGID(k[l].e);
+	}
+	qsort(&k[i], j - i, sizeof(k[0]), bulk_key_cmp);
+	bulk_insert(root->e_id, out ? &sn->out_id : &sn->in_id, &k[i], j - i,
+	            true);
+    }
+}
+
+void agbulkflush(Agraph_t *g) {
+    struct graphviz_edge_bulk *bulk = g->clos->bulk;
+    if (bulk == NULL || bulk_edges_is_empty(&bulk->pending))
+	return;
+
+    Agraph_t *root = agroot(g);
+    agthaw(root);
+    const size_t n = bulk_edges_size(&bulk->pending);
+    bulk_key_t *keys = gv_calloc(n, sizeof(keys[0]));
+    bulk_key_t *scratch = gv_calloc(n, sizeof(scratch[0]));
+    bulk_install(root, &bulk->pending, &keys, &scratch, true);
+    bulk_install(root, &bulk->pending, &keys, &scratch, false);
+    free(scratch);
+    free(keys);
+    bulk_edges_clear(&bulk->pending);
+}
+
+void agbulkbegin(Agraph_t *g) {
+    Agclos_t *clos = g->clos;
+    if (clos->bulk == NULL)
+	clos->bulk = gv_alloc(sizeof(struct graphviz_edge_bulk));
+    ++clos->bulk->depth;
+}
+
+void agbulkcommit(Agraph_t *g) {
+    struct graphviz_edge_bulk *bulk = g->clos->bulk;
+    if (bulk == NULL)
+	return;
+    agbulkflush(g);
+    if (bulk->depth > 0)
+	--bulk->depth;
+}
+
+void agbulkfree(Agraph_t *g) {
+    if (g->clos->bulk != NULL)
+	bulk_edges_free(&g->clos->bulk->pending);
+    free(g->clos->bulk);
+    g->clos->bulk = NULL;
+}
+
+/// clear one of a subgraph’s edge sets, releasing its holder objects
+static void drop_set(Dict_t *d, Dtlink_t **set) {
+    dtrestore(d, *set);
+    dtclear(d);
+    *set = dtextract(d);
+}
+
+void agfreeze(Agraph_t *g) {
+    agbulkflush(g);
+    if (g->e_frozen != NULL)
+	return;
+
+    const bool is_root = g == agroot(g);
+    frozen_t *f = gv_alloc(sizeof(frozen_t));
+    size_t n_out = 0, n_in = 0;
+    for (Agnode_t *n = agfstnode(g); n; n = agnxtnode(g, n)) {
+	if (is_root) {
+	    f->n = (size_t)AGSEQ(n) + 1;
+	} else {
+	    ++f->n;
+	}
+	n_out += (size_t)agdegree(g, n, 0, 1);
+	n_in += (size_t)agdegree(g, n, 1, 0);
+    }
+    if (!is_root)
+	f->seqs = gv_calloc(f->n, sizeof(f->seqs[0]));
+    f->out_start = gv_calloc(f->n + 1, sizeof(f->out_start[0]));
+    f->in_start = gv_calloc(f->n + 1, sizeof(f->in_start[0]));
+    f->out = gv_calloc(n_out, sizeof(f->out[0]));
+    f->in = gv_calloc(n_in, sizeof(f->in[0]));
+
+    // nodes are visited in sequence order, so slots are filled in order
+    size_t slot = 0, i = 0, j = 0;
+    for (Agnode_t *n = agfstnode(g); n; n = agnxtnode(g, n)) {
+	const size_t s = is_root ? (size_t)AGSEQ(n) : slot;
+	for (; slot <= s; ++slot) {
+	    f->out_start[slot] = i;
+	    f->in_start[slot] = j;
+	}
+	if (!is_root)
+	    f->seqs[s] = AGSEQ(n);
+	for (Agedge_t *e = agfstout(g, n); e; e = agnxtout(g, e))
+	    f->out[i++] = e;
+	for (Agedge_t *e = agfstin(g, n); e; e = agnxtin(g, e))
+	    f->in[j++] = e;
+    }
+    for (; slot <= f->n; ++slot) {
+	f->out_start[slot] = i;
+	f->in_start[slot] = j;
+    }
+    assert(i == n_out && j == n_in);
+
+    // a subgraph’s edge sets hold their edges through separately allocated
+    // holders, which the arrays make redundant
+    if (!is_root)
+	agsubedgesfree(g);
+    g->e_frozen = f;
+}
+
+void agsubedgesfree(Agraph_t *g) {
+    assert(g != agroot(g));
+    for (Agsubnode_t *sn = dtfirst(g->n_seq); sn; sn = dtnext(g->n_seq, sn)) {
+	drop_set(g->e_seq, &sn->out_seq);
+	drop_set(g->e_id, &sn->out_id);
+	drop_set(g->e_seq, &sn->in_seq);
+	drop_set(g->e_id, &sn->in_id);
+    }
+}
+
+void agthaw(Agraph_t *g) {
+    frozen_t *f = g->e_frozen;
+    if (f == NULL)
+	return;
+    g->e_frozen = NULL;
+
+    // a root graph’s edge sets were left intact, but a subgraph’s need to be
+    // rebuilt
+    if (g != agroot(g)) {
+	for (size_t slot = 0; slot < f->n; ++slot) {
+	    for (size_t i = f->out_start[slot]; i < f->out_start[slot + 1]; ++i) {
+		Agsubnode_t *sn = agsubrep(g, AGTAIL(f->out[i]));
+		ins(g->e_seq, &sn->out_seq, f->out[i]);
+		ins(g->e_id, &sn->out_id, f->out[i]);
+	    }
+	    for (size_t i = f->in_start[slot]; i < f->in_start[slot + 1]; ++i) {
+		Agsubnode_t *sn = agsubrep(g, AGHEAD(f->in[i]));
+		ins(g->e_seq, &sn->in_seq, f->in[i]);
+		ins(g->e_id, &sn->in_id, f->in[i]);
+	    }
+	}
+    }
+    frozen_free(f);
+}
+
+void agfrozenclose(Agraph_t *g) {
+    frozen_free(g->e_frozen);
+    g->e_frozen = NULL;
+}
+
+int agfrozendegree(Agraph_t *g, Agnode_t *n, bool out) {
+    size_t begin, end;
+    if (!frozen_range(g->e_frozen, n, out, &begin, &end))
+	return 0;
+    assert(end - begin <= INT_MAX);
+    return (int)(end - begin);
+}
+
 static void subedge(Agraph_t * g, Agedge_t * e)
 {
     installedge(g, e);
@@ -196,7 +615,7 @@ static Agedge_t *newedge(Agraph_t * g, Agnode_t * t, Agnode_t * h,
 
     (void)agsubnode(g, t, 1);
     (void)agsubnode(g, h, 1);
-    Agedgepair_t *e2 = gv_alloc(sizeof(Agedgepair_t));
+    Agedgepair_t *e2 = arena_alloc(g->clos->arena, sizeof(Agedgepair_t));
     in = &e2->in;
     out = &e2->out;
     uint64_t seq = agnextseq(g, AGEDGE);
@@ -208,7 +627,13 @@ static Agedge_t *newedge(Agraph_t * g, Agnode_t * t, Agnode_t * h,
     in->node = t;
     out->node = h;
 
-    installedge(g, out);
+    struct graphviz_edge_bulk *bulk = g->clos->bulk;
+    /* strict graphs look every edge up anyway, so deferring gains nothing */
+    if (bulk != NULL && bulk->depth > 0 && g == agroot(g) && !agisstrict(g))
+	bulk_edges_append(&bulk->pending, (bulk_edge_t){
+	    .e = out, .seq = {AGSEQ(t), AGSEQ(h)}, .id = {AGID(t), AGID(h)}});
+    else
+	installedge(g, out);
     if (g->desc.has_attrs) {
 	(void)agbindrec(out, AgDataRecName, sizeof(Agattr_t), false);
 	agedgeattr_init(g, out);
@@ -301,6 +726,7 @@ void agdeledgeimage(Agraph_t *g, Agobj_t *edge, void *ignored) {
     Agsubnode_t *sn;
 
     (void)ignored;
+    agthaw(g);
     if (AGTYPE(e) == AGINEDGE) {
 	in = e;
 	out = AGIN2OUT(e);
@@ -339,7 +765,7 @@ int agdeledge(Agraph_t * g, Agedge_t * e)
     }
     if (agapply(g, &e->base, agdeledgeimage, NULL, false) == SUCCESS) {
 	if (g == agroot(g))
-		free(e);
+		arena_free(g->clos->arena, e);
 	return SUCCESS;
     } else
 	return FAILURE;
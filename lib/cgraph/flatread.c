@@ -0,0 +1,584 @@
+/// @file
+/// @brief fast path for reading large flat graphs
+/// @ingroup cgraph_core
+///
+/// Large generated graphs are usually flat: after the header, the body holds
+/// only node, edge and attribute statements, with no subgraphs. Such a body is
+/// cut into chunks at line ends, and each chunk is lexed and parsed on a thread
+/// of its own into a list of operations, without calling into cgraph. The
+/// operations are then replayed in order, making the same calls the grammar
+/// makes, so nodes and edges come out in the same sequence.
+///
+/// A chunk takes its first token to start a statement. This holds when the
+/// chunk before it stopped at that very token, which is checked before
+/// replaying; if not, parsing resumes from where the chunk before stopped.
+/// Anything outside the flat subset, or anything the grammar would warn about
+/// or reject, makes @ref agflatparse give up before creating a graph, leaving
+/// the input to the grammar.
+///
+/// Every token is copied into the strings of its chunk, even when the input is
+/// a mapped file holding the same bytes. cgraph takes names and values as
+/// NUL-terminated strings, and a token within the input is not terminated, so
+/// a reference to it would only move the copy to replaying. The copy is about
+/// the size of the input, well below what the operations and the graph take.
+
+#include "config.h"
+
+#include <cgraph/cghdr.h>
+#include <cgraph/dotlex.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/alloc.h>
+#include <util/list.h>
+#include <util/streq.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+enum {
+  CHUNK_SIZE = 1 << 20,   ///< bytes to parse on one thread
+  THREADS_MAX = 16,       ///< most threads to parse with
+  SPLIT_SEARCH = 1 << 16, ///< how far to look for a line ending in `;`
+};
+
+/// kinds of recorded operations
+enum {
+  OP_ATTR, ///< attribute statement for objects of kind `kind`
+  OP_NODE, ///< node statement
+  OP_EDGE, ///< edge statement
+  OP_END,  ///< node of a statement, with name `a` and port `b` or `NO_PORT`
+  OP_SET,  ///< attribute of a statement, with name `a` and value `b`
+};
+
+#define NO_PORT SIZE_MAX
+
+/// an operation recorded by parsing a chunk
+///
+/// Each statement is recorded as an `OP_ATTR`, `OP_NODE` or `OP_EDGE`
+/// operation holding its number of nodes in `a` and attributes in `b`,
+/// followed by an `OP_END` for each node and an `OP_SET` for each attribute.
+/// Strings are offsets into the strings of the chunk.
+typedef struct {
+  unsigned char type; ///< `OP_*`
+  unsigned char kind; ///< `AGRAPH`, `AGNODE` or `AGEDGE` for `OP_ATTR`
+  bool html;          ///< is the value of an `OP_SET` an HTML-like string?
+  size_t a;
+  size_t b;
+} op_t;
+
+DEFINE_LIST(ops, op_t)
+
+/// parse an ID, joining any quoted strings after it with `+`
+///
+/// Strings are stored back to back, so joining only drops the NULs between
+/// them.
+///
+/// @param tok [in,out] Current token, moved past the ID
+/// @param str [out] String of the ID
+/// @param html [out] Is it an HTML-like string?
+/// @return False if the input does not hold an ID
+static bool atom(dotlex_t *s, int *tok, size_t *str, bool *html) {
+  if (*tok != TOK_ID && *tok != TOK_QID) {
+    return false;
+  }
+  const bool quoted = *tok == TOK_QID;
+  *str = s->str;
+  *html = s->html;
+  *tok = dotlex(s);
+  while (quoted && *tok == '+') {
+    if ((*tok = dotlex(s)) != TOK_QID) {
+      return false;
+    }
+    const size_t len = s->strings.size - s->str;
+    memmove(s->strings.data + s->str - 1, s->strings.data + s->str, len);
+    --s->strings.size;
+    *html = false;
+    *tok = dotlex(s);
+  }
+  return true;
+}
+
+/// parse bracketed attribute lists
+///
+/// @return Number of attributes, or `SIZE_MAX` on a syntax error
+static size_t attrs(dotlex_t *s, int *tok, ops_t *ops) {
+  size_t count = 0;
+  while (*tok == '[') {
+    *tok = dotlex(s);
+    while (*tok != ']') {
+      op_t set = {.type = OP_SET};
+      bool html;
+      if (!atom(s, tok, &set.a, &html) || *tok != '=') {
+        return SIZE_MAX;
+      }
+      *tok = dotlex(s);
+      if (!atom(s, tok, &set.b, &set.html)) {
+        return SIZE_MAX;
+      }
+      ops_append(ops, set);
+      ++count;
+      if (*tok == ';' || *tok == ',') {
+        *tok = dotlex(s);
+      }
+    }
+    *tok = dotlex(s);
+  }
+  return count;
+}
+
+/// parse the optional port of a node, with its optional compass point
+///
+/// A port with a compass point is stored as one string `port:compass`, the way
+/// the grammar joins them.
+static bool port(dotlex_t *s, int *tok, op_t *end) {
+  if (*tok != ':') {
+    return true;
+  }
+  bool html;
+  *tok = dotlex(s);
+  if (!atom(s, tok, &end->b, &html)) {
+    return false;
+  }
+  if (*tok == ':') {
+    // the compass point is stored right after the port, so replacing the NUL
+    // between them joins the two
+    s->strings.data[s->strings.size - 1] = ':';
+    *tok = dotlex(s);
+    size_t compass;
+    if (!atom(s, tok, &compass, &html)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// parse a node of an edge statement
+static bool end(dotlex_t *s, int *tok, ops_t *ops) {
+  op_t e = {.type = OP_END, .b = NO_PORT};
+  bool html;
+  if (!atom(s, tok, &e.a, &html) || !port(s, tok, &e)) {
+    return false;
+  }
+  ops_append(ops, e);
+  return true;
+}
+
+/// parse a statement and its optional `;`
+static bool stmt(dotlex_t *s, int *tok, ops_t *ops) {
+  const size_t head = ops_size(ops);
+  ops_append(ops, (op_t){0});
+  op_t st = {.type = OP_ATTR};
+
+  if (*tok == TOK_GRAPH || *tok == TOK_NODE || *tok == TOK_EDGE) {
+    st.kind = *tok == TOK_GRAPH ? AGRAPH : *tok == TOK_NODE ? AGNODE : AGEDGE;
+    // a name before the list would define a macro, which the grammar warns of
+    if ((*tok = dotlex(s)) != '[' || (st.b = attrs(s, tok, ops)) == SIZE_MAX) {
+      return false;
+    }
+  } else {
+    op_t first = {.type = OP_END, .b = NO_PORT};
+    bool html;
+    if (!atom(s, tok, &first.a, &html)) {
+      return false;
+    }
+    if (*tok == '=') {
+      // `name = value` sets a graph attribute
+      op_t set = {.type = OP_SET, .a = first.a};
+      *tok = dotlex(s);
+      if (!atom(s, tok, &set.b, &set.html)) {
+        return false;
+      }
+      ops_append(ops, set);
+      st.kind = AGRAPH;
+      st.b = 1;
+    } else {
+      if (!port(s, tok, &first)) {
+        return false;
+      }
+      ops_append(ops, first);
+      for (st.a = 1; *tok == TOK_EDGEOP; ++st.a) {
+        *tok = dotlex(s);
+        if (!end(s, tok, ops)) {
+          return false;
+        }
+      }
+      st.type = st.a > 1 ? OP_EDGE : OP_NODE;
+      if ((st.b = attrs(s, tok, ops)) == SIZE_MAX) {
+        return false;
+      }
+    }
+  }
+
+  *ops_at(ops, head) = st;
+  if (*tok == ';') {
+    *tok = dotlex(s);
+  }
+  return true;
+}
+
+/// how parsing a chunk ended
+enum {
+  CHUNK_FAIL,  ///< input outside the flat subset
+  CHUNK_EOF,   ///< input ended inside the body
+  CHUNK_FENCE, ///< reached a statement starting at or past the fence
+  CHUNK_CLOSE, ///< reached the `}` closing the body
+};
+
+/// a piece of the body of a graph, parsed on its own
+typedef struct {
+  const char *data; ///< whole input
+  size_t size;
+  bool directed;
+  size_t begin; ///< where to start parsing
+  size_t fence; ///< statements starting here or later are for the next chunk
+  int status;   ///< `CHUNK_*`
+  size_t first; ///< start of the first token
+  size_t stop;  ///< start of the next statement, or the end of the body
+  ops_t ops;
+  dotlex_strings_t strings;
+} chunk_t;
+
+static void parse_chunk(chunk_t *c) {
+  dotlex_t s = {.data = c->data,
+              .size = c->size,
+              .pos = c->begin,
+              .directed = c->directed};
+  int tok = dotlex(&s);
+  c->first = s.start;
+  for (;;) {
+    if (tok == TOK_EOF) {
+      c->status = CHUNK_EOF;
+      break;
+    }
+    if (s.start >= c->fence) {
+      c->status = CHUNK_FENCE;
+      c->stop = s.start;
+      break;
+    }
+    if (tok == '}') {
+      c->status = CHUNK_CLOSE;
+      c->stop = s.pos;
+      break;
+    }
+    if (!stmt(&s, &tok, &c->ops)) {
+      c->status = CHUNK_FAIL;
+      break;
+    }
+  }
+  c->strings = s.strings;
+}
+
+static void chunk_free(chunk_t *c) {
+  ops_free(&c->ops);
+  free(c->strings.data);
+  c->strings = (dotlex_strings_t){0};
+}
+
+#ifdef HAVE_PTHREAD
+static void *parse_thread(void *chunk) {
+  parse_chunk(chunk);
+  return NULL;
+}
+#endif
+
+/// parse chunks, each on its own thread where possible
+static void parse_chunks(chunk_t *chunks, size_t n) {
+#ifdef HAVE_PTHREAD
+  pthread_t *const threads = gv_calloc(n, sizeof(pthread_t));
+  bool *const started = gv_calloc(n, sizeof(bool));
+  for (size_t i = 1; i < n; ++i) {
+    started[i] =
+        pthread_create(&threads[i], NULL, parse_thread, &chunks[i]) == 0;
+  }
+  parse_chunk(&chunks[0]);
+  for (size_t i = 1; i < n; ++i) {
+    if (started[i]) {
+      pthread_join(threads[i], NULL);
+    } else {
+      parse_chunk(&chunks[i]);
+    }
+  }
+  free(started);
+  free(threads);
+#else
+  for (size_t i = 0; i < n; ++i) {
+    parse_chunk(&chunks[i]);
+  }
+#endif
+}
+
+/// number of threads worth starting
+static size_t thread_count(void) {
+#if defined(HAVE_PTHREAD) && defined(_SC_NPROCESSORS_ONLN)
+  const long n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n > 1) {
+    return n < THREADS_MAX ? (size_t)n : THREADS_MAX;
+  }
+#endif
+  return 1;
+}
+
+/// find where to end a chunk: after a nearby line ending in `;`, which most
+/// likely ends a statement, or else after the first line end
+static size_t split(const char *data, size_t size, size_t from) {
+  const char *const nl = memchr(data + from, '\n', size - from);
+  if (nl == NULL) {
+    return size;
+  }
+  const char *const limit =
+      data + (size - from > SPLIT_SEARCH ? from + SPLIT_SEARCH : size);
+  for (const char *p = nl; p != NULL;
+       p = memchr(p + 1, '\n', (size_t)(limit - p - 1))) {
+    const char *q = p;
+    while (q > data + from &&
+           (q[-1] == ' ' || q[-1] == '\t' || q[-1] == '\r')) {
+      --q;
+    }
+    if (q > data + from && q[-1] == ';') {
+      return (size_t)(p + 1 - data);
+    }
+    if (p + 1 >= limit) {
+      break;
+    }
+  }
+  return (size_t)(nl + 1 - data);
+}
+
+DEFINE_LIST(chunks, chunk_t)
+
+/// parse the body of a graph, which starts at `begin`
+///
+/// The first chunk is parsed alone, so a graph that ends within it is never
+/// parsed past, which matters when a file holds many graphs. Later chunks are
+/// parsed a batch at a time, one thread each.
+///
+/// @param chunks [out] Parsed chunks, the last closing the body
+/// @return Number of chunks, or 0 if the body is not flat
+static size_t parse_body(chunk_t **chunks, const char *data, size_t size,
+                         size_t begin, bool directed) {
+  chunks_t list = {0};
+  size_t batch = 1;
+  for (size_t at = begin;; batch = thread_count()) {
+    const size_t first = chunks_size(&list);
+    for (size_t i = 0; i < batch && (i == 0 || at < size); ++i) {
+      const size_t fence =
+          size - at > CHUNK_SIZE ? split(data, size, at + CHUNK_SIZE) : size;
+      chunks_append(&list, (chunk_t){.data = data,
+                                     .size = size,
+                                     .directed = directed,
+                                     .begin = at,
+                                     .fence = fence});
+      at = fence;
+    }
+    parse_chunks(chunks_at(&list, first), chunks_size(&list) - first);
+
+    // every chunk but the first trusts it starts with a statement, which holds
+    // if the chunk before stopped at that statement
+    for (size_t i = first; i < chunks_size(&list); ++i) {
+      chunk_t *const c = chunks_at(&list, i);
+      if (i > 0 && chunks_get(&list, i - 1).stop != c->first) {
+        // parse again from where the chunk before stopped
+        at = chunks_get(&list, i - 1).stop;
+        while (chunks_size(&list) > i) {
+          chunk_t last = chunks_pop_back(&list);
+          chunk_free(&last);
+        }
+        break;
+      }
+      if (c->status == CHUNK_CLOSE) {
+        while (chunks_size(&list) > i + 1) {
+          chunk_t last = chunks_pop_back(&list);
+          chunk_free(&last);
+        }
+        const size_t count = chunks_size(&list);
+        *chunks = chunks_detach(&list);
+        return count;
+      }
+      if (c->status != CHUNK_FENCE) {
+        for (size_t j = 0; j < chunks_size(&list); ++j) {
+          chunk_free(chunks_at(&list, j));
+        }
+        chunks_free(&list);
+        return 0;
+      }
+    }
+  }
+}
+
+DEFINE_LIST(syms, Agsym_t *)
+DEFINE_LIST(nodes, Agnode_t *)
+
+static const char Key[] = "key";
+
+/// set the attributes of a statement on an object, like `applyattrs` in
+/// grammar.y
+static void apply(void *obj, const chunk_t *c, size_t sets,
+                  const syms_t *syms) {
+  for (size_t i = 0; i < syms_size(syms); ++i) {
+    Agsym_t *const sym = syms_get(syms, i);
+    if (sym == NULL) {
+      continue;
+    }
+    const op_t set = ops_get(&c->ops, sets + i);
+    if (set.html) {
+      agxset_html(obj, sym, c->strings.data + set.b);
+    } else {
+      agxset(obj, sym, c->strings.data + set.b);
+    }
+  }
+}
+
+/// set a port of an edge, like `mkport` in grammar.y
+static void mkport(Agraph_t *g, Agedge_t *e, char *name, char *val) {
+  if (val != NULL) {
+    Agsym_t *attr = agattr_text(g, AGEDGE, name, NULL);
+    if (attr == NULL) {
+      attr = agattr_text(g, AGEDGE, name, "");
+    }
+    agxset(e, attr, val);
+  }
+}
+
+/// make the calls of the grammar for the statements of a chunk
+static void replay(Agraph_t *g, const chunk_t *c, syms_t *syms,
+                   nodes_t *nodes) {
+  char *const str = c->strings.data;
+  for (size_t i = 0; i < ops_size(&c->ops);) {
+    const op_t st = ops_get(&c->ops, i++);
+    const size_t ends = i;
+    i += st.a;
+    const size_t sets = i;
+    i += st.b;
+
+    nodes_clear(nodes);
+    for (size_t j = ends; j < sets; ++j) {
+      nodes_append(nodes, agnode(g, str + ops_get(&c->ops, j).a, 1));
+    }
+
+    // bind the attributes, as `bindattrs` does, before setting any
+    const int kind = st.type == OP_ATTR   ? st.kind
+                     : st.type == OP_NODE ? AGNODE
+                                          : AGEDGE;
+    char *key = NULL;
+    syms_clear(syms);
+    for (size_t j = sets; j < i; ++j) {
+      const op_t set = ops_get(&c->ops, j);
+      char *const name = str + set.a;
+      Agsym_t *sym = NULL;
+      if (kind == AGEDGE && streq(name, Key)) {
+        key = str + set.b;
+      } else if ((sym = agattr_text(g, kind, name, NULL)) == NULL) {
+        sym = agattr_text(g, kind, name, "");
+      }
+      syms_append(syms, sym);
+    }
+
+    if (st.type == OP_ATTR) {
+      // set defaults, as `attrstmt` does
+      for (size_t j = 0; j < syms_size(syms); ++j) {
+        Agsym_t *sym = syms_get(syms, j);
+        if (sym == NULL) {
+          continue;
+        }
+        const op_t set = ops_get(&c->ops, sets + j);
+        if (!sym->fixed) {
+          if (set.html) {
+            sym = agattr_html(g, kind, sym->name, str + set.b);
+          } else {
+            sym = agattr_text(g, kind, sym->name, str + set.b);
+          }
+        }
+        sym->print = true;
+      }
+    } else if (st.type == OP_NODE) {
+      apply(nodes_get(nodes, 0), c, sets, syms);
+    } else {
+      // make the edges, as `newedge` does
+      for (size_t j = 0; j + 1 < st.a; ++j) {
+        Agnode_t *const t = nodes_get(nodes, j);
+        Agnode_t *const h = nodes_get(nodes, j + 1);
+        const size_t tport = ops_get(&c->ops, ends + j).b;
+        const size_t hport = ops_get(&c->ops, ends + j + 1).b;
+        char *tp = tport == NO_PORT ? NULL : str + tport;
+        char *hp = hport == NO_PORT ? NULL : str + hport;
+        Agedge_t *const e = agedge(g, t, h, key, 1);
+        if (e == NULL) { // can fail if graph is strict and t==h
+          continue;
+        }
+        if (agtail(e) != aghead(e) && aghead(e) == t) {
+          // could happen with an undirected edge
+          char *const temp = tp;
+          tp = hp;
+          hp = temp;
+        }
+        mkport(g, e, TAILPORT_ID, tp);
+        mkport(g, e, HEADPORT_ID, hp);
+        apply(e, c, sets, syms);
+      }
+    }
+  }
+}
+
+Agraph_t *agflatparse(const char *data, size_t size, size_t *used,
+                      Agdisc_t *disc) {
+  dotlex_t s = {.data = data, .size = size};
+  size_t name = SIZE_MAX;
+  bool html;
+  chunk_t *chunks = NULL;
+  size_t count = 0;
+
+  int tok = dotlex(&s);
+  const bool strict = tok == TOK_STRICT;
+  if (strict) {
+    tok = dotlex(&s);
+  }
+  if (tok == TOK_GRAPH || tok == TOK_DIGRAPH) {
+    s.directed = tok == TOK_DIGRAPH;
+    tok = dotlex(&s);
+    if ((tok == TOK_ID || tok == TOK_QID) && !atom(&s, &tok, &name, &html)) {
+      tok = TOK_ERROR;
+    }
+    if (tok == '{') {
+      count = parse_body(&chunks, data, size, s.pos, s.directed);
+    }
+  }
+  if (count == 0) {
+    free(s.strings.data);
+    return NULL;
+  }
+
+  Agdesc_t desc = {.directed = s.directed, .strict = strict, .maingraph = true};
+  Agraph_t *const g = agopen(name == SIZE_MAX ? NULL : s.strings.data + name,
+                             desc, disc ? disc : &AgDefaultDisc);
+  free(s.strings.data);
+
+  syms_t syms = {0};
+  nodes_t nodes = {0};
+  if (g != NULL) {
+    agbulkbegin(g);
+    // free each chunk once replayed, so its strings and operations are not
+    // held alongside the whole graph
+    for (size_t i = 0; i < count; ++i) {
+      replay(g, &chunks[i], &syms, &nodes);
+      chunk_free(&chunks[i]);
+    }
+    agbulkcommit(g);
+    aginternalmapclearlocalnames(g);
+  }
+  syms_free(&syms);
+  nodes_free(&nodes);
+
+  // like the grammar, which reads by lines, consume the line closing the body
+  const size_t close = chunks[count - 1].stop;
+  const char *const nl = memchr(data + close, '\n', size - close);
+  *used = nl == NULL ? size : (size_t)(nl + 1 - data);
+
+  for (size_t i = 0; i < count; ++i) {
+    chunk_free(&chunks[i]);
+  }
+  free(chunks);
+  return g;
+}
@@ -28,6 +28,8 @@
 
 %code requires {
 #include <cghdr.h>
+#include <cgraph/rdr.h>
+#include <stdbool.h>
 #include <util/agxbuf.h>
 
 struct gstack_s;
@@ -35,11 +37,13 @@ struct gstack_s;
 struct aagextra_s {
 	/* Common */
 	Agdisc_t *Disc;		/* discipline passed to agread or agconcat */
+	Agiodisc_t *Io;		/* input discipline for Ifile */
 	void *Ifile;
 	Agraph_t *G;		/* top level graph */
 	/* Parser */
 	int SubgraphDepth;
 	struct gstack_s *S;
+	bool bulk;		/* has G a bulk load begun by this parse? */
 	/* Lexer */
 	int line_num; // = 1;
 	int html_nest;  /* nesting level for html strings */
@@ -579,13 +583,25 @@ static void startgraph(aagscan_t scanner, char *name, bool directed, bool strict
 		Agdesc_t req = {.directed = directed, .strict = strict, .maingraph = true};
 		ctx->G = agopen(name,req,ctx->Disc);
 	}
+	agbulkbegin(ctx->G);
+	ctx->bulk = true;
 	ctx->S = push(ctx->S,ctx->G);
 	agstrfree(NULL, name, false);
 }
 
+/* end the bulk load begun by startgraph, if any */
+static void endbulk(aagextra_t *ctx)
+{
+	if (ctx->bulk) {
+		agbulkcommit(ctx->G);
+		ctx->bulk = false;
+	}
+}
+
 static void endgraph(aagscan_t scanner)
 {
 	aglexeof(scanner);
+	endbulk(aagget_extra(scanner));
 	aginternalmapclearlocalnames(aagget_extra(scanner)->G);
 }
 
@@ -627,7 +643,9 @@ static void graph_error(aagscan_t scanner)
 	aagextra_t *ctx = aagget_extra(scanner);
 	if (ctx->G) {
 		freestack(scanner);
-		endgraph(scanner);
+		aglexeof(scanner);
+		/* agclose drops any edges still pending, with no need to index them */
+		ctx->bulk = false;
 		agclose(ctx->G);
 		ctx->G = NULL;
 	}
@@ -635,23 +653,58 @@ static void graph_error(aagscan_t scanner)
 
 Agraph_t *agconcat(Agraph_t *g, const char *filename, void *chan,
                    Agdisc_t *disc) {
+	Agdisc_t *const d = disc ? disc : &AgDefaultDisc;
+	Agiodisc_t *io = d->io;
+
+	// read a file in place rather than through stdio where we can
+	rdr_file_t map = {0};
+	const bool mapped = chan != NULL && io == &AgIoDisc && rdr_open(&map, chan);
+	if (mapped) {
+		io = &AgMemIoDisc;
+	}
+	void *const input = mapped ? &map.rdr : chan;
+
+	if (g == NULL && io == &AgMemIoDisc) {
+		Agraph_t *flat = agbinread(input, disc);
+		if (flat == NULL) {
+			flat = agflatread(input, disc);
+		}
+		if (flat != NULL) {
+			if (mapped) {
+				rdr_close(&map, chan);
+			}
+			return flat;
+		}
+	}
+
 	aagscan_t scanner = NULL;
 	aagextra_t extra = {
-		.Disc = disc ? disc : &AgDefaultDisc,
-		.Ifile = chan,
+		.Disc = d,
+		.Io = io,
+		.Ifile = input,
 		.G = g,
 		.line_num = 1,
 		.InputFile = filename,
 	};
 	if (aaglex_init_extra(&extra, &scanner)) {
+		if (mapped) {
+			rdr_close(&map, chan);
+		}
 		return NULL;
 	}
 	aagset_in(chan, scanner);
 	aagparse(scanner);
+	if (extra.G != NULL) {
+		/* the parse may have stopped before reaching endgraph */
+		endbulk(&extra);
+	}
 	if (extra.G == NULL) aglexbad(scanner);
 	aaglex_destroy(scanner);
 	agxbfree(&extra.InputFileBuffer);
 	agxbfree(&extra.Sbuf);
+	if (mapped) {
+		rdr_close(&map, chan);
+	}
 	return extra.G;
 }
 
@@ -14,6 +14,7 @@
  *************************************************************************/
 
 #include <assert.h>
+#include <cgraph/arena.h>
 #include <cgraph/cghdr.h>
 #include <cgraph/node_set.h>
 #include <limits.h>
@@ -31,6 +32,7 @@ static Agclos_t *agclos(Agdisc_t * proto)
 
     /* establish an allocation arena */
     rv = gv_calloc(1, sizeof(Agclos_t));
+    rv->arena = arena_new();
     rv->disc.id = ((proto && proto->id) ? proto->id : &AgIdDisc);
     rv->disc.io = ((proto && proto->io) ? proto->io : &AgIoDisc);
     return rv;
@@ -89,6 +91,68 @@ Agraph_t *agopen1(Agraph_t * g)
     return g;
 }
 
+/*
+ * Free the dictionaries of a graph and its subgraphs without deleting
+ * the objects in them, which are left to be released with the arena.
+ */
+static int agreleasedicts(Agraph_t * g)
+{
+    Agraph_t **subgs, *subg;
+    size_t i, n_subgs;
+
+    /* the parent's subgraph dictionaries must not be walked once a
+     * subgraph in them has been freed */
+    n_subgs = (size_t)dtsize(g->g_seq);
+    subgs = gv_calloc(n_subgs, sizeof(subgs[0]));
+    for (i = 0, subg = agfstsubg(g); subg; subg = agnxtsubg(subg))
+	subgs[i++] = subg;
+    for (i = 0; i < n_subgs; i++) {
+	if (agreleasedicts(subgs[i])) {
+	    free(subgs);
+	    return FAILURE;
+	}
+	free(subgs[i]);
+    }
+    free(subgs);
+    (void)dtextract(g->g_seq);
+    (void)dtextract(g->g_id);
+
+    agfrozenclose(g);
+    if (g != agroot(g))
+	agsubedgesfree(g);
+    (void)dtextract(g->n_seq);
+    node_set_free(&g->n_id);
+    if (agdtclose(g, g->n_seq)) return FAILURE;
+    if (agdtclose(g, g->e_id)) return FAILURE;
+    if (agdtclose(g, g->e_seq)) return FAILURE;
+    if (agdtclose(g, g->g_seq)) return FAILURE;
+    if (agdtclose(g, g->g_id)) return FAILURE;
+    if (g->desc.has_attrs)
+	if (agraphattr_delete(g)) return FAILURE;
+    return SUCCESS;
+}
+
+/*
+ * Close a root graph by releasing its arena, rather than deleting its
+ * nodes, edges and records one by one. This is only possible when no
+ * callbacks or ID discipline have to see them go.
+ */
+static int agrelease(Agraph_t * g)
+{
+    void *clos;
+
+    assert(g == agroot(g));
+    if (agreleasedicts(g)) return FAILURE;
+    aginternalmapclose(g);
+    arena_release(&g->clos->arena);
+    AGDISC(g, id)->close(AGCLOS(g, id));
+    if (agstrclose(g)) return FAILURE;
+    clos = g->clos;
+    free(g);
+    free(clos);
+    return SUCCESS;
+}
+
 /*
  * Close a graph or subgraph, freeing its storage.
  */
@@ -98,6 +162,17 @@ int agclose(Agraph_t * g)
     Agnode_t *n, *next_n;
 
     par = agparent(g);
+    if (par == NULL) {
+	const bool release = g->clos->cb == NULL && AGDISC(g, id) == &AgIdDisc;
+	/* deleting objects one by one needs deferred edges indexed first, while
+	 * releasing the arena frees them along with everything else */
+	if (!release)
+	    agbulkflush(g);
+	agbulkfree(g);
+	if (release)
+	    return agrelease(g);
+    }
+    agfrozenclose(g);
 
     for (subg = agfstsubg(g); subg; subg = next_subg) {
 	next_subg = agnxtsubg(subg);
@@ -142,6 +217,7 @@ int agclose(Agraph_t * g)
 	    agpopdisc(g, g->clos->cb->f);
 	AGDISC(g, id)->close(AGCLOS(g, id));
 	if (agstrclose(g)) return FAILURE;
+	arena_release(&g->clos->arena);
 	clos = g->clos;
 	free(g);
 	free(clos);
@@ -204,16 +280,25 @@ static int cnt(Dict_t * d, Dtlink_t ** set)
 	return rv;
 }
 
+/// count the out- or in-edges of a node, in its edge set or frozen array
+static int edgecnt(Agraph_t *g, Agnode_t *n, Agsubnode_t *sn, bool out)
+{
+    if (g->e_frozen != NULL)
+	return agfrozendegree(g, n, out);
+    return out ? cnt(g->e_seq, &sn->out_seq) : cnt(g->e_seq, &sn->in_seq);
+}
+
 int agcountuniqedges(Agraph_t * g, Agnode_t * n, int want_in, int want_out)
 {
     Agedge_t *e;
     Agsubnode_t *sn;
     int rv = 0;
 
+    agbulkflush(g);
     sn = agsubrep(g, n);
-    if (want_out) rv = cnt(g->e_seq,&(sn->out_seq));
+    if (want_out) rv = edgecnt(g, n, sn, true);
     if (want_in) {
-		if (!want_out) rv += cnt(g->e_seq,&(sn->in_seq));	/* cheap */
+		if (!want_out) rv += edgecnt(g, n, sn, false);	/* cheap */
 		else {	/* less cheap */
 			for (e = agfstin(g, n); e; e = agnxtin(g, e))
 				if (e->node != n) rv++;  /* don't double count loops */
@@ -227,10 +312,11 @@ int agdegree(Agraph_t * g, Agnode_t * n, int want_in, int want_out)
     Agsubnode_t *sn;
     int rv = 0;
 
+    agbulkflush(g);
     sn = agsubrep(g, n);
     if (sn) {
-	if (want_out) rv += cnt(g->e_seq,&(sn->out_seq));
-	if (want_in) rv += cnt(g->e_seq,&(sn->in_seq));
+	if (want_out) rv += edgecnt(g, n, sn, true);
+	if (want_in) rv += edgecnt(g, n, sn, false);
     }
 	return rv;
 }
@@ -12,10 +12,18 @@
  * Contributors: Details at https://graphviz.org
  *************************************************************************/
 
+#include "config.h"
+
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <cgraph/cghdr.h>
 #include <cgraph/rdr.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 
 static int iofread(void *chan, char *buf, int bufsize)
 {
@@ -41,48 +49,119 @@ Agiodisc_t AgIoDisc = { iofread, ioputstr, ioflush };
 static int
 memiofread(void *chan, char *buf, int bufsize)
 {
-    const char *ptr;
-    char *optr;
-    char c;
-    int l;
-    rdr_t *s;
-
-    if (bufsize == 0) return 0;
-    s = chan;
-    if (s->cur >= s->len)
-        return 0;
-    l = 0;
-    ptr = s->data + s->cur;
-    optr = buf;
-    /* We know we have at least one character */
-    c = *ptr++;
-    do {
-        *optr++ = c;
-        l++;
-	/* continue if c is not newline, we have space in buffer,
-	 * and next character is non-null (we are working with
-	 * null-terminated strings.
-	 */
-    } while (c != '\n' && l < bufsize && (c = *ptr++));
-    s->cur += (size_t)l;
-    return l;
+    rdr_t *const s = chan;
+
+    if (bufsize <= 0 || s->cur >= s->len)
+	return 0;
+
+    // hand over a line at a time, like `iofread`
+    const char *const ptr = s->data + s->cur;
+    size_t l = s->len - s->cur;
+    if (l > (size_t)bufsize)
+	l = (size_t)bufsize;
+    const char *const nl = memchr(ptr, '\n', l);
+    if (nl != NULL)
+	l = (size_t)(nl - ptr) + 1;
+    memcpy(buf, ptr, l);
+    s->cur += l;
+
+    // and like `fgets` in `iofread`, let a NUL cut the line short
+    const char *const nul = memchr(buf, '\0', l);
+    return (int)(nul == NULL ? l : (size_t)(nul - buf));
 }
 
-static Agiodisc_t memIoDisc = {memiofread, 0, 0};
+Agiodisc_t AgMemIoDisc = {memiofread, ioputstr, ioflush};
+
+enum { FLAT_MIN = 1 << 20 }; ///< fewest bytes worth trying @ref agflatparse on
+
+bool rdr_open(rdr_file_t *f, FILE *fp)
+{
+    *f = (rdr_file_t){0};
+
+    const long start = ftell(fp);
+    if (start < 0 || fseek(fp, 0, SEEK_END) != 0)
+	return false;
+    const long end = ftell(fp);
+    if (fseek(fp, start, SEEK_SET) != 0 || end <= start)
+	return false;
+    f->start = start;
+
+#ifdef HAVE_SYS_MMAN_H
+    // map the whole file, as mappings start on a page boundary
+    void *const map = mmap(NULL, (size_t)end, PROT_READ, MAP_PRIVATE,
+                           fileno(fp), 0);
+    if (map != MAP_FAILED) {
+	f->base = map;
+	f->length = (size_t)end;
+	f->mapped = true;
+	f->rdr = (rdr_t){.data = (char *)map + start,
+	                 .len = (size_t)(end - start)};
+	return true;
+    }
+#endif
+
+    // otherwise only a file large enough for `agflatparse`, or a binary graph,
+    // is worth a copy
+    if (end - start < FLAT_MIN) {
+	char magic[8];
+	const size_t got = fread(magic, 1, sizeof(magic), fp);
+	if (fseek(fp, start, SEEK_SET) != 0 || !agisbin(magic, got))
+	    return false;
+    }
+    char *const buffer = malloc((size_t)(end - start));
+    if (buffer == NULL)
+	return false;
+    f->base = buffer;
+    f->length = fread(buffer, 1, (size_t)(end - start), fp);
+    f->rdr = (rdr_t){.data = buffer, .len = f->length};
+    return true;
+}
+
+void rdr_close(rdr_file_t *f, FILE *fp)
+{
+#ifdef HAVE_SYS_MMAN_H
+    if (f->mapped) {
+	(void)fseek(fp, f->start + (long)f->rdr.cur, SEEK_SET);
+	munmap(f->base, f->length);
+	*f = (rdr_file_t){0};
+	return;
+    }
+#endif
+
+    // the copy left the file at its end
+    if (f->rdr.cur < f->rdr.len && fseek(fp, f->start, SEEK_SET) == 0) {
+	// read rather than seek past what was used, as text mode may translate
+	// line ends
+	const size_t skipped = fread(f->base, 1, f->rdr.cur, fp);
+	(void)skipped;
+    }
+    free(f->base);
+    *f = (rdr_file_t){0};
+}
+
+Agraph_t *agflatread(rdr_t *rdr, Agdisc_t *disc)
+{
+    if (rdr->len - rdr->cur < FLAT_MIN)
+	return NULL;
+    size_t used;
+    Agraph_t *const g = agflatparse(rdr->data + rdr->cur, rdr->len - rdr->cur,
+                                    &used, disc);
+    if (g != NULL)
+	rdr->cur += used;
+    return g;
+}
 
 static Agraph_t *agmemread0(Agraph_t *arg_g, const char *cp)
 {
     rdr_t rdr;
     Agdisc_t disc;
 
-    memIoDisc.putstr = AgIoDisc.putstr;
-    memIoDisc.flush = AgIoDisc.flush;
     rdr.data = cp;
     rdr.len = strlen(cp);
     rdr.cur = 0;
 
     disc.id = &AgIdDisc;
-    disc.io = &memIoDisc;  
+    disc.io = &AgMemIoDisc;
     if (arg_g) return agconcat(arg_g, NULL, &rdr, &disc);
     return agread(&rdr, &disc);
 }
@@ -12,6 +12,7 @@
  *************************************************************************/
 
 #include <assert.h>
+#include <cgraph/arena.h>
 #include <cgraph/cghdr.h>
 #include <cgraph/node_set.h>
 #include <stdbool.h>
@@ -74,7 +75,7 @@ static Agnode_t *newnode(Agraph_t * g, IDTYPE id, uint64_t seq)
 {
     assert((seq & SEQ_MASK) == seq && "sequence ID overflow");
 
-    Agnode_t *n = gv_alloc(sizeof(Agnode_t));
+    Agnode_t *n = arena_alloc(g->clos->arena, sizeof(Agnode_t));
     AGTYPE(n) = AGNODE;
     AGID(n) = id;
     AGSEQ(n) = seq & SEQ_MASK;
@@ -96,7 +97,7 @@ static void installnode(Agraph_t * g, Agnode_t * n)
     assert(node_set_size(g->n_id) == (size_t)dtsize(g->n_seq));
     osize = node_set_size(g->n_id);
     if (g == agroot(g)) sn = &(n->mainsub);
-    else sn = gv_alloc(sizeof(Agsubnode_t));
+    else sn = arena_alloc(g->clos->arena, sizeof(Agsubnode_t));
     sn->node = n;
     node_set_add(g->n_id, sn);
     dtinsert(g->n_seq, sn);
@@ -206,7 +207,7 @@ int agdelnode(Agraph_t * g, Agnode_t * n)
     }
     if (agapply(g, &n->base, agdelnodeimage, NULL, false) == SUCCESS) {
 	if (g == agroot(g))
-	    free(n);
+	    arena_free(g->clos->arena, n);
 	return SUCCESS;
     } else
 	return FAILURE;
@@ -237,6 +238,8 @@ int agrelabel_node(Agnode_t * n, char *newname)
 	return FAILURE;
     if (agmapnametoid(g, AGNODE, newname, &new_id, true)) {
 	if (agfindnode_by_id(agroot(g), new_id) == NULL) {
+	    /* pending edges were keyed on the old node ID */
+	    agbulkflush(g);
 	    agfreeid(g, AGNODE, AGID(n));
 	    agapply(g, &n->base, dict_relabel, &new_id, false);
 	    return SUCCESS;
@@ -256,6 +259,8 @@ Agnode_t *agsubnode(Agraph_t * g, Agnode_t * n0, int cflag)
 
     if (agroot(g) != n0->root)
 	return NULL;
+    if (g == n0->root)
+	return n0;	/* every node of a root graph is in it */
     n = agfindnode_by_id(g, AGID(n0));
     if (n == NULL && cflag) {
 	if ((par = agparent(g))) {
@@ -297,8 +302,8 @@ static int agsubnodeseqcmpf(void *arg0, void *arg1) {
  */
 static void free_subnode(void *subnode) {
    Agsubnode_t *sn = subnode;
-   if (!AGSNMAIN(sn)) 
-	free(sn);
+   if (!AGSNMAIN(sn))
+	arena_free(sn->node->root->clos->arena, sn);
 }
 
 Dtdisc_t Ag_subnode_seq_disc = {
@@ -310,6 +315,7 @@ Dtdisc_t Ag_subnode_seq_disc = {
 static void agnodesetfinger(Agraph_t *g, Agobj_t *node, void *ignored) {
     Agnode_t *const n = (Agnode_t *)((char *)node - offsetof(Agnode_t, base));
     Agsubnode_t template = {.node = n};
+    agthaw(g); /* renumbering nodes reorders edges */
 	dtsearch(g->n_seq,&template);
     (void)ignored;
 }
@@ -329,6 +335,9 @@ int agnodebefore(Agnode_t *fst, Agnode_t *snd)
 	g = agroot(fst);
 	if (AGSEQ(fst) > AGSEQ(snd)) return SUCCESS;
 
+	/* pending edges were keyed on the old node sequence numbers */
+	agbulkflush(g);
+
 	/* move snd out of the way somewhere */
 	n = snd;
 	if (agapply(g, &n->base, agnodesetfinger, n, false) != SUCCESS) {
@@ -5,10 +5,54 @@
 
 #pragma once
 
+#include <cgraph/cgraph.h>
+#include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 
+/// a reader over bytes in memory
 typedef struct {
   const char *data;
   size_t len;
-  size_t cur;
+  size_t cur; ///< bytes read so far
 } rdr_t;
+
+/// I/O discipline reading from a `rdr_t` a line at a time
+extern Agiodisc_t AgMemIoDisc;
+
+/// the rest of a seekable file, held in memory to be read in place
+typedef struct {
+  rdr_t rdr;     ///< reader over the rest of the file
+  void *base;    ///< mapping of the file, or a copy of the rest of it
+  size_t length; ///< bytes at `base`
+  bool mapped;   ///< is `base` a mapping rather than a copy?
+  long start;    ///< offset in the file of the first byte of `rdr`
+} rdr_file_t;
+
+/// hold the rest of a file in memory, mapping it where the platform can
+///
+/// Without memory mapping, only a file large enough for @ref agflatread, or one
+/// holding a binary graph, is copied into memory.
+///
+/// @param f [out] The rest of the file
+/// @param fp File to read
+/// @return False if the file is to be read through stdio instead
+bool rdr_open(rdr_file_t *f, FILE *fp);
+
+/// release the rest of a file, leaving it positioned past the bytes read
+void rdr_close(rdr_file_t *f, FILE *fp);
+
+/// try @ref agflatparse on the rest of a large input
+///
+/// @return The new graph, or `NULL` to read the input with the grammar
+Agraph_t *agflatread(rdr_t *rdr, Agdisc_t *disc);
+
+/// does the input start like a graph written by @ref agwritebin?
+bool agisbin(const char *data, size_t size);
+
+/// read a graph written by @ref agwritebin from the rest of an input
+///
+/// A malformed graph is reported and skipped.
+///
+/// @return The new graph, or `NULL` if the input is not in the binary format
+Agraph_t *agbinread(rdr_t *rdr, Agdisc_t *disc);
@@ -13,11 +13,11 @@
  * Contributors: Details at https://graphviz.org
  *************************************************************************/
 
+#include	<cgraph/arena.h>
 #include	<cgraph/cghdr.h>
 #include	<stdbool.h>
 #include	<stdlib.h>
 #include	<util/streq.h>
-#include	<util/alloc.h>
 #include	<util/unreachable.h>
 
 /*
@@ -37,6 +37,17 @@ static void set_data(Agobj_t * obj, Agrec_t * data, bool mtflock)
     }
 }
 
+/* records live in the root graph's arena */
+static Agrec_t *allocrec(Agraph_t * g, size_t recsize)
+{
+    return arena_alloc(g->clos->arena, recsize);
+}
+
+static void freerec(Agraph_t * g, Agrec_t * rec)
+{
+    arena_free(g->clos->arena, rec);
+}
+
 /* find record in circular list and do optional move-to-front */
 Agrec_t *aggetrec(void *obj, const char *name, int mtf)
 {
@@ -96,7 +107,7 @@ void *agbindrec(void *arg_obj, const char *recname, unsigned int recsize,
     g = agraphof(obj);
     Agrec_t *rec = aggetrec(obj, recname, 0);
     if (rec == NULL && recsize > 0) {
-	rec = gv_calloc(recsize, sizeof(char));
+	rec = allocrec(g, recsize);
 	rec->name = agstrdup(g, recname);
 	objputrec(obj, rec);
     }
@@ -156,7 +167,7 @@ int agdelrec(void *arg_obj, const char *name)
 	UNREACHABLE();
     }
     agstrfree(g, rec->name, false);
-    free(rec);
+    freerec(g, rec);
 
     return SUCCESS;
 }
@@ -234,7 +245,7 @@ void agrecclose(Agobj_t * obj)
 	do {
 	    nrec = rec->next;
 	    agstrfree(g, rec->name, false);
-	    free(rec);
+	    freerec(g, rec);
 	    rec = nrec;
 	} while (rec != obj->data);
     }
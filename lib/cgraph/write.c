@@ -416,18 +416,15 @@ static bool is_anonymous(Agraph_t *g) {
 
 static bool irrelevant_subgraph(Agraph_t * g)
 {
-    int i, n;
-    Agattr_t *sdata, *pdata, *rdata;
+    Agattr_t *sdata;
     Agdatadict_t *dd;
 
     if (!is_anonymous(g))
 	return false;
-    if ((sdata = agattrrec(g)) && (pdata = agattrrec(agparent(g)))) {
-	rdata = agattrrec(agroot(g));
-	n = dtsize(rdata->dict);
-	for (i = 0; i < n; i++)
-	    if (sdata->str[i] && pdata->str[i]
-		&& strcmp(sdata->str[i], pdata->str[i]))
+    if ((sdata = agattrrec(g)) && agattrrec(agparent(g))) {
+	for (Agsym_t *sym = dtfirst(sdata->dict); sym;
+	     sym = dtnext(sdata->dict, sym))
+	    if (strcmp(agxget(g, sym), agxget(agparent(g), sym)))
 		return false;
     }
     dd = agdatadict(g, false);
@@ -451,7 +448,7 @@ static bool not_default_attrs(Agraph_t * g, Agnode_t * n)
     (void)g;
     if ((data = agattrrec(n))) {
 	for (sym = dtfirst(data->dict); sym; sym = dtnext(data->dict, sym)) {
-	    if (data->str[sym->id] != sym->defval)
+	    if (agxget(n, sym) != sym->defval)
 		return true;
 	}
     }
@@ -518,7 +515,8 @@ static int write_nondefault_attrs(void *obj, iochan_t * ofile,
 		if (Headport && sym->id == Headport->id)
 		    continue;
 	    }
-	    if (data->str[sym->id] != sym->defval) {
+	    char *const value = agxget(obj, sym);
+	    if (value != sym->defval) {
 		if (cnt++ == 0) {
 		    CHKRV(ioput(g, ofile, "\t["));
 		    Level++;
@@ -528,7 +526,7 @@ static int write_nondefault_attrs(void *obj, iochan_t * ofile,
 		}
 		CHKRV(write_canonstr(g, ofile, sym->name, true));
 		CHKRV(ioput(g, ofile, "="));
-		CHKRV(write_canonstr(g, ofile, data->str[sym->id], true));
+		CHKRV(write_canonstr(g, ofile, value, true));
 	    }
 	}
     if (cnt > 0) {
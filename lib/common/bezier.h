@@ -0,0 +1,140 @@
+/**
+ * @file
+ * @ingroup common_utils
+ * @brief evaluation, subdivision and bounds of cubic Bézier segments
+ *
+ * The evaluation and subdivision here compute exactly what @ref Bezier does
+ * for a cubic, step for step, but unrolled and without its general-degree
+ * working storage, so loops over many segments or parameter values stay in
+ * registers and can be vectorized.
+ */
+
+#pragma once
+
+#include "geom.h"
+#include <math.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// one step of de Casteljau’s algorithm, as @ref Bezier takes it
+static inline pointf bezier_lerp_(pointf a, pointf b, double t) {
+  return (pointf){.x = (1.0 - t) * a.x + t * b.x,
+                  .y = (1.0 - t) * a.y + t * b.y};
+}
+
+/// the point at parameter `t` on a segment
+///
+/// @param cp The segment’s 4 control points
+/// @param t Parameter, 0 at `cp[0]` and 1 at `cp[3]`
+static inline pointf bezier_point(const pointf *cp, double t) {
+  const pointf a = bezier_lerp_(cp[0], cp[1], t);
+  const pointf b = bezier_lerp_(cp[1], cp[2], t);
+  const pointf c = bezier_lerp_(cp[2], cp[3], t);
+  return bezier_lerp_(bezier_lerp_(a, b, t), bezier_lerp_(b, c, t), t);
+}
+
+/// the points at parameters `0, 1/n, 2/n, … 1` on a segment
+///
+/// @param cp The segment’s 4 control points
+/// @param n Number of equal parameter steps
+/// @param [out] out Room for `n + 1` points
+static inline void bezier_points(const pointf *cp, size_t n, pointf *out) {
+  for (size_t i = 0; i <= n; ++i) {
+    out[i] = bezier_point(cp, (double)i / (double)n);
+  }
+}
+
+/// split a segment at parameter `t`
+///
+/// `left` and `right` may be `cp` itself.
+///
+/// @param cp The segment’s 4 control points
+/// @param t Parameter to split at
+/// @param [out] left If non-null, the control points of the part before `t`
+/// @param [out] right If non-null, the control points of the part after `t`
+/// @return The point at `t`
+static inline pointf bezier_split(const pointf *cp, double t, pointf *left,
+                                  pointf *right) {
+  const pointf p0 = cp[0];
+  const pointf p3 = cp[3];
+  const pointf a = bezier_lerp_(p0, cp[1], t);
+  const pointf b = bezier_lerp_(cp[1], cp[2], t);
+  const pointf c = bezier_lerp_(cp[2], p3, t);
+  const pointf d = bezier_lerp_(a, b, t);
+  const pointf e = bezier_lerp_(b, c, t);
+  const pointf m = bezier_lerp_(d, e, t);
+  if (left != NULL) {
+    left[0] = p0;
+    left[1] = a;
+    left[2] = d;
+    left[3] = m;
+  }
+  if (right != NULL) {
+    right[0] = m;
+    right[1] = e;
+    right[2] = c;
+    right[3] = p3;
+  }
+  return m;
+}
+
+/// widen `[*lo, *hi]` to the extremes of one coordinate of a segment
+///
+/// The extremes within the segment are where the derivative, a quadratic in
+/// the parameter, is zero.
+static inline void bezier_range_(double p0, double p1, double p2, double p3,
+                                 double *lo, double *hi) {
+  const double a = p1 - p0;
+  const double b = p2 - p1;
+  const double c = p3 - p2;
+  // derivative / 3 = qa t² + qb t + qc
+  const double qa = a - 2 * b + c;
+  const double qb = 2 * (b - a);
+  const double qc = a;
+
+  double roots[2];
+  int n = 0;
+  if (fabs(qa) < 1e-12) {
+    if (qb != 0) {
+      roots[n++] = -qc / qb;
+    }
+  } else {
+    const double disc = qb * qb - 4 * qa * qc;
+    if (disc >= 0) {
+      const double s = sqrt(disc);
+      roots[n++] = (-qb + s) / (2 * qa);
+      roots[n++] = (-qb - s) / (2 * qa);
+    }
+  }
+
+  for (int i = 0; i < n; ++i) {
+    const double t = roots[i];
+    if (t > 0 && t < 1) {
+      const double mt = 1 - t;
+      const double v = mt * mt * mt * p0 + 3 * mt * mt * t * p1 +
+                       3 * mt * t * t * p2 + t * t * t * p3;
+      *lo = fmin(*lo, v);
+      *hi = fmax(*hi, v);
+    }
+  }
+}
+
+/// the smallest box containing a segment
+///
+/// Unlike the box of the control points, this is tight around the curve.
+///
+/// @param cp The segment’s 4 control points
+static inline boxf bezier_bounds(const pointf *cp) {
+  boxf bb = {.LL = {fmin(cp[0].x, cp[3].x), fmin(cp[0].y, cp[3].y)},
+             .UR = {fmax(cp[0].x, cp[3].x), fmax(cp[0].y, cp[3].y)}};
+  bezier_range_(cp[0].x, cp[1].x, cp[2].x, cp[3].x, &bb.LL.x, &bb.UR.x);
+  bezier_range_(cp[0].y, cp[1].y, cp[2].y, cp[3].y, &bb.LL.y, &bb.UR.y);
+  return bb;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -24,10 +24,13 @@
 #include <limits.h>
 #include <locale.h>
 #include <math.h>
+#include <common/bezier.h>
 #include <common/geomprocs.h>
 #include <common/render.h>
 #include <common/htmltable.h>
 #include <gvc/gvc.h>
+#include <gvc/gvplugin_device.h>
+#include <gvc/gvrenderplan.h>
 #include <cdt/cdt.h>
 #include <pathplan/pathgeom.h>
 #include <util/agxbuf.h>
@@ -42,6 +45,13 @@
 #include <util/unused.h>
 #include <xdot/xdot.h>
 
+#ifndef _WIN32
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 #ifdef _WIN32
 #define strtok_r strtok_s
 #endif
@@ -741,7 +751,7 @@ static pointf *pEllipse(double a, double b, size_t np) {
  * returns true if four points are in line (or close to line)
  * else return false
  */
-static bool check_control_points(pointf *cp)
+static bool check_control_points(const pointf *cp)
 {
     double dis1 = ptToLine2 (cp[0], cp[3], cp[1]);
     double dis2 = ptToLine2 (cp[0], cp[3], cp[2]);
@@ -779,7 +789,7 @@ void update_bb_bz(boxf *bb, pointf *cp)
         }
         else { /* else refine the segment */
             pointf left[4], right[4];
-            Bezier (cp, 0.5, left, right);
+            bezier_split(cp, 0.5, left, right);
             update_bb_bz(bb, left);
             update_bb_bz(bb, right);
         }
@@ -798,23 +808,6 @@ static UNUSED void psmapOutput(const points_t *ps, size_t start, size_t n) {
    fprintf (stdout, "closepath stroke\n");
 }
 
-typedef struct segitem_s {
-    pointf p;
-    struct segitem_s* next;
-} segitem_t;
-
-#define MARK_FIRST_SEG(L) ((L)->next = (segitem_t*)1)
-#define FIRST_SEG(L) ((L)->next == (segitem_t*)1)
-#define INIT_SEG(P,L) {(L)->next = 0; (L)->p = P;} 
-
-static segitem_t* appendSeg (pointf p, segitem_t* lp)
-{
-    segitem_t* s = gv_alloc(sizeof(segitem_t));
-    INIT_SEG (p, s);
-    lp->next = s;
-    return s;
-}
-
 DEFINE_LIST(pbs_size, size_t)
 
 /* Output the polygon determined by the n points in p1, followed
@@ -840,24 +833,21 @@ static void map_bspline_poly(points_t *pbs_p, pbs_size_t *pbs_n, size_t n,
  * almost colinear, as determined by check_control_points, we store
  * the segment cp[0]-cp[3]. Otherwise we split the Bezier into 2 and recurse. 
  * Since 2 contiguous segments share an endpoint, we actually store
- * the segments as a list of points.
- * New points are appended to the list given by lp. The tail of the
- * list is returned.
+ * the segments as a list of points, appended to segs.
  */
-static segitem_t* approx_bezier (pointf *cp, segitem_t* lp)
+static void approx_bezier(const pointf *cp, points_t *segs)
 {
     pointf left[4], right[4];
 
     if (check_control_points(cp)) {
-        if (FIRST_SEG (lp)) INIT_SEG (cp[0], lp);
-        lp = appendSeg (cp[3], lp);
+        if (points_is_empty(segs)) points_append(segs, cp[0]);
+        points_append(segs, cp[3]);
     }
     else {
-        Bezier (cp, 0.5, left, right);
-        lp = approx_bezier (left, lp);
-        lp = approx_bezier (right, lp);
+        bezier_split(cp, 0.5, left, right);
+        approx_bezier(left, segs);
+        approx_bezier(right, segs);
     }
-    return lp;
 }
 
 /* Return the angle of the bisector between the two rays
@@ -882,29 +872,29 @@ static double bisect (pointf pp, pointf cp, pointf np)
  * If p2 is NULL, we use the normal to prv-cur.
  * Assume at least one of prv or nxt is non-NULL.
  */
-static void mkSegPts (segitem_t* prv, segitem_t* cur, segitem_t* nxt,
+static void mkSegPts(const pointf *prv, pointf cur, const pointf *nxt,
         pointf* p1, pointf* p2, double w2)
 {
     pointf cp, pp, np;
     double theta, delx, dely;
     pointf p;
 
-    cp = cur->p;
+    cp = cur;
     /* if prv or nxt are NULL, use the one given to create a collinear
      * prv or nxt. This could be more efficiently done with special case code, 
      * but this way is more uniform.
      */
     if (prv) {
-        pp = prv->p;
+        pp = *prv;
         if (nxt)
-            np = nxt->p;
+            np = *nxt;
         else {
             np.x = 2*cp.x - pp.x;
             np.y = 2*cp.y - pp.y;
         }
     }
     else {
-        np = nxt->p;
+        np = *nxt;
         pp.x = 2*cp.x - np.x;
         pp.y = 2*cp.y - np.y;
     }
@@ -928,27 +918,20 @@ static void mkSegPts (segitem_t* prv, segitem_t* cur, segitem_t* nxt,
  */
 static void map_output_bspline(points_t *pbs, pbs_size_t *pbs_n, bezier *bp,
                                double w2) {
-    segitem_t* segl = gv_alloc(sizeof(segitem_t));
-    segitem_t* segp = segl;
-    segitem_t* segprev;
-    segitem_t* segnext;
-    pointf pts[4], pt1[50], pt2[50];
+    points_t segs = {0};
+    pointf pt1[50], pt2[50];
 
-    MARK_FIRST_SEG(segl);
     const size_t nc = (bp->size - 1) / 3; // nc is number of bezier curves
     for (size_t j = 0; j < nc; j++) {
-        for (size_t k = 0; k < 4; k++) {
-            pts[k] = bp->list[3*j + k];
-        }
-        segp = approx_bezier (pts, segp);
+        approx_bezier(&bp->list[3 * j], &segs);
     }
 
-    segp = segl;
-    segprev = 0;
+    const size_t nsegs = points_size(&segs);
     size_t cnt = 0;
-    while (segp) {
-        segnext = segp->next;
-        mkSegPts (segprev, segp, segnext, pt1+cnt, pt2+cnt, w2);
+    for (size_t i = 0; i < nsegs; i++) {
+        const pointf *segprev = i > 0 ? points_at(&segs, i - 1) : NULL;
+        const pointf *segnext = i + 1 < nsegs ? points_at(&segs, i + 1) : NULL;
+        mkSegPts(segprev, points_get(&segs, i), segnext, pt1+cnt, pt2+cnt, w2);
         cnt++;
         if (segnext == NULL || cnt == 50) {
             map_bspline_poly(pbs, pbs_n, cnt, pt1, pt2);
@@ -956,16 +939,9 @@ static void map_output_bspline(points_t *pbs, pbs_size_t *pbs_n, bezier *bp,
             pt2[0] = pt2[cnt-1];
             cnt = 1;
         }
-        segprev = segp;
-        segp = segnext;
     }
 
-    /* free segl */
-    while (segl) {
-        segp = segl->next;
-        free (segl);
-        segl = segp;
-    }
+    points_free(&segs);
 }
 
 static bool is_natural_number(const char *sstr)
@@ -2169,6 +2145,13 @@ static void emit_edge_graphics(GVJ_t * job, edge_t * e, char** styles)
 #define SEP 2.0
 
     char *previous_color_scheme = setColorScheme(agget(e, "colorscheme"));
+    gvrenderplan_t *plan = job->gvc->render_plan;
+    if (ED_spl(e) && plan) {
+	/* drawn by an earlier job, or recorded for later ones */
+	if (gvrenderplan_replay(plan, job, e, styles))
+	    goto done;
+	gvrenderplan_record(plan, job, e, styles);
+    }
     if (ED_spl(e)) {
 	arrowsize = late_double(e, E_arrowsz, 1.0, 0.0);
 	color = late_string(e, E_color, "");
@@ -2370,7 +2353,8 @@ static void emit_edge_graphics(GVJ_t * job, edge_t * e, char** styles)
 	}
     }
 
-done:;
+done:
+    gvrenderplan_stop(job);
     char *color_scheme = setColorScheme(previous_color_scheme);
     free(color_scheme);
     free(previous_color_scheme);
@@ -3192,7 +3176,330 @@ static void emit_colors(GVJ_t * job, graph_t * g)
     }
 }
 
-static void emit_view(GVJ_t * job, graph_t * g, int flags)
+/* A node or edge in the spatial index of a graph, with its position in each of
+ * the orders emit_view walks the graph in.
+ */
+typedef struct {
+    boxf bb;		/* first, for str_sort */
+    void *obj;		/* node_t or edge_t */
+    bool is_edge;
+    size_t order;	/* position among the nodes, or among the edges, in
+			   the sorted walks */
+    size_t walk;	/* position in the default graph walk */
+} emit_item_t;
+
+/* A node of the index tree, covering a run of items or of tree nodes of the
+ * level below.
+ */
+typedef struct {
+    boxf bb;		/* first, for str_sort */
+    size_t first;
+    size_t count;
+    bool leaf;		/* are the children items rather than tree nodes? */
+} emit_rnode_t;
+
+/* Spatial index of the nodes and edges of a graph, so that each page of a
+ * paginated drawing need only visit the objects that may lie on it. It is an
+ * R-tree packed once over all the objects, which the layout never moves.
+ */
+typedef struct {
+    emit_item_t *items;
+    size_t n_items;
+    emit_rnode_t *nodes;
+    size_t n_nodes;
+    size_t root_first;	/* the top level of the tree */
+    size_t root_count;
+} emit_index_t;
+
+#define EMIT_INDEX_FANOUT 16
+
+DEFINE_LIST(emit_hits, emit_item_t *)
+
+/* a box with its sides in order, so that it overlaps wherever the given box
+ * would by OVERLAP
+ */
+static boxf box_normalize(boxf b)
+{
+    return (boxf){.LL = {fmin(b.LL.x, b.UR.x), fmin(b.LL.y, b.UR.y)},
+		  .UR = {fmax(b.LL.x, b.UR.x), fmax(b.LL.y, b.UR.y)}};
+}
+
+/* add an object to the index under a box, or not at all if the box is
+ * unusable, in which case the object is in no page's clip box anyway
+ */
+static void emit_index_add(emit_index_t *index, emit_item_t item, boxf b)
+{
+    if (isnan(b.LL.x) || isnan(b.LL.y) || isnan(b.UR.x) || isnan(b.UR.y))
+	return;
+    item.bb = box_normalize(b);
+    index->items[index->n_items++] = item;
+}
+
+static boxf label_box(textlabel_t *lp)
+{
+    const pointf s = {.x = lp->dimen.x / 2.0, .y = lp->dimen.y / 2.0};
+    return (boxf){.LL = sub_pointf(lp->pos, s), .UR = add_pointf(lp->pos, s)};
+}
+
+/* the box covering everything edge_in_box tests, or false if it tests nothing
+ */
+static bool edge_box(edge_t *e, boxf *bb)
+{
+    bool found = false;
+    textlabel_t *lp;
+
+    if (ED_spl(e)) {
+	*bb = ED_spl(e)->bb;
+	found = true;
+    }
+    if ((lp = ED_label(e))) {
+	if (found)
+	    EXPANDBB(bb, label_box(lp));
+	else
+	    *bb = label_box(lp);
+	found = true;
+    }
+    if ((lp = ED_xlabel(e)) && lp->set) {
+	if (found)
+	    EXPANDBB(bb, label_box(lp));
+	else
+	    *bb = label_box(lp);
+	found = true;
+    }
+    return found;
+}
+
+static int cmp_center_x(const void *x, const void *y)
+{
+    const boxf *a = x, *b = y;
+    const double ca = a->LL.x + a->UR.x, cb = b->LL.x + b->UR.x;
+    return (ca > cb) - (ca < cb);
+}
+
+static int cmp_center_y(const void *x, const void *y)
+{
+    const boxf *a = x, *b = y;
+    const double ca = a->LL.y + a->UR.y, cb = b->LL.y + b->UR.y;
+    return (ca > cb) - (ca < cb);
+}
+
+/* Order items or tree nodes, each starting with its box, for packing into
+ * the level above (sort-tile-recursive): in vertical slices holding about as
+ * many parents as there are slices, and bottom to top within a slice.
+ */
+static void str_sort(void *base, size_t n, size_t size)
+{
+    qsort(base, n, size, cmp_center_x);
+    const size_t parents = (n + EMIT_INDEX_FANOUT - 1) / EMIT_INDEX_FANOUT;
+    const size_t slices = (size_t)ceil(sqrt((double)parents));
+    const size_t per_slice = slices * EMIT_INDEX_FANOUT;
+    for (size_t i = 0; i < n; i += per_slice) {
+	const size_t k = n - i < per_slice ? n - i : per_slice;
+	qsort((char *)base + i * size, k, size, cmp_center_y);
+    }
+}
+
+/* add the tree nodes covering a run of items or tree nodes */
+static void emit_index_pack(emit_index_t *index, size_t first, size_t count,
+			    bool leaf)
+{
+    for (size_t i = 0; i < count; i += EMIT_INDEX_FANOUT) {
+	emit_rnode_t *rn = &index->nodes[index->n_nodes++];
+	rn->first = first + i;
+	rn->count = count - i < EMIT_INDEX_FANOUT ? count - i : EMIT_INDEX_FANOUT;
+	rn->leaf = leaf;
+	for (size_t j = rn->first; j < rn->first + rn->count; j++) {
+	    const boxf b = leaf ? index->items[j].bb : index->nodes[j].bb;
+	    if (j == rn->first)
+		rn->bb = b;
+	    else
+		EXPANDBB(&rn->bb, b);
+	}
+    }
+}
+
+/* Build the spatial index of a laid out graph. Nodes are numbered in each
+ * walk by their first appearance, as a node is drawn no more than once per
+ * view.
+ */
+static emit_index_t *emit_index_build(graph_t *g)
+{
+    size_t n_nodes = 0, n_edges = 0;
+    IDTYPE max_seq = 0;
+    for (node_t *n = agfstnode(g); n; n = agnxtnode(g, n)) {
+	n_nodes++;
+	if (AGSEQ(n) > max_seq)
+	    max_seq = AGSEQ(n);
+	for (edge_t *e = agfstout(g, n); e; e = agnxtout(g, e))
+	    n_edges++;
+    }
+
+    emit_index_t *index = gv_alloc(sizeof(emit_index_t));
+    index->items = gv_calloc(n_nodes + n_edges, sizeof(emit_item_t));
+
+    /* first appearance of each node, by sequence number, in the default walk */
+    size_t *first = gv_calloc((size_t)max_seq + 1, sizeof(size_t));
+    size_t walk = 0;
+#define SEEN(n) (first[AGSEQ(n)] != 0 ? 0 : (first[AGSEQ(n)] = walk + 1))
+    for (node_t *n = agfstnode(g); n; n = agnxtnode(g, n)) {
+	SEEN(n);
+	walk++;
+	for (edge_t *e = agfstout(g, n); e; e = agnxtout(g, e)) {
+	    SEEN(aghead(e));
+	    walk += 2;
+	}
+    }
+#undef SEEN
+
+    size_t order = 0, edge_order = 0;
+    walk = 0;
+    for (node_t *n = agfstnode(g); n; n = agnxtnode(g, n)) {
+	emit_item_t item = {.obj = n, .order = order++,
+			    .walk = first[AGSEQ(n)] - 1};
+	emit_index_add(index, item, ND_bb(n));
+	walk++;
+	for (edge_t *e = agfstout(g, n); e; e = agnxtout(g, e)) {
+	    walk++;
+	    boxf bb;
+	    if (edge_box(e, &bb)) {
+		item = (emit_item_t){.obj = e, .is_edge = true,
+				     .order = edge_order, .walk = walk};
+		emit_index_add(index, item, bb);
+	    }
+	    edge_order++;
+	    walk++;
+	}
+    }
+    free(first);
+
+    /* pack the tree bottom up */
+    size_t total = 0;
+    for (size_t k = index->n_items; ; ) {
+	k = (k + EMIT_INDEX_FANOUT - 1) / EMIT_INDEX_FANOUT;
+	total += k;
+	if (k <= EMIT_INDEX_FANOUT)
+	    break;
+    }
+    index->nodes = gv_calloc(total, sizeof(emit_rnode_t));
+    str_sort(index->items, index->n_items, sizeof(emit_item_t));
+    emit_index_pack(index, 0, index->n_items, true);
+    size_t level_first = 0;
+    while (index->n_nodes - level_first > EMIT_INDEX_FANOUT) {
+	const size_t level_count = index->n_nodes - level_first;
+	str_sort(&index->nodes[level_first], level_count, sizeof(emit_rnode_t));
+	const size_t next_first = index->n_nodes;
+	emit_index_pack(index, level_first, level_count, false);
+	level_first = next_first;
+    }
+    index->root_first = level_first;
+    index->root_count = index->n_nodes - level_first;
+    return index;
+}
+
+static void emit_index_free(emit_index_t *index)
+{
+    if (index == NULL)
+	return;
+    free(index->nodes);
+    free(index->items);
+    free(index);
+}
+
+/* collect the items under some tree nodes whose boxes overlap a box */
+static void emit_index_search(const emit_index_t *index, size_t first,
+			      size_t count, boxf b, emit_hits_t *hits)
+{
+    for (size_t i = first; i < first + count; i++) {
+	const emit_rnode_t *rn = &index->nodes[i];
+	if (!OVERLAP(rn->bb, b))
+	    continue;
+	if (!rn->leaf) {
+	    emit_index_search(index, rn->first, rn->count, b, hits);
+	    continue;
+	}
+	for (size_t j = rn->first; j < rn->first + rn->count; j++) {
+	    if (OVERLAP(index->items[j].bb, b))
+		emit_hits_append(hits, &index->items[j]);
+	}
+    }
+}
+
+/* sort nodes ahead of edges, each in the order of the sorted walks */
+static int cmp_item_order(const emit_item_t **x, const emit_item_t **y)
+{
+    const emit_item_t *a = *x, *b = *y;
+    if (a->is_edge != b->is_edge)
+	return a->is_edge ? 1 : -1;
+    return (a->order > b->order) - (a->order < b->order);
+}
+
+static int cmp_item_walk(const emit_item_t **x, const emit_item_t **y)
+{
+    const emit_item_t *a = *x, *b = *y;
+    return (a->walk > b->walk) - (a->walk < b->walk);
+}
+
+/* emit the nodes and edges of a view that the index places in its clip box,
+ * in the order emit_view would find them walking the whole graph
+ */
+static void emit_view_indexed(GVJ_t *job, graph_t *g, int flags,
+			      const emit_index_t *index)
+{
+    emit_hits_t hits = {0};
+    emit_index_search(index, index->root_first, index->root_count,
+		      box_normalize(job->clip), &hits);
+    const size_t n_hits = emit_hits_size(&hits);
+
+    if (flags & (EMIT_SORTED | EMIT_EDGE_SORTED | EMIT_PREORDER)) {
+	emit_hits_sort(&hits, cmp_item_order);
+	size_t n_nodes = 0;
+	while (n_nodes < n_hits && !emit_hits_get(&hits, n_nodes)->is_edge)
+	    n_nodes++;
+	const bool preorder = !(flags & (EMIT_SORTED | EMIT_EDGE_SORTED));
+
+	if ((flags & EMIT_EDGE_SORTED) && !(flags & EMIT_SORTED)) {
+	    /* output all edges, then all nodes */
+	    gvrender_begin_edges(job);
+	    for (size_t i = n_nodes; i < n_hits; i++)
+		emit_edge(job, emit_hits_get(&hits, i)->obj);
+	    gvrender_end_edges(job);
+	    gvrender_begin_nodes(job);
+	    for (size_t i = 0; i < n_nodes; i++)
+		emit_node(job, emit_hits_get(&hits, i)->obj);
+	    gvrender_end_nodes(job);
+	} else {
+	    /* output all nodes, then all edges */
+	    gvrender_begin_nodes(job);
+	    for (size_t i = 0; i < n_nodes; i++) {
+		node_t *n = emit_hits_get(&hits, i)->obj;
+		if (!preorder || write_node_test(g, n))
+		    emit_node(job, n);
+	    }
+	    gvrender_end_nodes(job);
+	    gvrender_begin_edges(job);
+	    for (size_t i = n_nodes; i < n_hits; i++) {
+		edge_t *e = emit_hits_get(&hits, i)->obj;
+		if (!preorder || write_edge_test(g, e))
+		    emit_edge(job, e);
+	    }
+	    gvrender_end_edges(job);
+	}
+    } else {
+	/* output in breadth first graph walk order */
+	emit_hits_sort(&hits, cmp_item_walk);
+	for (size_t i = 0; i < n_hits; i++) {
+	    const emit_item_t *it = emit_hits_get(&hits, i);
+	    if (it->is_edge)
+		emit_edge(job, it->obj);
+	    else
+		emit_node(job, it->obj);
+	}
+    }
+    emit_hits_free(&hits);
+}
+
+static void emit_view(GVJ_t * job, graph_t * g, int flags,
+		      const emit_index_t *index)
 {
     GVC_t * gvc = job->gvc;
     node_t *n;
@@ -3202,7 +3509,9 @@ static void emit_view(GVJ_t * job, graph_t * g, int flags)
     /* when drawing, lay clusters down before nodes and edges */
     if (!(flags & EMIT_CLUSTERS_LAST))
 	emit_clusters(job, g, flags);
-    if (flags & EMIT_SORTED) {
+    if (index) {
+	emit_view_indexed(job, g, flags, index);
+    } else if (flags & EMIT_SORTED) {
 	/* output all nodes, then all edges */
 	gvrender_begin_nodes(job);
 	for (n = agfstnode(g); n; n = agnxtnode(g, n))
@@ -3277,32 +3586,65 @@ static void emit_end_graph(GVJ_t * job)
 
 #define NotFirstPage(j) (((j)->layerNum>1)||((j)->pagesArrayElem.x > 0)||((j)->pagesArrayElem.x > 0))
 
-static void emit_page(GVJ_t * job, graph_t * g)
+/* Bitmaps larger than this, in pixels or along either side, are drawn a tile
+ * at a time by devices that can, so that no surface for the whole image is
+ * ever needed and tiles can be rasterized in parallel.
+ */
+#define TILE_PIXELS_MIN (4096. * 4096.)
+#define TILE_SIDE_MAX 16384
+#define TILE_SIZE 1024 /* device units */
+
+static bool emit_tiled(GVJ_t *job)
+{
+    return (job->flags & GVDEVICE_DOES_TILES) && !job->external_context
+	&& job->numPages == 1
+	&& ((double)job->width * job->height > TILE_PIXELS_MIN
+	    || job->width > TILE_SIDE_MAX || job->height > TILE_SIDE_MAX);
+}
+
+/* map a position in device units to graph units, as gvevent does for the
+ * pointer
+ */
+static pointf device2graph(GVJ_t *job, double x, double y)
+{
+    pointf p;
+
+    if (job->rotation) {
+	p.x = y / (job->zoom * job->devscale.y) - job->translation.x;
+	p.y = -x / (job->zoom * job->devscale.x) - job->translation.y;
+    }
+    else {
+	p.x = x / (job->zoom * job->devscale.x) - job->translation.x;
+	p.y = y / (job->zoom * job->devscale.y) - job->translation.y;
+    }
+    return p;
+}
+
+/* The part of the page clip box covered by the current tile, in graph units.
+ * The tile is widened by a pixel on each side so that its edges are cut by
+ * the edges of the tile surface rather than by clipping.
+ */
+static boxf tile_clip(GVJ_t *job, boxf page)
+{
+    boxf tile = box_normalize((boxf){
+	.LL = device2graph(job, job->tile.LL.x - 1, job->tile.LL.y - 1),
+	.UR = device2graph(job, job->tile.UR.x + 1, job->tile.UR.y + 1)});
+
+    tile.LL.x = fmax(tile.LL.x, page.LL.x);
+    tile.LL.y = fmax(tile.LL.y, page.LL.y);
+    tile.UR.x = fmax(fmin(tile.UR.x, page.UR.x), tile.LL.x);
+    tile.UR.y = fmax(fmin(tile.UR.y, page.UR.y), tile.LL.y);
+    return tile;
+}
+
+static void emit_page_body(GVJ_t * job, graph_t * g, const emit_index_t *index)
 {
     obj_state_t *obj = job->obj;
     int flags = job->flags;
     size_t nump = 0;
     textlabel_t *lab;
     pointf *p = NULL;
-    char* saveid;
-    agxbuf xb = {0};
-
-    /* For the first page, we can use the values generated in emit_begin_graph. 
-     * For multiple pages, we need to generate a new id.
-     */
-    bool obj_id_needs_restore = false;
-    if (NotFirstPage(job)) {
-	saveid = obj->id;
-	layerPagePrefix (job, &xb);
-	agxbput(&xb, saveid == NULL ? "layer" : saveid);
-	obj->id = agxbuse(&xb);
-	obj_id_needs_restore = true;
-    }
-    else
-	saveid = NULL;
 
-    char *previous_color_scheme = setColorScheme(agget(g, "colorscheme"));
-    setup_page(job);
     gvrender_begin_page(job);
     gvrender_set_pencolor(job, DEFAULT_COLOR);
     gvrender_set_fillcolor(job, DEFAULT_FILL);
@@ -3344,8 +3686,58 @@ static void emit_page(GVJ_t * job, graph_t * g)
 	emit_label(job, EMIT_GLABEL, GD_label(g));
     if (!(flags & EMIT_CLUSTERS_LAST) && (obj->url || obj->explicit_tooltip))
 	gvrender_end_anchor(job);
-    emit_view(job,g,flags);
+    emit_view(job, g, flags, index);
     gvrender_end_page(job);
+}
+
+/* Draw the page a tile at a time, left to right and then down in device
+ * space, with the clip box of each narrowed to the tile so that the index
+ * passes over whatever is drawn elsewhere.
+ */
+static void emit_page_tiles(GVJ_t * job, graph_t * g, const emit_index_t *index)
+{
+    const boxf page = job->clip;
+
+    for (unsigned y = 0; y < job->height; y += TILE_SIZE) {
+	for (unsigned x = 0; x < job->width; x += TILE_SIZE) {
+	    job->tile.LL.x = (int)x;
+	    job->tile.LL.y = (int)y;
+	    job->tile.UR.x = (int)MIN(x + TILE_SIZE, job->width);
+	    job->tile.UR.y = (int)MIN(y + TILE_SIZE, job->height);
+	    job->clip = tile_clip(job, page);
+	    emit_page_body(job, g, index);
+	}
+    }
+    job->tile = (box){{0, 0}, {0, 0}};
+    job->clip = page;
+}
+
+static void emit_page(GVJ_t * job, graph_t * g, const emit_index_t *index)
+{
+    obj_state_t *obj = job->obj;
+    char* saveid;
+    agxbuf xb = {0};
+
+    /* For the first page, we can use the values generated in emit_begin_graph. 
+     * For multiple pages, we need to generate a new id.
+     */
+    bool obj_id_needs_restore = false;
+    if (NotFirstPage(job)) {
+	saveid = obj->id;
+	layerPagePrefix (job, &xb);
+	agxbput(&xb, saveid == NULL ? "layer" : saveid);
+	obj->id = agxbuse(&xb);
+	obj_id_needs_restore = true;
+    }
+    else
+	saveid = NULL;
+
+    char *previous_color_scheme = setColorScheme(agget(g, "colorscheme"));
+    setup_page(job);
+    if (emit_tiled(job))
+	emit_page_tiles(job, g, index);
+    else
+	emit_page_body(job, g, index);
     if (obj_id_needs_restore) {
 	obj->id = saveid;
     }
@@ -3386,6 +3778,8 @@ void emit_graph(GVJ_t * job, graph_t * g)
     gvrender_comment(job, s);
 
     job->layerNum = 0;
+    /* not the last page of a previous graph */
+    job->pagesArrayElem = (point){0};
     emit_begin_graph(job, g);
 
     if (flags & EMIT_COLORS)
@@ -3394,6 +3788,12 @@ void emit_graph(GVJ_t * job, graph_t * g)
     /* reset node state */
     for (n = agfstnode(g); n; n = agnxtnode(g, n))
 	ND_state(n) = 0;
+    /* index nodes and edges by position if there are pages or tiles to pick
+     * them for
+     */
+    emit_index_t *index = NULL;
+    if (job->numPages > 1 || emit_tiled(job))
+	index = emit_index_build(g);
     /* iterate layers */
     for (firstlayer(job,&lp); validlayer(job); nextlayer(job,&lp)) {
 	if (numPhysicalLayers (job) > 1)
@@ -3401,11 +3801,12 @@ void emit_graph(GVJ_t * job, graph_t * g)
 
 	/* iterate pages */
 	for (firstpage(job); validpage(job); nextpage(job))
-	    emit_page(job, g);
+	    emit_page(job, g, index);
 
 	if (numPhysicalLayers (job) > 1)
 	    gvrender_end_layer(job);
     } 
+    emit_index_free(index);
     emit_end_graph(job);
 }
 
@@ -3753,25 +4154,17 @@ char **parse_style(char *s)
 
 static boxf bezier_bb(bezier bz)
 {
-    pointf p, p1, p2;
     boxf bb;
 
     assert(bz.size > 0);
     assert(bz.size % 3 == 1);
     bb.LL = bb.UR = bz.list[0];
-    for (size_t i = 1; i < bz.size;) {
-	/* take mid-point between two control points for bb calculation */
-	p1=bz.list[i];
-	i++;
-	p2=bz.list[i];
-	i++;
-	p.x = ( p1.x + p2.x ) / 2;
-	p.y = ( p1.y + p2.y ) / 2;
-        expandbp(&bb, p);
-
-	p=bz.list[i];
-        expandbp(&bb, p);
-	i++;
+    for (size_t i = 0; i + 3 < bz.size; i += 3) {
+	/* the curve, not just its end points, has to be inside the box for
+	 * edge_in_box to find every edge that crosses a page or tile
+	 */
+	const boxf b = bezier_bounds(&bz.list[i]);
+	EXPANDBB(&bb, b);
     }
     return bb;
 }
@@ -3874,7 +4267,132 @@ void gv_fixLocale (int set)
 }
 
 
-#define FINISH() if (Verbose) fprintf(stderr,"gvRenderJobs %s: %.2f secs.\n", agnameof(g), elapsed_sec())
+#define FINISH() do { \
+	gvrenderplan_free(gvc->render_plan); \
+	gvc->render_plan = NULL; \
+	if (Verbose) fprintf(stderr,"gvRenderJobs %s: %.2f secs.\n", agnameof(g), elapsed_sec()); \
+    } while (0)
+
+#ifndef _WIN32
+/* Can the job be rendered in a process of its own?  Not if it can take the
+ * pages of later graphs into the same document, as it does when rendering
+ * one at a time.
+ */
+static bool job_forkable(GVJ_t *job)
+{
+    return !(job->flags & GVDEVICE_DOES_PAGES);
+}
+
+/* Can the jobs be rendered side by side?  Only if every one writes a whole
+ * file of its own, none is interactive, and at least one can be forked.
+ */
+static bool jobs_forkable(GVC_t *gvc)
+{
+    GVJ_t *job, *other;
+    size_t n = 0, forkable = 0;
+
+    if (!gvc->parallel_jobs || gvc->active_jobs || gvc->write_fn)
+	return false;
+    for (job = gvc->jobs; job; job = job->next, n++) {
+	if (job->output_data || job->output_sink || job->output_file)
+	    return false;
+	if (gvrender_select(job, job->output_langname) == NO_SUPPORT
+	  || (job->flags & GVDEVICE_EVENTS)
+	  || (job->device.engine && job->device.engine->initialize))
+	    return false;
+	if (!gvc->common.auto_outfile_names && !job->output_filename)
+	    return false;
+	for (other = gvc->jobs; other != job; other = other->next) {
+	    if (gvc->common.auto_outfile_names
+	      ? streq(job->output_langname, other->output_langname)
+	      : streq(job->output_filename, other->output_filename))
+		return false;
+	}
+	if (job_forkable(job))
+	    forkable++;
+    }
+    return n > 1 && forkable > 0;
+}
+
+/* Render each forkable job start to finish in a child process, so that the
+ * formats are produced side by side, and the rest here meanwhile.  Each child
+ * gets its own copy of the laid out graph and of all render state, so nothing
+ * is shared between them.
+ */
+static int render_jobs_forked(GVC_t *gvc, graph_t *g)
+{
+    GVJ_t *jobs = gvc->jobs, *job;
+    size_t n = 0, i, forked = 0, kept = 0;
+    int rc = 0;
+
+    for (job = jobs; job; job = job->next)
+	n++;
+    GVJ_t **order = gv_calloc(n, sizeof(GVJ_t *));
+    GVJ_t **children = gv_calloc(n, sizeof(GVJ_t *));
+    GVJ_t **here = gv_calloc(n, sizeof(GVJ_t *));
+    pid_t *pids = gv_calloc(n, sizeof(pid_t));
+
+    for (i = 0, job = jobs; job; job = job->next)
+	order[i++] = job;
+
+    /* don't have buffered output written again by every child */
+    fflush(NULL);
+    for (i = 0; i < n; i++) {
+	job = order[i];
+	const pid_t pid = job_forkable(job) ? fork() : -1;
+	if (pid == 0) {
+	    /* errors seen before the fork are not this job's */
+	    agreseterrors();
+	    gvc->jobs = job;
+	    job->next = NULL;
+	    gvc->parallel_jobs = false;
+	    int r = gvRenderJobs(gvc, g);
+	    gvFinalize(gvc);
+	    fflush(NULL);
+	    _exit(r != 0 || agerrors() > 0);
+	}
+	if (pid < 0) {
+	    here[kept++] = job;
+	} else {
+	    children[forked] = job;
+	    pids[forked++] = pid;
+	}
+    }
+
+    /* render whatever could not be forked here, as a job list of its own */
+    if (kept > 0) {
+	for (i = 0; i < kept; i++)
+	    here[i]->next = i + 1 < kept ? here[i + 1] : NULL;
+	gvc->jobs = here[0];
+	gvc->parallel_jobs = false;
+	rc = gvRenderJobs(gvc, g);
+	gvc->parallel_jobs = true;
+	for (i = 0; i < n; i++)
+	    order[i]->next = i + 1 < n ? order[i + 1] : NULL;
+	gvc->jobs = jobs;
+    }
+
+    for (i = 0; i < forked; i++) {
+	int status = 0;
+	pid_t r;
+	while ((r = waitpid(pids[i], &status, 0)) < 0 && errno == EINTR)
+	    ;
+	if (r < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+	    agerrorf("rendering -T%s failed\n", children[i]->output_langname);
+	    rc = -1;
+	}
+	/* the child finished the job and closed its output, so later graphs
+	 * must not write the file again, just as when rendering one at a time
+	 */
+	children[i]->output_filename = NULL;
+    }
+    free(pids);
+    free(here);
+    free(children);
+    free(order);
+    return rc;
+}
+#endif
 
 int gvRenderJobs (GVC_t * gvc, graph_t * g)
 {
@@ -3894,6 +4412,18 @@ int gvRenderJobs (GVC_t * gvc, graph_t * g)
     init_gvc(gvc, g);
     init_layering(gvc, g);
 
+#ifndef _WIN32
+    if (jobs_forkable(gvc)) {
+	const int rc = render_jobs_forked(gvc, g);
+	FINISH();
+	return rc;
+    }
+#endif
+
+    /* with more than one job, drawing the first works out is shared */
+    if (gvc->jobs && gvc->jobs->next)
+	gvc->render_plan = gvrenderplan_new();
+
     gv_fixLocale (1);
     for (job = gvjobs_first(gvc); job; job = gvjobs_next(gvc)) {
 	if (gvc->gvg) {
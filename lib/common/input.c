@@ -272,6 +272,8 @@ int dotneato_args_initialize(GVC_t * gvc, int argc, char **argv)
 	} else if (argv[i] && startswith(argv[i], "--filepath=")) {
 	    free(Gvfilepath);
 	    Gvfilepath = gv_strdup(argv[i] + strlen("--filepath="));
+	} else if (argv[i] && strcmp(argv[i], "--parallel") == 0) {
+	    gvc->parallel_jobs = true;
 	} else if (argv[i] && argv[i][0] == '-') {
 	    char *const rest = &argv[i][2];
 	    switch (c = argv[i][1]) {
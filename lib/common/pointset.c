@@ -20,9 +20,17 @@ typedef struct {
     pointf id;
 } pair;
 
+/// the key of a point
+///
+/// Point sets are hashed on the bytes of their keys, so `-0.0` is turned into
+/// `0.0` to keep the two equal as they compare.
+static pointf key(pointf p) {
+    return (pointf){.x = p.x + 0.0, .y = p.y + 0.0};
+}
+
 static pair *mkPair(pointf p) {
     pair *pp = gv_alloc(sizeof(pair));
-    pp->id = p;
+    pp->id = key(p);
     return pp;
 }
 
@@ -67,7 +75,7 @@ static Dtdisc_t intPairDisc = {
 
 PointSet *newPS(void)
 {
-    return (dtopen(&intPairDisc, Dtoset));
+    return (dtopen(&intPairDisc, Dtprobe));
 }
 
 void freePS(PointSet * ps)
@@ -92,7 +100,7 @@ void addPS(PointSet *ps, double x, double y) {
 
 int inPS(PointSet *ps, pointf pt) {
     pair p;
-    p.id = pt;
+    p.id = key(pt);
     return dtsearch(ps, &p) ? 1 : 0;
 }
 
@@ -145,7 +153,7 @@ static Dtdisc_t intMPairDisc = {
 
 PointMap *newPM(void)
 {
-  return dtopen(&intMPairDisc, Dtoset);
+  return dtopen(&intMPairDisc, Dtprobe);
 }
 
 void clearPM(PointMap * ps)
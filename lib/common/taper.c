@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <types.h>
+#include <common/bezier.h>
 #include <common/render.h>
 #include <common/utils.h>
 #include <util/agxbuf.h>
@@ -129,10 +130,10 @@ static double l2dist (pointf p0, pointf p1)
  * turn all curves into lines
  */
 static vararr_t pathtolines(bezier *bez) {
-    int step;
     double seglen, linelen = 0;
     vararr_t arr = {0};
-    pointf p0, p1, V[4];
+    pointf p0, V[4];
+    pointf pts[BEZIERSUBDIVISION + 1];
     const size_t n = bez->size;
     pointf* A = bez->list;
 
@@ -143,8 +144,9 @@ static vararr_t pathtolines(bezier *bez) {
 	for (size_t j = 1; j <= 3; j++)
 	    V[j] = A[i + j];
 	p0 = V[0];
-	for (step = 1; step <= BEZIERSUBDIVISION; step++) {
-	    p1 = Bezier(V, (double) step / BEZIERSUBDIVISION, NULL, NULL);
+	bezier_points(V, BEZIERSUBDIVISION, pts);
+	for (size_t step = 1; step <= BEZIERSUBDIVISION; step++) {
+	    const pointf p1 = pts[step];
 	    seglen = l2dist(p0, p1);
 	    /* If initwid is large, this may never happen, so turn off. I assume this is to prevent
 	     * too man points or too small a movement. Perhaps a better test can be made, but for now
@@ -11,10 +11,12 @@
  *************************************************************************/
 
 #include <common/render.h>
+#include <common/bezier.h>
 #include <common/geomprocs.h>
 #include <common/htmltable.h>
 #include <common/entities.h>
 #include <limits.h>
+#include <locale.h>
 #include <math.h>
 #include <gvc/gvc.h>
 #include <stdatomic.h>
@@ -33,35 +35,66 @@
 #include <util/strview.h>
 #include <util/tokenize.h>
 
+/// how a value kept in an `Agparsed_t` was parsed
+enum {
+    PARSED_DOUBLE = 1,     ///< by `strtod`
+    PARSED_LONG,           ///< by `strtol`
+    PARSED_BOOL,           ///< by `mapbool`, as 0 or 1
+    PARSED_INVALID = 0x80, ///< flag: nothing could be parsed
+};
+
+/// parse an attribute value, or find it already parsed
+///
+/// Each object’s value of an attribute has its parsed form kept with it by
+/// cgraph, which clears it when the value changes, so a value is parsed once
+/// however often layout reads it. Objects with the default share the parsed
+/// default. Reading under another locale parses again, as what `strtod`
+/// accepts depends on the decimal point. A missing or empty value is invalid
+/// as a number.
+static const Agparsed_t *parse(void *obj, attrsym_t *attr, unsigned char how) {
+    char *p;
+    Agparsed_t *v = agxparsed(obj, attr, &p);
+    const char radix = how == PARSED_DOUBLE ? localeconv()->decimal_point[0]
+                                            : '\0';
+    if ((v->how & ~PARSED_INVALID) == how && v->radix == radix)
+        return v;
+
+    char *endp = NULL;
+    if (how == PARSED_BOOL) {
+        v->number = mapbool(p);
+    } else if (!p || p[0] == '\0') {
+        endp = p;
+    } else if (how == PARSED_DOUBLE) {
+        v->number = strtod(p, &endp);
+    } else {
+        v->number = (double)strtol(p, &endp, 10);
+    }
+    v->how = endp == p ? (how | PARSED_INVALID) : how;
+    v->radix = radix;
+    return v;
+}
+
 int late_int(void *obj, attrsym_t *attr, int defaultValue, int minimum) {
     if (attr == NULL)
         return defaultValue;
-    char *p = ag_xget(obj, attr);
-    if (!p || p[0] == '\0')
-        return defaultValue;
-    char *endp;
-    long rv = strtol(p, &endp, 10);
-    if (p == endp || rv > INT_MAX)
+    const Agparsed_t *v = parse(obj, attr, PARSED_LONG);
+    if ((v->how & PARSED_INVALID) || v->number > INT_MAX)
         return defaultValue; /* invalid int format */
-    if (rv < minimum)
+    if (v->number < minimum)
         return minimum;
-    return (int)rv;
+    return (int)v->number;
 }
 
 double late_double(void *obj, attrsym_t *attr, double defaultValue,
                    double minimum) {
     if (!attr || !obj)
         return defaultValue;
-    char *p = ag_xget(obj, attr);
-    if (!p || p[0] == '\0')
-        return defaultValue;
-    char *endp;
-    double rv = strtod(p, &endp);
-    if (p == endp)
+    const Agparsed_t *v = parse(obj, attr, PARSED_DOUBLE);
+    if (v->how & PARSED_INVALID)
         return defaultValue; /* invalid double format */
-    if (rv < minimum)
+    if (v->number < minimum)
         return minimum;
-    return rv;
+    return v->number;
 }
 
 /** Return value for PSinputscale. If this is > 0, it has been set on the
@@ -95,7 +128,7 @@ bool late_bool(void *obj, attrsym_t *attr, bool defaultValue) {
     if (attr == NULL)
         return defaultValue;
 
-    return mapbool(agxget(obj, attr));
+    return parse(obj, attr, PARSED_BOOL)->number != 0;
 }
 
 node_t *UF_find(node_t * n)
@@ -160,7 +193,6 @@ pointf coord(node_t * n)
 }
 
 /* from Glassner's Graphics Gems */
-#define W_DEGREE 5
 
 /*
  *	Evaluate a Bezier curve at a particular parameter value
@@ -169,33 +201,7 @@ pointf coord(node_t * n)
  *
  */
 pointf Bezier(pointf *V, double t, pointf *Left, pointf *Right) {
-    const int degree = 3;
-    int i, j;			/* Index variables      */
-    pointf Vtemp[W_DEGREE + 1][W_DEGREE + 1];
-
-    /* Copy control points  */
-    for (j = 0; j <= degree; j++) {
-	Vtemp[0][j] = V[j];
-    }
-
-    /* Triangle computation */
-    for (i = 1; i <= degree; i++) {
-	for (j = 0; j <= degree - i; j++) {
-	    Vtemp[i][j].x =
-		(1.0 - t) * Vtemp[i - 1][j].x + t * Vtemp[i - 1][j + 1].x;
-	    Vtemp[i][j].y =
-		(1.0 - t) * Vtemp[i - 1][j].y + t * Vtemp[i - 1][j + 1].y;
-	}
-    }
-
-    if (Left != NULL)
-	for (j = 0; j <= degree; j++)
-	    Left[j] = Vtemp[j][0];
-    if (Right != NULL)
-	for (j = 0; j <= degree; j++)
-	    Right[j] = Vtemp[degree - j][j];
-
-    return Vtemp[degree][0];
+    return bezier_split(V, t, Left, Right);
 }
 
 #ifdef DEBUG
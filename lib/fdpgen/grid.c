@@ -25,6 +25,7 @@
 #include <fdpgen/grid.h>
 #include <common/macros.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 #include <util/alloc.h>
 
@@ -110,6 +111,12 @@ static int ijcmpf(void *point1, void *point2) {
     return 0;
 }
 
+static int cellcmpf(const void *a, const void *b) {
+    cell *const *c1 = a;
+    cell *const *c2 = b;
+    return ijcmpf(&(*c1)->p, &(*c2)->p);
+}
+
 static Grid _grid; // hack because can't attach info. to Dt_t
 
 /* newCell:
@@ -164,7 +171,7 @@ Grid *mkGrid(int cellHint)
 {
     Grid *g = &_grid;
     memset(g, 0, sizeof(*g)); // see comment above
-    g->data = dtopen(&gridDisc, Dtoset);
+    g->data = dtopen(&gridDisc, Dtprobe);
     g->cellMem = newBlock(cellHint);
     return g;
 }
@@ -227,17 +234,28 @@ void addGrid(Grid * g, int i, int j, Agnode_t * n)
     }
 }
 
-typedef int (*walkfn_t)(void*, void*);
-
 /* walkGrid:
  * Apply function walkf to each cell in the grid.
- * The second argument to walkf is the cell; the
- * third argument is the grid. (The first argument
- * is the dictionary.) walkf must return 0.
+ * The first argument to walkf is the cell; the
+ * second argument is the grid. walkf must return 0.
+ * Cells are hashed for fast lookup, so they are sorted
+ * by index here to keep the order in which forces are
+ * summed, and hence the layout, independent of the table.
  */
 void walkGrid(Grid *g, int (*walkf)(cell*, Grid*))
 {
-    dtwalk(g->data, (walkfn_t) walkf, g);
+    const size_t n = (size_t)dtsize(g->data);
+    cell **cells = gv_calloc(n, sizeof(cell *));
+    size_t i = 0;
+
+    for (cell *cp = dtfirst(g->data); cp; cp = dtnext(g->data, cp))
+	cells[i++] = cp;
+    qsort(cells, n, sizeof(cell *), cellcmpf);
+    for (i = 0; i < n; i++) {
+	if (walkf(cells[i], g) != 0)
+	    break;
+    }
+    free(cells);
 }
 
 /* findGrid;
@@ -20,6 +20,7 @@
 #include <math.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <util/alloc.h>
 
 GVC_t *gvContext(void)
 {
@@ -216,6 +217,51 @@ int gvRenderData(GVC_t *gvc, graph_t *g, const char *format, char **result,
     return rc;
 }
 
+/* output is handed to the sink of gvRenderStream in chunks of this many bytes */
+#define OUTPUT_SINK_CHUNK_SIZE (64 * 1024)
+
+/* Render layout in a specified format, passing the output to a sink in
+ * chunks as it is produced
+ */
+int gvRenderStream(GVC_t *gvc, graph_t *g, const char *format,
+                   size_t (*sink)(void *context, const char *data, size_t len),
+                   void *context) {
+    int rc;
+    GVJ_t *job;
+
+    /* create a job for the required format */
+    bool r = gvjobs_output_langname(gvc, format);
+    job = gvc->job;
+    if (!r) {
+	agerrorf("Format: \"%s\" not recognized. Use one of:%s\n",
+                format, gvplugin_list(gvc, API_device, format));
+	return -1;
+    }
+
+    job->output_lang = gvrender_select(job, job->output_langname);
+    if (!LAYOUT_DONE(g) && !(job->flags & LAYOUT_NOT_REQUIRED)) {
+	agerrorf( "Layout was not done\n");
+	return -1;
+    }
+
+    char *chunk = gv_alloc(OUTPUT_SINK_CHUNK_SIZE);
+    job->output_data = chunk;
+    job->output_data_allocated = OUTPUT_SINK_CHUNK_SIZE;
+    job->output_data_position = 0;
+    job->output_sink = sink;
+    job->output_sink_context = context;
+
+    rc = gvRenderJobs(gvc, g);
+    gvrender_end_job(job);
+    if (job->output_sink_failed)
+	rc = -1;
+
+    free(chunk);
+    gvjobs_delete(gvc);
+
+    return rc;
+}
+
 /* gvFreeRenderData:
  * Utility routine to free memory allocated in gvRenderData, as the application code may use
  * a different runtime library.
@@ -98,6 +98,16 @@ GVC_API int gvRenderContext(GVC_t *gvc, graph_t *g, const char *format, void *co
 GVC_API int gvRenderData(GVC_t *gvc, graph_t *g, const char *format,
                          char **result, size_t *length);
 
+/* Render layout in a specified format, passing the output to sink(context,
+ * data, len) in chunks of 64KiB as it is produced, and a shorter last chunk.
+ * The sink returns how many bytes it took. If that is ever short, the rest of
+ * the output is dropped and -1 is returned.
+ */
+GVC_API int gvRenderStream(GVC_t *gvc, graph_t *g, const char *format,
+                           size_t (*sink)(void *context, const char *data,
+                                          size_t len),
+                           void *context);
+
 /* Free memory allocated and pointed to by *result in gvRenderData */
 GVC_API void gvFreeRenderData (char* data);
 
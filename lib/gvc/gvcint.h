@@ -122,6 +122,10 @@ extern "C" {
 
 	char *graphname;	/* name from graph */
 	GVJ_t *active_jobs;   /* linked list of active jobs */
+	/* drawing shared by the jobs of the current gvRenderJobs() */
+	struct gvrenderplan_s *render_plan;
+	/* run jobs writing to separate files in processes of their own */
+	bool parallel_jobs;
 
 	/* pagination */
 	char *pagedir;		/* pagination order */
@@ -57,6 +57,7 @@ extern "C" {
  GVDEVICE_BINARY_FORMAT		Suppresses \r\n substitution for linends 
  GVDEVICE_COMPRESSED_FORMAT	controls libz compression		
  GVDEVICE_NO_WRITER		used when gvdevice is not used because device uses its own writer, devil outputs   (FIXME seems to overlap OUTPUT_NOT_REQUIRED)
+ GVDEVICE_DOES_TILES		draws large bitmaps a tile at a time -Tpng:cairo
 
  GVRENDER_Y_GOES_DOWN		device origin top left, y goes down, otherwise
   				device origin lower left, y goes up	
@@ -93,6 +94,7 @@ extern "C" {
 #define GVDEVICE_NO_WRITER (1<<11)
 #define GVRENDER_Y_GOES_DOWN (1<<12)
 #define GVRENDER_DOES_TRANSFORM (1<<13)
+#define GVDEVICE_DOES_TILES (1<<14)
 #define GVRENDER_DOES_LABELS (1<<15)
 #define GVRENDER_DOES_MAPS (1<<16)
 #define GVRENDER_DOES_MAP_RECTANGLE (1<<17)
@@ -356,6 +358,16 @@ extern "C" {
 	gvevent_key_binding_t *keybindings;
 	size_t numkeys;
 	void *keycodes;
+
+	struct gvdeflate_s *deflate; ///< compression state of compressed formats
+	box	tile;		/* current tile if drawing in tiles, else empty - device units */
+	void	*tiles;		/* device state while drawing in tiles */
+	/* if set, receives output_data in whole chunks as it fills */
+	size_t (*output_sink)(void *context, const char *data, size_t len);
+	void *output_sink_context;
+	bool output_sink_failed;	/* output_sink took less than it was given */
+	/// if set, drawing calls are also recorded here for later jobs to replay
+	struct gvrenderplan_drawing_s *recording;
     };
 
 #ifdef __cplusplus
@@ -18,6 +18,7 @@
 
 #include "config.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 
 #include "builddate.h"
@@ -29,6 +30,7 @@
 #include <gvc/gvcproc.h>
 #include <gvc/gvc.h>
 #include <util/alloc.h>
+#include <util/prisize_t.h>
 
 /* from common/textspan.c */
 extern void textfont_dict_close(GVC_t *gvc);
@@ -67,6 +69,14 @@ int gvFreeContext(GVC_t * gvc)
     gvplugin_package_t *package, *package_next;
     gvplugin_available_t *api, *api_next;
 
+    if (Verbose) {
+	const gvusershape_stats_t us = gvusershape_stats();
+	if (us.size_hits + us.size_misses > 0)
+	    fprintf(stderr, "user shapes: %" PRISIZE_T " found, %" PRISIZE_T
+	            " read; images: %" PRISIZE_T " reused, %" PRISIZE_T
+	            " decoded\n", us.size_hits, us.size_misses, us.image_hits,
+	            us.image_misses);
+    }
     emit_once_reset();
     gvg_next = gvc->gvgs;
     while ((gvg = gvg_next)) {
@@ -63,6 +63,13 @@ gvplugin_available_t *gvplugin_load(GVC_t *gvc, api_t api, const char *type,
     point gvusershape_size_dpi(usershape_t *us, pointf dpi);
     point gvusershape_size(graph_t *g, char *name);
     usershape_t *gvusershape_find(const char *name);
+    /* after a loadimage plugin has drawn a shape that held data beforehand */
+    void gvusershape_used(usershape_t *us, const void *data);
+    typedef struct {
+	size_t size_hits, size_misses;   /* shapes found or read for sizing */
+	size_t image_hits, image_misses; /* decoded images reused or decoded */
+    } gvusershape_stats_t;
+    gvusershape_stats_t gvusershape_stats(void);
 
 /* device */
     int gvdevice_initialize(GVJ_t * job);
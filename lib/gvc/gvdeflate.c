@@ -0,0 +1,398 @@
+/// @file
+/// @brief gzip and zlib compression of device output
+///
+/// Writes are gathered into blocks of @ref BLOCK_SIZE bytes. Every block is
+/// deflated on its own, with the last 32KiB of input before it set as its
+/// dictionary so that compression barely suffers, and ends in a sync flush so
+/// that the compressed blocks can simply be concatenated. Once an output grows
+/// past its first block, worker threads are started to deflate blocks while
+/// the caller goes on producing output, and compressed blocks are written back
+/// in order by the caller whenever it hands over another block.
+
+#include "config.h"
+
+#include <gvc/gvdeflate.h>
+
+#ifdef HAVE_LIBZ
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/alloc.h>
+#include <zlib.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#ifndef OS_CODE
+#define OS_CODE 0x03 /* assume Unix */
+#endif
+
+enum {
+  BLOCK_SIZE = 128 * 1024, ///< input bytes per block
+  DICT_SIZE = 32 * 1024,   ///< dictionary bytes carried over between blocks
+  THREADS_MAX = 8,         ///< most threads to deflate with
+  RING_SIZE = 2 * THREADS_MAX + 1, ///< blocks in flight, plus one filling
+};
+
+static const unsigned char z_file_header[] = {
+    0x1f, 0x8b, /*magic*/ Z_DEFLATED, 0 /*flags*/, 0, 0, 0, 0 /*time*/,
+    0 /*xflags*/, OS_CODE};
+
+/// zlib header for a 32KiB window at the default compression level
+static const unsigned char zlib_header[] = {0x78, 0x9c};
+
+/// a block of input and, once deflated, its output
+typedef struct {
+  unsigned char *in; ///< dictionary followed by input
+  size_t dict;       ///< bytes of `in` that are dictionary
+  size_t len;        ///< bytes of `in` that are input, after the dictionary
+  bool last;         ///< is this the final block of the stream?
+  unsigned char *out;
+  size_t out_len;
+  size_t out_cap;
+  uLong check; ///< CRC-32 or Adler-32 of the input
+  int status;
+  bool done; ///< has `out` been filled in?
+} block_t;
+
+struct gvdeflate_s {
+  void *chan;
+  gvdeflate_write_f write;
+  bool zlib; ///< zlib rather than gzip framing, checked with Adler-32
+  z_stream z; ///< deflater for blocks done by the caller
+  uLong check;
+  uint64_t total_in;
+  int err; ///< first error seen, after which nothing more is written
+
+  /// Blocks are numbered in the order they were filled, and block `i` lives in
+  /// `ring[i % RING_SIZE]`. Those from `written` up to `submitted` are being
+  /// deflated or waiting to be written, and block `submitted` is filling.
+  block_t ring[RING_SIZE];
+  size_t written;
+  size_t submitted;
+  size_t limit; ///< most blocks to have in flight
+
+#ifdef HAVE_PTHREAD
+  bool threads_tried;
+  size_t nthreads;
+  pthread_t threads[THREADS_MAX];
+  pthread_mutex_t lock;
+  pthread_cond_t work;    ///< signaled when a block is submitted
+  pthread_cond_t done;    ///< signaled when a block is deflated
+  size_t taken;           ///< next block for a worker to deflate
+  bool stopping;
+#endif
+};
+
+static block_t *slot(gvdeflate_t *d, size_t i) {
+  return &d->ring[i % RING_SIZE];
+}
+
+static int init(z_stream *z) {
+  *z = (z_stream){0};
+  return deflateInit2(z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS,
+                      MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY);
+}
+
+/// deflate a block into its output buffer
+static void deflate_block(z_stream *z, block_t *b, bool zlib) {
+  unsigned char *const in = b->in + b->dict;
+  b->check = zlib ? adler32(adler32(0L, Z_NULL, 0), in, (uInt)b->len)
+                  : crc32(crc32(0L, Z_NULL, 0), in, (uInt)b->len);
+  b->out_len = 0;
+
+  int r = deflateReset(z);
+  if (r == Z_OK && b->dict > 0) {
+    r = deflateSetDictionary(z, b->in, (uInt)b->dict);
+  }
+  if (r != Z_OK) {
+    b->status = r;
+    return;
+  }
+
+  // a sync flush ends the block on a byte boundary with a few bytes beyond
+  // what a finished stream would take
+  const size_t bound = deflateBound(z, (uLong)b->len) + 16;
+  if (b->out_cap < bound) {
+    b->out = gv_realloc(b->out, b->out_cap, bound);
+    b->out_cap = bound;
+  }
+
+  const int flush = b->last ? Z_FINISH : Z_SYNC_FLUSH;
+  z->next_in = in;
+  z->avail_in = (uInt)b->len;
+  for (;;) {
+    z->next_out = b->out + b->out_len;
+    z->avail_out = (uInt)(b->out_cap - b->out_len);
+    r = deflate(z, flush);
+    b->out_len = (size_t)(z->next_out - b->out);
+    if (r == Z_STREAM_END || (r == Z_OK && flush != Z_FINISH &&
+                              z->avail_in == 0 && z->avail_out > 0)) {
+      b->status = Z_OK;
+      return;
+    }
+    if (r != Z_OK && r != Z_BUF_ERROR) {
+      b->status = r;
+      return;
+    }
+    if (z->avail_out == 0) {
+      b->out = gv_realloc(b->out, b->out_cap, 2 * b->out_cap);
+      b->out_cap *= 2;
+    }
+  }
+}
+
+#ifdef HAVE_PTHREAD
+static void *worker(void *arg) {
+  gvdeflate_t *const d = arg;
+  z_stream z;
+  const int ready = init(&z);
+
+  pthread_mutex_lock(&d->lock);
+  for (;;) {
+    while (!d->stopping && d->taken == d->submitted) {
+      pthread_cond_wait(&d->work, &d->lock);
+    }
+    if (d->taken == d->submitted) {
+      break;
+    }
+    block_t *const b = slot(d, d->taken++);
+    pthread_mutex_unlock(&d->lock);
+
+    if (ready == Z_OK) {
+      deflate_block(&z, b, d->zlib);
+    } else {
+      b->status = ready;
+    }
+
+    pthread_mutex_lock(&d->lock);
+    b->done = true;
+    pthread_cond_broadcast(&d->done);
+  }
+  pthread_mutex_unlock(&d->lock);
+
+  if (ready == Z_OK) {
+    deflateEnd(&z);
+  }
+  return NULL;
+}
+
+/// number of threads worth starting
+static size_t thread_count(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+  const long n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n > 1) {
+    return n < THREADS_MAX ? (size_t)n : THREADS_MAX;
+  }
+#endif
+  return 0;
+}
+
+/// start deflating on worker threads, if there are any to be had
+static void start_threads(gvdeflate_t *d) {
+  d->threads_tried = true;
+  const size_t n = thread_count();
+  if (n == 0) {
+    return;
+  }
+  pthread_mutex_init(&d->lock, NULL);
+  pthread_cond_init(&d->work, NULL);
+  pthread_cond_init(&d->done, NULL);
+  d->taken = d->submitted;
+  for (size_t i = 0; i < n; ++i) {
+    if (pthread_create(&d->threads[d->nthreads], NULL, worker, d) == 0) {
+      ++d->nthreads;
+    }
+  }
+  if (d->nthreads == 0) {
+    pthread_cond_destroy(&d->done);
+    pthread_cond_destroy(&d->work);
+    pthread_mutex_destroy(&d->lock);
+    return;
+  }
+  d->limit = 2 * d->nthreads;
+}
+
+static void stop_threads(gvdeflate_t *d) {
+  if (d->nthreads == 0) {
+    return;
+  }
+  pthread_mutex_lock(&d->lock);
+  d->stopping = true;
+  pthread_cond_broadcast(&d->work);
+  pthread_mutex_unlock(&d->lock);
+  for (size_t i = 0; i < d->nthreads; ++i) {
+    pthread_join(d->threads[i], NULL);
+  }
+  pthread_cond_destroy(&d->done);
+  pthread_cond_destroy(&d->work);
+  pthread_mutex_destroy(&d->lock);
+  d->nthreads = 0;
+}
+#endif
+
+/// write deflated blocks in order, until no more than `keep` are in flight
+static void drain(gvdeflate_t *d, size_t keep) {
+  while (d->written < d->submitted) {
+    block_t *const b = slot(d, d->written);
+#ifdef HAVE_PTHREAD
+    if (d->nthreads > 0) {
+      pthread_mutex_lock(&d->lock);
+      while (!b->done && d->submitted - d->written > keep) {
+        pthread_cond_wait(&d->done, &d->lock);
+      }
+      const bool done = b->done;
+      pthread_mutex_unlock(&d->lock);
+      if (!done) {
+        return;
+      }
+    }
+#else
+    (void)keep;
+#endif
+    if (b->status != Z_OK && d->err == 0) {
+      d->err = b->status;
+    }
+    if (d->err == 0) {
+      if (d->write(d->chan, b->out, b->out_len) != b->out_len) {
+        d->err = Z_ERRNO;
+      }
+      d->check = d->zlib ? adler32_combine(d->check, b->check, (z_off_t)b->len)
+                         : crc32_combine(d->check, b->check, (z_off_t)b->len);
+    }
+    b->done = false;
+    ++d->written;
+  }
+}
+
+/// hand over the filling block and start the next one
+static void submit(gvdeflate_t *d, bool last) {
+#ifdef HAVE_PTHREAD
+  if (!last && !d->threads_tried) {
+    start_threads(d);
+  }
+#endif
+
+  block_t *const b = slot(d, d->submitted);
+  b->last = last;
+#ifdef HAVE_PTHREAD
+  if (d->nthreads > 0) {
+    pthread_mutex_lock(&d->lock);
+    ++d->submitted;
+    pthread_cond_signal(&d->work);
+    pthread_mutex_unlock(&d->lock);
+  } else
+#endif
+  {
+    deflate_block(&d->z, b, d->zlib);
+    b->done = true;
+    ++d->submitted;
+  }
+
+  if (last) {
+    drain(d, 0);
+    return;
+  }
+  drain(d, d->limit - 1);
+
+  // prime the next block with the tail of this one
+  block_t *const next = slot(d, d->submitted);
+  if (next->in == NULL) {
+    next->in = gv_alloc(DICT_SIZE + BLOCK_SIZE);
+  }
+  const size_t have = b->dict + b->len;
+  next->dict = have < DICT_SIZE ? have : DICT_SIZE;
+  memcpy(next->in, b->in + have - next->dict, next->dict);
+  next->len = 0;
+}
+
+static gvdeflate_t *open_stream(void *chan, gvdeflate_write_f write,
+                                bool zlib) {
+  gvdeflate_t *d = gv_alloc(sizeof(*d));
+  if (init(&d->z) != Z_OK) {
+    free(d);
+    return NULL;
+  }
+  d->chan = chan;
+  d->write = write;
+  d->zlib = zlib;
+  d->check = zlib ? adler32(0L, Z_NULL, 0) : crc32(0L, Z_NULL, 0);
+  d->limit = 1;
+  d->ring[0].in = gv_alloc(DICT_SIZE + BLOCK_SIZE);
+  const unsigned char *const header = zlib ? zlib_header : z_file_header;
+  const size_t header_size =
+      zlib ? sizeof(zlib_header) : sizeof(z_file_header);
+  if (write(chan, header, header_size) != header_size) {
+    d->err = Z_ERRNO;
+  }
+  return d;
+}
+
+gvdeflate_t *gvdeflate_open(void *chan, gvdeflate_write_f write) {
+  return open_stream(chan, write, false);
+}
+
+gvdeflate_t *gvdeflate_open_zlib(void *chan, gvdeflate_write_f write) {
+  return open_stream(chan, write, true);
+}
+
+int gvdeflate_write(gvdeflate_t *d, const void *data, size_t size) {
+  const unsigned char *s = data;
+  d->total_in += size;
+  while (size > 0 && d->err == 0) {
+    block_t *const b = slot(d, d->submitted);
+    const size_t n = size < BLOCK_SIZE - b->len ? size : BLOCK_SIZE - b->len;
+    memcpy(b->in + b->dict + b->len, s, n);
+    b->len += n;
+    s += n;
+    size -= n;
+    if (b->len == BLOCK_SIZE) {
+      submit(d, false);
+    }
+  }
+  return d->err;
+}
+
+int gvdeflate_close(gvdeflate_t *d) {
+  if (d->err == 0) {
+    submit(d, true);
+  }
+#ifdef HAVE_PTHREAD
+  stop_threads(d);
+#endif
+
+  if (d->err == 0) {
+    // gzip ends in little endian CRC-32 and length, zlib in big endian Adler-32
+    unsigned char out[8];
+    size_t out_len = 0;
+    if (d->zlib) {
+      for (int i = 3; i >= 0; --i) {
+        out[out_len++] = (unsigned char)(d->check >> (8 * i));
+      }
+    } else {
+      for (int i = 0; i < 4; ++i) {
+        out[i] = (unsigned char)(d->check >> (8 * i));
+        out[4 + i] = (unsigned char)(d->total_in >> (8 * i));
+      }
+      out_len = 8;
+    }
+    if (d->write(d->chan, out, out_len) != out_len) {
+      d->err = Z_ERRNO;
+    }
+  }
+
+  const int err = d->err;
+  deflateEnd(&d->z);
+  for (size_t i = 0; i < RING_SIZE; ++i) {
+    free(d->ring[i].in);
+    free(d->ring[i].out);
+  }
+  free(d);
+  return err;
+}
+
+#endif /* HAVE_LIBZ */
@@ -0,0 +1,46 @@
+/// @file
+/// @brief gzip and zlib compression of device output
+///
+/// Output is gathered into blocks that are deflated independently of each
+/// other, each primed with the tail of the block before it as a dictionary, in
+/// the manner of pigz. The bytes produced depend only on the input, but blocks
+/// of a large output can be deflated on worker threads while rendering goes on.
+
+#pragma once
+
+#include <stddef.h>
+
+/// where compressed bytes go
+///
+/// @param chan Channel given to @ref gvdeflate_open
+/// @param data Bytes to write
+/// @param size Number of bytes to write
+/// @return Number of bytes written
+typedef size_t (*gvdeflate_write_f)(void *chan, const void *data, size_t size);
+
+typedef struct gvdeflate_s gvdeflate_t;
+
+/// start a gzip stream, writing its header
+///
+/// @param chan Channel to pass to `write`
+/// @param write Callback for compressed bytes, always called from the thread
+///   calling into this API
+/// @return A new stream or `NULL` if zlib could not be initialized
+gvdeflate_t *gvdeflate_open(void *chan, gvdeflate_write_f write);
+
+/// start a zlib stream, as PNG image data is compressed, writing its header
+///
+/// @param chan Channel to pass to `write`
+/// @param write Callback for compressed bytes, as for @ref gvdeflate_open
+/// @return A new stream or `NULL` if zlib could not be initialized
+gvdeflate_t *gvdeflate_open_zlib(void *chan, gvdeflate_write_f write);
+
+/// compress some bytes
+///
+/// @return 0 on success or a zlib error code
+int gvdeflate_write(gvdeflate_t *d, const void *data, size_t size);
+
+/// finish a stream, writing what remains and its trailer, and free it
+///
+/// @return 0 on success or a zlib error code
+int gvdeflate_close(gvdeflate_t *d);
@@ -33,40 +33,70 @@
 #include <io.h>
 #endif
 
-#ifdef HAVE_LIBZ
-#include <zlib.h>
-
-#ifndef OS_CODE
-#  define OS_CODE  0x03  /* assume Unix */
-#endif
-static const unsigned char z_file_header[] =
-   {0x1f, 0x8b, /*magic*/ Z_DEFLATED, 0 /*flags*/, 0,0,0,0 /*time*/, 0 /*xflags*/, OS_CODE};
-
-static z_stream z_strm;
-static unsigned char *df;
-static unsigned int dfallocated;
-static uint64_t crc;
-#endif /* HAVE_LIBZ */
-
 #include <assert.h>
 #include <common/const.h>
 #include <gvc/gvplugin_device.h>
 #include <gvc/gvcjob.h>
 #include <gvc/gvcint.h>
 #include <gvc/gvcproc.h>
+#include <gvc/gvdeflate.h>
 #include <common/utils.h>
 #include <gvc/gvio.h>
 #include <util/agxbuf.h>
 #include <util/exit.h>
+#include <util/fmtnum.h>
 #include <util/startswith.h>
 
+/* pass a chunk of output to the sink, or drop it if the sink has failed */
+static void gvwrite_sink(GVJ_t *job, const char *s, size_t len)
+{
+    if (len > 0 && !job->output_sink_failed
+	&& job->output_sink(job->output_sink_context, s, len) != len)
+	job->output_sink_failed = true;
+}
+
+/* hand what is held back for the sink over, as a short final chunk */
+static void gvwrite_sink_flush(GVJ_t *job)
+{
+    gvwrite_sink(job, job->output_data, job->output_data_position);
+    job->output_data_position = 0;
+}
+
 static size_t gvwrite_no_z(GVJ_t * job, const void *s, size_t len) {
     if (job->gvc->write_fn)   /* externally provided write discipline */
 	return job->gvc->write_fn(job, s, len);
+    if (job->output_sink) {
+	/* output_data holds back less than a chunk, and whole chunks go
+	 * straight to the sink, from the caller's buffer where possible
+	 */
+	const size_t chunk = job->output_data_allocated;
+	const char *p = s;
+	size_t left = len;
+	while (left > 0) {
+	    if (job->output_data_position == 0 && left >= chunk) {
+		gvwrite_sink(job, p, chunk);
+		p += chunk;
+		left -= chunk;
+		continue;
+	    }
+	    const size_t n = MIN(left, chunk - job->output_data_position);
+	    memcpy(job->output_data + job->output_data_position, p, n);
+	    job->output_data_position += n;
+	    p += n;
+	    left -= n;
+	    if (job->output_data_position == chunk)
+		gvwrite_sink_flush(job);
+	}
+	return len;
+    }
     if (job->output_data) {
 	if (len > job->output_data_allocated - (job->output_data_position + 1)) {
-	    /* ensure enough allocation for string = null terminator */
-	    job->output_data_allocated = job->output_data_position + len + 1;
+	    /* ensure enough allocation for string = null terminator, growing
+	     * geometrically so that a large document is not copied over and
+	     * over
+	     */
+	    job->output_data_allocated = MAX(2 * job->output_data_allocated,
+					     job->output_data_position + len + 1);
 	    job->output_data = realloc(job->output_data, job->output_data_allocated);
 	    if (!job->output_data) {
                 job->common->errorfn("memory allocation failure\n");
@@ -82,6 +112,12 @@ static size_t gvwrite_no_z(GVJ_t * job, const void *s, size_t len) {
     return fwrite(s, sizeof(char), len, job->output_file);
 }
 
+#ifdef HAVE_LIBZ
+static size_t gvwrite_deflated(void *job, const void *s, size_t len) {
+    return gvwrite_no_z(job, s, len);
+}
+#endif
+
 static void auto_output_filename(GVJ_t *job)
 {
     static agxbuf buf;
@@ -155,22 +191,11 @@ int gvdevice_initialize(GVJ_t * job)
 
     if (job->flags & GVDEVICE_COMPRESSED_FORMAT) {
 #ifdef HAVE_LIBZ
-	z_stream *z = &z_strm;
-
-	z->zalloc = 0;
-	z->zfree = 0;
-	z->opaque = 0;
-	z->next_in = NULL;
-	z->next_out = NULL;
-	z->avail_in = 0;
-
-	crc = crc32(0L, Z_NULL, 0);
-
-	if (deflateInit2(z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, MAX_MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
+	job->deflate = gvdeflate_open(job, gvwrite_deflated);
+	if (job->deflate == NULL) {
 	    job->common->errorfn("Error initializing for deflation\n");
 	    return 1;
 	}
-	gvwrite_no_z(job, z_file_header, sizeof(z_file_header));
 #else
 	job->common->errorfn("No libz support.\n");
 	return 1;
@@ -181,70 +206,23 @@ int gvdevice_initialize(GVJ_t * job)
 
 size_t gvwrite (GVJ_t * job, const char *s, size_t len)
 {
-    size_t ret, olen;
-
     if (!len || !s)
 	return 0;
 
     if (job->flags & GVDEVICE_COMPRESSED_FORMAT) {
 #ifdef HAVE_LIBZ
-	z_streamp z = &z_strm;
-
-	size_t dflen = deflateBound(z, len);
-	if (dfallocated < dflen) {
-	    dfallocated = dflen > UINT_MAX - 1 ? UINT_MAX : (unsigned)dflen + 1;
-	    df = realloc(df, dfallocated);
-	    if (! df) {
-                job->common->errorfn("memory allocation failure\n");
-		graphviz_exit(1);
-	    }
-	}
-
-#if ZLIB_VERNUM >= 0x1290
-	crc = crc32_z(crc, (const unsigned char*)s, len);
-#else
-	crc = crc32(crc, (const unsigned char*)s, len);
-#endif
-
-	for (size_t offset = 0; offset < len; ) {
-// Suppress Clang/GCC -Wcast-qual warnings. `next_in` is morally const.
-#ifdef __GNUC__
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wcast-qual"
-#endif
-	    z->next_in = (unsigned char *)s + offset;
-#ifdef __GNUC__
-#pragma GCC diagnostic pop
-#endif
-	    const unsigned chunk = len - offset > UINT_MAX
-	                         ? UINT_MAX : (unsigned)(len - offset);
-	    z->avail_in = chunk;
-	    z->next_out = df;
-	    z->avail_out = dfallocated;
-	    int r = deflate(z, Z_NO_FLUSH);
-	    if (r != Z_OK) {
-                job->common->errorfn("deflation problem %d\n", r);
-	        graphviz_exit(1);
-	    }
-
-	    if ((olen = (size_t)(z->next_out - df))) {
-		ret = gvwrite_no_z(job, df, olen);
-	        if (ret != olen) {
-                    job->common->errorfn("gvwrite_no_z problem %d\n", ret);
-	            graphviz_exit(1);
-	        }
-	    }
-	    offset += chunk - z->avail_in;
+	const int r = gvdeflate_write(job->deflate, s, len);
+	if (r != 0) {
+	    job->common->errorfn("deflation problem %d\n", r);
+	    graphviz_exit(1);
 	}
-
 #else
-        (void)olen;
 	job->common->errorfn("No libz support.\n");
 	graphviz_exit(1);
 #endif
     }
     else { /* uncompressed write */
-	ret = gvwrite_no_z (job, s, len);
+	const size_t ret = gvwrite_no_z (job, s, len);
 	if (ret != len) {
 	    job->common->errorfn("gvwrite_no_z problem %d\n", len);
 	    graphviz_exit(1);
@@ -259,6 +237,8 @@ int gvferror (FILE* stream)
 
     if (!job->gvc->write_fn && !job->output_data)
 	return ferror(job->output_file);
+    if (job->output_sink)
+	return job->output_sink_failed;
 
     return 0;
 }
@@ -345,40 +325,15 @@ void gvdevice_finalize(GVJ_t * job)
 
     if (job->flags & GVDEVICE_COMPRESSED_FORMAT) {
 #ifdef HAVE_LIBZ
-	z_streamp z = &z_strm;
-	unsigned char out[8] = "";
-	int ret;
-	int cnt = 0;
-
-	z->next_in = out;
-	z->avail_in = 0;
-	z->next_out = df;
-	z->avail_out = dfallocated;
-	while ((ret = deflate (z, Z_FINISH)) == Z_OK && (cnt++ <= 100)) {
-	    gvwrite_no_z(job, df, (size_t)(z->next_out - df));
-	    z->next_out = df;
-	    z->avail_out = dfallocated;
-	}
-	if (ret != Z_STREAM_END) {
-            job->common->errorfn("deflation finish problem %d cnt=%d\n", ret, cnt);
-	    graphviz_exit(1);
-	}
-	gvwrite_no_z(job, df, (size_t)(z->next_out - df));
-
-	ret = deflateEnd(z);
-	if (ret != Z_OK) {
-	    job->common->errorfn("deflation end problem %d\n", ret);
-	    graphviz_exit(1);
+	/* finalizing twice, as gvRenderFilename does, finishes the stream once */
+	if (job->deflate) {
+	    const int ret = gvdeflate_close(job->deflate);
+	    job->deflate = NULL;
+	    if (ret != 0) {
+		job->common->errorfn("deflation finish problem %d\n", ret);
+		graphviz_exit(1);
+	    }
 	}
-	out[0] = (unsigned char)crc;
-	out[1] = (unsigned char)(crc >> 8);
-	out[2] = (unsigned char)(crc >> 16);
-	out[3] = (unsigned char)(crc >> 24);
-	out[4] = (unsigned char)z->total_in;
-	out[5] = (unsigned char)(z->total_in >> 8);
-	out[6] = (unsigned char)(z->total_in >> 16);
-	out[7] = (unsigned char)(z->total_in >> 24);
-	gvwrite_no_z(job, out, sizeof(out));
 #else
 	job->common->errorfn("No libz support\n");
 	graphviz_exit(1);
@@ -397,6 +352,9 @@ void gvdevice_finalize(GVJ_t * job)
 	gvflush (job);
 	gvdevice_close(job);
     }
+
+    if (job->output_sink)
+	gvwrite_sink_flush(job);
 }
 
 void gvprintf(GVJ_t * job, const char *format, ...)
@@ -426,42 +384,41 @@ void gvprintf(GVJ_t * job, const char *format, ...)
 #define val_str(n, x) static double n = x; static char n##str[] = #x;
 val_str(maxnegnum, -999999999999999.99)
 
-static void gvprintnum(agxbuf *xb, double number) {
+static size_t gvprintnum(char *buf, double number) {
     /*
         number limited to a working range: maxnegnum >= n >= -maxnegnum
 	suppressing trailing "0" and "."
      */
 
     if (number < maxnegnum) {		/* -ve limit */
-	agxbput(xb, maxnegnumstr);
-	return;
+	memcpy(buf, maxnegnumstr, sizeof(maxnegnumstr));
+	return sizeof(maxnegnumstr) - 1;
     }
     if (number > -maxnegnum) {		/* +ve limit */
-	agxbput(xb, maxnegnumstr + 1); // +1 to skip the '-' sign
-	return;
+	// +1 to skip the '-' sign
+	memcpy(buf, maxnegnumstr + 1, sizeof(maxnegnumstr) - 1);
+	return sizeof(maxnegnumstr) - 2;
     }
 
-    agxbprint(xb, "%.03f", number);
-    agxbuf_trim_zeros(xb);
+    const size_t len = gv_fmtnum(buf, number, 3);
 
     // strip off unnecessary leading '0'
-    {
-        char *staging = agxbdisown(xb);
-        if (startswith(staging, "0.")) {
-            memmove(staging, &staging[1], strlen(staging));
-        } else if (startswith(staging, "-0.")) {
-            memmove(&staging[1], &staging[2], strlen(&staging[1]));
-        }
-        agxbput(xb, staging);
-        free(staging);
+    if (startswith(buf, "0.")) {
+	memmove(buf, &buf[1], len);
+	return len - 1;
     }
+    if (startswith(buf, "-0.")) {
+	memmove(&buf[1], &buf[2], len - 1);
+	return len - 1;
+    }
+    return len;
 }
 
 
 #ifdef GVPRINTNUM_TEST
 int main (int argc, char *argv[])
 {
-    agxbuf xb = {0};
+    char buf[GV_FMTNUM_SIZE];
 
     double test[] = {
 	-maxnegnum*1.1, -maxnegnum*.9,
@@ -475,41 +432,14 @@ int main (int argc, char *argv[])
     int i = sizeof(test) / sizeof(test[0]);
 
     while (i--) {
-	gvprintnum(&xb, test[i]);
-	const char *buf = agxbuse(&xb);
-	const size_t len = strlen(buf);
+	const size_t len = gvprintnum(buf, test[i]);
         printf("%g = %s %" PRISIZE_T "\n", test[i], buf, len);
     }
 
-    agxbfree(&xb);
     graphviz_exit(0);
 }
 #endif
 
-/* gv_trim_zeros
-* Identify Trailing zeros and decimal point, if possible.
-* Assumes the input is the result of %.02f printing.
-*/
-static size_t gv_trim_zeros(const char *buf) {
-  char *dotp = strchr(buf, '.');
-  if (dotp == NULL) {
-    return strlen(buf);
-  }
-
-  // check this really is the result of %.02f printing
-  assert(isdigit((int)dotp[1]) && isdigit((int)dotp[2]) && dotp[3] == '\0');
-
-  if (dotp[2] == '0') {
-    if (dotp[1] == '0') {
-      return (size_t)(dotp - buf);
-    } else {
-      return (size_t)(dotp - buf) + 2;
-    }
-  }
-
-  return strlen(buf);
-}
-
 void gvprintdouble(GVJ_t * job, double num)
 {
     // Prevents values like -0
@@ -519,26 +449,20 @@ void gvprintdouble(GVJ_t * job, double num)
         return;
     }
 
-    char buf[50];
-
-    snprintf(buf, 50, "%.02f", num);
-    size_t len = gv_trim_zeros(buf);
+    char buf[GV_FMTNUM_SIZE];
+    const size_t len = gv_fmtnum(buf, num, 2);
 
     gvwrite(job, buf, len);
 }
 
 void gvprintpointf(GVJ_t * job, pointf p)
 {
-    agxbuf xb = {0};
-
-    gvprintnum(&xb, p.x);
-    const char *buf = agxbuse(&xb);
-    gvwrite(job, buf, strlen(buf));
-    gvwrite(job, " ", 1);
-    gvprintnum(&xb, p.y);
-    buf = agxbuse(&xb);
-    gvwrite(job, buf, strlen(buf));
-    agxbfree(&xb);
+    char buf[2 * GV_FMTNUM_SIZE];
+
+    size_t len = gvprintnum(buf, p.x);
+    buf[len++] = ' ';
+    len += gvprintnum(&buf[len], p.y);
+    gvwrite(job, buf, len);
 } 
 
 void gvprintpointflist(GVJ_t *job, pointf *p, size_t n) {
@@ -57,8 +57,11 @@ void gvloadimage(GVJ_t * job, usershape_t *us, boxf b, bool filled, const char *
     if (gvloadimage_select(job, type) == NO_SUPPORT)
 	    agwarningf("No loadimage plugin for \"%s\"\n", type);
 
-    if ((gvli = job->loadimage.engine) && gvli->loadimage)
+    if ((gvli = job->loadimage.engine) && gvli->loadimage) {
+	const void *data = us->data;
 	gvli->loadimage(job, us, b, filled);
+	gvusershape_used(us, data);
+    }
 
     agxbfree(&type_buf);
 }
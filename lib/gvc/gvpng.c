@@ -0,0 +1,240 @@
+/// @file
+/// @brief streaming PNG output of bitmaps drawn a band of rows at a time
+///
+/// Rows are written as 8-bit RGBA, unpremultiplied the way cairo's own PNG
+/// writer does it, and each is filtered with whichever of the five PNG filters
+/// leaves the smallest sum of absolute byte values, the heuristic libpng uses.
+/// The filtered rows are compressed by @ref gvdeflate_open_zlib, so a large
+/// image is deflated on worker threads while the device goes on drawing, and
+/// compressed data is written out in IDAT chunks as it comes back.
+
+#include "config.h"
+
+#include <common/types.h>
+#include <gvc/gvio.h>
+#include <gvc/gvpng.h>
+
+#ifdef HAVE_LIBZ
+
+#include <gvc/gvdeflate.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/alloc.h>
+#include <zlib.h>
+
+enum {
+  BYTES_PER_PIXEL = 4,
+  FILTERS = 5, ///< none, sub, up, average and Paeth
+};
+
+struct gvpng_s {
+  GVJ_t *job;
+  gvdeflate_t *deflate;
+  unsigned width;
+  unsigned height;
+  unsigned rows; ///< rows written so far
+  size_t stride; ///< bytes in a row, before filtering
+  unsigned char *prev; ///< previous row, unfiltered, or zeros at the top
+  unsigned char *cur;  ///< this row, unfiltered
+  unsigned char *filtered[FILTERS]; ///< filter type byte and filtered row
+  bool failed;
+};
+
+static void put_be32(unsigned char *p, uint32_t v) {
+  p[0] = (unsigned char)(v >> 24);
+  p[1] = (unsigned char)(v >> 16);
+  p[2] = (unsigned char)(v >> 8);
+  p[3] = (unsigned char)v;
+}
+
+/// write a chunk of the given type
+static bool write_chunk(GVJ_t *job, const char type[4], const void *data,
+                        size_t size) {
+  unsigned char head[8];
+  put_be32(head, (uint32_t)size);
+  memcpy(head + 4, type, 4);
+  uLong crc = crc32(crc32(0L, Z_NULL, 0), head + 4, 4);
+  if (size > 0) {
+    crc = crc32(crc, data, (uInt)size);
+  }
+  unsigned char tail[4];
+  put_be32(tail, (uint32_t)crc);
+  return gvwrite(job, (const char *)head, sizeof(head)) == sizeof(head) &&
+         (size == 0 || gvwrite(job, data, size) == size) &&
+         gvwrite(job, (const char *)tail, sizeof(tail)) == sizeof(tail);
+}
+
+/// pass compressed image data on as an IDAT chunk
+static size_t write_idat(void *chan, const void *data, size_t size) {
+  gvpng_t *const png = chan;
+  return write_chunk(png->job, "IDAT", data, size) ? size : 0;
+}
+
+gvpng_t *gvpng_begin(GVJ_t *job, unsigned width, unsigned height) {
+  static const unsigned char signature[] = {0x89, 'P',  'N',  'G',
+                                            '\r', '\n', 0x1a, '\n'};
+
+  // PNG dimensions are positive 31-bit numbers
+  if (width == 0 || height == 0 || width > INT32_MAX || height > INT32_MAX) {
+    return NULL;
+  }
+
+  gvpng_t *png = gv_alloc(sizeof(*png));
+  png->job = job;
+  png->width = width;
+  png->height = height;
+  png->stride = (size_t)width * BYTES_PER_PIXEL;
+
+  unsigned char ihdr[13];
+  put_be32(ihdr, width);
+  put_be32(ihdr + 4, height);
+  ihdr[8] = 8;  // bit depth
+  ihdr[9] = 6;  // truecolor with alpha
+  ihdr[10] = 0; // deflate
+  ihdr[11] = 0; // adaptive filtering
+  ihdr[12] = 0; // not interlaced
+  if (gvwrite(job, (const char *)signature, sizeof(signature)) !=
+          sizeof(signature) ||
+      !write_chunk(job, "IHDR", ihdr, sizeof(ihdr))) {
+    free(png);
+    return NULL;
+  }
+
+  png->deflate = gvdeflate_open_zlib(png, write_idat);
+  if (png->deflate == NULL) {
+    free(png);
+    return NULL;
+  }
+  png->prev = gv_calloc(png->stride, sizeof(unsigned char));
+  png->cur = gv_calloc(png->stride, sizeof(unsigned char));
+  for (size_t i = 0; i < FILTERS; ++i) {
+    png->filtered[i] = gv_calloc(png->stride + 1, sizeof(unsigned char));
+    png->filtered[i][0] = (unsigned char)i;
+  }
+  return png;
+}
+
+static unsigned char paeth(unsigned char a, unsigned char b, unsigned char c) {
+  const int p = a + b - c;
+  const int pa = abs(p - a);
+  const int pb = abs(p - b);
+  const int pc = abs(p - c);
+  if (pa <= pb && pa <= pc) {
+    return a;
+  }
+  return pb <= pc ? b : c;
+}
+
+/// filter `png->cur` every way, returning the filter that came out smallest
+static size_t filter(gvpng_t *png) {
+  const unsigned char *const cur = png->cur;
+  const unsigned char *const up = png->prev;
+  unsigned char *const *const f = png->filtered;
+  unsigned long cost[FILTERS] = {0};
+
+  for (size_t i = 0; i < png->stride; ++i) {
+    const unsigned char left = i < BYTES_PER_PIXEL ? 0 : cur[i - BYTES_PER_PIXEL];
+    const unsigned char corner =
+        i < BYTES_PER_PIXEL ? 0 : up[i - BYTES_PER_PIXEL];
+    f[0][i + 1] = cur[i];
+    f[1][i + 1] = (unsigned char)(cur[i] - left);
+    f[2][i + 1] = (unsigned char)(cur[i] - up[i]);
+    f[3][i + 1] = (unsigned char)(cur[i] - (left + up[i]) / 2);
+    f[4][i + 1] = (unsigned char)(cur[i] - paeth(left, up[i], corner));
+    for (size_t j = 0; j < FILTERS; ++j) {
+      // bytes are costed as signed, so small negative differences count small
+      const int v = (signed char)f[j][i + 1];
+      cost[j] += (unsigned long)abs(v);
+    }
+  }
+
+  size_t best = 0;
+  for (size_t j = 1; j < FILTERS; ++j) {
+    if (cost[j] < cost[best]) {
+      best = j;
+    }
+  }
+  return best;
+}
+
+/// filter and compress `png->cur` and make it the previous row
+static int emit_row(gvpng_t *png) {
+  const size_t best = filter(png);
+  if (gvdeflate_write(png->deflate, png->filtered[best], png->stride + 1) !=
+      Z_OK) {
+    png->failed = true;
+  }
+  unsigned char *const prev = png->prev;
+  png->prev = png->cur;
+  png->cur = prev;
+  ++png->rows;
+  return png->failed;
+}
+
+int gvpng_write_row(gvpng_t *png, const uint32_t *pixels) {
+  if (png->failed || png->rows == png->height) {
+    return 1;
+  }
+  unsigned char *out = png->cur;
+  for (unsigned i = 0; i < png->width; ++i, out += BYTES_PER_PIXEL) {
+    const uint32_t pixel = pixels[i];
+    const unsigned alpha = pixel >> 24;
+    if (alpha == 0) {
+      memset(out, 0, BYTES_PER_PIXEL);
+      continue;
+    }
+    out[0] = (unsigned char)((((pixel >> 16) & 0xff) * 255 + alpha / 2) / alpha);
+    out[1] = (unsigned char)((((pixel >> 8) & 0xff) * 255 + alpha / 2) / alpha);
+    out[2] = (unsigned char)(((pixel & 0xff) * 255 + alpha / 2) / alpha);
+    out[3] = (unsigned char)alpha;
+  }
+  return emit_row(png);
+}
+
+int gvpng_end(gvpng_t *png) {
+  memset(png->cur, 0, png->stride);
+  while (!png->failed && png->rows < png->height) {
+    (void)emit_row(png);
+    memset(png->cur, 0, png->stride);
+  }
+  if (gvdeflate_close(png->deflate) != Z_OK) {
+    png->failed = true;
+  }
+  if (!png->failed && !write_chunk(png->job, "IEND", NULL, 0)) {
+    png->failed = true;
+  }
+
+  const int rc = png->failed;
+  free(png->prev);
+  free(png->cur);
+  for (size_t i = 0; i < FILTERS; ++i) {
+    free(png->filtered[i]);
+  }
+  free(png);
+  return rc;
+}
+
+#else
+
+gvpng_t *gvpng_begin(GVJ_t *job, unsigned width, unsigned height) {
+  (void)job;
+  (void)width;
+  (void)height;
+  return NULL;
+}
+
+int gvpng_write_row(gvpng_t *png, const uint32_t *pixels) {
+  (void)png;
+  (void)pixels;
+  return 1;
+}
+
+int gvpng_end(gvpng_t *png) {
+  (void)png;
+  return 1;
+}
+
+#endif /* HAVE_LIBZ */
@@ -0,0 +1,58 @@
+/// @file
+/// @brief streaming PNG output of bitmaps drawn a band of rows at a time
+///
+/// A device drawing a large bitmap in pieces hands over its rows in order from
+/// the top, and they are filtered, compressed and written out as they come,
+/// so the whole image never has to be held at once.
+
+#pragma once
+
+#include "gvcjob.h"
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef GVDLL
+#ifdef GVC_EXPORTS
+#define GVPNG_API __declspec(dllexport)
+#else
+#define GVPNG_API __declspec(dllimport)
+#endif
+#endif
+
+#ifndef GVPNG_API
+#define GVPNG_API /* nothing */
+#endif
+
+typedef struct gvpng_s gvpng_t;
+
+/// start writing a PNG image to the job's output
+///
+/// @param job Job whose output the image is written to, with @ref gvwrite
+/// @param width Width of the image in pixels
+/// @param height Height of the image in pixels
+/// @return A new image or `NULL` if PNG output is not available
+GVPNG_API gvpng_t *gvpng_begin(GVJ_t *job, unsigned width, unsigned height);
+
+/// write the next row of the image
+///
+/// @param png Image to write to
+/// @param pixels `width` pixels of premultiplied 32-bit ARGB in native byte
+///   order, as in a `CAIRO_FORMAT_ARGB32` surface
+/// @return 0 on success or non-zero if the image could not be written
+GVPNG_API int gvpng_write_row(gvpng_t *png, const uint32_t *pixels);
+
+/// finish the image and free it
+///
+/// Rows that were not written are left transparent.
+///
+/// @return 0 on success or non-zero if the image could not be written
+GVPNG_API int gvpng_end(gvpng_t *png);
+
+#undef GVPNG_API
+
+#ifdef __cplusplus
+}
+#endif
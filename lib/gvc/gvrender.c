@@ -28,6 +28,7 @@
 #include <common/geomprocs.h>
 #include <common/render.h>
 #include <gvc/gvcproc.h>
+#include <gvc/gvrenderplan.h>
 #include <limits.h>
 #include <stdlib.h>
 #include <util/agxbuf.h>
@@ -436,6 +437,8 @@ void gvrender_set_pencolor(GVJ_t * job, char *name)
     gvcolor_t *color = &(job->obj->pencolor);
     char *cp = NULL;
 
+    if (job->recording)
+	gvrenderplan_note_color(job, false, name);
     if ((cp = strchr(name, ':'))) // if it’s a color list, then use only first
 	*cp = '\0';
     if (gvre) {
@@ -453,6 +456,8 @@ void gvrender_set_fillcolor(GVJ_t * job, char *name)
     gvcolor_t *color = &(job->obj->fillcolor);
     char *cp = NULL;
 
+    if (job->recording)
+	gvrenderplan_note_color(job, true, name);
     if ((cp = strchr(name, ':'))) // if it’s a color list, then use only first
 	*cp = '\0';
     if (gvre) {
@@ -485,6 +490,8 @@ void gvrender_set_style(GVJ_t * job, char **s)
     char *line, *p;
 
     obj->rawstyle = s;
+    if (job->recording)
+	gvrenderplan_note_style(job, s);
     if (gvre) {
 	if (s)
 	    while ((p = line = *s++)) {
@@ -520,6 +527,8 @@ void gvrender_set_style(GVJ_t * job, char **s)
 void gvrender_ellipse(GVJ_t *job, pointf *pf, int filled) {
     gvrender_engine_t *gvre = job->render.engine;
 
+    if (job->recording)
+	gvrenderplan_note_ellipse(job, pf, filled);
     if (gvre) {
 	if (gvre->ellipse && job->obj->pen != PEN_NONE) {
 	    pointf af[] = {
@@ -539,6 +548,8 @@ void gvrender_polygon(GVJ_t *job, pointf *af, size_t n, int filled) {
     gvcolor_t save_pencolor;
 
     gvrender_engine_t *gvre = job->render.engine;
+    if (job->recording)
+	gvrenderplan_note_polygon(job, af, n, filled);
     if (gvre) {
 	if (gvre->polygon && job->obj->pen != PEN_NONE) {
 	    if (filled & NO_POLY) {
@@ -579,6 +590,8 @@ void gvrender_box(GVJ_t * job, boxf B, int filled)
 void gvrender_beziercurve(GVJ_t *job, pointf *af, size_t n, int filled) {
     gvrender_engine_t *gvre = job->render.engine;
 
+    if (job->recording)
+	gvrenderplan_note_beziercurve(job, af, n, filled);
     if (gvre) {
 	if (gvre->beziercurve && job->obj->pen != PEN_NONE) {
 	    if (job->flags & GVRENDER_DOES_TRANSFORM)
@@ -596,6 +609,8 @@ void gvrender_beziercurve(GVJ_t *job, pointf *af, size_t n, int filled) {
 void gvrender_polyline(GVJ_t *job, pointf *af, size_t n) {
     gvrender_engine_t *gvre = job->render.engine;
 
+    if (job->recording)
+	gvrenderplan_note_polyline(job, af, n);
     if (gvre) {
 	if (gvre->polyline && job->obj->pen != PEN_NONE) {
 	    if (job->flags & GVRENDER_DOES_TRANSFORM)
@@ -799,6 +814,8 @@ void gvrender_set_penwidth(GVJ_t * job, double penwidth)
 {
     gvrender_engine_t *gvre = job->render.engine;
 
+    if (job->recording)
+	gvrenderplan_note_penwidth(job, penwidth);
     if (gvre) {
 	job->obj->penwidth = penwidth;
     }
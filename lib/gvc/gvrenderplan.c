@@ -0,0 +1,227 @@
+/// @file
+/// @brief drawing shared between the output jobs of one render
+
+#include "config.h"
+
+#include <common/types.h>
+#include <gvc/gvcint.h>
+#include <gvc/gvcproc.h>
+#include <gvc/gvrenderplan.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/alloc.h>
+#include <util/list.h>
+
+typedef enum {
+  OP_PENCOLOR,
+  OP_FILLCOLOR,
+  OP_STYLE,         ///< the object's own style
+  OP_DEFAULT_STYLE, ///< the context's default line style
+  OP_PENWIDTH,
+  OP_ELLIPSE,
+  OP_POLYGON,
+  OP_BEZIERCURVE,
+  OP_POLYLINE,
+} op_kind_t;
+
+typedef struct {
+  op_kind_t kind;
+  emit_state_t emit_state; ///< state of the object when the call was made
+  int filled;
+  double penwidth;
+  char *color;
+  pointf *points;
+  size_t n;
+} op_t;
+
+static void op_free(op_t op) {
+  free(op.color);
+  free(op.points);
+}
+
+DEFINE_LIST_WITH_DTOR(ops, op_t, op_free)
+
+/// the recorded drawing of one object
+typedef struct gvrenderplan_drawing_s {
+  bool usable;     ///< false if a call was made that cannot be replayed
+  double penwidth; ///< pen width the drawing started with
+  ops_t ops;
+  // only set while recording
+  char **styles;
+  char **default_style;
+} drawing_t;
+
+static void drawing_free(drawing_t *drawing) {
+  if (drawing != NULL) {
+    ops_free(&drawing->ops);
+    free(drawing);
+  }
+}
+
+DEFINE_LIST_WITH_DTOR(drawings, drawing_t *, drawing_free)
+
+struct gvrenderplan_s {
+  drawings_t edges; ///< edge drawings, indexed by sequence number
+};
+
+gvrenderplan_t *gvrenderplan_new(void) {
+  return gv_alloc(sizeof(gvrenderplan_t));
+}
+
+void gvrenderplan_free(gvrenderplan_t *plan) {
+  if (plan == NULL) {
+    return;
+  }
+  drawings_free(&plan->edges);
+  free(plan);
+}
+
+static drawing_t *edge_drawing(gvrenderplan_t *plan, Agedge_t *e) {
+  const size_t seq = (size_t)AGSEQ(e);
+  if (seq >= drawings_size(&plan->edges)) {
+    return NULL;
+  }
+  return drawings_get(&plan->edges, seq);
+}
+
+bool gvrenderplan_replay(gvrenderplan_t *plan, GVJ_t *job, Agedge_t *e,
+                         char **styles) {
+  const drawing_t *const drawing = edge_drawing(plan, e);
+  if (drawing == NULL || !drawing->usable ||
+      drawing->penwidth != job->obj->penwidth) {
+    return false;
+  }
+
+  obj_state_t *const obj = job->obj;
+  const emit_state_t emit_state = obj->emit_state;
+  for (size_t i = 0; i < ops_size(&drawing->ops); ++i) {
+    const op_t op = ops_get(&drawing->ops, i);
+    obj->emit_state = op.emit_state;
+    switch (op.kind) {
+    case OP_PENCOLOR:
+      gvrender_set_pencolor(job, op.color);
+      break;
+    case OP_FILLCOLOR:
+      gvrender_set_fillcolor(job, op.color);
+      break;
+    case OP_STYLE:
+      gvrender_set_style(job, styles);
+      break;
+    case OP_DEFAULT_STYLE:
+      gvrender_set_style(job, job->gvc->defaultlinestyle);
+      break;
+    case OP_PENWIDTH:
+      gvrender_set_penwidth(job, op.penwidth);
+      break;
+    case OP_ELLIPSE:
+      gvrender_ellipse(job, op.points, op.filled);
+      break;
+    case OP_POLYGON:
+      gvrender_polygon(job, op.points, op.n, op.filled);
+      break;
+    case OP_BEZIERCURVE:
+      gvrender_beziercurve(job, op.points, op.n, op.filled);
+      break;
+    case OP_POLYLINE:
+      gvrender_polyline(job, op.points, op.n);
+      break;
+    }
+  }
+  obj->emit_state = emit_state;
+  return true;
+}
+
+void gvrenderplan_record(gvrenderplan_t *plan, GVJ_t *job, Agedge_t *e,
+                         char **styles) {
+  const size_t seq = (size_t)AGSEQ(e);
+  while (drawings_size(&plan->edges) <= seq) {
+    drawings_append(&plan->edges, NULL);
+  }
+  if (drawings_get(&plan->edges, seq) != NULL) {
+    return;
+  }
+
+  drawing_t *drawing = gv_alloc(sizeof(drawing_t));
+  drawing->usable = true;
+  drawing->penwidth = job->obj->penwidth;
+  drawing->styles = styles;
+  drawing->default_style = job->gvc->defaultlinestyle;
+  drawings_set(&plan->edges, seq, drawing);
+  job->recording = drawing;
+}
+
+void gvrenderplan_stop(GVJ_t *job) {
+  drawing_t *const drawing = job->recording;
+  if (drawing == NULL) {
+    return;
+  }
+  drawing->styles = NULL;
+  drawing->default_style = NULL;
+  ops_shrink_to_fit(&drawing->ops);
+  job->recording = NULL;
+}
+
+static void note(GVJ_t *job, op_t op) {
+  op.emit_state = job->obj->emit_state;
+  ops_append(&job->recording->ops, op);
+}
+
+static pointf *copy_points(const pointf *af, size_t n) {
+  if (n == 0) {
+    return NULL;
+  }
+  pointf *points = gv_calloc(n, sizeof(pointf));
+  memcpy(points, af, n * sizeof(pointf));
+  return points;
+}
+
+void gvrenderplan_note_color(GVJ_t *job, bool fill, const char *name) {
+  note(job, (op_t){.kind = fill ? OP_FILLCOLOR : OP_PENCOLOR,
+                   .color = gv_strdup(name)});
+}
+
+void gvrenderplan_note_style(GVJ_t *job, char **s) {
+  drawing_t *const drawing = job->recording;
+  if (s != NULL && s == drawing->styles) {
+    note(job, (op_t){.kind = OP_STYLE});
+  } else if (s == drawing->default_style) {
+    note(job, (op_t){.kind = OP_DEFAULT_STYLE});
+  } else {
+    // a style from somewhere else may not exist by the time of a replay
+    drawing->usable = false;
+  }
+}
+
+void gvrenderplan_note_penwidth(GVJ_t *job, double penwidth) {
+  note(job, (op_t){.kind = OP_PENWIDTH, .penwidth = penwidth});
+}
+
+void gvrenderplan_note_ellipse(GVJ_t *job, const pointf *pf, int filled) {
+  note(job, (op_t){.kind = OP_ELLIPSE,
+                   .filled = filled,
+                   .points = copy_points(pf, 2),
+                   .n = 2});
+}
+
+void gvrenderplan_note_polygon(GVJ_t *job, const pointf *af, size_t n,
+                               int filled) {
+  note(job, (op_t){.kind = OP_POLYGON,
+                   .filled = filled,
+                   .points = copy_points(af, n),
+                   .n = n});
+}
+
+void gvrenderplan_note_beziercurve(GVJ_t *job, const pointf *af, size_t n,
+                                   int filled) {
+  note(job, (op_t){.kind = OP_BEZIERCURVE,
+                   .filled = filled,
+                   .points = copy_points(af, n),
+                   .n = n});
+}
+
+void gvrenderplan_note_polyline(GVJ_t *job, const pointf *af, size_t n) {
+  note(job,
+       (op_t){.kind = OP_POLYLINE, .points = copy_points(af, n), .n = n});
+}
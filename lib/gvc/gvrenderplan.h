@@ -0,0 +1,71 @@
+/// @file
+/// @brief drawing shared between the output jobs of one render
+///
+/// When a laid out graph is rendered to several formats at once, every job
+/// walks the graph and works out the same drawing again: color lists split
+/// into segments, tapered edges stroked, arrowheads placed. The plan records
+/// the drawing calls a job makes for an object, in graph coordinates, and
+/// replays them to the jobs that come after it.
+
+#pragma once
+
+#include "gvcjob.h"
+#include <cgraph/cgraph.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct gvrenderplan_s gvrenderplan_t;
+
+/// create an empty plan
+gvrenderplan_t *gvrenderplan_new(void);
+
+/// free a plan and everything recorded in it
+void gvrenderplan_free(gvrenderplan_t *plan);
+
+/// draw an edge from the plan
+///
+/// Nothing is drawn if the edge was never recorded, or if it was recorded in
+/// a state that does not match the job's.
+///
+/// @param plan Plan to draw from
+/// @param job Job to draw to
+/// @param e Edge to draw
+/// @param styles Parsed `style` of the edge
+/// @return True if the edge was drawn
+bool gvrenderplan_replay(gvrenderplan_t *plan, GVJ_t *job, Agedge_t *e,
+                         char **styles);
+
+/// start recording the drawing calls a job makes for an edge
+///
+/// Does nothing if the edge has been recorded already.
+///
+/// @param plan Plan to record to
+/// @param job Job about to draw the edge
+/// @param e Edge about to be drawn
+/// @param styles Parsed `style` of the edge
+void gvrenderplan_record(gvrenderplan_t *plan, GVJ_t *job, Agedge_t *e,
+                         char **styles);
+
+/// stop recording the job's drawing calls
+void gvrenderplan_stop(GVJ_t *job);
+
+/// @defgroup gvrenderplan_note recording hooks called from gvrender.c
+/// @{
+void gvrenderplan_note_color(GVJ_t *job, bool fill, const char *name);
+void gvrenderplan_note_style(GVJ_t *job, char **s);
+void gvrenderplan_note_penwidth(GVJ_t *job, double penwidth);
+void gvrenderplan_note_ellipse(GVJ_t *job, const pointf *pf, int filled);
+void gvrenderplan_note_polygon(GVJ_t *job, const pointf *af, size_t n,
+                               int filled);
+void gvrenderplan_note_beziercurve(GVJ_t *job, const pointf *af, size_t n,
+                                   int filled);
+void gvrenderplan_note_polyline(GVJ_t *job, const pointf *af, size_t n);
+/// @}
+
+#ifdef __cplusplus
+}
+#endif
@@ -17,6 +17,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
 #include <util/agxbuf.h>
 #include <util/gv_ctype.h>
 #include <util/gv_fopen.h>
@@ -40,6 +43,30 @@ extern shape_desc *find_user_shape(const char *);
 
 static Dict_t *ImageDict;
 
+/// most decoded images the loadimage plugins may keep between uses
+#define MAX_USERSHAPE_DECODED 512
+
+/// a user shape as held in `ImageDict`
+typedef struct cached_s {
+  usershape_t us; ///< the shape itself, first so each can be cast to the other
+  char *path;     ///< file the shape was read from, `NULL` for library shapes
+  time_t mtime;   ///< modification time of `path` when it was read
+  long long size; ///< size of `path` when it was read
+  struct cached_s *prev; ///< next less recently used decoded image
+  struct cached_s *next; ///< next more recently used decoded image
+  bool decoded;          ///< is this in `Decoded`?
+} cached_t;
+
+/// shapes whose image a loadimage plugin has decoded and kept in `us.data`,
+/// least recently used first
+static struct {
+  cached_t *head;
+  cached_t *tail;
+  size_t size;
+} Decoded;
+
+static gvusershape_stats_t Stats;
+
 typedef struct {
   char *template;
   size_t size;
@@ -662,14 +689,46 @@ static void pdf_size(usershape_t *us) {
   }
 }
 
+static void decoded_remove(cached_t *c) {
+  if (!c->decoded)
+    return;
+  if (c->prev)
+    c->prev->next = c->next;
+  else
+    Decoded.head = c->next;
+  if (c->next)
+    c->next->prev = c->prev;
+  else
+    Decoded.tail = c->prev;
+  c->prev = c->next = NULL;
+  c->decoded = false;
+  --Decoded.size;
+}
+
+static void decoded_append(cached_t *c) {
+  assert(!c->decoded);
+  c->prev = Decoded.tail;
+  c->next = NULL;
+  if (Decoded.tail)
+    Decoded.tail->next = c;
+  else
+    Decoded.head = c;
+  Decoded.tail = c;
+  c->decoded = true;
+  ++Decoded.size;
+}
+
 static void usershape_close(void *p) {
-  usershape_t *us = p;
+  cached_t *c = p;
+  usershape_t *us = &c->us;
 
+  decoded_remove(c);
   if (us->f)
     fclose(us->f);
   if (us->data && us->datafree)
     us->datafree(us);
-  free(us);
+  free(c->path);
+  free(c);
 }
 
 static Dtdisc_t ImageDictDisc = {
@@ -731,9 +790,32 @@ void gvusershape_file_release(usershape_t *us) {
 }
 
 static void freeUsershape(usershape_t *us) {
+  cached_t *c = (cached_t *)us;
   if (us->name)
     agstrfree(0, us->name, false);
-  free(us);
+  free(c->path);
+  free(c);
+}
+
+/// note which file a shape was read from, and the state it was in
+static void stamp(cached_t *c) {
+  const char *fn = safefile(c->us.name);
+  struct stat st;
+  if (fn == NULL || stat(fn, &st) != 0)
+    return;
+  c->path = gv_strdup(fn);
+  c->mtime = st.st_mtime;
+  c->size = (long long)st.st_size;
+}
+
+/// has the file a shape was read from changed since?
+static bool is_stale(const cached_t *c) {
+  if (c->path == NULL)
+    return false;
+  struct stat st;
+  if (stat(c->path, &st) != 0)
+    return true;
+  return st.st_mtime != c->mtime || (long long)st.st_size != c->size;
 }
 
 static usershape_t *gvusershape_open(const char *name) {
@@ -744,8 +826,15 @@ static usershape_t *gvusershape_open(const char *name) {
   if (!ImageDict)
     ImageDict = dtopen(&ImageDictDisc, Dttree);
 
-  if (!(us = gvusershape_find(name))) {
-    us = gv_alloc(sizeof(usershape_t));
+  if ((us = gvusershape_find(name)) && is_stale((cached_t *)us)) {
+    dtdelete(ImageDict, us);
+    us = NULL;
+  }
+
+  if (!us) {
+    ++Stats.size_misses;
+    cached_t *c = gv_alloc(sizeof(cached_t));
+    us = &c->us;
 
     us->name = agstrdup(0, name);
     if (!gvusershape_file_access(us)) {
@@ -796,14 +885,44 @@ static usershape_t *gvusershape_open(const char *name) {
     default:
       break;
     }
+    if (us->type != FT_NULL)
+      stamp(c);
     gvusershape_file_release(us);
     dtinsert(ImageDict, us);
     return us;
   }
+  ++Stats.size_hits;
   gvusershape_file_release(us);
   return us;
 }
 
+void gvusershape_used(usershape_t *us, const void *data) {
+  if (gvusershape_find(us->name) != us)
+    return;
+  cached_t *c = (cached_t *)us;
+
+  decoded_remove(c);
+  if (us->data == NULL)
+    return;
+  if (us->data == data)
+    ++Stats.image_hits;
+  else
+    ++Stats.image_misses;
+  decoded_append(c);
+
+  // drop the images that have gone unused longest
+  while (Decoded.size > MAX_USERSHAPE_DECODED) {
+    cached_t *lru = Decoded.head;
+    decoded_remove(lru);
+    if (lru->us.datafree)
+      lru->us.datafree(&lru->us);
+    lru->us.data = NULL;
+    lru->us.datafree = NULL;
+  }
+}
+
+gvusershape_stats_t gvusershape_stats(void) { return Stats; }
+
 /* gvusershape_size_dpi:
  * Return image size in points.
  */
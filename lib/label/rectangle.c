@@ -92,7 +92,7 @@ Rect_t CombineRect(const Rect_t r, const Rect_t rr) {
     for (size_t i = 0; i < NUMDIMS; i++) {
 	new.boundary[i] = fmin(r.boundary[i], rr.boundary[i]);
 	size_t j = i + NUMDIMS;
-	new.boundary[j] = fmin(r.boundary[j], rr.boundary[j]);
+	new.boundary[j] = fmax(r.boundary[j], rr.boundary[j]);
     }
     return new;
 }
@@ -17,11 +17,11 @@
 
 #include <sparse/SparseMatrix.h>
 #include <neatogen/call_tri.h>
-#include <rbtree/red_black_tree.h>
 #include <common/types.h>
 #include <math.h>
 #include <common/globals.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <time.h>
 
 static void ideal_distance_avoid_overlap(int dim, SparseMatrix A, double *x, double *width, double *ideal_distance, double *tmax, double *tmin){
@@ -74,139 +74,158 @@ static void ideal_distance_avoid_overlap(int dim, SparseMatrix A, double *x, dou
   }
 }
 
-enum {INTV_OPEN, INTV_CLOSE};
+/* ============================== overlap detection ==================*/
+
+/* Overlapping pairs of boxes are found with a uniform grid. Each box is
+   registered in every cell it covers, and candidate pairs are only those
+   sharing a cell. A pair that shares several cells is only checked in the cell
+   containing the lower left corner of the intersection of the two boxes, so
+   each pair is checked once. */
 
 typedef struct {
-  int node;
-  double x;
-  int status;
-} scan_point;
-
-static int comp_scan_points(const void *p, const void *q){
-  const scan_point *pp = p;
-  const scan_point *qq = q;
-  if (pp->x > qq->x){
-    return 1;
-  } else if (pp->x < qq->x){
-    return -1;
-  } else {
-    if (pp->node > qq->node){
-      return 1;
-    } else if (pp->node < qq->node){
-      return -1;
-    }
-    return 0;
-  }
-  return 0;
+  double xmin, ymin; /* lower left corner of the grid */
+  double hx, hy;     /* cell size */
+  int nx, ny;        /* number of cells in each direction */
+  int *start;        /* boxes in cell c are boxes[start[c]..start[c+1]) */
+  int *boxes;
+} overlap_grid;
+
+static int grid_cell_x(const overlap_grid *g, double x) {
+  const double c = floor((x - g->xmin) / g->hx);
+  if (c < 0) return 0;
+  if (c >= g->nx) return g->nx - 1;
+  return (int)c;
 }
 
-static void NodeDest(void* a) {
-  (void)a;
-  /*  free((int*)a);*/
+static int grid_cell_y(const overlap_grid *g, double y) {
+  const double c = floor((y - g->ymin) / g->hy);
+  if (c < 0) return 0;
+  if (c >= g->ny) return g->ny - 1;
+  return (int)c;
 }
 
-static SparseMatrix get_overlap_graph(int dim, int n, double *x, double *width, int check_overlap_only){
-  /* if check_overlap_only = TRUE, we only check whether there is one overlap */
-  int i, k, neighbor;
-  SparseMatrix A = NULL, B = NULL;
-  rb_red_blk_node *newNode, *newNode0;
-  rb_red_blk_tree* treey;
-  double one = 1;
+static int cmp_double(const void *a, const void *b) {
+  const double x = *(const double *)a;
+  const double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
 
-  A = SparseMatrix_new(n, n, 1, MATRIX_TYPE_REAL, FORMAT_COORD);
+/* median of the half widths of the boxes along one axis */
+static double median_width(int dim, int n, const double *width, int axis) {
+  double *w = gv_calloc((size_t)n, sizeof(double));
+  for (int i = 0; i < n; i++) w[i] = width[i*dim+axis];
+  qsort(w, (size_t)n, sizeof(double), cmp_double);
+  const double m = w[n / 2];
+  free(w);
+  return m;
+}
 
-  scan_point *scanpointsx = gv_calloc(2 * n, sizeof(scan_point));
-  for (i = 0; i < n; i++){
-    scanpointsx[2*i].node = i;
-    scanpointsx[2*i].x = x[i*dim] - width[i*dim];
-    scanpointsx[2*i].status = INTV_OPEN;
-    scanpointsx[2*i+1].node = i+n;
-    scanpointsx[2*i+1].x = x[i*dim] + width[i*dim];
-    scanpointsx[2*i+1].status = INTV_CLOSE;
-  }
-  qsort(scanpointsx, 2*n, sizeof(scan_point), comp_scan_points);
+static void overlap_grid_init(overlap_grid *g, int dim, int n, double *x,
+                              double *width) {
+  double xmax, ymax;
+  int i, ix, iy;
 
-  scan_point *scanpointsy = gv_calloc(2 * n, sizeof(scan_point));
+  g->xmin = xmax = x[0] - width[0];
+  g->ymin = ymax = x[1] - width[1];
   for (i = 0; i < n; i++){
-    scanpointsy[i].node = i;
-    scanpointsy[i].x = x[i*dim+1] - width[i*dim+1];
-    scanpointsy[i].status = INTV_OPEN;
-    scanpointsy[i+n].node = i;
-    scanpointsy[i+n].x = x[i*dim+1] + width[i*dim+1];
-    scanpointsy[i+n].status = INTV_CLOSE;
+    g->xmin = fmin(g->xmin, x[i*dim] - width[i*dim]);
+    g->ymin = fmin(g->ymin, x[i*dim+1] - width[i*dim+1]);
+    xmax = fmax(xmax, x[i*dim] + width[i*dim]);
+    ymax = fmax(ymax, x[i*dim+1] + width[i*dim+1]);
   }
 
-  treey = RBTreeCreate(comp_scan_points, NodeDest);
-
-  for (i = 0; i < 2*n; i++){
-#ifdef DEBUG_RBTREE
-    fprintf(stderr," k = %d node = %d x====%f\n",(scanpointsx[i].node)%n, (scanpointsx[i].node), (scanpointsx[i].x));
-#endif
-
-    k = (scanpointsx[i].node)%n;
-
-
-    if (scanpointsx[i].status == INTV_OPEN){
-#ifdef DEBUG_RBTREE
-      fprintf(stderr, "inserting...");
-      treey->PrintKey(&(scanpointsy[k]));
-#endif
-
-      RBTreeInsert(treey, &scanpointsy[k]); // add both open and close int for y
-
-#ifdef DEBUG_RBTREE
-      fprintf(stderr, "inserting2...");
-      treey->PrintKey(&(scanpointsy[k+n]));
-#endif
+  /* cells about the size of a median box, but no more cells than a small
+     multiple of the number of boxes. Sizing them from the mean instead would
+     let a few very large boxes, like long labels, grow every cell until most
+     small boxes share one and checking them is quadratic again. Under the
+     median, a large box is registered in many cells, but there are at most
+     4n cells, so it costs O(n) rather than O(n²). */
+  const double lx = fmax(xmax - g->xmin, MACHINEACC);
+  const double ly = fmax(ymax - g->ymin, MACHINEACC);
+  g->hx = fmax(2 * median_width(dim, n, width, 0), lx / n);
+  g->hy = fmax(2 * median_width(dim, n, width, 1), ly / n);
+  const double max_cells = 4.0 * n;
+  const double ncells = ceil(lx / g->hx) * ceil(ly / g->hy);
+  if (ncells > max_cells) {
+    const double s = sqrt(ncells / max_cells);
+    g->hx *= s;
+    g->hy *= s;
+  }
+  g->nx = (int)fmax(1, ceil(lx / g->hx));
+  g->ny = (int)fmax(1, ceil(ly / g->hy));
 
-      RBTreeInsert(treey, &scanpointsy[k + n]);
-    } else {
-      double bsta, bbsta, bsto, bbsto; int ii; 
+  /* count the boxes in each cell, then fill the cells */
+  const size_t ncell = (size_t)g->nx * (size_t)g->ny;
+  g->start = gv_calloc(ncell + 1, sizeof(int));
+  for (i = 0; i < n; i++){
+    const int x0 = grid_cell_x(g, x[i*dim] - width[i*dim]);
+    const int x1 = grid_cell_x(g, x[i*dim] + width[i*dim]);
+    const int y0 = grid_cell_y(g, x[i*dim+1] - width[i*dim+1]);
+    const int y1 = grid_cell_y(g, x[i*dim+1] + width[i*dim+1]);
+    for (iy = y0; iy <= y1; iy++){
+      for (ix = x0; ix <= x1; ix++) g->start[(size_t)iy*g->nx + ix + 1]++;
+    }
+  }
+  for (size_t c = 0; c < ncell; c++) g->start[c+1] += g->start[c];
 
-      assert(scanpointsx[i].node >= n);
+  int *fill = gv_calloc(ncell, sizeof(int));
+  g->boxes = gv_calloc((size_t)g->start[ncell], sizeof(int));
+  for (i = 0; i < n; i++){
+    const int x0 = grid_cell_x(g, x[i*dim] - width[i*dim]);
+    const int x1 = grid_cell_x(g, x[i*dim] + width[i*dim]);
+    const int y0 = grid_cell_y(g, x[i*dim+1] - width[i*dim+1]);
+    const int y1 = grid_cell_y(g, x[i*dim+1] + width[i*dim+1]);
+    for (iy = y0; iy <= y1; iy++){
+      for (ix = x0; ix <= x1; ix++){
+        const size_t c = (size_t)iy*g->nx + ix;
+        g->boxes[g->start[c] + fill[c]++] = i;
+      }
+    }
+  }
+  free(fill);
+}
 
-      newNode = newNode0 = RBExactQuery(treey, &(scanpointsy[k + n]));
-      ii = ((scan_point *)newNode->key)->node;
-      assert(ii < n);
-      bsta = scanpointsy[ii].x; bsto = scanpointsy[ii+n].x;
+static void overlap_grid_free(overlap_grid *g) {
+  free(g->start);
+  free(g->boxes);
+}
 
-#ifdef DEBUG_RBTREE
-      fprintf(stderr, "popping..%d....yinterval={%f,%f}\n", scanpointsy[k + n].node, bsta, bsto);
-      treey->PrintKey(newNode->key);
-#endif
+static SparseMatrix get_overlap_graph(int dim, int n, double *x, double *width, int check_overlap_only){
+  /* if check_overlap_only = TRUE, we only check whether there is one overlap */
+  SparseMatrix A = NULL, B = NULL;
+  overlap_grid g;
+  double one = 1;
+  int ix, iy;
 
-     assert(treey->nil != newNode);
-      while ((newNode) && ((newNode = TreePredecessor(treey, newNode)) != treey->nil)){
-	neighbor = (((scan_point *)newNode->key)->node)%n;
-	bbsta = scanpointsy[neighbor].x; bbsto = scanpointsy[neighbor+n].x;/* the y-interval of the node that has one end of the interval lower than the top of the leaving interval (bsto) */
-#ifdef DEBUG_RBTREE
-	fprintf(stderr," predecessor is node %d y = %f\n", ((scan_point *)newNode->key)->node, ((scan_point *)newNode->key)->x);
-#endif
-	if (neighbor != k){
-	  if (fabs(0.5*(bsta+bsto) - 0.5*(bbsta+bbsto)) < 0.5*(bsto-bsta) + 0.5*(bbsto-bbsta)){/* if the distance of the centers of the interval is less than sum of width, we have overlap */
-	    A = SparseMatrix_coordinate_form_add_entry(A, neighbor, k, &one);
-#ifdef DEBUG_RBTREE
-	    fprintf(stderr,"======================================  %d %d\n",k,neighbor);
-#endif
-	    if (check_overlap_only) goto check_overlap_RETURN;
-	  }
-	}
+  A = SparseMatrix_new(n, n, 1, MATRIX_TYPE_REAL, FORMAT_COORD);
+  if (n == 0) goto RETURN;
+
+  overlap_grid_init(&g, dim, n, x, width);
+
+  for (iy = 0; iy < g.ny; iy++){
+    for (ix = 0; ix < g.nx; ix++){
+      const size_t c = (size_t)iy*g.nx + ix;
+      for (int a = g.start[c]; a < g.start[c+1]; a++){
+        const int i = g.boxes[a];
+        for (int b = a + 1; b < g.start[c+1]; b++){
+          const int j = g.boxes[b];
+          if (fabs(x[i*dim] - x[j*dim]) >= width[i*dim] + width[j*dim]) continue;
+          if (fabs(x[i*dim+1] - x[j*dim+1]) >= width[i*dim+1] + width[j*dim+1]) continue;
+          /* only report the pair in the cell holding the lower left corner of
+             the intersection */
+          if (grid_cell_x(&g, fmax(x[i*dim] - width[i*dim], x[j*dim] - width[j*dim])) != ix) continue;
+          if (grid_cell_y(&g, fmax(x[i*dim+1] - width[i*dim+1], x[j*dim+1] - width[j*dim+1])) != iy) continue;
+          A = SparseMatrix_coordinate_form_add_entry(A, i, j, &one);
+          if (check_overlap_only) goto DONE;
+        }
       }
-
-#ifdef DEBUG_RBTREE
-      fprintf(stderr, "deleting...");
-      treey->PrintKey(newNode0->key);
-#endif
-
-      if (newNode0) RBDelete(treey,newNode0);
     }
   }
 
-check_overlap_RETURN:
-   free(scanpointsx);
-  free(scanpointsy);
-  RBTreeDestroy(treey);
+ DONE:
+  overlap_grid_free(&g);
 
+ RETURN:
   B = SparseMatrix_from_coordinate_format(A);
   SparseMatrix_delete(A);
   A = SparseMatrix_symmetrize(B, false);
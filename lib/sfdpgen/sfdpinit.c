@@ -184,6 +184,8 @@ late_quadtree_scheme (graph_t* g, Agsym_t* sym, int dflt)
 	rv = QUAD_TREE_NORMAL;
       } else if (!strcasecmp(s, "fast")){
 	rv = QUAD_TREE_FAST;
+      } else if (!strcasecmp(s, "fmm")){
+	rv = QUAD_TREE_FMM;
       }	else {
 	rv = dflt;
       }
@@ -45,6 +45,15 @@ static const double tol = 0.001;
 
 static const double cool = 0.90;
 
+/// step size below which the fast embedding refits its quadtree in place
+/// between iterations instead of rebuilding it
+static const double qtree_refit_step = 0.01;
+
+/// multipole acceptance criterion, two cells are approximated by their
+/// multipole expansions if the sum of their radii is less than
+/// fmm_theta × the distance between their centers
+static const double fmm_theta = 0.9;
+
 spring_electrical_control spring_electrical_control_new(void){
   spring_electrical_control ctrl = {0};
   ctrl.p = AUTOP;/*a negativve number default to -1. repulsive force = dist^p */
@@ -73,7 +82,7 @@ static char* smoothings[] = {
 };
 
 static char* tschemes[] = {
-  "NONE", "NORMAL", "FAST", "HYBRID"
+  "NONE", "NORMAL", "FAST", "HYBRID", "FMM"
 };
 
 void spring_electrical_control_print(spring_electrical_control ctrl){
@@ -182,6 +191,61 @@ static double update_step(bool adaptive_cooling, double step, double Fnorm,
 }
 
 
+/// add the attractive force C^((2-p)/3) ||x_i-x_j||/K × (x_j - x_i) on node i
+/// from its neighbors in A to f
+///
+/// This is written for the callers below to pass a literal dimension, so that
+/// compilers can unroll and vectorize the coordinate loops for 2D and 3D.
+static inline void attractive_force_dim(int dim, const int *ia, const int *ja,
+                                        const double *x, double CRK, int i,
+                                        double *f) {
+  const double *xi = &x[i * dim];
+  for (int j = ia[i]; j < ia[i + 1]; j++) {
+    if (ja[j] == i) continue;
+    const double *xj = &x[ja[j] * dim];
+    double dist = 0;
+    for (int k = 0; k < dim; k++) dist += (xi[k] - xj[k]) * (xi[k] - xj[k]);
+    const double s = CRK * sqrt(dist);
+    for (int k = 0; k < dim; k++) f[k] -= s * (xi[k] - xj[k]);
+  }
+}
+
+static void attractive_force(int dim, const int *ia, const int *ja,
+                             const double *x, double CRK, int i, double *f) {
+  switch (dim) {
+  case 2:
+    attractive_force_dim(2, ia, ja, x, CRK, i, f);
+    break;
+  case 3:
+    attractive_force_dim(3, ia, ja, x, CRK, i, f);
+    break;
+  default:
+    attractive_force_dim(dim, ia, ja, x, CRK, i, f);
+    break;
+  }
+}
+
+/// attractive forces on all nodes, accumulated into force
+static void attractive_forces(int dim, const int *ia, const int *ja,
+                              const double *x, double CRK, int n,
+                              double *force) {
+  int i;
+  switch (dim) {
+  case 2:
+    for (i = 0; i < n; i++)
+      attractive_force_dim(2, ia, ja, x, CRK, i, &force[i * 2]);
+    break;
+  case 3:
+    for (i = 0; i < n; i++)
+      attractive_force_dim(3, ia, ja, x, CRK, i, &force[i * 3]);
+    break;
+  default:
+    for (i = 0; i < n; i++)
+      attractive_force_dim(dim, ia, ja, x, CRK, i, &force[i * dim]);
+    break;
+  }
+}
+
 #define node_degree(i) (ia[(i)+1] - ia[(i)])
 
 static void set_leaves(double *x, int dim, double dist, double ang, int i, int j){
@@ -244,10 +308,10 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0,
   /* x is a point to a 1D array, x[i*dim+j] gives the coordinate of the i-th node at dimension j.  */
   SparseMatrix A = A0;
   int m, n;
-  int i, j, k;
+  int i, k;
   double p = ctrl->p, K = ctrl->K, CRK, maxiter = ctrl->maxiter, step = ctrl->step, KP;
   int *ia = NULL, *ja = NULL;
-  double *f = NULL, dist, F, Fnorm = 0, Fnorm0;
+  double *f = NULL, F, Fnorm = 0, Fnorm0;
   int iter = 0;
   const bool adaptive_cooling = ctrl->adaptive_cooling;
   double counts[4], *force = NULL;
@@ -289,17 +353,23 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0,
 
   force = gv_calloc(dim * n, sizeof(double));
 
+  QuadTree qt = NULL;
   do {
     iter++;
     Fnorm0 = Fnorm;
     Fnorm = 0.;
 
-    max_qtree_level = oned_optimizer_get(qtree_level_optimizer);
-
 #ifdef TIME
     start = clock();
 #endif
-    QuadTree qt = QuadTree_new_from_point_list(dim, n, max_qtree_level, x);
+    // once nodes barely move, keep the tree (and its level) from the previous
+    // iteration and only move the nodes that left their cell
+    const bool refit = step < qtree_refit_step;
+    if (!refit || !QuadTree_refit(qt, x)) {
+      QuadTree_delete(qt);
+      max_qtree_level = oned_optimizer_get(qtree_level_optimizer);
+      qt = QuadTree_new_from_point_list(dim, n, max_qtree_level, x);
+    }
 
 #ifdef TIME
     qtree_new_cpu += (double)(clock() - start) / CLOCKS_PER_SEC;
@@ -310,7 +380,11 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0,
     start = clock();
 #endif
 
-    QuadTree_get_repulsive_force(qt, force, x, bh, p, KP, counts);
+    if (ctrl->tscheme == QUAD_TREE_FMM) {
+      QuadTree_get_repulsive_force_fmm(qt, force, x, fmm_theta, p, KP, counts);
+    } else {
+      QuadTree_get_repulsive_force(qt, force, x, bh, p, KP, counts);
+    }
 
 #ifdef TIME
     end = clock();
@@ -318,16 +392,7 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0,
 #endif
 
     /* attractive force   C^((2-p)/3) ||x_i-x_j||/K * (x_j - x_i) */
-    for (i = 0; i < n; i++){
-      f = &(force[i*dim]);
-      for (j = ia[i]; j < ia[i+1]; j++){
-	if (ja[j] == i) continue;
-	dist = distance(x, dim, i, ja[j]);
-	for (k = 0; k < dim; k++){
-	  f[k] -= CRK*(x[i*dim+k] - x[ja[j]*dim+k])*dist;
-	}
-      }
-    }
+    attractive_forces(dim, ia, ja, x, CRK, n, force);
 
 
     /* move */
@@ -344,17 +409,10 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0,
 
 
     if (qt) {
-#ifdef TIME
-      start = clock();
-#endif
-      QuadTree_delete(qt);
-#ifdef TIME
-      end = clock();
-      qtree_new_cpu += (double)(end - start) / CLOCKS_PER_SEC;
-#endif
-
-      oned_optimizer_train(&qtree_level_optimizer,
-                           counts[0] + 0.85 * counts[1] + 3.3 * counts[2]);
+      if (!refit) {
+        oned_optimizer_train(&qtree_level_optimizer,
+                             counts[0] + 0.85 * counts[1] + 3.3 * counts[2]);
+      }
     } else {
       if (Verbose) {
         fprintf(stderr, "\r                iter = %d, step = %f Fnorm = %f nz = %d  K = %f                                  ",iter, step, Fnorm, A->nz,K);
@@ -364,6 +422,14 @@ void spring_electrical_embedding_fast(int dim, SparseMatrix A0,
     step = update_step(adaptive_cooling, step, Fnorm, Fnorm0);
   } while (step > tol && iter < maxiter);
 
+#ifdef TIME
+  start = clock();
+#endif
+  QuadTree_delete(qt);
+#ifdef TIME
+  qtree_new_cpu += (double)(clock() - start) / CLOCKS_PER_SEC;
+#endif
+
 #ifdef DEBUG_PRINT
     if (Verbose) {
       fprintf(stderr, "\n iter = %d, step = %f Fnorm = %f nz = %d  K = %f   ",iter, step, Fnorm, A->nz, K);
@@ -452,8 +518,9 @@ static void spring_electrical_embedding_slow(int dim, SparseMatrix A0,
       for (j = 0; j < n; j++){
 	if (j == i) continue;
 	dist = distance_cropped(x, dim, i, j);
+	const double s = repulsive_scale(KP, p, dist);
 	for (k = 0; k < dim; k++){
-	  f[k] += KP*(x[i*dim+k] - x[j*dim+k])/pow(dist, 1.- p);
+	  f[k] += s*(x[i*dim+k] - x[j*dim+k]);
 	}
       }
       for (k = 0; k < dim; k++) force[i*dim+k] += f[k];
@@ -464,13 +531,7 @@ static void spring_electrical_embedding_slow(int dim, SparseMatrix A0,
     for (i = 0; i < n; i++){
       for (k = 0; k < dim; k++) f[k] = 0.;
       /* attractive force   C^((2-p)/3) ||x_i-x_j||/K * (x_j - x_i) */
-      for (j = ia[i]; j < ia[i+1]; j++){
-	if (ja[j] == i) continue;
-	dist = distance(x, dim, i, ja[j]);
-	for (k = 0; k < dim; k++){
-	  f[k] -= CRK*(x[i*dim+k] - x[ja[j]*dim+k])*dist;
-	}
-      }
+      attractive_force(dim, ia, ja, x, CRK, i, f);
       for (k = 0; k < dim; k++) force[i*dim+k] += f[k];
     }
 
@@ -594,13 +655,7 @@ void spring_electrical_embedding(int dim, SparseMatrix A0,
     for (i = 0; i < n; i++){
       for (k = 0; k < dim; k++) f[k] = 0.;
       /* attractive force   C^((2-p)/3) ||x_i-x_j||/K * (x_j - x_i) */
-      for (j = ia[i]; j < ia[i+1]; j++){
-	if (ja[j] == i) continue;
-	dist = distance(x, dim, i, ja[j]);
-	for (k = 0; k < dim; k++){
-	  f[k] -= CRK*(x[i*dim+k] - x[ja[j]*dim+k])*dist;
-	}
-      }
+      attractive_force(dim, ia, ja, x, CRK, i, f);
 
       /* repulsive force K^(1 - p)/||x_i-x_j||^(1 - p) (x_i - x_j) */
       if (USE_QT){
@@ -618,16 +673,18 @@ void spring_electrical_embedding(int dim, SparseMatrix A0,
 	nsuper_avg += nsuper;
 	for (j = 0; j < nsuper; j++){
 	  dist = MAX(distances[j], MINDIST);
+	  const double s = supernode_wgts[j] * repulsive_scale(KP, p, dist);
 	  for (k = 0; k < dim; k++){
-	    f[k] += supernode_wgts[j]*KP*(x[i*dim+k] - center[j*dim+k])/pow(dist, 1.- p);
+	    f[k] += s*(x[i*dim+k] - center[j*dim+k]);
 	  }
 	}
       } else {
 	for (j = 0; j < n; j++){
 	  if (j == i) continue;
 	  dist = distance_cropped(x, dim, i, j);
+	  const double s = repulsive_scale(KP, p, dist);
 	  for (k = 0; k < dim; k++){
-	    f[k] += KP*(x[i*dim+k] - x[j*dim+k])/pow(dist, 1.- p);
+	    f[k] += s*(x[i*dim+k] - x[j*dim+k]);
 	  }
 	}
       }
@@ -754,14 +811,7 @@ void spring_electrical_spring_embedding(int dim, SparseMatrix A0, SparseMatrix D
     for (i = 0; i < n; i++){
       for (k = 0; k < dim; k++) f[k] = 0.;
       /* attractive force   C^((2-p)/3) ||x_i-x_j||/K * (x_j - x_i) */
-
-      for (j = ia[i]; j < ia[i+1]; j++){
-	if (ja[j] == i) continue;
-	dist = distance(x, dim, i, ja[j]);
-	for (k = 0; k < dim; k++){
-	  f[k] -= CRK*(x[i*dim+k] - x[ja[j]*dim+k])*dist;
-	}
-      }
+      attractive_force(dim, ia, ja, x, CRK, i, f);
 
       for (j = id[i]; j < id[i+1]; j++){
 	if (jd[j] == i) continue;
@@ -782,16 +832,18 @@ void spring_electrical_spring_embedding(int dim, SparseMatrix A0, SparseMatrix D
 				&center, &supernode_wgts, &distances, &counts);
 	for (j = 0; j < nsuper; j++){
 	  dist = MAX(distances[j], MINDIST);
+	  const double s = supernode_wgts[j] * repulsive_scale(KP, p, dist);
 	  for (k = 0; k < dim; k++){
-	    f[k] += supernode_wgts[j]*KP*(x[i*dim+k] - center[j*dim+k])/pow(dist, 1.- p);
+	    f[k] += s*(x[i*dim+k] - center[j*dim+k]);
 	  }
 	}
       } else {
 	for (j = 0; j < n; j++){
 	  if (j == i) continue;
 	  dist = distance_cropped(x, dim, i, j);
+	  const double s = repulsive_scale(KP, p, dist);
 	  for (k = 0; k < dim; k++){
-	    f[k] += KP*(x[i*dim+k] - x[j*dim+k])/pow(dist, 1.- p);
+	    f[k] += s*(x[i*dim+k] - x[j*dim+k]);
 	  }
 	}
       }
@@ -1159,7 +1211,7 @@ void multilevel_spring_electrical_embedding(int dim, SparseMatrix A0,
 #endif
     if (ctrl->tscheme == QUAD_TREE_NONE){
       spring_electrical_embedding_slow(dim, grid->A, ctrl, xc, flag);
-    } else if (ctrl->tscheme == QUAD_TREE_FAST || (ctrl->tscheme == QUAD_TREE_HYBRID && grid->A->m > QUAD_TREE_HYBRID_SIZE)){
+    } else if (ctrl->tscheme == QUAD_TREE_FAST || ctrl->tscheme == QUAD_TREE_FMM || (ctrl->tscheme == QUAD_TREE_HYBRID && grid->A->m > QUAD_TREE_HYBRID_SIZE)){
       if (ctrl->tscheme == QUAD_TREE_HYBRID && grid->A->m > 10 && Verbose){
 	fprintf(stderr, "QUAD_TREE_HYBRID, size larger than %d, switch to fast quadtree", QUAD_TREE_HYBRID_SIZE);
       }
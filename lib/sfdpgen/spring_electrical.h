@@ -22,7 +22,7 @@ enum {SMOOTHING_NONE, SMOOTHING_STRESS_MAJORIZATION_GRAPH_DIST, SMOOTHING_STRESS
 
 enum {QUAD_TREE_HYBRID_SIZE = 10000};
 
-enum {QUAD_TREE_NONE = 0, QUAD_TREE_NORMAL, QUAD_TREE_FAST, QUAD_TREE_HYBRID};
+enum {QUAD_TREE_NONE = 0, QUAD_TREE_NORMAL, QUAD_TREE_FAST, QUAD_TREE_HYBRID, QUAD_TREE_FMM};
 
 typedef struct {
   double p;/*a negativve real number default to -1. repulsive force = dist^p */
@@ -38,7 +38,7 @@ typedef struct {
   int smoothing;
   int overlap;
   bool do_shrinking;
-  int tscheme; /* octree scheme. 0 (no octree), 1 (normal), 2 (fast) */
+  int tscheme; /* octree scheme. 0 (no octree), 1 (normal), 2 (fast), 4 (fast multipole) */
   double initial_scaling;/* how to scale the layout of the graph before passing to overlap removal algorithm.
 			  positive values are absolute in points, negative values are relative
 			  to average label size.
@@ -15,6 +15,7 @@
 #include <sparse/QuadTree.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <string.h>
 #include <util/alloc.h>
 
 extern double distance_cropped(double *x, int dim, int i, int j);
@@ -130,7 +131,7 @@ static void QuadTree_repulsive_force_interact(QuadTree qt1, QuadTree qt2, double
   // calculate the all to all repulsive force and accumulate on each node of the
   // quadtree if an interaction is possible.
   //   force[i × dim + j], j=1,..., dim is the force on node i
-  double *x1, *x2, dist, wgt1, wgt2, f, *f1, *f2, w1, w2;
+  double *x1, *x2, dist, wgt1, wgt2, f, s, *f1, *f2, w1, w2;
   int dim, i, j, i1, i2, k;
   QuadTree qt11, qt12; 
 
@@ -152,12 +153,9 @@ static void QuadTree_repulsive_force_interact(QuadTree qt1, QuadTree qt2, double
     w2 = qt2->total_weight;
     f2 = get_or_alloc_force_qt(qt2, dim);
     assert(dist > 0);
+    s = w1*w2*repulsive_scale(KP, p, dist);
     for (k = 0; k < dim; k++){
-      if (p == -1){
-	f = w1*w2*KP*(x1[k] - x2[k])/(dist*dist);
-      } else {
-	f = w1*w2*KP*(x1[k] - x2[k])/pow(dist, 1.- p);
-      }
+      f = s*(x1[k] - x2[k]);
       f1[k] += f;
       f2[k] -= f;
     }
@@ -184,12 +182,9 @@ static void QuadTree_repulsive_force_interact(QuadTree qt1, QuadTree qt2, double
 	}
 	counts[1]++;
 	dist = distance_cropped(x, dim, i1, i2);
+	s = wgt1*wgt2*repulsive_scale(KP, p, dist);
 	for (k = 0; k < dim; k++){
-	  if (p == -1){
-	    f = wgt1*wgt2*KP*(x1[k] - x2[k])/(dist*dist);
-	  } else {
-	    f = wgt1*wgt2*KP*(x1[k] - x2[k])/pow(dist, 1.- p);
-	  }
+	  f = s*(x1[k] - x2[k]);
 	  f1[k] += f;
 	  f2[k] -= f;
 	}
@@ -306,6 +301,244 @@ void QuadTree_get_repulsive_force(QuadTree qt, double *force, double *x, double
   for (i = 0; i < 4; i++) counts[i] /= n;
 
 }
+/* Fast multipole evaluation of the 2D repulsive force for p = -1.
+   Writing a node position as the complex number z, the force on node i is
+   w_i × KP × conj(F(z_i)) where F(z) = Σ_j w_j ÷ (z - z_j). Each cell carries a
+   multipole expansion F(z) = Σ_k M_k ÷ (z - c)^(k+1) about its center c of the
+   nodes it contains and a local expansion F(z) = Σ_k L_k × (z - c)^k of the
+   field due to well separated cells. */
+
+enum { FMM_ORDER = 6 };
+
+typedef struct {
+  double re, im;
+} cplx;
+
+typedef struct {
+  cplx M[FMM_ORDER]; ///< multipole coefficients
+  cplx L[FMM_ORDER]; ///< local coefficients
+  bool local;        ///< are any of the local coefficients nonzero?
+} fmm_cell;
+
+static cplx cplx_mul(cplx a, cplx b) {
+  return (cplx){a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re};
+}
+
+static cplx cplx_inv(cplx a) {
+  const double d = a.re * a.re + a.im * a.im;
+  return (cplx){a.re / d, -a.im / d};
+}
+
+/// z^0, z^1, …, z^(n-1)
+static void cplx_powers(cplx z, int n, cplx *pw) {
+  pw[0] = (cplx){1, 0};
+  for (int k = 1; k < n; k++) pw[k] = cplx_mul(pw[k - 1], z);
+}
+
+/// binomial coefficients C(n, k) for n < 2 × FMM_ORDER
+typedef struct {
+  double c[2 * FMM_ORDER][2 * FMM_ORDER];
+} fmm_binomials;
+
+static void fmm_binomials_init(fmm_binomials *b) {
+  for (int n = 0; n < 2 * FMM_ORDER; n++) {
+    b->c[n][0] = b->c[n][n] = 1;
+    for (int k = 1; k < n; k++) b->c[n][k] = b->c[n - 1][k - 1] + b->c[n - 1][k];
+  }
+}
+
+static fmm_cell *fmm_get_cell(QuadTree qt) {
+  // the expansions are recomputed on each evaluation, but a cell keeps its
+  // storage, so a tree refit between evaluations only allocates for new cells
+  if (qt->data) {
+    memset(qt->data, 0, sizeof(fmm_cell));
+  } else {
+    qt->data = gv_calloc(1, sizeof(fmm_cell));
+  }
+  return qt->data;
+}
+
+static void fmm_upward(QuadTree qt, const fmm_binomials *b, double *counts) {
+  cplx pw[FMM_ORDER];
+  int i, k, l;
+
+  if (!qt) return;
+  counts[2]++;
+  fmm_cell *cell = fmm_get_cell(qt);
+
+  for (node_data nd = qt->l; nd; nd = nd->next) {/* particle to multipole */
+    cplx_powers((cplx){nd->coord[0] - qt->center[0], nd->coord[1] - qt->center[1]}, FMM_ORDER, pw);
+    for (k = 0; k < FMM_ORDER; k++) {
+      cell->M[k].re += nd->node_weight * pw[k].re;
+      cell->M[k].im += nd->node_weight * pw[k].im;
+    }
+  }
+
+  if (!qt->qts) return;
+  for (i = 0; i < 4; i++) {/* multipole to multipole */
+    QuadTree child = qt->qts[i];
+    if (!child) continue;
+    fmm_upward(child, b, counts);
+    const fmm_cell *c = child->data;
+    cplx_powers((cplx){child->center[0] - qt->center[0], child->center[1] - qt->center[1]}, FMM_ORDER, pw);
+    for (k = 0; k < FMM_ORDER; k++) {
+      for (l = 0; l <= k; l++) {
+        cplx t = cplx_mul(pw[k - l], c->M[l]);
+        cell->M[k].re += b->c[k][l] * t.re;
+        cell->M[k].im += b->c[k][l] * t.im;
+      }
+    }
+  }
+}
+
+/// add the multipole expansion of cell "src" to the local expansion of "dst"
+static void fmm_m2l(QuadTree src, QuadTree dst, const fmm_binomials *b) {
+  cplx ipw[2 * FMM_ORDER];
+  const fmm_cell *s = src->data;
+  fmm_cell *d = dst->data;
+  int k, m;
+
+  const cplx D = {dst->center[0] - src->center[0], dst->center[1] - src->center[1]};
+  cplx_powers(cplx_inv(D), 2 * FMM_ORDER, ipw);
+  d->local = true;
+
+  for (m = 0; m < FMM_ORDER; m++) {
+    const double sign = m % 2 == 0 ? 1 : -1;
+    for (k = 0; k < FMM_ORDER; k++) {
+      cplx t = cplx_mul(s->M[k], ipw[k + m + 1]);
+      d->L[m].re += sign * b->c[m + k][k] * t.re;
+      d->L[m].im += sign * b->c[m + k][k] * t.im;
+    }
+  }
+}
+
+static void fmm_interact(QuadTree qt1, QuadTree qt2, double *x, double *force,
+                         double bh, double KP, const fmm_binomials *b,
+                         double *counts) {
+  double dist, f, *x1, *x2;
+  int i, j, k;
+
+  if (!qt1 || !qt2) return;
+  assert(qt1->n > 0 && qt2->n > 0);
+  const int dim = qt1->dim;
+
+  node_data l1 = qt1->l;
+  node_data l2 = qt2->l;
+
+  /* well separated: translate each cell's multipole into the other's local
+     expansion. Cells are squares, so their radius is √2 × width. Pairs of
+     cells with few nodes are cheaper to sum directly */
+  if (qt1 != qt2 && qt1->n * qt2->n > FMM_ORDER * FMM_ORDER) {
+    dist = point_distance(qt1->center, qt2->center, dim);
+    if (sqrt(2) * (qt1->width + qt2->width) < bh * dist) {
+      counts[0]++;
+      fmm_m2l(qt1, qt2, b);
+      fmm_m2l(qt2, qt1, b);
+      return;
+    }
+  }
+
+  /* both at leaves, calculate repulsive force directly */
+  if (l1 && l2) {
+    for (; l1; l1 = l1->next) {
+      x1 = l1->coord;
+      for (l2 = qt2->l; l2; l2 = l2->next) {
+        if ((qt1 == qt2 && l2->id < l1->id) || l1->id == l2->id) continue;
+        counts[1]++;
+        x2 = l2->coord;
+        dist = distance_cropped(x, dim, l1->id, l2->id);
+        for (k = 0; k < dim; k++) {
+          f = l1->node_weight * l2->node_weight * KP * (x1[k] - x2[k]) / (dist * dist);
+          force[l1->id * dim + k] += f;
+          force[l2->id * dim + k] -= f;
+        }
+      }
+    }
+    return;
+  }
+
+  if (qt1 == qt2) {/* identical, split one */
+    for (i = 0; i < 4; i++) {
+      for (j = i; j < 4; j++) {
+        fmm_interact(qt1->qts[i], qt1->qts[j], x, force, bh, KP, b, counts);
+      }
+    }
+  } else if (!l1 && (qt1->width >= qt2->width || l2)) {/* split the bigger one that is not a leaf */
+    for (i = 0; i < 4; i++) {
+      fmm_interact(qt1->qts[i], qt2, x, force, bh, KP, b, counts);
+    }
+  } else {
+    assert(!l2);
+    for (i = 0; i < 4; i++) {
+      fmm_interact(qt1, qt2->qts[i], x, force, bh, KP, b, counts);
+    }
+  }
+}
+
+static void fmm_downward(QuadTree qt, double *force, double KP,
+                         const fmm_binomials *b) {
+  cplx pw[FMM_ORDER];
+  int i, k, m;
+
+  if (!qt) return;
+  const fmm_cell *cell = qt->data;
+
+  if (cell->local) {
+    for (node_data nd = qt->l; nd; nd = nd->next) {/* evaluate local expansion */
+      cplx F = {0, 0};
+      cplx_powers((cplx){nd->coord[0] - qt->center[0], nd->coord[1] - qt->center[1]}, FMM_ORDER, pw);
+      for (k = 0; k < FMM_ORDER; k++) {
+        cplx t = cplx_mul(cell->L[k], pw[k]);
+        F.re += t.re;
+        F.im += t.im;
+      }
+      force[nd->id * 2] += nd->node_weight * KP * F.re;
+      force[nd->id * 2 + 1] -= nd->node_weight * KP * F.im;
+    }
+  }
+
+  if (!qt->qts) return;
+  for (i = 0; i < 4; i++) {
+    QuadTree child = qt->qts[i];
+    if (!child) continue;
+    if (cell->local) {/* local to local */
+      fmm_cell *c = child->data;
+      c->local = true;
+      cplx_powers((cplx){child->center[0] - qt->center[0], child->center[1] - qt->center[1]}, FMM_ORDER, pw);
+      for (m = 0; m < FMM_ORDER; m++) {
+        for (k = m; k < FMM_ORDER; k++) {
+          cplx t = cplx_mul(cell->L[k], pw[k - m]);
+          c->L[m].re += b->c[k][m] * t.re;
+          c->L[m].im += b->c[k][m] * t.im;
+        }
+      }
+    }
+    fmm_downward(child, force, KP, b);
+  }
+}
+
+void QuadTree_get_repulsive_force_fmm(QuadTree qt, double *force, double *x, double bh, double p, double KP, double *counts){
+  int n = qt->n, i;
+
+  // expansions are only derived for the 2D, p = -1 kernel
+  if (qt->dim != 2 || p != -1) {
+    QuadTree_get_repulsive_force(qt, force, x, bh, p, KP, counts);
+    return;
+  }
+
+  for (i = 0; i < 4; i++) counts[i] = 0;
+
+  for (i = 0; i < 2*n; i++) force[i] = 0;
+
+  fmm_binomials b;
+  fmm_binomials_init(&b);
+
+  fmm_upward(qt, &b, counts);
+  fmm_interact(qt, qt, x, force, bh, KP, &b, counts);
+  fmm_downward(qt, force, KP, &b);
+  for (i = 0; i < 4; i++) counts[i] /= n;
+}
+
 QuadTree QuadTree_new_from_point_list(int dim, int n, int max_level, double *coord){
   /* form a new QuadTree data structure from a list of coordinates of n points
      coord: of length n*dim, point i sits at [i*dim, i*dim+dim - 1]
@@ -500,9 +733,9 @@ static QuadTree QuadTree_add_internal(QuadTree q, double *coord, double weight,
   } else {
     assert(!(q->qts));
     /* level is too high, append data in the linked list */
-    q->n++;
     q->total_weight += weight;
     for (i = 0; i < q->dim; i++) q->average[i] = (q->average[i] * q->n + coord[i]) / (q->n + 1);
+    q->n++;
     nd = node_data_new(q->dim, weight, coord, id);
     assert(q->l);
     nd->next = q->l;
@@ -518,6 +751,98 @@ QuadTree QuadTree_add(QuadTree q, double *coord, double weight, int id){
   
 }
 
+static bool QuadTree_contains(QuadTree q, double *coord) {
+  for (int i = 0; i < q->dim; i++) {
+    if (coord[i] < q->center[i] - q->width || coord[i] > q->center[i] + q->width)
+      return false;
+  }
+  return true;
+}
+
+static void QuadTree_refit_internal(QuadTree q, double *coord, node_data *moved) {
+  /* update node coordinates from "coord", unlink every node that has left its
+     cell onto the "moved" list, drop cells that became empty, and recompute
+     n, total_weight and average bottom up. */
+  int i, k, dim = q->dim;
+
+  q->n = 0;
+  q->total_weight = 0;
+  if (q->average) {
+    for (k = 0; k < dim; k++) q->average[k] = 0;
+  }
+  if (q->data) {/* cell forces are accumulated, so clear them */
+    double *f = q->data;
+    for (k = 0; k < dim; k++) f[k] = 0;
+  }
+
+  node_data *prev = &q->l;
+  while (*prev) {
+    node_data l = *prev;
+    for (k = 0; k < dim; k++) l->coord[k] = coord[l->id * dim + k];
+    l->data = NULL;
+    if (!QuadTree_contains(q, l->coord)) {
+      *prev = l->next;
+      l->next = *moved;
+      *moved = l;
+      continue;
+    }
+    q->n++;
+    q->total_weight += l->node_weight;
+    for (k = 0; k < dim; k++) q->average[k] += l->coord[k];
+    prev = &l->next;
+  }
+
+  if (q->qts) {
+    bool empty = true;
+    for (i = 0; i < 1<<dim; i++) {
+      QuadTree qt = q->qts[i];
+      if (!qt) continue;
+      QuadTree_refit_internal(qt, coord, moved);
+      if (qt->n == 0) {
+        QuadTree_delete(qt);
+        q->qts[i] = NULL;
+        continue;
+      }
+      empty = false;
+      q->n += qt->n;
+      q->total_weight += qt->total_weight;
+      for (k = 0; k < dim; k++) q->average[k] += qt->average[k] * qt->n;
+    }
+    if (empty) {
+      free(q->qts);
+      q->qts = NULL;
+    }
+  }
+
+  if (q->n == 0) {
+    free(q->average);
+    q->average = NULL;
+    return;
+  }
+  for (k = 0; k < dim; k++) q->average[k] /= q->n;
+}
+
+bool QuadTree_refit(QuadTree qt, double *coord) {
+  node_data moved = NULL;
+  bool ok = true;
+
+  if (!qt) return false;
+
+  QuadTree_refit_internal(qt, coord, &moved);
+
+  while (moved) {
+    node_data next = moved->next;
+    if (ok && QuadTree_contains(qt, moved->coord)) {
+      QuadTree_add(qt, moved->coord, moved->node_weight, moved->id);
+    } else {
+      ok = false;
+    }
+    node_data_delete(moved);
+    moved = next;
+  }
+  return ok;
+}
+
 static void draw_polygon(FILE *fp, int dim, double *center, double width){
   // plot the enclosing square
   if (dim < 2 || dim > 3) return;
@@ -10,6 +10,8 @@
 
 #pragma once
 
+#include <math.h>
+#include <stdbool.h>
 #include <stdio.h>
 
 #ifdef __cplusplus
@@ -53,6 +55,13 @@ void QuadTree_delete(QuadTree q);
 
 QuadTree QuadTree_add(QuadTree q, double *coord, double weight, int id);/* coord is copied in */
 
+/* Update a tree built by QuadTree_new_from_point_list in place for new
+   coordinates "coord" (same layout and node ids), instead of rebuilding it.
+   Node positions, averages and weights are refreshed and only nodes that left
+   their cell are reinserted. Returns false if some node has left the root
+   cell, in which case the tree is no longer usable and must be deleted. */
+bool QuadTree_refit(QuadTree qt, double *coord);
+
 void QuadTree_print(FILE *fp, QuadTree q);
 
 QuadTree QuadTree_new_from_point_list(int dim, int n, int max_level, double *coord);
@@ -62,8 +71,25 @@ double point_distance(double *p1, double *p2, int dim);
 void QuadTree_get_supernodes(QuadTree qt, double bh, double *pt, int nodeid, int *nsuper, 
 			     int *nsupermax, double **center, double **supernode_wgts, double **distances, double *counts);
 
+/// KP ÷ dist^(1 - p), the magnitude of the repulsive force per unit of
+/// displacement, avoiding pow for the common p = -1
+static inline double repulsive_scale(double KP, double p, double dist) {
+  if (p == -1) return KP / (dist * dist);
+  return KP / pow(dist, 1. - p);
+}
+
 void QuadTree_get_repulsive_force(QuadTree qt, double *force, double *x, double bh, double p, double KP, double *counts);
 
+/* Same as QuadTree_get_repulsive_force, but well separated cells interact
+   through multipole-to-local translations of truncated multipole expansions
+   instead of as point masses, which makes the cost linear in the number of
+   nodes with an error that decreases geometrically in the expansion order.
+   Expansions exist for the 2D, p = -1 case only; other cases fall back to
+   QuadTree_get_repulsive_force. The expansions are kept in the "data" of each
+   cell and reused by later calls, so a tree given to this function must not
+   also be given to QuadTree_get_repulsive_force. */
+void QuadTree_get_repulsive_force_fmm(QuadTree qt, double *force, double *x, double bh, double p, double KP, double *counts);
+
 /* find the nearest point and put in ymin, index in imin and distance in min */
 void QuadTree_get_nearest(QuadTree qt, double *x, double *ymin, int *imin, double *min);
 
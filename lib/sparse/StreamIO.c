@@ -0,0 +1,496 @@
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * https://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+#include "config.h"
+#include <assert.h>
+#include <cgraph/dotlex.h>
+#include <limits.h>
+#include <sparse/SparseMatrix.h>
+#include <sparse/StreamIO.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <util/agxbuf.h>
+#include <util/alloc.h>
+#include <util/gv_ctype.h>
+#include <util/list.h>
+
+DEFINE_LIST(ints, int)
+DEFINE_LIST(doubles, double)
+DEFINE_LIST(offsets, size_t)
+
+/// interning table from node names to node numbers
+typedef struct {
+  char *buf;         ///< names, each NUL terminated
+  size_t len;        ///< bytes used in `buf`
+  size_t capacity;   ///< bytes allocated for `buf`
+  offsets_t offsets; ///< start of each name in `buf`
+  int *slots;        ///< open addressing hash table of node numbers, -1 if free
+  size_t nslots;     ///< size of `slots`, a power of 2
+} nametable_t;
+
+static uint64_t hash_name(const char *s, size_t len) {
+  // FNV-1a
+  uint64_t h = 14695981039346656037ull;
+  for (size_t i = 0; i < len; ++i) {
+    h ^= (unsigned char)s[i];
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+static void nametable_rehash(nametable_t *t) {
+  const size_t nslots = t->nslots == 0 ? 1024 : t->nslots * 2;
+  int *slots = gv_calloc(nslots, sizeof(int));
+  for (size_t i = 0; i < nslots; ++i) slots[i] = -1;
+  const char *base = t->buf;
+  for (size_t i = 0; i < offsets_size(&t->offsets); ++i) {
+    const char *name = base + offsets_get(&t->offsets, i);
+    size_t s = hash_name(name, strlen(name)) & (nslots - 1);
+    while (slots[s] != -1) s = (s + 1) & (nslots - 1);
+    slots[s] = (int)i;
+  }
+  free(t->slots);
+  t->slots = slots;
+  t->nslots = nslots;
+}
+
+/// look up a name, adding it if it is new
+///
+/// @return The node number of the name, or -1 if there are too many nodes
+static int nametable_intern(nametable_t *t, const char *name, size_t len) {
+  // keep the load factor at most ½
+  if (2 * (offsets_size(&t->offsets) + 1) > t->nslots) nametable_rehash(t);
+
+  const char *base = t->buf;
+  size_t s = hash_name(name, len) & (t->nslots - 1);
+  while (t->slots[s] != -1) {
+    const char *candidate = base + offsets_get(&t->offsets, (size_t)t->slots[s]);
+    if (strncmp(candidate, name, len) == 0 && candidate[len] == '\0')
+      return t->slots[s];
+    s = (s + 1) & (t->nslots - 1);
+  }
+
+  if (offsets_size(&t->offsets) >= INT_MAX) return -1;
+  const int id = (int)offsets_size(&t->offsets);
+  if (t->len + len + 1 > t->capacity) {
+    size_t capacity = t->capacity == 0 ? 4096 : t->capacity * 2;
+    while (t->len + len + 1 > capacity) capacity *= 2;
+    t->buf = gv_recalloc(t->buf, t->capacity, capacity, sizeof(char));
+    t->capacity = capacity;
+  }
+  offsets_append(&t->offsets, t->len);
+  memcpy(t->buf + t->len, name, len);
+  t->buf[t->len + len] = '\0';
+  t->len += len + 1;
+  t->slots[s] = id;
+  return id;
+}
+
+void stream_names_free(stream_names_t *names) {
+  free(names->buf);
+  free(names->offsets);
+  *names = (stream_names_t){0};
+}
+
+enum { WINDOW_SIZE = 1 << 16 }; ///< bytes to read at a time
+
+/// input, read a window at a time and lexed with cgraph's flat DOT lexer
+typedef struct {
+  FILE *f;
+  char *buf;       ///< the window, holding `lex.size` bytes
+  size_t capacity; ///< bytes allocated for `buf`
+  bool eof;        ///< has the rest of `f` been read into the window?
+  size_t line;     ///< line number of the start of the window
+  bool bol;        ///< does the window start a line?
+  dotlex_t lex;    ///< lexer over the window
+  bool newline;    ///< was a line break skipped before the current token?
+} reader_t;
+
+/// drop the window up to `keep` and read more input after what is left
+static void refill(reader_t *r, size_t keep) {
+  if (keep > 0) {
+    for (size_t i = 0; i < keep; ++i) {
+      if (r->buf[i] == '\n') ++r->line;
+    }
+    r->bol = r->buf[keep - 1] == '\n';
+    memmove(r->buf, r->buf + keep, r->lex.size - keep);
+    r->lex.size -= keep;
+  }
+  r->lex.pos = 0;
+
+  // grow the window if one token fills it
+  if (r->lex.size == r->capacity) {
+    const size_t capacity = r->capacity == 0 ? WINDOW_SIZE : r->capacity * 2;
+    r->buf = gv_recalloc(r->buf, r->capacity, capacity, sizeof(char));
+    r->capacity = capacity;
+  }
+
+  const size_t want = r->capacity - r->lex.size;
+  const size_t got = fread(r->buf + r->lex.size, 1, want, r->f);
+  r->lex.size += got;
+  r->lex.data = r->buf;
+  r->eof = got < want;
+}
+
+/// line the current token is on, for error messages
+static size_t line_of(const reader_t *r) {
+  size_t n = r->line;
+  for (size_t i = 0; i < r->lex.start; ++i) {
+    if (r->buf[i] == '\n') ++n;
+  }
+  return n;
+}
+
+/// read the next word of an edge list, lexed like a `dotlex` token
+///
+/// Words are separated by white space, and lines starting with `#` or `%` are
+/// comments.
+static int lex_word(reader_t *r) {
+  dotlex_t *const s = &r->lex;
+  const char *const d = s->data;
+  for (;;) {
+    while (s->pos < s->size && gv_isspace(d[s->pos])) ++s->pos;
+    const bool bol = s->pos == 0 ? r->bol : d[s->pos - 1] == '\n';
+    if (s->pos == s->size || !bol || (d[s->pos] != '#' && d[s->pos] != '%'))
+      break;
+    const char *const nl = memchr(d + s->pos, '\n', s->size - s->pos);
+    s->pos = nl == NULL ? s->size : (size_t)(nl - d);
+  }
+  s->start = s->pos;
+  s->cut = s->pos == s->size;
+  if (s->pos == s->size) return TOK_EOF;
+
+  size_t end = s->pos;
+  while (end < s->size && !gv_isspace(d[end])) ++end;
+  dotlex_store(s, d + s->pos, end - s->pos, false);
+  s->pos = end;
+  return TOK_ID;
+}
+
+static int lex_dot(reader_t *r) { return dotlex(&r->lex); }
+
+/// read the next token, refilling the window as needed
+///
+/// The string of the previous token is discarded.
+static int next(reader_t *r, int (*lex)(reader_t *)) {
+  r->lex.strings.size = 0;
+  for (;;) {
+    const size_t from = r->lex.pos;
+    const int t = lex(r);
+    // a token running into the end of the window may go on past it
+    if (r->eof || (!r->lex.cut && r->lex.pos < r->lex.size)) {
+      r->newline = memchr(r->buf + from, '\n', r->lex.start - from) != NULL;
+      return t;
+    }
+    r->lex.strings.size = 0;
+    refill(r, from);
+  }
+}
+
+/// read the next DOT token, reporting a lexical error
+static int next_token(reader_t *r) {
+  const int t = next(r, lex_dot);
+  if (t == TOK_ERROR) {
+    const dotlex_t *const s = &r->lex;
+    const char *const text = s->data + s->start;
+    size_t len = 0;
+    while (s->start + len < s->size &&
+           dotlex_is_namechar((unsigned char)text[len]))
+      ++len;
+    if (dotlex_keyword(text, len, "subgraph")) {
+      fprintf(stderr, "line %zu: subgraphs are not supported\n", line_of(r));
+    } else {
+      fprintf(stderr, "line %zu: syntax error\n", line_of(r));
+    }
+  }
+  return t;
+}
+
+/// text of the last `TOK_ID` or `TOK_QID`
+static const char *tok_str(const reader_t *r) {
+  return r->lex.strings.data + r->lex.str;
+}
+
+/// length of the last `TOK_ID` or `TOK_QID`, excluding its NUL terminator
+static size_t tok_len(const reader_t *r) {
+  return r->lex.strings.size - r->lex.str - 1;
+}
+
+static bool is_id(int t) { return t == TOK_ID || t == TOK_QID; }
+
+/// graph being built
+typedef struct {
+  nametable_t names;
+  ints_t irn;
+  ints_t jcn;
+  doubles_t val;
+} builder_t;
+
+static int intern(builder_t *b, const reader_t *r, const char *name,
+                  size_t len) {
+  const int id = nametable_intern(&b->names, name, len);
+  if (id < 0) fprintf(stderr, "line %zu: too many nodes\n", line_of(r));
+  return id;
+}
+
+static bool add_edge(builder_t *b, int tail, int head, double weight) {
+  if (ints_size(&b->irn) >= INT_MAX) {
+    fprintf(stderr, "too many edges\n");
+    return false;
+  }
+  ints_append(&b->irn, tail);
+  ints_append(&b->jcn, head);
+  doubles_append(&b->val, weight);
+  return true;
+}
+
+/// parse one or more `[ a = b, … ]` lists, the first `[` already consumed
+///
+/// @param weight [out] If non-NULL, receives the value of any `weight`
+/// @return The token following the lists
+static int attr_lists(reader_t *r, double *weight) {
+  int t;
+  for (;;) {
+    t = next_token(r);
+    if (t == ']') {
+      t = next_token(r);
+      if (t != '[') return t;
+      continue;
+    }
+    if (t == ',' || t == ';') continue;
+    if (!is_id(t)) break;
+
+    const bool is_weight = t == TOK_ID && strcmp(tok_str(r), "weight") == 0;
+    t = next_token(r);
+    if (t != '=') break;
+    t = next_token(r);
+    if (!is_id(t)) break;
+    if (is_weight && weight != NULL) {
+      char *end;
+      const double v = strtod(tok_str(r), &end);
+      if (end != tok_str(r)) *weight = v;
+    }
+  }
+  if (t != TOK_ERROR)
+    fprintf(stderr, "line %zu: syntax error in attribute list\n", line_of(r));
+  return TOK_ERROR;
+}
+
+/// skip a port suffix `: port [: compass]` on a node
+static int skip_port(reader_t *r, int t) {
+  for (int i = 0; i < 2 && t == ':'; ++i) {
+    t = next_token(r);
+    if (!is_id(t)) {
+      if (t != TOK_ERROR)
+        fprintf(stderr, "line %zu: syntax error in port\n", line_of(r));
+      return TOK_ERROR;
+    }
+    t = next_token(r);
+  }
+  return t;
+}
+
+static bool read_dot(reader_t *r, builder_t *b, bool *directed) {
+  int t = next_token(r);
+  if (t == TOK_STRICT) t = next_token(r);
+  if (t != TOK_GRAPH && t != TOK_DIGRAPH) {
+    fprintf(stderr, "line %zu: expected graph or digraph\n", line_of(r));
+    return false;
+  }
+  *directed = r->lex.directed = t == TOK_DIGRAPH;
+
+  t = next_token(r);
+  if (is_id(t)) t = next_token(r);
+  if (t != '{') {
+    if (t != TOK_ERROR) fprintf(stderr, "line %zu: expected {\n", line_of(r));
+    return false;
+  }
+
+  double default_weight = 1;
+  agxbuf name = {0};
+  bool ok = false;
+  t = next_token(r);
+  for (;;) {
+    if (t == TOK_ERROR) break;
+    if (t == TOK_EOF) {
+      fprintf(stderr, "line %zu: unexpected end of input\n", line_of(r));
+      break;
+    }
+    if (t == '}') {
+      ok = true;
+      break;
+    }
+    if (t == ';') {
+      t = next_token(r);
+      continue;
+    }
+    if (t == '{') {
+      fprintf(stderr, "line %zu: subgraphs are not supported\n", line_of(r));
+      break;
+    }
+
+    // attribute statements
+    if (t == TOK_GRAPH || t == TOK_NODE || t == TOK_EDGE) {
+      const bool is_edge = t == TOK_EDGE;
+      t = next_token(r);
+      if (t != '[') {
+        if (t != TOK_ERROR) fprintf(stderr, "line %zu: expected [\n", line_of(r));
+        break;
+      }
+      t = attr_lists(r, is_edge ? &default_weight : NULL);
+      continue;
+    }
+
+    if (!is_id(t)) {
+      fprintf(stderr, "line %zu: syntax error near '%c'\n", line_of(r), t);
+      break;
+    }
+    agxbclear(&name);
+    agxbput_n(&name, tok_str(r), tok_len(r));
+    t = next_token(r);
+
+    // graph attribute `a = b`
+    if (t == '=') {
+      t = next_token(r);
+      if (!is_id(t)) {
+        if (t != TOK_ERROR)
+          fprintf(stderr, "line %zu: syntax error in attribute\n", line_of(r));
+        break;
+      }
+      t = next_token(r);
+      continue;
+    }
+
+    int prev = intern(b, r, agxbstart(&name), agxblen(&name));
+    if (prev < 0) break;
+    t = skip_port(r, t);
+    const size_t first_edge = ints_size(&b->irn);
+    while (t == TOK_EDGEOP) {
+      t = next_token(r);
+      if (t == '{') {
+        fprintf(stderr, "line %zu: subgraphs are not supported\n", line_of(r));
+        t = TOK_ERROR;
+        break;
+      }
+      if (!is_id(t)) {
+        if (t != TOK_ERROR)
+          fprintf(stderr, "line %zu: expected node after edge operator\n",
+                  line_of(r));
+        t = TOK_ERROR;
+        break;
+      }
+      const int head = intern(b, r, tok_str(r), tok_len(r));
+      if (head < 0 || !add_edge(b, prev, head, default_weight)) {
+        t = TOK_ERROR;
+        break;
+      }
+      prev = head;
+      t = skip_port(r, next_token(r));
+    }
+    if (t == '[') {
+      double weight = default_weight;
+      t = attr_lists(r, &weight);
+      for (size_t i = first_edge; i < doubles_size(&b->val); ++i)
+        doubles_set(&b->val, i, weight);
+    }
+  }
+
+  agxbfree(&name);
+  return ok;
+}
+
+static bool read_edge_list(reader_t *r, builder_t *b) {
+  int t = next(r, lex_word);
+  while (t != TOK_EOF) {
+    const int tail = intern(b, r, tok_str(r), tok_len(r));
+    if (tail < 0) return false;
+    t = next(r, lex_word);
+    if (t == TOK_EOF || r->newline) continue;
+    const int head = intern(b, r, tok_str(r), tok_len(r));
+    if (head < 0) return false;
+    double weight = 1;
+    t = next(r, lex_word);
+    if (t != TOK_EOF && !r->newline) {
+      char *end;
+      weight = strtod(tok_str(r), &end);
+      if (end == tok_str(r) || *end != '\0') {
+        fprintf(stderr, "line %zu: invalid edge weight %s\n", line_of(r),
+                tok_str(r));
+        return false;
+      }
+      t = next(r, lex_word);
+      if (t != TOK_EOF && !r->newline) {
+        fprintf(stderr, "line %zu: trailing characters after edge\n",
+                line_of(r));
+        return false;
+      }
+    }
+    if (!add_edge(b, tail, head, weight)) return false;
+  }
+  return true;
+}
+
+/// does the input start with a DOT graph header?
+///
+/// This leaves the input to be read again from its start.
+static bool is_dot(reader_t *r) {
+  const int t = next(r, lex_dot);
+  r->lex.pos = 0;
+  return t == TOK_STRICT || t == TOK_GRAPH || t == TOK_DIGRAPH;
+}
+
+SparseMatrix SparseMatrix_import_stream(FILE *f, stream_names_t *names) {
+  reader_t r = {.f = f, .line = 1, .bol = true};
+  builder_t b = {0};
+  bool directed = false;
+  SparseMatrix A = NULL;
+
+  *names = (stream_names_t){0};
+
+  const bool ok = is_dot(&r) ? read_dot(&r, &b, &directed)
+                             : read_edge_list(&r, &b);
+
+  if (ok) {
+    const int n = (int)offsets_size(&b.names.offsets);
+    const int nz = (int)ints_size(&b.irn);
+    int *irn = ints_detach(&b.irn);
+    int *jcn = ints_detach(&b.jcn);
+    double *val = doubles_detach(&b.val);
+    if (n == 0) {
+      A = SparseMatrix_new(0, 0, 0, MATRIX_TYPE_REAL, FORMAT_CSR);
+    } else {
+      A = SparseMatrix_from_coordinate_arrays(nz, n, n, irn, jcn, val,
+                                              MATRIX_TYPE_REAL, sizeof(double));
+    }
+    free(irn);
+    free(jcn);
+    free(val);
+
+    names->n = n;
+    names->directed = directed;
+    names->offsets = offsets_detach(&b.names.offsets);
+    names->buf = b.names.buf;
+    b.names.buf = NULL;
+  }
+
+  ints_free(&b.irn);
+  ints_free(&b.jcn);
+  doubles_free(&b.val);
+  offsets_free(&b.names.offsets);
+  free(b.names.buf);
+  free(b.names.slots);
+  free(r.lex.strings.data);
+  free(r.buf);
+  return A;
+}
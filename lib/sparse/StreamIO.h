@@ -0,0 +1,69 @@
+/*************************************************************************
+ * Copyright (c) 2011 AT&T Intellectual Property
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * which accompanies this distribution, and is available at
+ * https://www.eclipse.org/legal/epl-v10.html
+ *
+ * Contributors: Details at https://graphviz.org
+ *************************************************************************/
+
+/// @file
+/// @brief read graphs straight into a SparseMatrix, without building a cgraph
+///
+/// This is intended for laying out very large graphs, where the memory used
+/// by a full `Agraph_t` (node, edge and attribute records and their
+/// dictionaries) is several times the size of the adjacency matrix itself.
+
+#pragma once
+
+#include <assert.h>
+#include <sparse/SparseMatrix.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// node names of a graph read by `SparseMatrix_import_stream`
+typedef struct {
+  char *buf;       ///< NUL-terminated node names, back to back
+  size_t *offsets; ///< `offsets[i]` is where the name of node `i` starts in `buf`
+  int n;           ///< number of nodes
+  bool directed;   ///< was the input a digraph?
+} stream_names_t;
+
+/// get the name of node `i`
+static inline const char *stream_names_get(const stream_names_t *names, int i) {
+  assert(i >= 0 && i < names->n);
+  return &names->buf[names->offsets[i]];
+}
+
+/// release the memory used by node names
+void stream_names_free(stream_names_t *names);
+
+/// read a graph into an adjacency matrix
+///
+/// Two input forms are accepted. If the input starts with `graph`, `digraph`
+/// or `strict`, it is read as a “flat” DOT graph: top-level node, edge and
+/// attribute statements, without subgraphs. Only the `weight` attribute of
+/// edges is read; all other attributes are skipped. Otherwise the input is read
+/// as an edge list, one edge per line given as a tail and head name optionally
+/// followed by a weight, with lines of a single name declaring a node. Blank
+/// lines and lines starting with `#` or `%` are ignored.
+///
+/// Nodes are numbered in order of first appearance. Entry `(i, j)` of the
+/// returned matrix is the sum of the weights of edges from `i` to `j`. Note
+/// that `multilevel_spring_electrical_embedding` reduces the matrix to its
+/// pattern, so the weights do not affect an sfdp layout of it.
+///
+/// @param f Input to read
+/// @param names [out] Node names. Release with `stream_names_free`.
+/// @return The adjacency matrix, or `NULL` after printing an error message
+SparseMatrix SparseMatrix_import_stream(FILE *f, stream_names_t *names);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,149 @@
+/// @file
+/// @brief fast fixed-precision formatting of coordinates
+///
+/// Text renderers write coordinates as `printf("%.2f")` or `printf("%.3f")`
+/// with trailing zeros removed. Going through `printf` for each of the
+/// millions of numbers in a large drawing is a noticeable share of rendering
+/// time, so the usual case of a finite number of modest size is converted here
+/// with integer arithmetic instead, giving the same bytes.
+
+#pragma once
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// bytes needed to hold any number formatted by `gv_fmtnum`, including the NUL
+enum { GV_FMTNUM_SIZE = 320 };
+
+/// drop trailing zeros after a decimal point, and the point if nothing is left
+/// after it
+static inline size_t gv_fmtnum_trim_(const char *buf, size_t len) {
+  const char *const dot = memchr(buf, '.', len);
+  if (dot == NULL) {
+    return len;
+  }
+  while (buf[len - 1] == '0') {
+    --len;
+  }
+  if (buf + len - 1 == dot) {
+    --len;
+  }
+  return len;
+}
+
+/// round a number to a multiple of 10^-precision, ties to even, as an integer
+/// count of those multiples in its magnitude
+///
+/// @return False if integer arithmetic cannot do this exactly, including for
+///   infinities and NaNs
+static inline bool gv_fmtnum_scaled_(double v, int precision, uint64_t *n) {
+  static const double scales[] = {1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6};
+  assert(precision >= 0 &&
+         (size_t)precision < sizeof(scales) / sizeof(scales[0]));
+
+  const double scale = scales[precision];
+  const double a = fabs(v);
+  const double t = a * scale;
+  if (!(t < 0x1p52)) {
+    return false;
+  }
+
+  // Round to the nearest multiple of 10^-precision, with ties going to even
+  // like `printf`. The product may itself have been rounded across the
+  // midpoint between two candidates, so within an ulp of it decide on the
+  // exact product instead.
+  const double whole = floor(t);
+  *n = (uint64_t)whole;
+  const double frac = t - whole;
+  if (fabs(frac - 0.5) <= t * DBL_EPSILON) {
+    const double d = fma(a, scale, -(whole + 0.5));
+    if (d > 0 || (d == 0 && *n % 2 != 0)) {
+      ++*n;
+    }
+  } else if (frac > 0.5) {
+    ++*n;
+  }
+  return true;
+}
+
+/// format a number as `printf("%.*f")` does, without trailing zeros
+///
+/// A number whose digits would all be zeros after the decimal point is written
+/// without the point, and a negative number rounding to zero as plain "0", so
+/// for example 2.0 becomes "2" and -0.001 at a precision of 2 becomes "0", as
+/// they would with `printf` and `agxbuf_trim_zeros`.
+///
+/// @param buf [out] Destination of at least `GV_FMTNUM_SIZE` bytes
+/// @param v Number to format
+/// @param precision Number of digits after the decimal point, at most 6
+/// @return Length of the result, which is also NUL-terminated
+static inline size_t gv_fmtnum(char *buf, double v, int precision) {
+  // leave what integer arithmetic cannot represent exactly to `snprintf`
+  uint64_t n;
+  if (!gv_fmtnum_scaled_(v, precision, &n)) {
+    const int len = snprintf(buf, GV_FMTNUM_SIZE, "%.*f", precision, v);
+    assert(len > 0 && len < GV_FMTNUM_SIZE);
+    const size_t trimmed = gv_fmtnum_trim_(buf, (size_t)len);
+    buf[trimmed] = '\0';
+    return trimmed;
+  }
+
+  // write digits from the right
+  const bool negative = signbit(v) && (n != 0 || precision == 0);
+  char digits[32];
+  size_t i = sizeof(digits);
+  int places = precision;
+  while (places > 0 && n % 10 == 0) { // trailing zeros are dropped
+    n /= 10;
+    --places;
+  }
+  for (; places > 0; --places) {
+    digits[--i] = (char)('0' + n % 10);
+    n /= 10;
+  }
+  if (i < sizeof(digits)) {
+    digits[--i] = '.';
+  }
+  do {
+    digits[--i] = (char)('0' + n % 10);
+    n /= 10;
+  } while (n != 0);
+  if (negative) {
+    digits[--i] = '-';
+  }
+
+  const size_t len = sizeof(digits) - i;
+  memcpy(buf, &digits[i], len);
+  buf[len] = '\0';
+  return len;
+}
+
+/// the number `gv_fmtnum` writes, as it would be read back by `strtod`
+///
+/// This lets code producing numbers that would otherwise be written out and
+/// parsed again arrive at the same values directly.
+///
+/// @param v Number to round
+/// @param precision Number of digits after the decimal point, at most 6
+/// @return `v` rounded to `precision` decimal places
+static inline double gv_roundnum(double v, int precision) {
+  static const double scales[] = {1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6};
+  uint64_t n;
+  if (!gv_fmtnum_scaled_(v, precision, &n)) {
+    char buf[GV_FMTNUM_SIZE];
+    (void)gv_fmtnum(buf, v, precision);
+    return strtod(buf, NULL);
+  }
+  // n is exact and the division correctly rounded, so this is the double
+  // nearest the decimal `gv_fmtnum` would write, as `strtod` gives
+  const double r = (double)n / scales[precision];
+  const bool negative = signbit(v) && (n != 0 || precision == 0);
+  return negative ? -r : r;
+}
@@ -0,0 +1,148 @@
+/// @file
+/// @brief basic unit tester for fmtnum.h
+
+#ifdef NDEBUG
+#error this is not intended to be compiled with assertions off
+#endif
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <util/agxbuf.h>
+#include <util/fmtnum.h>
+
+/// what callers used to do: `printf` and then drop trailing zeros
+static const char *reference(agxbuf *xb, double v, int precision) {
+  agxbprint(xb, "%.*f", precision, v);
+  agxbuf_trim_zeros(xb);
+  return agxbuse(xb);
+}
+
+static void check(double v, int precision) {
+  agxbuf xb = {0};
+  char buf[GV_FMTNUM_SIZE];
+  const size_t len = gv_fmtnum(buf, v, precision);
+  const char *const expected = reference(&xb, v, precision);
+  if (strcmp(buf, expected) != 0) {
+    fprintf(stderr, "%.17g at precision %d: got \"%s\", expected \"%s\"\n", v,
+            precision, buf, expected);
+  }
+  assert(strcmp(buf, expected) == 0);
+  assert(len == strlen(buf));
+  agxbfree(&xb);
+}
+
+static void test_simple(void) {
+  const double values[] = {0,     -0.0,  1,      -1,     10,    100,
+                           0.5,   -0.5,  1.5,    2.5,    0.001, -0.001,
+                           0.004, 0.005, 0.006,  -0.005, 10.25, 123.456,
+                           1e14,  -1e14, 999.999, 0.125, 0.375, 1.005};
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+    for (int p = 0; p <= 6; ++p) {
+      check(values[i], p);
+    }
+  }
+}
+
+static void test_large(void) {
+  const double values[] = {1e15,     -1e15,    1e20,     DBL_MAX,
+                           -DBL_MAX, INFINITY, -INFINITY, NAN};
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i) {
+    check(values[i], 2);
+    check(values[i], 3);
+  }
+}
+
+/// values around where formatting switches over to `snprintf`
+static void test_boundary(void) {
+  srand(42);
+  for (int p = 0; p <= 6; ++p) {
+    const double limit = 0x1p52 / pow(10, p);
+    for (int i = 0; i < 10000; ++i) {
+      const double v = limit * (0.75 + 0.5 * rand() / RAND_MAX);
+      check(v, p);
+      check(-v, p);
+    }
+  }
+}
+
+/// values exactly halfway between two outputs, or as close as a double gets
+static void test_ties(void) {
+  for (int i = -100000; i <= 100000; ++i) {
+    const double tie = (i + 0.5) / 100;
+    check(tie, 2);
+    check(nextafter(tie, INFINITY), 2);
+    check(nextafter(tie, -INFINITY), 2);
+    const double tie3 = (i + 0.5) / 1000;
+    check(tie3, 3);
+    check(nextafter(tie3, INFINITY), 3);
+    check(nextafter(tie3, -INFINITY), 3);
+  }
+}
+
+static void test_random(void) {
+  srand(42);
+  for (int i = 0; i < 200000; ++i) {
+    const double magnitude = pow(10, rand() % 16 - 4);
+    const double v = ((double)rand() / RAND_MAX - 0.5) * magnitude;
+    check(v, 2);
+    check(v, 3);
+  }
+}
+
+/// `gv_roundnum` should agree with reading back what `gv_fmtnum` writes
+static void test_roundnum(void) {
+  srand(42);
+  for (int i = 0; i < 200000; ++i) {
+    const double magnitude = pow(10, rand() % 20 - 4);
+    const double v = ((double)rand() / RAND_MAX - 0.5) * magnitude;
+    for (int p = 0; p <= 6; ++p) {
+      char buf[GV_FMTNUM_SIZE];
+      (void)gv_fmtnum(buf, v, p);
+      const double expected = strtod(buf, NULL);
+      const double got = gv_roundnum(v, p);
+      if (memcmp(&got, &expected, sizeof(got)) != 0) {
+        fprintf(stderr, "%.17g at precision %d: got %.17g, expected %.17g\n",
+                v, p, got, expected);
+      }
+      assert(memcmp(&got, &expected, sizeof(got)) == 0);
+    }
+  }
+  const double specials[] = {0, -0.0, -0.001, 1e20, -1e20, INFINITY, -INFINITY};
+  for (size_t i = 0; i < sizeof(specials) / sizeof(specials[0]); ++i) {
+    for (int p = 0; p <= 6; ++p) {
+      char buf[GV_FMTNUM_SIZE];
+      (void)gv_fmtnum(buf, specials[i], p);
+      const double expected = strtod(buf, NULL);
+      const double got = gv_roundnum(specials[i], p);
+      assert(memcmp(&got, &expected, sizeof(got)) == 0);
+    }
+  }
+}
+
+int main(void) {
+
+#define RUN(t)                                                                 \
+  do {                                                                         \
+    printf("running test_%s... ", #t);                                         \
+    fflush(stdout);                                                            \
+    test_##t();                                                                \
+    printf("OK\n");                                                            \
+  } while (0)
+
+  RUN(simple);
+  RUN(large);
+  RUN(boundary);
+  RUN(ties);
+  RUN(random);
+  RUN(roundnum);
+
+#undef RUN
+
+  return EXIT_SUCCESS;
+}
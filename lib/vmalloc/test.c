@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 // include vmalloc and some of its internals directly so we can call them
 #include <vmalloc/vmalloc.h>
@@ -179,6 +180,138 @@ static void test_strdup(void) {
   vmclose(v);
 }
 
+// freed blocks should be reused, and bad frees ignored
+static void test_reuse(void) {
+
+  // create a new vmalloc region
+  Vmalloc_t *v = vmopen();
+  assert(v != NULL);
+
+  // a freed block should satisfy the next request of the same size class
+  char *p = vmalloc(v, 100);
+  assert(p != NULL);
+  vmfree(v, p);
+  assert(v->size == 0);
+  char *q = vmalloc(v, 97);
+  assert(q == p);
+
+  // freeing a block twice should be harmless
+  vmfree(v, q);
+  vmfree(v, q);
+  assert(v->size == 0);
+
+  // as should freeing memory the region did not allocate
+  char local[32];
+  vmfree(v, local);
+  char *heap = malloc(32);
+  assert(heap != NULL);
+  vmfree(v, heap);
+  free(heap);
+
+  // as should freeing the inside of a block, even where its contents look
+  // like the header of a live block
+  char *r = vmalloc(v, 100);
+  assert(r != NULL);
+  header_t fake = {.h = {.class = 1, .tag = TAG_LIVE}};
+  memcpy(r + VM_GRAIN, &fake, sizeof(fake));
+  vmfree(v, r + VM_GRAIN + sizeof(fake));
+  vmfree(v, r + 1);
+  assert(v->size == 1);
+
+  // and freeing the part of a chunk not yet carved into blocks
+  vmfree(v, v->top + sizeof(header_t));
+  assert(v->size == 1);
+  vmfree(v, r);
+  assert(v->size == 0);
+
+  // large blocks should be freed individually
+  char *big = vmalloc(v, 100000);
+  assert(big != NULL);
+  memset(big, 0xff, 100000);
+  assert(v->size == 1);
+  memcpy(big + 4096, &fake, sizeof(fake));
+  vmfree(v, big + 4096 + sizeof(fake));
+  assert(v->size == 1);
+  vmfree(v, big);
+  assert(v->size == 0);
+
+  // clean up
+  vmclose(v);
+}
+
+// many large blocks, freed in an order unrelated to their addresses
+static void test_large(void) {
+
+  enum { COUNT = 5000 };
+
+  // create a new vmalloc region
+  Vmalloc_t *v = vmopen();
+  assert(v != NULL);
+
+  static char *blocks[COUNT];
+  for (size_t i = 0; i < COUNT; ++i) {
+    blocks[i] = vmalloc(v, 2000 + i % 7);
+    assert(blocks[i] != NULL);
+    memset(blocks[i], (int)(i % 256), 2000);
+  }
+  assert(v->size == COUNT);
+
+  // free every third block, twice, and then the rest from the back
+  for (size_t i = 0; i < COUNT; i += 3) {
+    vmfree(v, blocks[i]);
+    vmfree(v, blocks[i]);
+  }
+  assert(v->size == COUNT - (COUNT + 2) / 3);
+  for (size_t i = COUNT; i-- > 0;) {
+    if (i % 3 != 0) {
+      assert(blocks[i][1999] == (char)(i % 256));
+      vmfree(v, blocks[i]);
+    }
+  }
+  assert(v->size == 0);
+  assert(v->n_large == 0);
+
+  // blocks left allocated should be released by closing the region
+  for (size_t i = 0; i < COUNT; ++i) {
+    blocks[i] = vmalloc(v, 5000);
+    assert(blocks[i] != NULL);
+  }
+  vmclose(v);
+}
+
+// microbenchmark of allocation churn, like the expression evaluator’s
+static void test_churn(void) {
+
+  enum { LIVE = 10000, ROUNDS = 100 };
+
+  // create a new vmalloc region
+  Vmalloc_t *v = vmopen();
+  assert(v != NULL);
+
+  static void *live[LIVE];
+  const clock_t start = clock();
+  for (size_t round = 0; round < ROUNDS; ++round) {
+
+    // allocate a working set of mixed sizes
+    for (size_t i = 0; i < LIVE; ++i) {
+      live[i] = vmalloc(v, 8 + (i * 37) % 200);
+      assert(live[i] != NULL);
+    }
+    assert(v->size == LIVE);
+
+    // free them in the order they were allocated
+    for (size_t i = 0; i < LIVE; ++i) {
+      vmfree(v, live[i]);
+    }
+    assert(v->size == 0);
+  }
+  const double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+  printf("%d allocations and frees in %.3fs... ", LIVE * ROUNDS, elapsed);
+
+  // clean up
+  vmclose(v);
+}
+
 int main(void) {
 
 #define RUN(t)                                                                 \
@@ -193,6 +326,9 @@ int main(void) {
   RUN(empty_vmclear);
   RUN(lifecycle);
   RUN(strdup);
+  RUN(reuse);
+  RUN(large);
+  RUN(churn);
 
 #undef RUN
 
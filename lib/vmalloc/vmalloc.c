@@ -9,49 +9,289 @@
  *************************************************************************/
 
 #include <vmalloc/vmalloc.h>
+#include <assert.h>
+#include <limits.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <util/asan.h>
 
-/** make room to store a new pointer we are about to allocate
+/* Blocks of up to `VM_CLASSES * VM_GRAIN` bytes are carved from chunks of
+ * `CHUNK_SIZE` bytes and recycled through a free list per size class. Every
+ * block is preceded by a header recording its size class, and each chunk has a
+ * bit per grain marking where its blocks start. So `vmfree` of a small block is
+ * a constant-time push onto a free list after a binary search finds the chunk
+ * holding the pointer and its bit confirms a block starts there.
+ *
+ * Larger blocks are allocated on their own and kept in an open-addressing hash
+ * set, so allocating or freeing one takes constant expected time however many
+ * there are.
+ */
+
+/// bytes in a chunk that small blocks are carved from
+#define CHUNK_SIZE ((size_t)64 * 1024)
+
+/// bytes in the block start map of a chunk
+#define STARTS_SIZE (CHUNK_SIZE / VM_GRAIN / CHAR_BIT)
+
+/// largest block carved from a shared chunk
+#define SMALL_MAX ((size_t)VM_CLASSES * VM_GRAIN)
+
+/// header tags of blocks in use and free blocks
+enum { TAG_LIVE = 0x766d616c, TAG_FREE = 0x766d6672 };
+
+/// header preceding every block
+typedef union {
+  struct {
+    uint32_t class; ///< size in grains, or 0 for a block allocated on its own
+    uint32_t tag;   ///< `TAG_LIVE` or `TAG_FREE`
+  } h;
+  char pad[VM_GRAIN]; ///< keep blocks aligned
+} header_t;
+
+/** record a newly allocated chunk
  *
  * @param vm Vmalloc to operate on
+ * @param base Start of the chunk
+ * @param size Bytes in the chunk
+ * @param starts Block start map of the chunk
  * @returns true on success
  */
-static bool make_space(Vmalloc_t *vm) {
+static bool add_chunk(Vmalloc_t *vm, char *base, size_t size,
+                      unsigned char *starts) {
 
-  if (vm->size == vm->capacity) {
+  if (vm->n_chunks == vm->chunks_capacity) {
 
-    // expand our allocation storage
-    size_t c = vm->capacity == 0 ? 1 : vm->capacity * 2;
-    void **p = realloc(vm->allocated, sizeof(vm->allocated[0]) * c);
+    // expand our chunk storage
+    size_t c = vm->chunks_capacity == 0 ? 8 : vm->chunks_capacity * 2;
+    Vmchunk_t *p = realloc(vm->chunks, sizeof(vm->chunks[0]) * c);
     if (p == NULL) {
       return false;
     }
 
     // save the new array
-    vm->allocated = p;
-    vm->capacity = c;
+    vm->chunks = p;
+    vm->chunks_capacity = c;
   }
 
+  // keep the chunks sorted by address, so we can look pointers up; chunks
+  // usually come at rising addresses, so this rarely moves any
+  size_t i = vm->n_chunks;
+  while (i > 0 && vm->chunks[i - 1].base > base) {
+    --i;
+  }
+  size_t extent = sizeof(vm->chunks[0]) * (vm->n_chunks - i);
+  memmove(vm->chunks + i + 1, vm->chunks + i, extent);
+  vm->chunks[i] = (Vmchunk_t){.base = base, .size = size, .starts = starts};
+  ++vm->n_chunks;
+
   return true;
 }
 
-void *vmalloc(Vmalloc_t *vm, size_t size) {
+/** find the chunk containing a pointer
+ *
+ * @param vm Vmalloc to operate on
+ * @param p Pointer to look up
+ * @returns Index of the chunk or `vm->n_chunks` if `p` is not in any
+ */
+static size_t find_chunk(const Vmalloc_t *vm, const void *p) {
+  const char *const q = p;
+  size_t lo = 0, hi = vm->n_chunks;
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if (vm->chunks[mid].base + vm->chunks[mid].size <= q) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo < vm->n_chunks && vm->chunks[lo].base <= q) {
+    return lo;
+  }
+  return vm->n_chunks;
+}
+
+/** does a block we gave out start at a pointer?
+ *
+ * @param chunk Chunk containing the pointer
+ * @param p Pointer to check
+ * @returns true if `p` is the start of a block carved from `chunk`
+ */
+static bool is_block_start(const Vmchunk_t *chunk, const void *p) {
+  const size_t offset = (size_t)((const char *)p - chunk->base);
+  if (offset % VM_GRAIN != 0) {
+    return false;
+  }
+  const size_t grain = offset / VM_GRAIN;
+  return (chunk->starts[grain / CHAR_BIT] >> (grain % CHAR_BIT)) & 1;
+}
+
+/** home slot of a large block in the hash set
+ *
+ * @param vm Vmalloc to operate on
+ * @param p Block, as returned by `vmalloc`
+ * @returns Index into `vm->large`
+ */
+static size_t large_home(const Vmalloc_t *vm, const void *p) {
+  // Fibonacci hashing of the address, less its always-zero low bits
+  const uint64_t key = (uint64_t)((uintptr_t)p / VM_GRAIN);
+  return (size_t)((key * UINT64_C(0x9e3779b97f4a7c15)) >> 32) &
+         (vm->large_capacity - 1);
+}
+
+/** find a large block
+ *
+ * @param vm Vmalloc to operate on
+ * @param p Pointer to look up
+ * @returns Index of `p` in `vm->large`, or `vm->large_capacity` if it is not
+ *   one of our large blocks
+ */
+static size_t large_find(const Vmalloc_t *vm, const void *p) {
+  if (vm->n_large == 0) {
+    return vm->large_capacity;
+  }
+  const size_t mask = vm->large_capacity - 1;
+  for (size_t i = large_home(vm, p); vm->large[i] != NULL;
+       i = (i + 1) & mask) {
+    if (vm->large[i] == p) {
+      return i;
+    }
+  }
+  return vm->large_capacity;
+}
+
+/** place a large block known not to be in the hash set
+ *
+ * @param vm Vmalloc to operate on
+ * @param p Block to place
+ */
+static void large_place(Vmalloc_t *vm, void *p) {
+  const size_t mask = vm->large_capacity - 1;
+  size_t i = large_home(vm, p);
+  while (vm->large[i] != NULL) {
+    i = (i + 1) & mask;
+  }
+  vm->large[i] = p;
+}
+
+/** record a newly allocated large block
+ *
+ * @param vm Vmalloc to operate on
+ * @param p Block, as returned by `vmalloc`
+ * @returns true on success
+ */
+static bool large_add(Vmalloc_t *vm, void *p) {
 
-  if (!make_space(vm)) {
-    return NULL;
+  // keep the set at most half full
+  if (2 * (vm->n_large + 1) > vm->large_capacity) {
+    const size_t c = vm->large_capacity == 0 ? 16 : vm->large_capacity * 2;
+    void **const old = vm->large;
+    const size_t old_capacity = vm->large_capacity;
+    vm->large = calloc(c, sizeof(vm->large[0]));
+    if (vm->large == NULL) {
+      vm->large = old;
+      return false;
+    }
+    vm->large_capacity = c;
+    for (size_t i = 0; i < old_capacity; ++i) {
+      if (old[i] != NULL) {
+        large_place(vm, old[i]);
+      }
+    }
+    free(old);
   }
 
-  void *p = malloc(size);
-  if (p == NULL) {
-    return NULL;
+  large_place(vm, p);
+  ++vm->n_large;
+  return true;
+}
+
+/** forget a large block
+ *
+ * @param vm Vmalloc to operate on
+ * @param i Index of the block in `vm->large`
+ */
+static void large_remove(Vmalloc_t *vm, size_t i) {
+  const size_t mask = vm->large_capacity - 1;
+
+  // shift later entries of the same probe run back, so no search stops short
+  for (size_t j = (i + 1) & mask; vm->large[j] != NULL; j = (j + 1) & mask) {
+    const size_t home = large_home(vm, vm->large[j]);
+    // can the entry at `j` move to `i`? only if its home is not in (i, j]
+    if (((j - home) & mask) >= ((j - i) & mask)) {
+      vm->large[i] = vm->large[j];
+      i = j;
+    }
   }
+  vm->large[i] = NULL;
+  --vm->n_large;
+}
+
+void *vmalloc(Vmalloc_t *vm, size_t size) {
+
+  header_t *h;
 
-  vm->allocated[vm->size] = p;
+  if (size > SMALL_MAX) {
+
+    // allocate this block on its own
+    if (size > SIZE_MAX - sizeof(header_t)) {
+      return NULL;
+    }
+    char *base = malloc(sizeof(header_t) + size);
+    if (base == NULL) {
+      return NULL;
+    }
+    h = (header_t *)base;
+    if (!large_add(vm, h + 1)) {
+      free(base);
+      return NULL;
+    }
+    h->h.class = 0;
+
+  } else {
+
+    const size_t class = size == 0 ? 1 : (size + VM_GRAIN - 1) / VM_GRAIN;
+    const size_t bytes = sizeof(header_t) + class * VM_GRAIN;
+
+    if (vm->free[class] != NULL) {
+      // reuse a previously freed block
+      h = vm->free[class];
+      ASAN_UNPOISON(h + 1, bytes - sizeof(header_t));
+      memcpy(&vm->free[class], h + 1, sizeof(vm->free[class]));
+
+    } else {
+      if ((size_t)(vm->end - vm->top) < bytes) {
+        // start a new chunk, abandoning the tail of the current one
+        char *base = malloc(CHUNK_SIZE);
+        unsigned char *starts = calloc(STARTS_SIZE, 1);
+        if (base == NULL || starts == NULL ||
+            !add_chunk(vm, base, CHUNK_SIZE, starts)) {
+          free(starts);
+          free(base);
+          return NULL;
+        }
+        vm->top = base;
+        vm->end = base + CHUNK_SIZE;
+        vm->starts = starts;
+        ASAN_POISON(base, CHUNK_SIZE);
+      }
+      h = (header_t *)vm->top;
+      vm->top += bytes;
+      ASAN_UNPOISON(h, bytes);
+
+      // note where this block starts, for `vmfree` to check
+      const char *base = vm->end - CHUNK_SIZE;
+      const size_t grain = (size_t)((char *)(h + 1) - base) / VM_GRAIN;
+      vm->starts[grain / CHAR_BIT] |= (unsigned char)(1 << (grain % CHAR_BIT));
+    }
+    h->h.class = (uint32_t)class;
+  }
+
+  h->h.tag = TAG_LIVE;
   ++vm->size;
 
-  return p;
+  return h + 1;
 }
 
 void vmfree(Vmalloc_t *vm, void *data) {
@@ -60,21 +300,34 @@ void vmfree(Vmalloc_t *vm, void *data) {
     return;
   }
 
-  // find the pointer we previously allocated
-  for (size_t i = 0; i < vm->size; ++i) {
-    if (vm->allocated[i] == data) {
-
-      // clear this slot
-      size_t extent = sizeof(vm->allocated[0]) * (vm->size - i - 1);
-      memmove(vm->allocated + i, vm->allocated + i + 1, extent);
-      --vm->size;
-
-      // give this back to the underlying allocator
-      free(data);
-
+  // find the chunk holding this pointer
+  const size_t i = find_chunk(vm, data);
+  if (i == vm->n_chunks) {
+    const size_t j = large_find(vm, data);
+    if (j == vm->large_capacity) {
+      // free() of something we did not allocate, or of the inside of a block
       return;
     }
+    // give this block back to the underlying allocator
+    large_remove(vm, j);
+    --vm->size;
+    free((header_t *)data - 1);
+    return;
+  }
+  if (!is_block_start(&vm->chunks[i], data)) {
+    // free() of the inside of a block
+    return;
+  }
+  header_t *h = (header_t *)data - 1;
+  if (h->h.tag != TAG_LIVE) {
+    // already freed
+    return;
   }
+  --vm->size;
 
-  // we did not find this pointer; free() of something we did not allocate
+  // put this block on the free list for its size class
+  h->h.tag = TAG_FREE;
+  memcpy(data, &vm->free[h->h.class], sizeof(vm->free[h->h.class]));
+  vm->free[h->h.class] = h;
+  ASAN_POISON(data, (size_t)h->h.class * VM_GRAIN);
 }
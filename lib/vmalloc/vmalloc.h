@@ -23,10 +23,28 @@ extern "C" {
 
     typedef struct _vmalloc_s Vmalloc_t;
 
+/// number of block size classes, in steps of @ref VM_GRAIN bytes
+enum { VM_GRAIN = 16, VM_CLASSES = 64 };
+
+/// a span of memory the region carves blocks from
+typedef struct {
+  char *base;            ///< start of the chunk
+  size_t size;           ///< bytes in the chunk
+  unsigned char *starts; ///< a bit per grain marking where blocks start
+} Vmchunk_t;
+
     struct _vmalloc_s {
-	void **allocated;	/* pointers we have given out           */
-	size_t size;	/* used entries in `allocated`          */
-	size_t capacity;	/* available entries in `allocated`     */
+	Vmchunk_t *chunks;	/* chunks owned, sorted by address      */
+	size_t n_chunks;	/* used entries in `chunks`             */
+	size_t chunks_capacity;	/* available entries in `chunks`        */
+	char *top;		/* next unused byte of the last chunk   */
+	char *end;		/* end of the chunk being carved        */
+	unsigned char *starts;	/* block starts in the chunk being carved */
+	void *free[VM_CLASSES + 1];	/* freed blocks by size class   */
+	void **large;		/* blocks too big for a chunk, hashed   */
+	size_t n_large;		/* used entries in `large`              */
+	size_t large_capacity;	/* entries in `large`, a power of 2     */
+	size_t size;	/* number of blocks given out           */
     };
 
     extern Vmalloc_t *vmopen(void);
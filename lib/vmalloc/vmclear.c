@@ -10,6 +10,8 @@
 
 #include <vmalloc/vmalloc.h>
 #include <stdlib.h>
+#include <string.h>
+#include <util/asan.h>
 
 /** Clear out all allocated space.
  *
@@ -20,13 +22,22 @@
  */
 void vmclear(Vmalloc_t *vm) {
 
-  // free all allocated pointers
-  for (size_t i = 0; i < vm->size; ++i) {
-    free(vm->allocated[i]);
+  // free all chunks, and with them every block carved from them
+  for (size_t i = 0; i < vm->n_chunks; ++i) {
+    ASAN_UNPOISON(vm->chunks[i].base, vm->chunks[i].size);
+    free(vm->chunks[i].base);
+    free(vm->chunks[i].starts);
+  }
+
+  // free all large blocks, each allocated a grain-sized header before it
+  for (size_t i = 0; i < vm->large_capacity; ++i) {
+    if (vm->large[i] != NULL) {
+      free((char *)vm->large[i] - VM_GRAIN);
+    }
   }
 
   // reset our metadata
-  free(vm->allocated);
-  vm->allocated = NULL;
-  vm->size = vm->capacity = 0;
+  free(vm->chunks);
+  free(vm->large);
+  memset(vm, 0, sizeof(*vm));
 }
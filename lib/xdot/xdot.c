@@ -12,6 +12,7 @@
 #include <string.h>
 #include <util/agxbuf.h>
 #include <util/alloc.h>
+#include <util/fmtnum.h>
 #include <util/gv_ctype.h>
 #include <util/prisize_t.h>
 #include <util/unreachable.h>
@@ -395,37 +396,26 @@ xdot *parseXDot(char *s) { return parseXDotF(s, 0, 0); }
 
 typedef int (*pf)(void *, char *, ...);
 
+/// print a number as `" %.02f"` would, without trailing zeros
+static void printNum(double v, pf print, void *info) {
+  char buf[GV_FMTNUM_SIZE + 1] = " ";
+  gv_fmtnum(&buf[1], v, 2);
+  print(info, "%s", buf);
+}
+
 static void printRect(xdot_rect *r, pf print, void *info) {
-  agxbuf buf = {0};
-
-  agxbprint(&buf, " %.02f", r->x);
-  agxbuf_trim_zeros(&buf);
-  print(info, "%s", agxbuse(&buf));
-  agxbprint(&buf, " %.02f", r->y);
-  agxbuf_trim_zeros(&buf);
-  print(info, "%s", agxbuse(&buf));
-  agxbprint(&buf, " %.02f", r->w);
-  agxbuf_trim_zeros(&buf);
-  print(info, "%s", agxbuse(&buf));
-  agxbprint(&buf, " %.02f", r->h);
-  agxbuf_trim_zeros(&buf);
-  print(info, "%s", agxbuse(&buf));
-  agxbfree(&buf);
+  printNum(r->x, print, info);
+  printNum(r->y, print, info);
+  printNum(r->w, print, info);
+  printNum(r->h, print, info);
 }
 
 static void printPolyline(xdot_polyline *p, pf print, void *info) {
-  agxbuf buf = {0};
-
   print(info, " %" PRISIZE_T, p->cnt);
   for (size_t i = 0; i < p->cnt; i++) {
-    agxbprint(&buf, " %.02f", p->pts[i].x);
-    agxbuf_trim_zeros(&buf);
-    print(info, "%s", agxbuse(&buf));
-    agxbprint(&buf, " %.02f", p->pts[i].y);
-    agxbuf_trim_zeros(&buf);
-    print(info, "%s", agxbuse(&buf));
+    printNum(p->pts[i].x, print, info);
+    printNum(p->pts[i].y, print, info);
   }
-  agxbfree(&buf);
 }
 
 static void printString(char *p, pf print, void *info) {
@@ -433,15 +423,13 @@ static void printString(char *p, pf print, void *info) {
 }
 
 static void printFloat(double f, pf print, void *info, int space) {
-  agxbuf buf = {0};
-
-  if (space)
-    agxbprint(&buf, " %.02f", f);
-  else
-    agxbprint(&buf, "%.02f", f);
-  agxbuf_trim_zeros(&buf);
-  print(info, "%s", agxbuse(&buf));
-  agxbfree(&buf);
+  if (space) {
+    printNum(f, print, info);
+  } else {
+    char buf[GV_FMTNUM_SIZE];
+    gv_fmtnum(buf, f, 2);
+    print(info, "%s", buf);
+  }
 }
 
 static void printAlign(xdot_align a, pf print, void *info) {
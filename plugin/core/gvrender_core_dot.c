@@ -27,11 +27,14 @@
 #include <gvc/gvio.h>
 #include <util/agxbuf.h>
 #include <util/alloc.h>
+#include <util/fmtnum.h>
 #include <util/gv_ctype.h>
 #include <util/prisize_t.h>
 #include <util/streq.h>
 #include <util/unreachable.h>
+#include <xdot/xdot.h>
 #include "core_loadimage_xdot.h"
+#include "xdot_ops.h"
 
 typedef enum {
 	FORMAT_DOT,
@@ -41,6 +44,7 @@ typedef enum {
 	FORMAT_XDOT,
 	FORMAT_XDOT12,
 	FORMAT_XDOT14,
+	FORMAT_GVB,
 } format_type;
 
 #define XDOTVERSION "1.7"
@@ -80,6 +84,160 @@ typedef struct {
 } xdot_state_t;
 static xdot_state_t* xd;
 
+/* When recording for xdot_ops_render, operations go into these lists instead
+ * of xbufs, shared between states the same way, with numbers rounded as
+ * writing and parsing them would.
+ */
+static bool record_ops;
+static xdot xop[NUMXBUFS];
+static xdot* xops[] = {
+    xop+EMIT_GDRAW, xop+EMIT_CDRAW, xop+EMIT_TDRAW, xop+EMIT_HDRAW,
+    xop+EMIT_GLABEL, xop+EMIT_CLABEL, xop+EMIT_TLABEL, xop+EMIT_HLABEL,
+    xop+EMIT_CDRAW, xop+EMIT_CDRAW, xop+EMIT_CLABEL, xop+EMIT_CLABEL,
+};
+
+#define XDOT_OPS_REC "xdot_ops"
+
+/* attributes operations are recorded for, in the order of xdot_ops_t.ops */
+static const char *const xdot_ops_attrs[] = {
+    "_draw_", "_ldraw_", "_hdraw_", "_tdraw_", "_hldraw_", "_tldraw_",
+};
+
+typedef struct {
+    Agrec_t h;
+    xdot *ops[sizeof(xdot_ops_attrs) / sizeof(xdot_ops_attrs[0])];
+} xdot_ops_t;
+
+/* add an operation to the list of the current state */
+static xdot_op *record_op(GVJ_t *job, xdot_kind kind)
+{
+    xdot *x = xops[job->obj->emit_state];
+    /* the list is full whenever its length is 0 or a power of 2 */
+    if ((x->cnt & (x->cnt - 1)) == 0)
+	x->ops = gv_recalloc(x->ops, x->cnt, x->cnt == 0 ? 1 : 2 * x->cnt,
+	                     sizeof(xdot_op));
+    xdot_op *op = &x->ops[x->cnt++];
+    op->kind = kind;
+    return op;
+}
+
+static double record_num(double v)
+{
+    return gv_roundnum(v, 2);
+}
+
+static xdot_point record_point(pointf p)
+{
+    assert(xd != NULL);
+    return (xdot_point){.x = record_num(p.x),
+                        .y = record_num(yDir(p.y, xd->yOff))};
+}
+
+static char *record_color(const unsigned char rgba[4])
+{
+    agxbuf xb = {0};
+    if (rgba[3] == 0xFF)
+	agxbprint(&xb, "#%02x%02x%02x", rgba[0], rgba[1], rgba[2]);
+    else
+	agxbprint(&xb, "#%02x%02x%02x%02x", rgba[0], rgba[1], rgba[2], rgba[3]);
+    return agxbdisown(&xb);
+}
+
+static void record_points(GVJ_t *job, xdot_kind kind, pointf *A, size_t n)
+{
+    xdot_polyline *pl = &record_op(job, kind)->u.polyline;
+    pl->cnt = n;
+    pl->pts = gv_calloc(n, sizeof(xdot_point));
+    for (size_t i = 0; i < n; i++)
+	pl->pts[i] = record_point(A[i]);
+}
+
+/* move the operations of a state into a list of their own */
+static xdot *take_ops(xdot *x)
+{
+    xdot *taken = gv_alloc(sizeof(xdot));
+    *taken = *x;
+    *x = (xdot){.sz = sizeof(xdot_op)};
+    return taken;
+}
+
+/* escape backslashes in a recorded string, as put_escaping_backslashes does */
+static void escape_str(char **s)
+{
+    if (!*s || !strchr(*s, '\\'))
+	return;
+    agxbuf xb = {0};
+    for (const char *p = *s; *p != '\0'; ++p) {
+	if (*p == '\\')
+	    agxbputc(&xb, '\\');
+	agxbputc(&xb, *p);
+    }
+    free(*s);
+    *s = agxbdisown(&xb);
+}
+
+static void escape_stops(xdot_color *clr)
+{
+    if (clr->type == xd_linear)
+	for (int i = 0; i < clr->u.ling.n_stops; i++)
+	    escape_str(&clr->u.ling.stops[i].color);
+    else if (clr->type == xd_radial)
+	for (int i = 0; i < clr->u.ring.n_stops; i++)
+	    escape_str(&clr->u.ring.stops[i].color);
+}
+
+/* escape the strings of a state's operations, to keep what reading them back
+ * from an attribute set by put_escaping_backslashes would give
+ */
+static void escape_ops(xdot *x)
+{
+    for (size_t i = 0; i < x->cnt; i++) {
+	xdot_op *op = &x->ops[i];
+	switch (op->kind) {
+	case xd_text:
+	    escape_str(&op->u.text.text);
+	    break;
+	case xd_fill_color:
+	case xd_pen_color:
+	    escape_str(&op->u.color);
+	    break;
+	case xd_grad_fill_color:
+	case xd_grad_pen_color:
+	    escape_stops(&op->u.grad_color);
+	    break;
+	case xd_font:
+	    escape_str(&op->u.font.name);
+	    break;
+	case xd_style:
+	    escape_str(&op->u.style);
+	    break;
+	case xd_image:
+	    escape_str(&op->u.image.name);
+	    break;
+	default:
+	    break;
+	}
+    }
+}
+
+/* hand the operations of a state over to the object drawn with them, in place
+ * of setting the attribute of the given name
+ */
+static void store_ops(void *obj, const char *name, xdot *x)
+{
+    xdot_ops_t *r = (xdot_ops_t *)agbindrec(obj, XDOT_OPS_REC,
+                                           sizeof(xdot_ops_t), false);
+    for (size_t i = 0; i < sizeof(r->ops) / sizeof(r->ops[0]); i++) {
+	if (streq(name, xdot_ops_attrs[i])) {
+	    if (r->ops[i])
+		freeXDot(r->ops[i]);
+	    r->ops[i] = take_ops(x);
+	    return;
+	}
+    }
+    UNREACHABLE();
+}
+
 static void xdot_str_xbuf (agxbuf* xb, char* pfx, const char* s)
 {
     agxbprint (xb, "%s%" PRISIZE_T " -%s ", pfx, strlen(s), s);
@@ -124,12 +282,13 @@ static void xdot_str_color(GVJ_t *job, const char *prefix,
  * Trailing zeros are removed and decimal point, if possible.
  */
 static void xdot_fmt_num(agxbuf *buf, double v) {
-  agxbprint(buf, "%.02f", v);
-  agxbuf_trim_zeros(buf);
-  agxbputc(buf, ' ');
+  char num[GV_FMTNUM_SIZE + 1];
+  size_t len = gv_fmtnum(num, v, 2);
+  num[len++] = ' ';
+  agxbput_n(buf, num, len);
 }
 
-static void xdot_point(agxbuf *xb, pointf p)
+static void xdot_fmt_point(agxbuf *xb, pointf p)
 {
   xdot_fmt_num(xb, p.x);
   assert(xd != NULL);
@@ -142,22 +301,51 @@ static void xdot_num(agxbuf *xb, double v)
 }
 
 static void xdot_points(GVJ_t *job, char c, pointf *A, size_t n) {
+    if (record_ops) {
+	switch (c) {
+	case 'b': record_points(job, xd_filled_bezier, A, n); break;
+	case 'B': record_points(job, xd_unfilled_bezier, A, n); break;
+	case 'P': record_points(job, xd_filled_polygon, A, n); break;
+	case 'p': record_points(job, xd_unfilled_polygon, A, n); break;
+	case 'L': record_points(job, xd_polyline, A, n); break;
+	default: UNREACHABLE();
+	}
+	return;
+    }
     emit_state_t emit_state = job->obj->emit_state;
     agxbprint(xbufs[emit_state], "%c %" PRISIZE_T " ", c, n);
     for (size_t i = 0; i < n; i++)
-        xdot_point(xbufs[emit_state], A[i]);
+        xdot_fmt_point(xbufs[emit_state], A[i]);
 }
 
 static void xdot_pencolor (GVJ_t *job)
 {
+  if (record_ops) {
+    record_op(job, xd_pen_color)->u.color =
+        record_color(job->obj->pencolor.u.rgba);
+    return;
+  }
   xdot_str_color(job, "c ", job->obj->pencolor.u.rgba);
 }
 
 static void xdot_fillcolor (GVJ_t *job)
 {
+  if (record_ops) {
+    record_op(job, xd_fill_color)->u.color =
+        record_color(job->obj->fillcolor.u.rgba);
+    return;
+  }
   xdot_str_color(job, "C ", job->obj->fillcolor.u.rgba);
 }
 
+static void xdot_style_str(GVJ_t *job, const char *style)
+{
+    if (record_ops)
+	record_op(job, xd_style)->u.style = gv_strdup(style);
+    else
+	xdot_str(job, "S ", style);
+}
+
 static void xdot_style (GVJ_t *job)
 {
     agxbuf xb = {0};
@@ -167,10 +355,10 @@ static void xdot_style (GVJ_t *job)
     if (fabs(job->obj->penwidth - penwidth[job->obj->emit_state]) >= 0.0005) {
 	penwidth[job->obj->emit_state] = job->obj->penwidth;
 	agxbput (&xb, "setlinewidth(");
-	agxbprint(&xb, "%.3f", job->obj->penwidth);
-	agxbuf_trim_zeros(&xb);
+	char num[GV_FMTNUM_SIZE];
+	agxbput_n(&xb, num, gv_fmtnum(num, job->obj->penwidth, 3));
 	agxbputc(&xb, ')');
-        xdot_str (job, "S ", agxbuse(&xb));
+        xdot_style_str(job, agxbuse(&xb));
     }
 
     /* now process raw style, if any */
@@ -195,7 +383,7 @@ static void xdot_style (GVJ_t *job)
             }
             agxbputc(&xb, ')');
         }
-        xdot_str (job, "S ", agxbuse(&xb));
+        xdot_style_str(job, agxbuse(&xb));
     }
 
     agxbfree(&xb);
@@ -234,13 +422,39 @@ static void put_escaping_backslashes(Agobj_t* n, Agsym_t *sym, const char *value
     agxbfree(&buf);
 }
 
+/* set an attribute of an object to what was drawn in a state, if anything,
+ * or when recording, hand the operations over to the object instead
+ */
+static void xdot_put(void *obj, attrsym_t *sym, const char *name,
+                     emit_state_t state)
+{
+    if (record_ops) {
+	if (xops[state]->cnt)
+	    store_ops(obj, name, xops[state]);
+    }
+    else if (agxblen(xbufs[state]))
+	agxset(obj, sym, agxbuse(xbufs[state]));
+}
+
+/* as xdot_put, escaping backslashes */
+static void xdot_put_escaping(void *obj, attrsym_t *sym, const char *name,
+                              emit_state_t state)
+{
+    if (record_ops) {
+	if (xops[state]->cnt) {
+	    escape_ops(xops[state]);
+	    store_ops(obj, name, xops[state]);
+	}
+    }
+    else if (agxblen(xbufs[state]))
+	put_escaping_backslashes(obj, sym, agxbuse(xbufs[state]));
+}
+
 static void xdot_end_node(GVJ_t* job)
 {
     Agnode_t* n = job->obj->u.n; 
-    if (agxblen(xbufs[EMIT_NDRAW]))
-	agxset(n, xd->n_draw, agxbuse(xbufs[EMIT_NDRAW]));
-    if (agxblen(xbufs[EMIT_NLABEL]))
-	put_escaping_backslashes(&n->base, xd->n_l_draw, agxbuse(xbufs[EMIT_NLABEL]));
+    xdot_put(n, xd->n_draw, "_draw_", EMIT_NDRAW);
+    xdot_put_escaping(n, xd->n_l_draw, "_ldraw_", EMIT_NLABEL);
     penwidth[EMIT_NDRAW] = 1;
     penwidth[EMIT_NLABEL] = 1;
     textflags[EMIT_NDRAW] = 0;
@@ -251,18 +465,12 @@ static void xdot_end_edge(GVJ_t* job)
 {
     Agedge_t* e = job->obj->u.e; 
 
-    if (agxblen(xbufs[EMIT_EDRAW]))
-	agxset(e, xd->e_draw, agxbuse(xbufs[EMIT_EDRAW]));
-    if (agxblen(xbufs[EMIT_TDRAW]))
-	agxset(e, xd->t_draw, agxbuse(xbufs[EMIT_TDRAW]));
-    if (agxblen(xbufs[EMIT_HDRAW]))
-	agxset(e, xd->h_draw, agxbuse(xbufs[EMIT_HDRAW]));
-    if (agxblen(xbufs[EMIT_ELABEL]))
-	put_escaping_backslashes(&e->base, xd->e_l_draw, agxbuse(xbufs[EMIT_ELABEL]));
-    if (agxblen(xbufs[EMIT_TLABEL]))
-	agxset(e, xd->tl_draw, agxbuse(xbufs[EMIT_TLABEL]));
-    if (agxblen(xbufs[EMIT_HLABEL]))
-	agxset(e, xd->hl_draw, agxbuse(xbufs[EMIT_HLABEL]));
+    xdot_put(e, xd->e_draw, "_draw_", EMIT_EDRAW);
+    xdot_put(e, xd->t_draw, "_tdraw_", EMIT_TDRAW);
+    xdot_put(e, xd->h_draw, "_hdraw_", EMIT_HDRAW);
+    xdot_put_escaping(e, xd->e_l_draw, "_ldraw_", EMIT_ELABEL);
+    xdot_put(e, xd->tl_draw, "_tldraw_", EMIT_TLABEL);
+    xdot_put(e, xd->hl_draw, "_hldraw_", EMIT_HLABEL);
     penwidth[EMIT_EDRAW] = 1;
     penwidth[EMIT_ELABEL] = 1;
     penwidth[EMIT_TDRAW] = 1;
@@ -281,9 +489,16 @@ static void xdot_end_cluster(GVJ_t * job)
 {
     Agraph_t* cluster_g = job->obj->u.sg;
 
-    agxset(cluster_g, xd->g_draw, agxbuse(xbufs[EMIT_CDRAW]));
-    if (GD_label(cluster_g))
-	agxset(cluster_g, xd->g_l_draw, agxbuse(xbufs[EMIT_CLABEL]));
+    if (record_ops) {
+	store_ops(cluster_g, "_draw_", xops[EMIT_CDRAW]);
+	if (GD_label(cluster_g))
+	    store_ops(cluster_g, "_ldraw_", xops[EMIT_CLABEL]);
+    }
+    else {
+	agxset(cluster_g, xd->g_draw, agxbuse(xbufs[EMIT_CDRAW]));
+	if (GD_label(cluster_g))
+	    agxset(cluster_g, xd->g_l_draw, agxbuse(xbufs[EMIT_CLABEL]));
+    }
     penwidth[EMIT_CDRAW] = 1;
     penwidth[EMIT_CLABEL] = 1;
     textflags[EMIT_CDRAW] = 0;
@@ -389,8 +604,10 @@ static void xdot_begin_graph(graph_t *g, bool s_arrows, bool e_arrows,
     else
 	xd->tl_draw = NULL;
 
-    for (i = 0; i < NUMXBUFS; i++)
+    for (i = 0; i < NUMXBUFS; i++) {
 	xbuf[i] = (agxbuf){0};
+	xop[i] = (xdot){.sz = sizeof(xdot_op)};
+    }
 
     xd->yOff = yOff;
 }
@@ -401,6 +618,7 @@ static void dot_begin_graph(GVJ_t *job)
 
     switch (job->render.id) {
 	case FORMAT_DOT:
+	case FORMAT_GVB:
 	    attach_attrs(g);
 	    break;
 	case FORMAT_CANON:
@@ -428,17 +646,25 @@ static void xdot_end_graph(graph_t* g)
 {
     int i;
 
-    if (agxblen(xbufs[EMIT_GDRAW])) {
+    if (record_ops ? xops[EMIT_GDRAW]->cnt > 0 : agxblen(xbufs[EMIT_GDRAW]) > 0) {
 	if (!xd->g_draw)
 	    xd->g_draw = safe_dcl(g, AGRAPH, "_draw_", "");
-	agxset(g, xd->g_draw, agxbuse(xbufs[EMIT_GDRAW]));
+	xdot_put(g, xd->g_draw, "_draw_", EMIT_GDRAW);
+    }
+    if (GD_label(g)) {
+	if (record_ops) {
+	    escape_ops(xops[EMIT_GLABEL]);
+	    store_ops(g, "_ldraw_", xops[EMIT_GLABEL]);
+	}
+	else
+	    put_escaping_backslashes(&g->base, xd->g_l_draw, agxbuse(xbufs[EMIT_GLABEL]));
     }
-    if (GD_label(g))
-	put_escaping_backslashes(&g->base, xd->g_l_draw, agxbuse(xbufs[EMIT_GLABEL]));
     agsafeset (g, "xdotversion", xd->version_s, "");
 
-    for (i = 0; i < NUMXBUFS; i++)
+    for (i = 0; i < NUMXBUFS; i++) {
 	agxbfree(xbuf+i);
+	freeXDot(take_ops(xop+i));
+    }
     free (xd);
     penwidth[EMIT_GDRAW] = 1;
     penwidth[EMIT_GLABEL] = 1;
@@ -448,6 +674,12 @@ static void xdot_end_graph(graph_t* g)
 
 typedef int (*putstrfn) (void *chan, const char *str);
 typedef int (*flushfn) (void *chan);
+
+/// `agwritebin` output for the job that is its channel
+static size_t gvwrite_bin(void *job, const char *data, size_t size) {
+    return gvwrite(job, data, size);
+}
+
 static void dot_end_graph(GVJ_t *job)
 {
     graph_t *g = job->obj->u.g;
@@ -481,6 +713,10 @@ static void dot_end_graph(GVJ_t *job)
 	    if (!(job->flags & OUTPUT_NOT_REQUIRED))
 		agwrite(g, job);
 	    break;
+	case FORMAT_GVB:
+	    if (!(job->flags & OUTPUT_NOT_REQUIRED))
+		agwritebin(g, job, gvwrite_bin);
+	    break;
 	default:
 	    UNREACHABLE();
     }
@@ -495,9 +731,16 @@ static void xdot_textspan(GVJ_t * job, pointf p, textspan_t * span)
     unsigned flags;
     int j;
     
-    agxbput(xbufs[emit_state], "F ");
-    xdot_fmt_num(xbufs[emit_state], span->font->size);
-    xdot_str (job, "", span->font->name);
+    if (record_ops) {
+	xdot_font *font = &record_op(job, xd_font)->u.font;
+	font->size = record_num(span->font->size);
+	font->name = gv_strdup(span->font->name);
+    }
+    else {
+	agxbput(xbufs[emit_state], "F ");
+	xdot_fmt_num(xbufs[emit_state], span->font->size);
+	xdot_str (job, "", span->font->name);
+    }
     xdot_pencolor(job);
 
     switch (span->just) {
@@ -521,26 +764,71 @@ static void xdot_textspan(GVJ_t * job, pointf p, textspan_t * span)
 	unsigned int mask = flag_masks[xd->version-15];
 	unsigned int bits = flags & mask;
 	if (textflags[emit_state] != bits) {
-	    agxbprint(xbufs[emit_state], "t %u ", bits);
+	    if (record_ops)
+		record_op(job, xd_fontchar)->u.fontchar = bits;
+	    else
+		agxbprint(xbufs[emit_state], "t %u ", bits);
 	    textflags[emit_state] = bits;
 	}
     }
 
     p.y += span->yoffset_centerline;
+    if (record_ops) {
+	xdot_text *text = &record_op(job, xd_text)->u.text;
+	const xdot_point pt = record_point(p);
+	text->x = pt.x;
+	text->y = pt.y;
+	text->align = j < 0 ? xd_left : j > 0 ? xd_right : xd_center;
+	text->width = record_num(span->size.x);
+	text->text = gv_strdup(span->str);
+	return;
+    }
     agxbput(xbufs[emit_state], "T ");
-    xdot_point(xbufs[emit_state], p);
+    xdot_fmt_point(xbufs[emit_state], p);
     agxbprint(xbufs[emit_state], "%d ", j);
     xdot_fmt_num(xbufs[emit_state], span->size.x);
     xdot_str (job, "", span->str);
 }
 
-static void xdot_color_stop(agxbuf *xb, double v, gvcolor_t *clr) {
-  agxbprint(xb, "%.03f", v);
-  agxbuf_trim_zeros(xb);
-  agxbputc(xb, ' ');
+static void xdot_fmt_color_stop(agxbuf *xb, double v, gvcolor_t *clr) {
+  char num[GV_FMTNUM_SIZE + 1];
+  size_t len = gv_fmtnum(num, v, 3);
+  num[len++] = ' ';
+  agxbput_n(xb, num, len);
   xdot_str_color_xbuf(xb, "", clr->u.rgba);
 }
 
+/* record a gradient fill as the parsed form of what xdot_gradient_fillcolor
+ * writes
+ */
+static void record_gradient(GVJ_t *job, int filled, pointf p0, double r0,
+                            pointf p1, double r1)
+{
+    obj_state_t* obj = job->obj;
+    xdot_color *clr = &record_op(job, xd_grad_fill_color)->u.grad_color;
+    const xdot_point q0 = record_point(p0);
+    const xdot_point q1 = record_point(p1);
+    xdot_color_stop *stops = gv_calloc(2, sizeof(xdot_color_stop));
+    stops[0].frac = obj->gradient_frac > 0 ? gv_roundnum(obj->gradient_frac, 3) : 0;
+    stops[0].color = record_color(obj->fillcolor.u.rgba);
+    stops[1].frac = obj->gradient_frac > 0 ? gv_roundnum(obj->gradient_frac, 3) : 1;
+    stops[1].color = record_color(obj->stopcolor.u.rgba);
+    if (filled == GRADIENT) {
+	clr->type = xd_linear;
+	clr->u.ling = (xdot_linear_grad){.x0 = q0.x, .y0 = q0.y,
+	                                 .x1 = q1.x, .y1 = q1.y,
+	                                 .n_stops = 2, .stops = stops};
+    }
+    else {
+	clr->type = xd_radial;
+	clr->u.ring = (xdot_radial_grad){.x0 = q0.x, .y0 = q0.y,
+	                                 .r0 = record_num(r0),
+	                                 .x1 = q1.x, .y1 = q1.y,
+	                                 .r1 = record_num(r1),
+	                                 .n_stops = 2, .stops = stops};
+    }
+}
+
 static void xdot_gradient_fillcolor(GVJ_t *job, int filled, pointf *A, size_t n)
 {
     obj_state_t* obj = job->obj;
@@ -555,9 +843,13 @@ static void xdot_gradient_fillcolor(GVJ_t *job, int filled, pointf *A, size_t n)
     agxbuf xb = {0};
     if (filled == GRADIENT) {
 	get_gradient_points(A, G, n, angle, 2);
+	if (record_ops) {
+	    record_gradient(job, filled, G[0], 0, G[1], 0);
+	    return;
+	}
 	agxbputc (&xb, '[');
-	xdot_point (&xb, G[0]);
-	xdot_point (&xb, G[1]);
+	xdot_fmt_point (&xb, G[0]);
+	xdot_fmt_point (&xb, G[1]);
     }
     else {
 	get_gradient_points(A, G, n, 0, 3);
@@ -574,21 +866,25 @@ static void xdot_gradient_fillcolor(GVJ_t *job, int filled, pointf *A, size_t n)
 	c2.x = G[0].x;
 	c2.y = G[0].y;
 	double r1 = r2 / 4;
+	if (record_ops) {
+	    record_gradient(job, filled, c1, r1, c2, r2);
+	    return;
+	}
 	agxbputc(&xb, '(');
-	xdot_point (&xb, c1);
+	xdot_fmt_point (&xb, c1);
 	xdot_num (&xb, r1);
-	xdot_point (&xb, c2);
+	xdot_fmt_point (&xb, c2);
 	xdot_num (&xb, r2);
     }
     
     agxbput(&xb, "2 ");
     if (obj->gradient_frac > 0) {
-	xdot_color_stop (&xb, obj->gradient_frac, &obj->fillcolor);
-	xdot_color_stop (&xb, obj->gradient_frac, &obj->stopcolor);
+	xdot_fmt_color_stop (&xb, obj->gradient_frac, &obj->fillcolor);
+	xdot_fmt_color_stop (&xb, obj->gradient_frac, &obj->stopcolor);
     }
     else {
-	xdot_color_stop (&xb, 0, &obj->fillcolor);
-	xdot_color_stop (&xb, 1, &obj->stopcolor);
+	xdot_fmt_color_stop (&xb, 0, &obj->fillcolor);
+	xdot_fmt_color_stop (&xb, 1, &obj->stopcolor);
     }
     agxbpop(&xb);
     if (filled == GRADIENT)
@@ -611,11 +907,19 @@ static void xdot_ellipse(GVJ_t * job, pointf * A, int filled)
 	}
         else 
 	    xdot_fillcolor (job);
-        agxbput(xbufs[emit_state], "E ");
     }
-    else
-        agxbput(xbufs[emit_state], "e ");
-    xdot_point(xbufs[emit_state], A[0]);
+    if (record_ops) {
+	xdot_rect *r = &record_op(job, filled ? xd_filled_ellipse
+	                                       : xd_unfilled_ellipse)->u.ellipse;
+	const xdot_point c = record_point(A[0]);
+	r->x = c.x;
+	r->y = c.y;
+	r->w = record_num(A[1].x - A[0].x);
+	r->h = record_num(A[1].y - A[0].y);
+	return;
+    }
+    agxbput(xbufs[emit_state], filled ? "E " : "e ");
+    xdot_fmt_point(xbufs[emit_state], A[0]);
     xdot_fmt_num(xbufs[emit_state], A[1].x - A[0].x);
     xdot_fmt_num(xbufs[emit_state], A[1].y - A[0].y);
 }
@@ -650,7 +954,7 @@ static void xdot_polygon(GVJ_t *job, pointf *A, size_t n, int filled) {
         xdot_points(job, 'p', A, n);
 }
 
-static void xdot_polyline(GVJ_t *job, pointf *A, size_t n) {
+static void xdot_lines(GVJ_t *job, pointf *A, size_t n) {
     xdot_style (job);
     xdot_pencolor (job);
     xdot_points(job, 'L', A, n);
@@ -661,14 +965,70 @@ void core_loadimage_xdot(GVJ_t * job, usershape_t *us, boxf b, bool filled)
     (void)filled;
 
     emit_state_t emit_state = job->obj->emit_state;
-    
+
+    if (record_ops) {
+	xdot_image *image = &record_op(job, xd_image)->u.image;
+	const xdot_point ll = record_point(b.LL);
+	image->pos.x = ll.x;
+	image->pos.y = ll.y;
+	image->pos.w = record_num(b.UR.x - b.LL.x);
+	image->pos.h = record_num(b.UR.y - b.LL.y);
+	image->name = gv_strdup(us->name);
+	return;
+    }
     agxbput(xbufs[emit_state], "I ");
-    xdot_point(xbufs[emit_state], b.LL);
+    xdot_fmt_point(xbufs[emit_state], b.LL);
     xdot_fmt_num(xbufs[emit_state], b.UR.x - b.LL.x);
     xdot_fmt_num(xbufs[emit_state], b.UR.y - b.LL.y);
     xdot_str (job, "", us->name);
 }
 
+void xdot_ops_render(GVC_t *gvc, Agraph_t *g)
+{
+    record_ops = true;
+    gvRender(gvc, g, "xdot", NULL);
+    record_ops = false;
+}
+
+xdot *xdot_ops_get(void *obj, const char *name)
+{
+    xdot_ops_t *r = (xdot_ops_t *)aggetrec(obj, XDOT_OPS_REC, 0);
+    if (!r)
+	return NULL;
+    for (size_t i = 0; i < sizeof(r->ops) / sizeof(r->ops[0]); i++)
+	if (streq(name, xdot_ops_attrs[i]))
+	    return r->ops[i];
+    return NULL;
+}
+
+static void free_ops(void *obj)
+{
+    xdot_ops_t *r = (xdot_ops_t *)aggetrec(obj, XDOT_OPS_REC, 0);
+    if (!r)
+	return;
+    for (size_t i = 0; i < sizeof(r->ops) / sizeof(r->ops[0]); i++)
+	if (r->ops[i])
+	    freeXDot(r->ops[i]);
+    agdelrec(obj, XDOT_OPS_REC);
+}
+
+static void free_subg_ops(Agraph_t *g)
+{
+    free_ops(g);
+    for (Agraph_t *sg = agfstsubg(g); sg; sg = agnxtsubg(sg))
+	free_subg_ops(sg);
+}
+
+void xdot_ops_free(Agraph_t *g)
+{
+    free_subg_ops(g);
+    for (Agnode_t *n = agfstnode(g); n; n = agnxtnode(g, n)) {
+	free_ops(n);
+	for (Agedge_t *e = agfstout(g, n); e; e = agnxtout(g, e))
+	    free_ops(e);
+    }
+}
+
 gvrender_engine_t dot_engine = {
     0,				/* dot_begin_job */
     0,				/* dot_end_job */
@@ -730,7 +1090,7 @@ gvrender_engine_t xdot_engine = {
     xdot_ellipse,
     xdot_polygon,
     xdot_bezier,
-    xdot_polyline,
+    xdot_lines,
     0,				/* xdot_comment */
     0,				/* xdot_library_shape */
 };
@@ -768,6 +1128,13 @@ gvdevice_features_t device_features_dot = {
     {72.,72.},			/* default dpi */
 };
 
+gvdevice_features_t device_features_gvb = {
+    GVDEVICE_BINARY_FORMAT,	/* flags */
+    {0.,0.},			/* default margin - points */
+    {0.,0.},			/* default page width, height - points */
+    {72.,72.},			/* default dpi */
+};
+
 gvplugin_installed_t gvrender_dot_types[] = {
     {FORMAT_DOT, "dot", 1, &dot_engine, &render_features_dot},
     {FORMAT_XDOT, "xdot", 1, &xdot_engine, &render_features_xdot},
@@ -783,5 +1150,6 @@ gvplugin_installed_t gvdevice_dot_types[] = {
     {FORMAT_XDOT, "xdot:xdot", 1, NULL, &device_features_dot},
     {FORMAT_XDOT12, "xdot1.2:xdot", 1, NULL, &device_features_dot},
     {FORMAT_XDOT14, "xdot1.4:xdot", 1, NULL, &device_features_dot},
+    {FORMAT_GVB, "gvb:dot", 1, NULL, &device_features_gvb},
     {0, NULL, 0, NULL, NULL}
 };
@@ -30,6 +30,7 @@
 #include <util/startswith.h>
 #include <util/streq.h>
 #include <util/unreachable.h>
+#include "xdot_ops.h"
 
 enum {
 	FORMAT_JSON,
@@ -63,7 +64,7 @@ static void json_begin_graph(GVJ_t *job)
     if (job->render.id == FORMAT_JSON) {
 	GVC_t* gvc = gvCloneGVC (job->gvc); 
 	graph_t *g = job->obj->u.g;
-	gvRender (gvc, g, "xdot", NULL); 
+	xdot_ops_render (gvc, g); 
 	gvFreeCloneGVC (gvc);
     }
     else if (job->render.id == FORMAT_JSON0) {
@@ -310,18 +311,8 @@ static void write_xdot (xdot_op * op, GVJ_t * job, state_t* sp)
     gvputs(job, "}");
 }
 
-static void write_xdots (char * val, GVJ_t * job, state_t* sp)
+static void write_xdot_ops (xdot * cmds, GVJ_t * job, state_t* sp)
 {
-    xdot* cmds;
-
-    if (!val || *val == '\0') return;
-
-    cmds = parseXDot(val);
-    if (!cmds) {
-	agwarningf("Could not parse xdot \"%s\"\n", val);
-	return;
-    }
-
     gvputs(job, "\n");
     indent(job, sp->Level++);
     gvputs(job, "[\n");
@@ -334,6 +325,21 @@ static void write_xdots (char * val, GVJ_t * job, state_t* sp)
     gvputs(job, "\n");
     indent(job, sp->Level);
     gvputs(job, "]");
+}
+
+static void write_xdots (char * val, GVJ_t * job, state_t* sp)
+{
+    xdot* cmds;
+
+    if (!val || *val == '\0') return;
+
+    cmds = parseXDot(val);
+    if (!cmds) {
+	agwarningf("Could not parse xdot \"%s\"\n", val);
+	return;
+    }
+
+    write_xdot_ops(cmds, job, sp);
     freeXDot(cmds);
 }
 
@@ -352,13 +358,25 @@ static void write_attrs(Agobj_t * obj, GVJ_t * job, state_t* sp)
     if (!sym) return;
 
     for (; sym; sym = agnxtattr(g, type, sym)) {
-	if (!(attrval = agxget(obj, sym))) continue;
-	if (*attrval == '\0' && !streq(sym->name, "label")) continue;
+	/* operations recorded by xdot_ops_render take the place of the
+	 * attribute, even if it has some other value
+	 */
+	xdot *ops = sp->doXDot && isXDot(sym->name) ? xdot_ops_get(obj, sym->name)
+	                                            : NULL;
+	if (ops) {
+	    if (ops->cnt == 0) continue;
+	}
+	else {
+	    if (!(attrval = agxget(obj, sym))) continue;
+	    if (*attrval == '\0' && !streq(sym->name, "label")) continue;
+	}
 	gvputs(job, ",\n");
 	indent(job, sp->Level);
 	stoj(sym->name, sp, job);
 	gvputs(job, ": ");
-	if (sp->doXDot && isXDot(sym->name))
+	if (ops)
+	    write_xdot_ops(ops, job, sp);
+	else if (sp->doXDot && isXDot(sym->name))
 	    write_xdots(agxget(obj, sym), job, sp);
 	else
 	    stoj(agxget(obj, sym), sp, job);
@@ -728,6 +746,8 @@ static void json_end_graph(GVJ_t *job)
     sp.isLatin = GD_charset(g) == CHAR_LATIN1;
     sp.doXDot = job->render.id == FORMAT_JSON || job->render.id == FORMAT_XDOT_JSON;
     write_graph(g, job, true, &sp);
+    if (job->render.id == FORMAT_JSON)
+	xdot_ops_free(g);
 }
 
 gvrender_engine_t json_engine = {
@@ -0,0 +1,33 @@
+/// @file
+/// @brief xdot drawing operations recorded as data rather than attributes
+///
+/// The xdot renderer normally writes each object's drawing operations into
+/// `_draw_` and similar attributes as text. Output that wants them as data
+/// can instead have them recorded on the objects, with the same values that
+/// parsing the attributes back would give, and skip the round trip.
+
+#pragma once
+
+#include <cgraph/cgraph.h>
+#include <gvc/gvcext.h>
+#include <xdot/xdot.h>
+
+/// draw a laid out graph with the xdot renderer, recording its operations
+///
+/// Attributes are declared and set as for `-Txdot`, except for those holding
+/// drawing operations, whose values are left alone.
+///
+/// @param gvc Context to render with
+/// @param g Graph to draw
+void xdot_ops_render(GVC_t *gvc, Agraph_t *g);
+
+/// operations recorded for an object
+///
+/// @param obj Graph, subgraph, node or edge
+/// @param name Attribute the operations would have been written to, e.g.
+///   "_draw_"
+/// @return The operations, possibly none, or `NULL` if none were recorded
+xdot *xdot_ops_get(void *obj, const char *name);
+
+/// discard operations recorded by @ref xdot_ops_render
+void xdot_ops_free(Agraph_t *g);
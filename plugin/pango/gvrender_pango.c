@@ -59,6 +59,25 @@ static int dotted_len = ARRAY_SIZE(dotted);
 #include <cairo-svg.h>
 #endif
 
+/* Large PNG output is drawn a tile at a time, each tile into a recording
+ * surface that is rasterized on a worker thread while the next is drawn.
+ * Whole bands of tiles are then written out a row at a time by gvpng.
+ */
+#if defined(CAIRO_HAS_PNG_FUNCTIONS) && defined(CAIRO_HAS_RECORDING_SURFACE) \
+    && defined(HAVE_LIBZ)
+#define CAIRO_DOES_TILES GVDEVICE_DOES_TILES
+#include <gvc/gvpng.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <util/alloc.h>
+#ifdef HAVE_PTHREAD
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#else
+#define CAIRO_DOES_TILES 0
+#endif
+
 static void cairogen_polyline(GVJ_t *job, pointf *A, size_t n);
 
 static void cairogen_set_color(cairo_t * cr, gvcolor_t * color)
@@ -82,6 +101,263 @@ writer (void *closure, const unsigned char *data, unsigned int length)
     return CAIRO_STATUS_WRITE_ERROR;
 }
 
+#if CAIRO_DOES_TILES
+enum { TILE_THREADS_MAX = 16 };
+
+typedef struct {
+    cairo_surface_t *surface;	/* recording of the tile, then its image */
+    box area;			/* device units */
+    bool done;			/* has the recording been rasterized? */
+} tile_t;
+
+/* Tiles are numbered in the order they were drawn, and tile i lives in
+ * ring[i % size]. Those from written up to submitted are being rasterized or
+ * waiting for the rest of their band, and are written out a band at a time.
+ */
+typedef struct {
+    gvpng_t *png;
+    uint32_t *row;		/* a row of the whole image */
+    size_t band_tiles;		/* tiles across the image */
+    tile_t *ring;
+    size_t size;
+    size_t written;
+    size_t submitted;
+    bool failed;
+#ifdef HAVE_PTHREAD
+    size_t nthreads;
+    pthread_t threads[TILE_THREADS_MAX];
+    pthread_mutex_t lock;
+    pthread_cond_t work;	/* signaled when a tile is submitted */
+    pthread_cond_t done;	/* signaled when a tile is rasterized */
+    size_t taken;		/* next tile for a worker to rasterize */
+    bool stopping;
+#endif
+} tiles_t;
+
+/* replace the recording of a tile with its image */
+static void tile_rasterize(tile_t *tile)
+{
+    cairo_surface_t *image = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+	tile->area.UR.x - tile->area.LL.x, tile->area.UR.y - tile->area.LL.y);
+    cairo_t *cr = cairo_create(image);
+    cairo_set_source_surface(cr, tile->surface, 0, 0);
+    cairo_paint(cr);
+    cairo_destroy(cr);
+    cairo_surface_flush(image);
+    cairo_surface_destroy(tile->surface);
+    tile->surface = image;
+}
+
+#ifdef HAVE_PTHREAD
+static void *tiles_worker(void *arg)
+{
+    tiles_t *t = arg;
+
+    pthread_mutex_lock(&t->lock);
+    for (;;) {
+	while (!t->stopping && t->taken == t->submitted)
+	    pthread_cond_wait(&t->work, &t->lock);
+	if (t->taken == t->submitted)
+	    break;
+	tile_t *tile = &t->ring[t->taken++ % t->size];
+	pthread_mutex_unlock(&t->lock);
+
+	tile_rasterize(tile);
+
+	pthread_mutex_lock(&t->lock);
+	tile->done = true;
+	pthread_cond_broadcast(&t->done);
+    }
+    pthread_mutex_unlock(&t->lock);
+    return NULL;
+}
+
+static void tiles_start_threads(tiles_t *t)
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    const long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n <= 1)
+	return;
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_cond_init(&t->work, NULL);
+    pthread_cond_init(&t->done, NULL);
+    for (long i = 0; i < n && i < TILE_THREADS_MAX; ++i) {
+	if (pthread_create(&t->threads[t->nthreads], NULL, tiles_worker, t) == 0)
+	    ++t->nthreads;
+    }
+    if (t->nthreads == 0) {
+	pthread_cond_destroy(&t->done);
+	pthread_cond_destroy(&t->work);
+	pthread_mutex_destroy(&t->lock);
+    }
+#else
+    (void)t;
+#endif
+}
+
+static void tiles_stop_threads(tiles_t *t)
+{
+    if (t->nthreads == 0)
+	return;
+    pthread_mutex_lock(&t->lock);
+    t->stopping = true;
+    pthread_cond_broadcast(&t->work);
+    pthread_mutex_unlock(&t->lock);
+    for (size_t i = 0; i < t->nthreads; ++i)
+	pthread_join(t->threads[i], NULL);
+    pthread_cond_destroy(&t->done);
+    pthread_cond_destroy(&t->work);
+    pthread_mutex_destroy(&t->lock);
+    t->nthreads = 0;
+}
+#endif
+
+static tiles_t *tiles_new(GVJ_t *job)
+{
+    tiles_t *t = gv_alloc(sizeof(tiles_t));
+    const unsigned tile_width = (unsigned)(job->tile.UR.x - job->tile.LL.x);
+
+    t->png = gvpng_begin(job, job->width, job->height);
+    if (t->png == NULL) {
+	fprintf(stderr, "%s: failure to start PNG output\n",
+		job->common->cmdname);
+	t->failed = true;
+    }
+    t->row = gv_calloc(job->width, sizeof(uint32_t));
+    t->band_tiles = (job->width + tile_width - 1) / tile_width;
+#ifdef HAVE_PTHREAD
+    tiles_start_threads(t);
+    t->size = t->band_tiles + (t->nthreads > 0 ? t->nthreads : 1);
+#else
+    t->size = t->band_tiles + 1;
+#endif
+    t->ring = gv_calloc(t->size, sizeof(tile_t));
+    if (job->common->verbose)
+	fprintf(stderr,
+		"%s: drawing a %u x %u pixel image in bands of %d x %d pixel tiles\n",
+		job->common->cmdname, job->width, job->height,
+		job->tile.UR.x - job->tile.LL.x, job->tile.UR.y - job->tile.LL.y);
+    return t;
+}
+
+/* write out the oldest band of tiles, once they have all been rasterized */
+static void tiles_write_band(tiles_t *t)
+{
+    const size_t first = t->written;
+
+#ifdef HAVE_PTHREAD
+    if (t->nthreads > 0) {
+	pthread_mutex_lock(&t->lock);
+	for (size_t i = first; i < first + t->band_tiles; ++i) {
+	    while (!t->ring[i % t->size].done)
+		pthread_cond_wait(&t->done, &t->lock);
+	}
+	pthread_mutex_unlock(&t->lock);
+    }
+#endif
+
+    const tile_t *lead = &t->ring[first % t->size];
+    const int rows = lead->area.UR.y - lead->area.LL.y;
+    for (int y = 0; y < rows && !t->failed; ++y) {
+	for (size_t i = first; i < first + t->band_tiles; ++i) {
+	    tile_t *tile = &t->ring[i % t->size];
+	    const int w = tile->area.UR.x - tile->area.LL.x;
+	    uint32_t *dst = t->row + tile->area.LL.x;
+	    const unsigned char *data = cairo_image_surface_get_data(tile->surface);
+	    if (data == NULL) {		/* the tile could not be rasterized */
+		memset(dst, 0, (size_t)w * sizeof(uint32_t));
+		continue;
+	    }
+	    const int stride = cairo_image_surface_get_stride(tile->surface);
+	    memcpy(dst, data + (size_t)y * (size_t)stride,
+		   (size_t)w * sizeof(uint32_t));
+	}
+	if (gvpng_write_row(t->png, t->row) != 0) {
+	    fprintf(stderr, "cairo: failure to write PNG output\n");
+	    t->failed = true;
+	}
+    }
+
+    for (size_t i = first; i < first + t->band_tiles; ++i) {
+	tile_t *tile = &t->ring[i % t->size];
+	cairo_surface_destroy(tile->surface);
+	*tile = (tile_t){0};
+    }
+    t->written += t->band_tiles;
+}
+
+/* hand over a drawn tile, to be rasterized and written out in its turn */
+static void tiles_submit(tiles_t *t, cairo_surface_t *recording, box area)
+{
+    if (t->failed) {
+	cairo_surface_destroy(recording);
+	return;
+    }
+    while (t->submitted - t->written == t->size)
+	tiles_write_band(t);
+
+    tile_t *tile = &t->ring[t->submitted % t->size];
+    tile->surface = recording;
+    tile->area = area;
+#ifdef HAVE_PTHREAD
+    if (t->nthreads > 0) {
+	pthread_mutex_lock(&t->lock);
+	++t->submitted;
+	pthread_cond_signal(&t->work);
+	pthread_mutex_unlock(&t->lock);
+	return;
+    }
+#endif
+    tile_rasterize(tile);
+    tile->done = true;
+    ++t->submitted;
+}
+
+/* write out what remains of the image and free it */
+static void tiles_finish(GVJ_t *job)
+{
+    tiles_t *t = job->tiles;
+
+    while (!t->failed && t->written + t->band_tiles <= t->submitted)
+	tiles_write_band(t);
+#ifdef HAVE_PTHREAD
+    tiles_stop_threads(t);
+#endif
+    for (size_t i = t->written; i < t->submitted; ++i)
+	cairo_surface_destroy(t->ring[i % t->size].surface);
+    if (t->png && gvpng_end(t->png) != 0 && !t->failed)
+	fprintf(stderr, "cairo: failure to write PNG output\n");
+    free(t->ring);
+    free(t->row);
+    free(t);
+    job->tiles = NULL;
+}
+
+/* a recording surface for the current tile */
+static cairo_surface_t *tiles_surface(GVJ_t *job)
+{
+    if (job->tiles == NULL)
+	job->tiles = tiles_new(job);
+    const cairo_rectangle_t extents = {0, 0, job->tile.UR.x - job->tile.LL.x,
+				       job->tile.UR.y - job->tile.LL.y};
+    return cairo_recording_surface_create(CAIRO_CONTENT_COLOR_ALPHA, &extents);
+}
+
+/* finish drawing the current tile */
+static void tiles_end_page(GVJ_t *job)
+{
+    cairo_t *cr = job->context;
+    cairo_surface_t *surface = cairo_surface_reference(cairo_get_target(cr));
+
+    cairo_destroy(cr);
+    job->context = NULL;
+    tiles_submit(job->tiles, surface, job->tile);
+    if ((unsigned)job->tile.UR.x == job->width
+	&& (unsigned)job->tile.UR.y == job->height)
+	tiles_finish(job);
+}
+#endif
+
 static void cairogen_begin_job(GVJ_t * job)
 {
     if (job->external_context && job->context)
@@ -92,6 +368,10 @@ static void cairogen_end_job(GVJ_t * job)
 {
     cairo_t *cr = job->context;
 
+#if CAIRO_DOES_TILES
+    if (job->tiles)
+	tiles_finish(job);
+#endif
     if (job->external_context)
         cairo_restore(cr);
     else {
@@ -173,6 +453,12 @@ static void cairogen_begin_page(GVJ_t * job)
         case FORMAT_CAIRO:
         case FORMAT_PNG:
         default:
+#if CAIRO_DOES_TILES
+	    if (job->tile.UR.x > job->tile.LL.x) {
+		surface = tiles_surface(job);
+		break;
+	    }
+#endif
 	    if (job->width >= CAIRO_XMAX || job->height >= CAIRO_YMAX) {
 		double scale = fmin(CAIRO_XMAX / job->width, CAIRO_YMAX / job->height);
 		assert(job->width * scale <= UINT_MAX);
@@ -208,6 +494,10 @@ static void cairogen_begin_page(GVJ_t * job)
         cr = cairo_create(surface);
         cairo_surface_destroy (surface);
         job->context = cr;
+#if CAIRO_DOES_TILES
+	if (job->tiles)
+	    cairo_translate(cr, -job->tile.LL.x, -job->tile.LL.y);
+#endif
     }
 
     cairo_scale(cr, job->scale.x, job->scale.y);
@@ -229,6 +519,12 @@ static void cairogen_end_page(GVJ_t * job)
 
 #ifdef CAIRO_HAS_PNG_FUNCTIONS
     case FORMAT_PNG:
+#if CAIRO_DOES_TILES
+	if (job->tiles) {
+	    tiles_end_page(job);
+	    break;
+	}
+#endif
         surface = cairo_get_target(cr);
 	cairo_surface_write_to_png_stream(surface, writer, job);
 	break;
@@ -514,6 +810,7 @@ static gvrender_features_t render_features_cairo = {
 
 static gvdevice_features_t device_features_png = {
     GVDEVICE_BINARY_FORMAT
+      | CAIRO_DOES_TILES
       | GVDEVICE_DOES_TRUECOLOR,/* flags */
     {0.,0.},			/* default margin - points */
     {0.,0.},                    /* default page width, height - points */
@@ -0,0 +1,164 @@
+/// @file
+/// @brief Accompanying test code for test_agbulk
+
+#include <assert.h>
+#include <graphviz/cgraph.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum { NODES = 200, EDGES = 5000 };
+
+/// build a pseudo-random multigraph, optionally under a bulk load
+static Agraph_t *build(Agdesc_t desc, int bulk) {
+  Agraph_t *g = agopen("g", desc, NULL);
+  assert(g != NULL);
+  Agnode_t *nodes[NODES];
+  for (int i = 0; i < NODES; ++i) {
+    char name[16];
+    snprintf(name, sizeof(name), "n%d", i);
+    nodes[i] = agnode(g, name, 1);
+  }
+  Agraph_t *sg = agsubg(g, "s", 1);
+
+  srand(1);
+  // some edges exist before the load starts
+  for (int i = 0; i < EDGES / 10; ++i)
+    (void)agedge(g, nodes[rand() % NODES], nodes[rand() % NODES], NULL, 1);
+
+  if (bulk)
+    agbulkbegin(g);
+  for (int i = 0; i < EDGES; ++i) {
+    Agnode_t *t = nodes[rand() % NODES];
+    Agnode_t *h = nodes[rand() % NODES];
+    if (i % 500 == 7) {
+      // subgraph edges and keyed edges look up pending edges mid-load
+      (void)agedge(sg, t, h, NULL, 1);
+    } else if (i % 500 == 9) {
+      char key[16];
+      snprintf(key, sizeof(key), "k%d", i);
+      (void)agedge(g, t, h, key, 1);
+    } else {
+      (void)agedge(g, t, h, NULL, 1);
+    }
+  }
+  if (bulk)
+    agbulkcommit(g);
+  return g;
+}
+
+static void check(Agdesc_t desc) {
+  Agraph_t *a = build(desc, 0);
+  Agraph_t *b = build(desc, 1);
+
+  assert(agnedges(a) == agnedges(b));
+  assert(agnedges(agsubg(a, "s", 0)) == agnedges(agsubg(b, "s", 0)));
+
+  // edges should be visited in the same order, and be found by lookup
+  for (Agnode_t *u = agfstnode(a), *v = agfstnode(b); u != NULL;
+       u = agnxtnode(a, u), v = agnxtnode(b, v)) {
+    assert(v != NULL);
+    assert(agdegree(a, u, 1, 1) == agdegree(b, v, 1, 1));
+
+    Agedge_t *f = agfstout(b, v);
+    for (Agedge_t *e = agfstout(a, u); e != NULL; e = agnxtout(a, e)) {
+      assert(f != NULL && AGSEQ(e) == AGSEQ(f));
+      assert(ageqedge(agidedge(b, agtail(f), aghead(f), AGID(f), 0), f));
+      f = agnxtout(b, f);
+    }
+    assert(f == NULL);
+
+    f = agfstin(b, v);
+    for (Agedge_t *e = agfstin(a, u); e != NULL; e = agnxtin(a, e)) {
+      assert(f != NULL && AGSEQ(e) == AGSEQ(f));
+      f = agnxtin(b, f);
+    }
+    assert(f == NULL);
+  }
+
+  agclose(a);
+  agclose(b);
+}
+
+/// build a graph whose nodes are reordered and renamed during a bulk load
+static Agraph_t *build_reordered(int bulk) {
+  Agraph_t *g = agopen("g", Agdirected, NULL);
+  assert(g != NULL);
+  Agnode_t *nodes[NODES];
+  for (int i = 0; i < NODES; ++i) {
+    char name[16];
+    snprintf(name, sizeof(name), "n%d", i);
+    nodes[i] = agnode(g, name, 1);
+  }
+
+  srand(2);
+  if (bulk)
+    agbulkbegin(g);
+  for (int i = 0; i < EDGES; ++i) {
+    if (i == EDGES / 2) {
+      // renumbering and renaming nodes changes the keys of pending edges
+      assert(agnodebefore(nodes[0], nodes[NODES / 2]) == 0);
+      assert(agrelabel_node(nodes[NODES / 3], "renamed") == 0);
+    }
+    (void)agedge(g, nodes[rand() % NODES], nodes[rand() % NODES], NULL, 1);
+  }
+  if (bulk)
+    agbulkcommit(g);
+  return g;
+}
+
+static void check_reordered(void) {
+  Agraph_t *a = build_reordered(0);
+  Agraph_t *b = build_reordered(1);
+
+  // every edge should be kept by its own endpoints
+  for (Agnode_t *u = agfstnode(a), *v = agfstnode(b); u != NULL;
+       u = agnxtnode(a, u), v = agnxtnode(b, v)) {
+    assert(v != NULL);
+    assert(agdegree(a, u, 0, 1) == agdegree(b, v, 0, 1));
+    assert(agdegree(a, u, 1, 0) == agdegree(b, v, 1, 0));
+    for (Agedge_t *e = agfstout(b, v); e != NULL; e = agnxtout(b, e))
+      assert(agtail(e) == v);
+    for (Agedge_t *e = agfstin(b, v); e != NULL; e = agnxtin(b, e))
+      assert(aghead(e) == v);
+  }
+
+  agclose(a);
+  agclose(b);
+}
+
+/// count deleted edges
+static void count_deletion(Agraph_t *g, Agobj_t *obj, void *arg) {
+  (void)g;
+  (void)obj;
+  ++*(int *)arg;
+}
+
+int main(void) {
+  check(Agdirected);
+  check(Agundirected);
+  check_reordered();
+
+  // a graph closed with a bulk load still open should release it
+  Agraph_t *g = agopen("g", Agdirected, NULL);
+  agbulkbegin(g);
+  (void)agedge(g, agnode(g, "a", 1), agnode(g, "b", 1), NULL, 1);
+  agclose(g);
+
+  // and one whose objects are deleted one by one should see every pending
+  // edge go
+  int deleted = 0;
+  Agcbdisc_t callbacks = {.edge = {.del = count_deletion}};
+  g = agopen("g", Agdirected, NULL);
+  agpushdisc(g, &callbacks, &deleted);
+  agbulkbegin(g);
+  for (int i = 0; i < 3; ++i)
+    (void)agedge(g, agnode(g, "a", 1), agnode(g, "b", 1), NULL, 1);
+  agclose(g);
+  assert(deleted == 3);
+
+  // a parse error should discard the graph being read, edges and all
+  assert(agmemread("digraph { a -> b; b -> c; c -> a ] }") == NULL);
+
+  return 0;
+}
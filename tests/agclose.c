@@ -0,0 +1,153 @@
+/// @file
+/// @brief Accompanying test code for test_agclose
+
+#include <assert.h>
+#include <graphviz/cgraph.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum { NODES = 500, EDGES = 2000 };
+
+/// a record small enough to share arena chunks
+typedef struct {
+  Agrec_t h;
+  int tag;
+} small_rec_t;
+
+/// a record too large for the arena's size classes
+typedef struct {
+  Agrec_t h;
+  int tag[256];
+} large_rec_t;
+
+/// give an object records of both sizes, tagged with `tag`
+static void tag_object(void *obj, int tag) {
+  small_rec_t *s = agbindrec(obj, "small", sizeof(small_rec_t), false);
+  large_rec_t *l = agbindrec(obj, "large", sizeof(large_rec_t), false);
+  assert(s != NULL && l != NULL);
+  // records should start out zeroed, even in reused blocks
+  assert(s->tag == 0);
+  for (size_t i = 0; i < sizeof(l->tag) / sizeof(l->tag[0]); ++i)
+    assert(l->tag[i] == 0);
+  s->tag = tag;
+  for (size_t i = 0; i < sizeof(l->tag) / sizeof(l->tag[0]); ++i)
+    l->tag[i] = tag;
+}
+
+/// check the records given by `tag_object`
+static void check_object(void *obj, int tag) {
+  const small_rec_t *s = (small_rec_t *)aggetrec(obj, "small", 0);
+  const large_rec_t *l = (large_rec_t *)aggetrec(obj, "large", 0);
+  assert(s != NULL && s->tag == tag);
+  assert(l != NULL);
+  for (size_t i = 0; i < sizeof(l->tag) / sizeof(l->tag[0]); ++i)
+    assert(l->tag[i] == tag);
+}
+
+/// build a graph with nested subgraphs, deleting and recreating objects so
+/// that freed blocks are reused
+static Agraph_t *build(void) {
+  Agraph_t *g = agopen("g", Agdirected, NULL);
+  assert(g != NULL);
+  agattr_text(g, AGNODE, "color", "black");
+  agattr_text(g, AGEDGE, "weight", "1");
+
+  Agraph_t *outer = agsubg(g, "outer", 1);
+  Agraph_t *inner = agsubg(outer, "inner", 1);
+  Agnode_t *nodes[NODES];
+  for (int i = 0; i < NODES; ++i) {
+    char name[16];
+    snprintf(name, sizeof(name), "n%d", i);
+    nodes[i] = agnode(g, name, 1);
+    tag_object(nodes[i], i);
+    if (i % 3 == 0)
+      (void)agsubnode(inner, nodes[i], 1);
+  }
+
+  srand(1);
+  for (int i = 0; i < EDGES; ++i) {
+    Agnode_t *t = nodes[rand() % NODES];
+    Agnode_t *h = nodes[rand() % NODES];
+    Agraph_t *owner = i % 4 == 0 ? outer : g;
+    Agedge_t *e = agedge(owner, t, h, NULL, 1);
+    tag_object(e, i);
+  }
+
+  // delete every other node with its edges, and recreate it
+  for (int i = 0; i < NODES; i += 2) {
+    assert(agdelnode(g, nodes[i]) == 0);
+    char name[16];
+    snprintf(name, sizeof(name), "m%d", i);
+    nodes[i] = agnode(g, name, 1);
+    tag_object(nodes[i], -i);
+    (void)agsubnode(inner, nodes[i], 1);
+    (void)agedge(inner, nodes[i], nodes[(i + 1) % NODES], NULL, 1);
+  }
+
+  // survivors and newcomers should each keep their own records
+  for (int i = 0; i < NODES; ++i)
+    check_object(nodes[i], i % 2 == 0 ? -i : i);
+
+  // a closed subgraph can be replaced, and a frozen one closed with its root
+  assert(agclose(agsubg(outer, "inner", 0)) == 0);
+  inner = agsubg(outer, "inner", 1);
+  for (int i = 0; i < NODES; i += 5)
+    (void)agsubnode(inner, nodes[i], 1);
+  agfreeze(outer);
+
+  Agraph_t *g_sub = agsubg(g, "tagged", 1);
+  tag_object(g_sub, 42);
+  check_object(g_sub, 42);
+
+  return g;
+}
+
+/// deletions seen by the callbacks
+static size_t deleted_nodes, deleted_edges, deleted_graphs;
+
+static void count_node(Agraph_t *g, Agobj_t *obj, void *arg) {
+  (void)g;
+  (void)obj;
+  (void)arg;
+  ++deleted_nodes;
+}
+
+static void count_edge(Agraph_t *g, Agobj_t *obj, void *arg) {
+  (void)g;
+  (void)obj;
+  (void)arg;
+  ++deleted_edges;
+}
+
+static void count_graph(Agraph_t *g, Agobj_t *obj, void *arg) {
+  (void)g;
+  (void)obj;
+  (void)arg;
+  ++deleted_graphs;
+}
+
+static Agcbdisc_t counters = {
+    .graph = {.del = count_graph},
+    .node = {.del = count_node},
+    .edge = {.del = count_edge},
+};
+
+int main(void) {
+  // without callbacks, closing releases the arena in one go
+  Agraph_t *g = build();
+  assert(agclose(g) == 0);
+
+  // with callbacks, every object is deleted one by one and seen going
+  g = build();
+  const size_t nodes = (size_t)agnnodes(g);
+  const size_t edges = (size_t)agnedges(g);
+  agpushdisc(g, &counters, NULL);
+  assert(agclose(g) == 0);
+  assert(deleted_nodes == nodes);
+  assert(deleted_edges == edges);
+  // the root, "outer", "inner" and "tagged"
+  assert(deleted_graphs == 4);
+
+  return 0;
+}
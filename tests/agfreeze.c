@@ -0,0 +1,115 @@
+/// @file
+/// @brief Accompanying test code for test_agfreeze
+
+#include <assert.h>
+#include <graphviz/cgraph.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+enum { NODES = 100, EDGES = 2000 };
+
+/// a snapshot of a graph’s edges as visited by the public API
+typedef struct {
+  size_t size;
+  Agedge_t *edges[4 * EDGES];
+  int degree[NODES];
+} walk_t;
+
+static void walk(Agraph_t *g, walk_t *w) {
+  w->size = 0;
+  int i = 0;
+  for (Agnode_t *n = agfstnode(g); n != NULL; n = agnxtnode(g, n), ++i) {
+    for (Agedge_t *e = agfstout(g, n); e != NULL; e = agnxtout(g, e))
+      w->edges[w->size++] = e;
+    for (Agedge_t *e = agfstin(g, n); e != NULL; e = agnxtin(g, e))
+      w->edges[w->size++] = e;
+    w->degree[i] = agdegree(g, n, 1, 1);
+  }
+}
+
+/// walk the out-edges of every node in step with those of the next node, as
+/// two readers of the same frozen graph would
+static void interleave(Agraph_t *g, const walk_t *w) {
+  size_t i = 0;
+  for (Agnode_t *n = agfstnode(g); n != NULL; n = agnxtnode(g, n)) {
+    Agnode_t *m = agnxtnode(g, n);
+    Agedge_t *a = agfstout(g, n);
+    Agedge_t *b = m == NULL ? NULL : agfstout(g, m);
+    for (; a != NULL; a = agnxtout(g, a)) {
+      assert(w->edges[i++] == a);
+      if (b != NULL)
+        b = agnxtout(g, b);
+    }
+    for (Agedge_t *e = agfstin(g, n); e != NULL; e = agnxtin(g, e))
+      ++i;
+  }
+  assert(i == w->size);
+}
+
+static void check(Agraph_t *g) {
+  static walk_t before, after;
+  walk(g, &before);
+  agfreeze(g);
+  walk(g, &after);
+  assert(before.size == after.size);
+  for (size_t i = 0; i < before.size; ++i) {
+    assert(before.edges[i] == after.edges[i]);
+    // every edge should be found by lookup
+    Agedge_t *e = after.edges[i];
+    assert(ageqedge(agidedge(g, agtail(e), aghead(e), AGID(e), 0), e));
+  }
+  for (size_t i = 0; i < NODES; ++i)
+    assert(before.degree[i] == after.degree[i]);
+  interleave(g, &after);
+}
+
+int main(void) {
+  Agraph_t *g = agopen("g", Agdirected, NULL);
+  Agraph_t *sg = agsubg(g, "s", 1);
+  Agnode_t *nodes[NODES];
+  for (int i = 0; i < NODES; ++i) {
+    char name[16];
+    snprintf(name, sizeof(name), "n%d", i);
+    nodes[i] = agnode(g, name, 1);
+  }
+  srand(1);
+  for (int i = 0; i < EDGES; ++i) {
+    Agraph_t *where = i % 3 == 0 ? sg : g;
+    (void)agedge(where, nodes[rand() % NODES], nodes[rand() % NODES], NULL, 1);
+  }
+
+  // freezing should not change what is seen, in the root or a subgraph
+  check(g);
+  check(sg);
+
+  // a new edge should thaw both graphs and be visible in both
+  Agedge_t *e = agedge(sg, nodes[0], nodes[1], "new", 1);
+  assert(e != NULL);
+  assert(ageqedge(agedge(g, nodes[0], nodes[1], "new", 0), e));
+  assert(ageqedge(agedge(sg, nodes[0], nodes[1], "new", 0), e));
+  check(g);
+  check(sg);
+
+  // so should deleting one
+  assert(agdeledge(g, e) == 0);
+  assert(agedge(sg, nodes[0], nodes[1], "new", 0) == NULL);
+  check(g);
+  check(sg);
+
+  // deleting a node removes its edges from frozen graphs
+  agfreeze(g);
+  const int edges = agnedges(g) - agcountuniqedges(g, nodes[2], 1, 1);
+  assert(agdelnode(g, nodes[2]) == 0);
+  assert(agnedges(g) == edges);
+  nodes[2] = agnode(g, "n2", 1);
+  check(sg);
+
+  // a frozen subgraph can be thawed and closed
+  agthaw(sg);
+  check(sg);
+  assert(agclose(sg) == 0);
+  assert(agclose(g) == 0);
+
+  return 0;
+}
@@ -0,0 +1,126 @@
+/// @file
+/// @brief Accompanying test code for test_agwritebin
+
+#include <assert.h>
+#include <graphviz/cgraph.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// write a graph to a string
+static char *text(Agraph_t *g) {
+  FILE *f = tmpfile();
+  assert(f != NULL);
+  assert(agwrite(g, f) == 0);
+  const long len = ftell(f);
+  assert(len > 0);
+  rewind(f);
+  char *s = calloc((size_t)len + 1, 1);
+  assert(s != NULL);
+  assert(fread(s, 1, (size_t)len, f) == (size_t)len);
+  fclose(f);
+  return s;
+}
+
+static size_t put(void *chan, const char *data, size_t size) {
+  return fwrite(data, 1, size, chan);
+}
+
+/// a laid-out looking graph using most of what the format has to hold
+static Agraph_t *example(void) {
+  Agraph_t *g = agopen("G", Agdirected, NULL);
+  assert(g != NULL);
+  agattr_text(g, AGRAPH, "bb", "0,0,100,100");
+  agattr_text(g, AGNODE, "color", "black");
+  agattr_text(g, AGNODE, "label", "\\N");
+  agattr_text(g, AGEDGE, "pos", "");
+
+  Agnode_t *a = agnode(g, "a", 1);
+  Agnode_t *b = agnode(g, "b b", 1);
+  Agnode_t *c = agnode(g, "c", 1);
+  Agnode_t *anon = agnode(g, NULL, 1);
+  agset(a, "color", "red");
+  char *html = agstrdup_html(g, "<b>bold</b>");
+  agxset_html(b, agattr_text(g, AGNODE, "label", NULL), html);
+  agstrfree(g, html, true);
+
+  Agedge_t *e = agedge(g, a, b, "k1", 1);
+  agset(e, "pos", "e,10,10 20,20 30,30 40,40");
+  agedge(g, b, c, NULL, 1);
+  agedge(g, c, anon, NULL, 1);
+  agedge(g, a, b, NULL, 1);
+  agedge(g, c, a, NULL, 1);
+
+  Agraph_t *sub = agsubg(g, "cluster_x", 1);
+  agattr_text(sub, AGNODE, "color", "blue");
+  agsubnode(sub, a, 1);
+  agsubnode(sub, b, 1);
+  agsubedge(sub, e, 1);
+  agset(sub, "bb", "5,5,50,50");
+  Agraph_t *inner = agsubg(sub, NULL, 1);
+  agsubnode(inner, agnode(g, "d", 1), 1);
+
+  return g;
+}
+
+int main(void) {
+  Agraph_t *g = example();
+  char *expected = text(g);
+
+  // a binary graph, then a second one, then DOT
+  FILE *f = tmpfile();
+  assert(f != NULL);
+  assert(agwritebin(g, f, put) == 0);
+  agclose(g);
+  g = agopen("H", Agstrictundirected, NULL);
+  agedge(g, agnode(g, "x", 1), agnode(g, "y", 1), NULL, 1);
+  assert(agwritebin(g, f, put) == 0);
+  agclose(g);
+  fputs("graph I { p -- q }\n", f);
+
+  // which reading a file takes in turn
+  rewind(f);
+  g = agread(f, NULL);
+  assert(g != NULL);
+  char *got = text(g);
+  assert(strcmp(expected, got) == 0);
+  free(got);
+  agclose(g);
+
+  g = agread(f, NULL);
+  assert(g != NULL);
+  assert(strcmp(agnameof(g), "H") == 0);
+  assert(agisstrict(g) && agisundirected(g));
+  assert(agnnodes(g) == 2 && agnedges(g) == 1);
+  agclose(g);
+
+  g = agread(f, NULL);
+  assert(g != NULL);
+  assert(strcmp(agnameof(g), "I") == 0);
+  agclose(g);
+  assert(agread(f, NULL) == NULL);
+
+  // reading from memory gives the same graph
+  const long size = ftell(f);
+  assert(size > 0);
+  rewind(f);
+  char *data = malloc((size_t)size);
+  assert(data != NULL);
+  assert(fread(data, 1, (size_t)size, f) == (size_t)size);
+  fclose(f);
+  size_t used = 0;
+  g = agmemreadbin(data, (size_t)size, &used, NULL);
+  assert(g != NULL);
+  assert(used > 0 && used < (size_t)size);
+  got = text(g);
+  assert(strcmp(expected, got) == 0);
+  free(got);
+  agclose(g);
+
+  // a truncated graph is rejected
+  assert(agmemreadbin(data, used - 1, NULL, NULL) == NULL);
+
+  free(data);
+  free(expected);
+  return 0;
+}
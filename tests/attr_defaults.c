@@ -0,0 +1,107 @@
+/// @file
+/// @brief Accompanying test code for test_attr_defaults
+
+#include <assert.h>
+#include <graphviz/cgraph.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+static int streq(const char *a, const char *b) { return strcmp(a, b) == 0; }
+
+int main(void) {
+
+  Agraph_t *g = agopen("g", Agdirected, NULL);
+  assert(g != NULL);
+
+  // an object keeps the default in force when it was created
+  agattr_text(g, AGNODE, "color", "red");
+  Agnode_t *a = agnode(g, "a", 1);
+  agattr_text(g, AGNODE, "color", "blue");
+  Agnode_t *b = agnode(g, "b", 1);
+  assert(streq(agget(a, "color"), "red"));
+  assert(streq(agget(b, "color"), "blue"));
+
+  // nodes created in a subgraph take its local default
+  Agraph_t *sg = agsubg(g, "sg", 1);
+  agattr_text(sg, AGNODE, "color", "green");
+  Agnode_t *c = agnode(sg, "c", 1);
+  Agnode_t *d = agnode(g, "d", 1);
+  assert(streq(agget(c, "color"), "green"));
+  assert(streq(agget(d, "color"), "blue"));
+
+  // a new attribute gives every existing object its default
+  Agsym_t *shape = agattr_text(g, AGNODE, "shape", "box");
+  Agnode_t *nodes[] = {a, b, c, d};
+  for (size_t i = 0; i < sizeof(nodes) / sizeof(nodes[0]); ++i) {
+    assert(streq(agxget(nodes[i], shape), "box"));
+  }
+
+  // setting a value affects only that object, and unset values are defaults
+  assert(agset(b, "shape", "circle") == 0);
+  assert(streq(agxget(b, shape), "circle"));
+  assert(agxget(a, shape) == shape->defval);
+
+  // edge halves share their values
+  agattr_text(g, AGEDGE, "weight", "1");
+  Agedge_t *e = agedge(g, a, b, NULL, 1);
+  assert(agxset(agopp(e), agattr_text(g, AGEDGE, "weight", NULL), "5") == 0);
+  assert(streq(agget(e, "weight"), "5"));
+
+  // a recreated object does not inherit the values of a deleted one
+  assert(agdelnode(g, b) == 0);
+  b = agnode(g, "b", 1);
+  assert(streq(agxget(b, shape), "box"));
+
+  // graph values follow the same rules
+  agattr_text(g, AGRAPH, "label", "top");
+  Agraph_t *early = agsubg(g, "early", 1);
+  agattr_text(g, AGRAPH, "label", "changed");
+  Agraph_t *late = agsubg(g, "late", 1);
+  assert(streq(agget(early, "label"), "top"));
+  assert(streq(agget(late, "label"), "changed"));
+
+  // an object reusing the storage of a deleted one takes the current defaults
+  Agnode_t *old = agnode(g, "old", 1);
+  assert(agset(old, "shape", "star") == 0);
+  agattr_text(g, AGNODE, "color", "purple");
+  assert(agdelnode(g, old) == 0);
+  Agnode_t *reused = agnode(g, "reused", 1);
+  assert(streq(agget(reused, "color"), "purple"));
+  assert(agxget(reused, shape) == shape->defval);
+  assert(streq(agget(a, "color"), "red"));
+
+  // repeated deletion and creation keeps every object’s defaults
+  for (int i = 0; i < 1000; ++i) {
+    char name[32];
+    snprintf(name, sizeof(name), "churn%d", i);
+    Agnode_t *n = agnode(g, name, 1);
+    const char *const color = i % 2 ? "orange" : "purple";
+    assert(streq(agget(n, "color"), color));
+    agattr_text(g, AGNODE, "color", i % 2 ? "purple" : "orange");
+    assert(streq(agget(n, "color"), color));
+    assert(agdelnode(g, n) == 0);
+  }
+  assert(streq(agget(reused, "color"), "purple"));
+  assert(streq(agget(a, "color"), "red"));
+
+  // a parsed form kept with a value is cleared when the value changes
+  char *value;
+  Agparsed_t *parsed = agxparsed(a, shape, &value);
+  assert(value == shape->defval);
+  *parsed = (Agparsed_t){.number = 1, .how = 1};
+  assert(agxparsed(d, shape, &value) == parsed && "default not shared");
+  assert(agset(a, "shape", "ellipse") == 0);
+  parsed = agxparsed(a, shape, &value);
+  assert(streq(value, "ellipse"));
+  assert(parsed->how == 0);
+  *parsed = (Agparsed_t){.number = 2, .how = 1};
+  assert(agxparsed(a, shape, &value)->number == 2);
+  assert(agset(a, "shape", "box") == 0);
+  assert(agxparsed(a, shape, &value)->how == 0);
+  assert(agxparsed(d, shape, &value)->number == 1);
+
+  assert(agclose(g) == 0);
+
+  return 0;
+}
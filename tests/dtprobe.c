@@ -0,0 +1,205 @@
+/// @file
+/// @brief Accompanying test code for test_dtprobe
+
+#include <assert.h>
+#include <graphviz/cdt.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+  Dtlink_t link;
+  int key;
+} item_t;
+
+static int cmpint(void *a, void *b) {
+  const int *x = a;
+  const int *y = b;
+  return *x < *y ? -1 : *x > *y;
+}
+
+static Dtdisc_t disc = {
+    .key = offsetof(item_t, key),
+    .size = sizeof(int),
+    .link = offsetof(item_t, link),
+    .comparf = cmpint,
+};
+
+static Dtdisc_t held = {
+    .key = offsetof(item_t, key),
+    .size = sizeof(int),
+    .link = -1,
+    .comparf = cmpint,
+};
+
+enum { N = 100000 };
+
+static item_t items[N];
+
+/// exercise the operations of a Dtprobe dictionary
+static void test_operations(Dtdisc_t *dc) {
+  Dt_t *d = dtopen(dc, Dtprobe);
+  assert(d != NULL);
+
+  for (int i = 0; i < N; ++i) {
+    items[i].key = i * 7;
+    assert(dtinsert(d, &items[i]) == &items[i]);
+  }
+  assert(dtsize(d) == N);
+
+  // duplicates are not inserted
+  item_t dup = {.key = 70};
+  assert(dtinsert(d, &dup) == &items[10]);
+  assert(dtsize(d) == N);
+
+  for (int i = 0; i < N; ++i) {
+    int key = i * 7;
+    assert(dtmatch(d, &key) == &items[i]);
+    ++key;
+    assert(dtmatch(d, &key) == NULL);
+  }
+
+  // delete every third object
+  for (int i = 0; i < N; i += 3) {
+    assert(dtdelete(d, &items[i]) == &items[i]);
+  }
+  for (int i = 0; i < N; ++i) {
+    assert((dtsearch(d, &items[i]) != NULL) == (i % 3 != 0));
+  }
+
+  // a walk sees every object once
+  int seen = 0;
+  for (item_t *it = dtfirst(d); it != NULL; it = dtnext(d, it)) {
+    assert(it->key % 7 == 0 && (it->key / 7) % 3 != 0);
+    ++seen;
+  }
+  assert(seen == dtsize(d));
+
+  // and so does a walk backwards
+  seen = 0;
+  for (item_t *it = dtlast(d); it != NULL; it = dtprev(d, it)) {
+    ++seen;
+  }
+  assert(seen == dtsize(d));
+
+  // flattening and restoring keeps the objects
+  seen = 0;
+  for (Dtlink_t *l = dtflatten(d); l != NULL; l = dtlink(d, l)) {
+    ++seen;
+  }
+  assert(seen == dtsize(d));
+  int key = 7;
+  assert(dtmatch(d, &key) == &items[1]);
+
+  // renewing an object moves it to its new key
+  if (dc->link >= 0) {
+    assert(dtsearch(d, &items[1]) == &items[1]);
+    items[1].key = -1;
+    assert(dtrenew(d, &items[1]) == &items[1]);
+    key = -1;
+    assert(dtmatch(d, &key) == &items[1]);
+    key = 7;
+    assert(dtmatch(d, &key) == NULL);
+  }
+
+  // switching methods keeps the objects
+  const int size = dtsize(d);
+  dtmethod(d, Dtoset);
+  assert(dtsize(d) == size);
+  dtmethod(d, Dtprobe);
+  assert(dtsize(d) == size);
+  key = 14;
+  assert(dtmatch(d, &key) == &items[2]);
+
+  // deleting the current object during a walk skips nothing
+  seen = 0;
+  for (item_t *it = dtfirst(d); it != NULL;) {
+    item_t *const next = dtnext(d, it);
+    assert(dtdelete(d, it) == it);
+    ++seen;
+    it = next;
+  }
+  assert(seen == size);
+  assert(dtsize(d) == 0);
+
+  assert(dtclose(d) == 0);
+}
+
+/// statistics of a Dtprobe dictionary should count every object once
+static void test_stat(void) {
+  Dt_t *d = dtopen(&disc, Dtprobe);
+  assert(d != NULL);
+
+  Dtstat_t st;
+  assert(dtstat(d, &st, 1) == 0);
+  assert(st.dt_meth == DT_PROBE);
+  assert(st.dt_size == 0);
+
+  for (int i = 0; i < N; ++i) {
+    items[i].key = i * 7;
+    assert(dtinsert(d, &items[i]) == &items[i]);
+  }
+
+  assert(dtstat(d, &st, 1) == 0);
+  assert(st.dt_meth == DT_PROBE);
+  assert(st.dt_size == N);
+  assert(st.dt_count != NULL);
+
+  // every object is some distance from its home slot
+  size_t total = 0;
+  size_t most = 0;
+  for (size_t i = 0; i <= st.dt_n; ++i) {
+    total += st.dt_count[i];
+    if (st.dt_count[i] > most) {
+      most = st.dt_count[i];
+    }
+  }
+  assert(total == N);
+  assert(st.dt_max == most);
+  assert(st.dt_count[st.dt_n] > 0);
+  printf("longest probe: %zu slots past home\n", st.dt_n);
+
+  assert(dtclose(d) == 0);
+}
+
+/// time lookups of integer keys with the given method
+static double lookups(Dtmethod_t *method) {
+  Dt_t *d = dtopen(&disc, method);
+  assert(d != NULL);
+  for (int i = 0; i < N; ++i) {
+    items[i].key = i * 7;
+    dtinsert(d, &items[i]);
+  }
+
+  enum { ROUNDS = 20 };
+  unsigned state = 1;
+  int found = 0;
+  const clock_t start = clock();
+  for (int i = 0; i < N * ROUNDS; ++i) {
+    state = state * 1103515245 + 12345;
+    int key = (int)((state >> 8) % N) * 7;
+    found += dtmatch(d, &key) != NULL;
+  }
+  const double elapsed = (double)(clock() - start) / CLOCKS_PER_SEC;
+  assert(found == N * ROUNDS);
+
+  dtclose(d);
+  return elapsed;
+}
+
+int main(void) {
+
+  test_operations(&disc);
+  test_operations(&held);
+  test_stat();
+
+  const double oset = lookups(Dtoset);
+  const double set = lookups(Dtset);
+  const double probe = lookups(Dtprobe);
+  printf("lookups: Dtoset %.3fs, Dtset %.3fs, Dtprobe %.3fs\n", oset, set,
+         probe);
+
+  return 0;
+}
@@ -0,0 +1,130 @@
+/// @file
+/// @brief Accompanying test code for test_flatread
+
+#include <assert.h>
+#include <graphviz/cgraph.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/// write a graph to a string
+static char *text(Agraph_t *g) {
+  FILE *f = tmpfile();
+  assert(f != NULL);
+  assert(agwrite(g, f) == 0);
+  const long len = ftell(f);
+  assert(len > 0);
+  rewind(f);
+  char *s = calloc((size_t)len + 1, 1);
+  assert(s != NULL);
+  assert(fread(s, 1, (size_t)len, f) == (size_t)len);
+  fclose(f);
+  return s;
+}
+
+/// the fast path of cgraph, from cghdr.h
+extern Agraph_t *agflatparse(const char *data, size_t size, size_t *used,
+                             Agdisc_t *disc);
+
+/// read a graph with the grammar, by concatenating it into an empty graph
+static char *read_with_grammar(const char *input, Agdesc_t desc) {
+  Agraph_t *g = agopen("G", desc, NULL);
+  assert(agmemconcat(g, input) == g);
+  char *s = text(g);
+  agclose(g);
+  return s;
+}
+
+int main(void) {
+
+  // a flat graph well past the size the fast path kicks in at, with
+  // statements split over lines so chunks may start mid-statement
+  size_t cap = 1 << 24;
+  char *input = malloc(cap);
+  assert(input != NULL);
+  size_t len = (size_t)snprintf(input, cap,
+                                "digraph G {\n"
+                                "  node [shape=box, color=\"re\\\"d\"]\n"
+                                "  rankdir=LR\n"
+                                "# comment\n");
+  for (int i = 0; len + 256 < cap && i < 200000; ++i) {
+    const char *const fmt[] = {
+        "n%d [label=<<b>x</b>> weight=-1.5];\n",
+        "n%d:p:n -> n0\n  -> \"n1\" [key=k%d, color=blue];\n",
+        "edge [penwidth=%d] // comment\n",
+        "%d -> n3:w [label=\"a\\\\b\" +\n \"c\\\nd\"];\n",
+        "/* x\n */ n%d -> n%d\n",
+    };
+    len += (size_t)snprintf(input + len, cap - len, fmt[i % 5], i, i % 7);
+  }
+  len += (size_t)snprintf(input + len, cap - len, "}\n");
+
+  // the fast path must take the input, or comparing with the grammar would
+  // only compare the grammar with itself
+  size_t used = 0;
+  Agraph_t *g = agflatparse(input, len, &used, NULL);
+  assert(g != NULL && "fast path declined the input");
+  assert(used == len);
+  char *fast = text(g);
+  agclose(g);
+  char *slow = read_with_grammar(input, Agdirected);
+  assert(strcmp(fast, slow) == 0);
+  free(slow);
+
+  // which agmemread should take too
+  g = agmemread(input);
+  assert(g != NULL);
+  char *from_memory = text(g);
+  agclose(g);
+  assert(strcmp(fast, from_memory) == 0);
+  free(from_memory);
+
+  // reading from a file leaves the next graph to read
+  FILE *f = tmpfile();
+  assert(f != NULL);
+  assert(fwrite(input, 1, len, f) == len);
+  fputs("graph H { a -- b }\n", f);
+  rewind(f);
+  g = agread(f, NULL);
+  assert(g != NULL);
+  char *from_file = text(g);
+  agclose(g);
+  assert(strcmp(fast, from_file) == 0);
+  g = agread(f, NULL);
+  assert(g != NULL);
+  assert(strcmp(agnameof(g), "H") == 0);
+  assert(agnedges(g) == 1);
+  agclose(g);
+  fclose(f);
+  free(from_file);
+  free(fast);
+
+  // so does reading small graphs from a file, with the grammar
+  f = tmpfile();
+  assert(f != NULL);
+  fputs("graph A { a -- b }\ndigraph B { c -> d -> e }\n", f);
+  rewind(f);
+  g = agread(f, NULL);
+  assert(g != NULL);
+  assert(strcmp(agnameof(g), "A") == 0);
+  agclose(g);
+  g = agread(f, NULL);
+  assert(g != NULL);
+  assert(strcmp(agnameof(g), "B") == 0);
+  assert(agnedges(g) == 2);
+  agclose(g);
+  assert(agread(f, NULL) == NULL);
+  fclose(f);
+
+  // a large graph with a subgraph is left to the grammar
+  len -= 2;
+  len += (size_t)snprintf(input + len, cap - len, "subgraph s { q }\n}\n");
+  assert(agflatparse(input, len, &used, NULL) == NULL);
+  g = agmemread(input);
+  assert(g != NULL);
+  assert(agsubg(g, "s", 0) != NULL);
+  agclose(g);
+
+  free(input);
+  return 0;
+}
@@ -12,6 +12,8 @@ import tempfile
 from pathlib import Path
 from typing import Optional, Union
 
+import pytest
+
 ROOT = Path(__file__).resolve().parent.parent
 """absolute path to the root of the repository"""
 
@@ -339,6 +341,13 @@ def is_static_build() -> bool:
     return False
 
 
+skip_if_static = pytest.mark.skipif(
+    is_static_build(),
+    reason="dynamic libraries are unavailable to link against in static builds",
+)
+"""skip a test that links a C program against Graphviz libraries"""
+
+
 def remove_asan_summary(s: str) -> str:
     """
     Remove the “Suppressions used…” informational text Address Sanitizer prints.
@@ -445,6 +454,23 @@ def run_c(
         return stdout, stderr
 
 
+def run_c_test(name: str, **kwargs) -> tuple[str, str]:
+    """
+    compile and run a C program that accompanies the test suite
+
+    Args:
+        name: filename of the program, relative to the test directory
+        kwargs: further arguments to `run_c`
+    """
+
+    # find co-located test source
+    c_src = (Path(__file__).parent / name).resolve()
+    assert c_src.exists(), "missing test case"
+
+    # run it
+    return run_c(c_src, **kwargs)
+
+
 def which(cmd: str) -> Optional[Path]:
     """
     `shutil.which` but only return results that are adjacent to the main Graphviz
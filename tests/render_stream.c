@@ -0,0 +1,83 @@
+/// @file
+/// @brief Accompanying test code for test_render_stream
+
+#include <assert.h>
+#include <graphviz/cgraph.h>
+#include <graphviz/gvc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef NDEBUG
+#error "this code is not intended to be compiled with assertions disabled"
+#endif
+
+/// output gathered from the sink
+typedef struct {
+  char *data;
+  size_t size;
+  size_t chunks;
+  size_t last; ///< size of the most recent chunk
+} gathered_t;
+
+static size_t gather(void *context, const char *data, size_t len) {
+  gathered_t *g = context;
+  // only the last chunk may be short
+  assert(g->chunks == 0 || g->last == 64 * 1024);
+  assert(len > 0);
+  g->data = realloc(g->data, g->size + len);
+  assert(g->data != NULL);
+  memcpy(g->data + g->size, data, len);
+  g->size += len;
+  ++g->chunks;
+  g->last = len;
+  return len;
+}
+
+static size_t refuse(void *context, const char *data, size_t len) {
+  (void)data;
+  size_t *calls = context;
+  ++*calls;
+  return len / 2;
+}
+
+int main(void) {
+  GVC_t *gvc = gvContext();
+  assert(gvc != NULL);
+
+  // a graph whose SVG is many chunks long
+  Agraph_t *g = agopen("G", Agdirected, NULL);
+  assert(g != NULL);
+  for (int i = 0; i < 5000; ++i) {
+    char name[32];
+    snprintf(name, sizeof(name), "n%d", i);
+    agnode(g, name, 1);
+  }
+  assert(gvLayout(gvc, g, "dot") == 0);
+
+  char *expected = NULL;
+  size_t expected_size = 0;
+  assert(gvRenderData(gvc, g, "svg", &expected, &expected_size) == 0);
+  assert(expected_size > 4 * 64 * 1024 && "test graph too small");
+
+  // streamed output should match output rendered to memory
+  gathered_t got = {0};
+  assert(gvRenderStream(gvc, g, "svg", gather, &got) == 0);
+  assert(got.chunks > 1);
+  assert(got.size == expected_size);
+  assert(memcmp(got.data, expected, expected_size) == 0);
+
+  // a sink that stops taking output should fail the render and not be called
+  // again
+  size_t calls = 0;
+  assert(gvRenderStream(gvc, g, "svg", refuse, &calls) == -1);
+  assert(calls == 1);
+
+  free(got.data);
+  gvFreeRenderData(expected);
+  gvFreeLayout(gvc, g);
+  agclose(g);
+  gvFreeContext(gvc);
+
+  return 0;
+}
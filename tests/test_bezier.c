@@ -0,0 +1,125 @@
+/// @file
+/// @brief Supporting file for test_c_utils.py::test_bezier
+
+#ifdef NDEBUG
+#error this is not intended to be compiled with assertions off
+#endif
+
+#include <assert.h>
+#include <common/bezier.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/// the general de Casteljau evaluation `Bezier` used to do
+static pointf reference(const pointf *V, double t, pointf *Left,
+                        pointf *Right) {
+  enum { degree = 3 };
+  pointf Vtemp[degree + 1][degree + 1];
+
+  for (int j = 0; j <= degree; j++) {
+    Vtemp[0][j] = V[j];
+  }
+  for (int i = 1; i <= degree; i++) {
+    for (int j = 0; j <= degree - i; j++) {
+      Vtemp[i][j].x = (1.0 - t) * Vtemp[i - 1][j].x + t * Vtemp[i - 1][j + 1].x;
+      Vtemp[i][j].y = (1.0 - t) * Vtemp[i - 1][j].y + t * Vtemp[i - 1][j + 1].y;
+    }
+  }
+  for (int j = 0; j <= degree; j++) {
+    Left[j] = Vtemp[j][0];
+    Right[j] = Vtemp[degree - j][j];
+  }
+  return Vtemp[degree][0];
+}
+
+static bool same(pointf a, pointf b) { return a.x == b.x && a.y == b.y; }
+
+static void random_segment(pointf *cp) {
+  for (int i = 0; i < 4; ++i) {
+    cp[i] = (pointf){.x = rand() % 2001 - 1000.0, .y = rand() % 2001 - 1000.0};
+  }
+}
+
+/// splitting and evaluation should give exactly what they always did
+static void test_split(void) {
+  for (int k = 0; k < 10000; ++k) {
+    pointf cp[4];
+    random_segment(cp);
+    const double t = (double)(rand() % 1001) / 1000;
+
+    pointf want_left[4], want_right[4];
+    const pointf want = reference(cp, t, want_left, want_right);
+
+    pointf left[4], right[4];
+    assert(same(bezier_split(cp, t, left, right), want));
+    assert(same(bezier_point(cp, t), want));
+    for (int i = 0; i < 4; ++i) {
+      assert(same(left[i], want_left[i]));
+      assert(same(right[i], want_right[i]));
+    }
+
+    // splitting in place should give the same left half
+    pointf in_place[4] = {cp[0], cp[1], cp[2], cp[3]};
+    bezier_split(in_place, t, in_place, NULL);
+    for (int i = 0; i < 4; ++i) {
+      assert(same(in_place[i], want_left[i]));
+    }
+  }
+}
+
+static void test_points(void) {
+  const pointf cp[] = {{0, 0}, {10, 30}, {40, -20}, {50, 10}};
+  pointf pts[21];
+  bezier_points(cp, 20, pts);
+  assert(same(pts[0], cp[0]));
+  assert(same(pts[20], cp[3]));
+  for (int i = 0; i <= 20; ++i) {
+    assert(same(pts[i], bezier_point(cp, (double)i / 20)));
+  }
+}
+
+/// the bounds should hold the whole curve and touch it
+static void test_bounds(void) {
+  for (int k = 0; k < 1000; ++k) {
+    pointf cp[4];
+    random_segment(cp);
+    const boxf bb = bezier_bounds(cp);
+
+    const double eps = 1e-9;
+    double lo_x = cp[0].x, hi_x = cp[0].x, lo_y = cp[0].y, hi_y = cp[0].y;
+    for (int i = 0; i <= 1000; ++i) {
+      const pointf p = bezier_point(cp, (double)i / 1000);
+      assert(p.x >= bb.LL.x - eps && p.x <= bb.UR.x + eps);
+      assert(p.y >= bb.LL.y - eps && p.y <= bb.UR.y + eps);
+      lo_x = fmin(lo_x, p.x);
+      hi_x = fmax(hi_x, p.x);
+      lo_y = fmin(lo_y, p.y);
+      hi_y = fmax(hi_y, p.y);
+    }
+
+    // sampling can only miss a little of an extremum
+    const double slack = 1;
+    assert(bb.LL.x >= lo_x - slack && bb.UR.x <= hi_x + slack);
+    assert(bb.LL.y >= lo_y - slack && bb.UR.y <= hi_y + slack);
+  }
+}
+
+/// a straight segment with its control points on the line
+static void test_bounds_line(void) {
+  const pointf cp[] = {{0, 0}, {1, 1}, {2, 2}, {3, 3}};
+  const boxf bb = bezier_bounds(cp);
+  assert(same(bb.LL, cp[0]));
+  assert(same(bb.UR, cp[3]));
+}
+
+int main(void) {
+  test_split();
+  test_points();
+  test_bounds();
+  test_bounds_line();
+
+  printf("all tests passed\n");
+  return EXIT_SUCCESS;
+}
@@ -11,7 +11,7 @@ sys.path.append(os.path.dirname(__file__))
 from gvtest import compile_c, run, run_c  # pylint: disable=wrong-import-position
 
 
-@pytest.mark.parametrize("utility", ("bitarray", "itos", "list", "tokenize"))
+@pytest.mark.parametrize("utility", ("bitarray", "fmtnum", "itos", "list", "tokenize"))
 def test_utility(utility: str):
     """run the given utility’s unit tests"""
 
@@ -25,7 +25,7 @@ def test_utility(utility: str):
     # extra C flags this compilation needs
     cflags = ["-I", lib]
     if platform.system() != "Windows":
-        cflags += ["-std=gnu17"]
+        cflags += ["-std=gnu17", "-lm"]
 
     _, _ = run_c(src, cflags=cflags)
 
@@ -75,3 +75,21 @@ def test_gv_find_me(tmp_path: Path):
     output = run([exe])
 
     assert output == f"{exe}\n", "gv_find_me did not determine executable absolute path"
+
+
+def test_bezier():
+    """test ../lib/common/bezier.h"""
+
+    # locate our support test file
+    src = Path(__file__).parent.resolve() / "test_bezier.c"
+    assert src.exists()
+
+    # locate lib directory that needs to be in the include path
+    lib = Path(__file__).resolve().parents[1] / "lib"
+
+    # extra C flags this compilation needs
+    cflags = ["-I", lib]
+    if platform.system() != "Windows":
+        cflags += ["-std=gnu17", "-lm"]
+
+    run_c(src, cflags=cflags)
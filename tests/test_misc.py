@@ -2,15 +2,32 @@
 Graphviz miscellaneous test cases
 """
 
+import gzip
 import itertools
 import json
+import math
 import os
+import platform
+import struct
+import subprocess
 import sys
+import zlib
 from pathlib import Path
 from typing import Union
 
+import pytest
+
 sys.path.append(os.path.dirname(__file__))
-from gvtest import ROOT, compile_c, dot, run  # pylint: disable=wrong-import-position
+from gvtest import (  # pylint: disable=wrong-import-position
+    ROOT,
+    compile_c,
+    dot,
+    run,
+    run_c,
+    run_c_test,
+    skip_if_static,
+    which,
+)
 
 
 def test_json_node_order():
@@ -202,3 +219,548 @@ def test_xml_escape(tmp_path: Path):
                 assert escaped == f"character |{expected}|", "bad UTF-8 escaping"
             else:
                 assert escaped == unescaped, "bad UTF-8 passthrough"
+
+
+@pytest.mark.skipif(which("sfdp") is None, reason="sfdp not available")
+@pytest.mark.parametrize("scheme", ("normal", "fast", "fmm", "none"))
+def test_sfdp_quadtree(scheme: str):
+    """
+    sfdp should produce a layout with every quadtree scheme
+    """
+
+    # a grid, big enough to take more than one multilevel step
+    size = 30
+    edges = []
+    for i in range(size):
+        for j in range(size):
+            if i + 1 < size:
+                edges.append(f"n{i}_{j} -- n{i + 1}_{j};")
+            if j + 1 < size:
+                edges.append(f"n{i}_{j} -- n{i}_{j + 1};")
+    source = "graph { overlap=true; " + " ".join(edges) + " }"
+
+    sfdp = which("sfdp")
+    p = subprocess.run(
+        [sfdp, f"-Gquadtree={scheme}", "-Tjson"],
+        input=source,
+        capture_output=True,
+        check=False,
+        text=True,
+    )
+
+    # if sfdp was built without libgts, it will not handle anything non-trivial
+    no_gts_error = "remove_overlap: Graphviz not built with triangulation library"
+    if no_gts_error in p.stderr:
+        assert p.returncode != 0, "sfdp returned success after an error message"
+        return
+
+    p.check_returncode()
+    data = json.loads(p.stdout)
+
+    # every node should have been given a finite position
+    nodes = [o for o in data["objects"] if "nodes" not in o]
+    assert len(nodes) == size * size
+    for node in nodes:
+        x, y = (float(v) for v in node["pos"].split(","))
+        assert math.isfinite(x) and math.isfinite(y)
+
+
+def test_quadtree():
+    """
+    check the repulsive forces computed with a quadtree against the exact sum,
+    and that a quadtree refit to moved points matches one built from them
+    """
+
+    # locate our test program
+    src = Path(__file__).parent / "test_quadtree.c"
+    assert src.exists(), "missing test_quadtree.c"
+
+    # the quadtree is internal to sfdp, so build it into the test directly
+    lib = ROOT / "lib"
+    cflags = [
+        f"-I{lib}",
+        f"-I{lib / 'cdt'}",
+        f"-I{lib / 'cgraph'}",
+        f"-I{lib / 'common'}",
+        lib / "sparse/QuadTree.c",
+        lib / "sparse/general.c",
+    ]
+    if platform.system() != "Windows":
+        cflags += ["-std=gnu17", "-lm"]
+
+    run_c(src, cflags=cflags)
+
+
+@pytest.mark.skipif(which("neato") is None, reason="neato not available")
+def test_prism_shrink():
+    """
+    prism overlap removal should shrink a spread out row of nodes until they
+    nearly touch
+
+    Nodes whose boxes only overlapped vertically used to be reported as
+    overlapping, so a row of nodes at similar heights was never shrunk.
+    """
+
+    n = 8
+    nodes = " ".join(f'n{i} [pos="{i * 300},{i % 2 * 10}"];' for i in range(n))
+    edges = " ".join(f"n{i} -- n{i + 1};" for i in range(n - 1))
+    source = f"graph {{ overlap=prism; overlap_scaling=0; {nodes} {edges} }}"
+
+    neato = which("neato")
+    p = subprocess.run(
+        [neato, "-n", "-Tjson"],
+        input=source,
+        capture_output=True,
+        check=True,
+        text=True,
+    )
+    if 'Overlap value "prism" unsupported' in p.stderr:
+        pytest.skip("prism overlap removal not available")
+    data = json.loads(p.stdout)
+
+    xs = {}
+    for obj in data["objects"]:
+        x, _ = (float(v) for v in obj["pos"].split(","))
+        xs[obj["name"]] = x
+
+    # default nodes are 54pt wide with 4pt of separation on each side
+    for i in range(n - 1):
+        gap = abs(xs[f"n{i + 1}"] - xs[f"n{i}"])
+        assert 54 < gap < 100, f"n{i} and n{i + 1} were not shrunk together"
+
+
+@skip_if_static
+def test_agbulk():
+    """
+    edges added under `agbulkbegin` should be indexed as if added one by one
+    """
+
+    run_c_test("agbulk.c", link=["cgraph"])
+
+
+@skip_if_static
+def test_agfreeze():
+    """
+    a frozen graph should present the same edges as before freezing it
+    """
+
+    run_c_test("agfreeze.c", link=["cgraph"])
+
+
+@skip_if_static
+def test_attr_defaults():
+    """
+    objects should keep the attribute defaults in force when they were created
+    """
+
+    run_c_test("attr_defaults.c", link=["cgraph"])
+
+
+@skip_if_static
+def test_agclose():
+    """
+    graphs whose objects are deleted, reused and bound to records should close
+    cleanly, with or without callbacks watching
+    """
+
+    run_c_test("agclose.c", link=["cgraph"])
+
+
+@skip_if_static
+def test_dtprobe():
+    """
+    the open-addressing cdt method should support the dictionary operations
+    """
+
+    run_c_test("dtprobe.c", link=["cdt"])
+
+
+@skip_if_static
+def test_flatread():
+    """
+    large flat graphs read through the parallel fast path should come out as
+    the grammar would read them
+    """
+
+    run_c_test("flatread.c", link=["cgraph"])
+
+
+@skip_if_static
+def test_agwritebin():
+    """
+    graphs written in the binary graph format should read back unchanged
+    """
+
+    run_c_test("agwritebin.c", link=["cgraph"])
+
+
+def test_gvb_command_line_attributes(tmp_path: Path):
+    """
+    a binary graph should read back into a graph that already declares
+    attributes of its own, from `-N`, `-E` and `-G`, as its DOT form would
+    """
+
+    source = 'digraph { node [shape=box]; a -> b [color=red]; b [label="B"]; }'
+    gvb = tmp_path / "g.gvb"
+    run(["dot", "-Tgvb", "-o", gvb], input=source)
+    laid_out = dot("dot", source=source)
+
+    args = ["dot", "-Nfoo=x", "-Ewidth=2", "-Gbar=y", "-Tcanon"]
+    got = run(args + [gvb])
+    assert got == run(args, input=laid_out)
+    assert "foo=x" in got and "bar=y" in got
+
+
+def test_svgz_blocks():
+    """
+    compressed output spanning many compression blocks should decompress to
+    the uncompressed output
+    """
+
+    # a graph whose SVG is several times the size of a block
+    source = "digraph { " + " ".join(f"n{i};" for i in range(5000)) + " }"
+
+    svg = dot("svg", source=source)
+    svgz = dot("svgz", source=source)
+    assert len(svg) > 4 * 128 * 1024, "test graph too small"
+    assert gzip.decompress(svgz).decode("utf-8") == svg
+
+
+@skip_if_static
+def test_render_stream():
+    """
+    output passed to a streaming sink should arrive in whole chunks and match
+    output rendered to memory
+    """
+
+    run_c_test("render_stream.c", link=["cgraph", "gvc"])
+
+
+@skip_if_static
+def test_usershape_stale(tmp_path: Path):
+    """
+    an image file that changes between graphs should be read again rather than
+    have its old size taken from the cache
+    """
+
+    run_c_test(
+        "usershape_stale.c", args=[tmp_path / "icon.png"], link=["cgraph", "gvc"]
+    )
+
+
+def test_json_xdot_ops():
+    """
+    drawing operations in JSON output, which are recorded as data while
+    rendering, should match those parsed back from xdot output
+    """
+
+    source = (
+        "digraph {\n"
+        '  label="graph label";\n'
+        "  subgraph cluster_a {\n"
+        '    label="cluster"; style=filled; fillcolor="red:blue";\n'
+        "    a [shape=box style=dashed penwidth=2];\n"
+        "  }\n"
+        '  b [style=radial fillcolor="yellow:green" gradientangle=45];\n'
+        "  c [label=<<b>bold</b> <i>italic</i>> fontname=Courier];\n"
+        '  a -> b [label="edge" headlabel="head" taillabel="tail" dir=both];\n'
+        "  b -> c [color=\"#00ff0080\" style=bold];\n"
+        "  c -> a [shape=ellipse];\n"
+        "  d [shape=ellipse style=filled fillcolor=pink];\n"
+        "}"
+    )
+
+    direct = json.loads(dot("json", source=source))
+    xdot = dot("xdot", source=source)
+    parsed = json.loads(run(["dot", "-Txdot_json"], input=xdot))
+
+    keys = ("_draw_", "_ldraw_", "_hdraw_", "_tdraw_", "_hldraw_", "_tldraw_")
+
+    def ops(data):
+        objs = data.get("objects", []) + data.get("edges", [])
+        return [{k: o[k] for k in keys if k in o} for o in [data] + objs]
+
+    assert ops(direct) == ops(parsed)
+    assert any("_hdraw_" in o and "_tdraw_" in o for o in direct["edges"])
+
+
+@pytest.mark.parametrize("formats", (("svg", "xdot"), ("xdot", "svg", "fig")))
+def test_render_plan(formats: tuple[str, ...]):
+    """
+    edges drawn for several output formats in one run, where later formats
+    replay the drawing of the first, should come out as they do alone
+    """
+
+    source = (
+        "digraph {\n"
+        '  a -> b [color="red;0.3:green;0.2:blue" arrowhead=odiamond];\n'
+        '  b -> c [color="red:green:blue" dir=both arrowtail=crowtee];\n'
+        "  c -> d [style=tapered penwidth=7 arrowhead=none];\n"
+        "  d -> a [style=dashed arrowhead=dotcurve headclip=false];\n"
+        "  a -> c [style=invis];\n"
+        "}"
+    )
+
+    together = run(["dot"] + [f"-T{f}" for f in formats], input=source)
+    apart = "".join(dot(f, source=source) for f in formats)
+
+    assert together == apart
+
+
+def test_several_graphs_svg_ids():
+    """
+    every graph of an input holding several should be drawn from its first
+    page, so that its SVG ids carry no page prefix
+    """
+
+    source = "digraph { a -> b; }\ndigraph { c -> d; }\n"
+    svg = dot("svg", source=source)
+
+    assert svg.count('<g id="graph0" class="graph"') == 2
+    assert 'id="page' not in svg, "page prefix on an SVG id"
+
+
+@pytest.mark.skipif(platform.system() == "Windows", reason="--parallel needs fork")
+def test_parallel_formats(tmp_path: Path):
+    """
+    formats rendered side by side with `--parallel` should come out as they do
+    one at a time
+    """
+
+    source = (
+        "digraph {\n"
+        '  a -> b [color="red:green:blue" label="ab"];\n'
+        "  b -> c [style=tapered penwidth=5];\n"
+        '  c [shape=box style=filled fillcolor="yellow"];\n'
+        "}"
+    )
+    formats = ("svg", "xdot", "fig", "ps")
+
+    args = ["dot", "--parallel"]
+    args += [f"-T{f}" for f in formats]
+    args += [f"-o{tmp_path / f'out.{f}'}" for f in formats]
+    run(args, input=source)
+
+    for f in formats:
+        want = dot(f, source=source)
+        got = (tmp_path / f"out.{f}").read_bytes()
+        if isinstance(want, str):
+            got = got.decode("utf-8")
+        assert got == want, f"-T{f} output differs"
+
+
+@pytest.mark.skipif(platform.system() == "Windows", reason="--parallel needs fork")
+@pytest.mark.parametrize("formats", (("svg", "xdot"), ("svg", "ps")))
+def test_parallel_several_graphs(tmp_path: Path, formats: tuple[str, ...]):
+    """
+    with `--parallel`, an input of several graphs rendered to `-o` files should
+    come out as it does one at a time
+    """
+
+    source = "digraph { a -> b; }\ndigraph { c -> d; }\ngraph { e -- f; }\n"
+
+    outputs = {}
+    for parallel in (False, True):
+        out = tmp_path / ("parallel" if parallel else "serial")
+        out.mkdir()
+        args = ["dot"] + (["--parallel"] if parallel else [])
+        args += [f"-T{f}" for f in formats]
+        args += [f"-o{out / f'out.{f}'}" for f in formats]
+        stdout = run(args, input=source)
+        files = {f: (out / f"out.{f}").read_text() for f in formats}
+        outputs[parallel] = (stdout, files)
+
+    _, files = outputs[True]
+    assert all(files.values()), "output file left empty"
+    assert outputs[True] == outputs[False], "--parallel changed the output"
+
+
+def test_paged_emit():
+    """
+    every node and edge of a graph spread over many pages should be drawn on
+    some page
+    """
+
+    # a long chain, far taller than a page
+    source = (
+        'graph { page="2,2"; '
+        + " ".join(f"n{i} -- n{i + 1};" for i in range(200))
+        + " }"
+    )
+
+    ps = dot("ps", source=source).decode("utf-8")
+    assert ps.count("%%Page:") > 1, "graph does not span several pages"
+    for i in range(200):
+        assert f"\n% n{i}\n" in ps, f"node n{i} missing"
+        assert f"\n% n{i}--n{i + 1}\n" in ps, f"edge n{i}--n{i + 1} missing"
+
+
+def test_xlabel_overlap():
+    """
+    external labels should be placed clear of nodes and of each other, even
+    when there are too many of them for one R-tree node
+    """
+
+    n = 200
+    source = (
+        "graph { node [shape=box]; "
+        + " ".join(f'n{i} [xlabel="label number {i}"];' for i in range(n))
+        + " ".join(f"n{i} -- n{(i * 7 + 3) % n};" for i in range(n))
+        + " }"
+    )
+    layout = json.loads(dot("json", source=source))
+
+    def box(x: float, y: float, width: float, height: float):
+        return (x - width / 2, y - height / 2, x + width / 2, y + height / 2)
+
+    def overlap(a, b) -> bool:
+        return a[0] < b[2] and b[0] < a[2] and a[1] < b[3] and b[1] < a[3]
+
+    nodes = {}
+    xlabels = {}
+    for obj in layout["objects"]:
+        x, y = (float(v) for v in obj["pos"].split(","))
+        nodes[obj["name"]] = box(
+            x, y, float(obj["width"]) * 72, float(obj["height"]) * 72
+        )
+        # the external label is the last text drawn with the node’s labels, in
+        # the default 14pt font
+        text = [op for op in obj["_ldraw_"] if op["op"] == "T"][-1]
+        x, y = (float(v) for v in obj["xlp"].split(","))
+        xlabels[obj["name"]] = box(x, y, text["width"], 14)
+
+    for name, label in xlabels.items():
+        for other, node in nodes.items():
+            assert not overlap(label, node), f"xlabel of {name} covers {other}"
+        for other, other_label in xlabels.items():
+            if other < name:
+                assert not overlap(
+                    label, other_label
+                ), f"xlabels of {name} and {other} overlap"
+
+
+def _png_decode(png: bytes) -> tuple[int, int, list[bytearray]]:
+    """
+    decode a PNG of 8-bit RGBA pixels
+
+    Returns:
+        the width, the height, and the rows of the image
+    """
+
+    assert png[:8] == b"\x89PNG\r\n\x1a\n", "output is not a PNG"
+
+    # gather up the chunks
+    chunks = []
+    offset = 8
+    while offset < len(png):
+        (length,) = struct.unpack(">I", png[offset : offset + 4])
+        kind = png[offset + 4 : offset + 8]
+        data = png[offset + 8 : offset + 8 + length]
+        (crc,) = struct.unpack(">I", png[offset + 8 + length : offset + 12 + length])
+        assert zlib.crc32(kind + data) == crc, f"bad CRC in {kind} chunk"
+        chunks.append((kind, data))
+        offset += 12 + length
+    assert chunks[0][0] == b"IHDR" and chunks[-1][0] == b"IEND"
+
+    width, height, depth, colour, _, _, interlace = struct.unpack(
+        ">IIBBBBB", chunks[0][1]
+    )
+    assert depth == 8 and colour == 6 and interlace == 0, "not 8-bit RGBA"
+
+    # the image data should hold a filter byte and RGBA pixels for every row
+    data = zlib.decompress(b"".join(d for k, d in chunks if k == b"IDAT"))
+    stride = 4 * width
+    assert len(data) == height * (1 + stride), "wrong amount of image data"
+
+    # undo the filter of each row
+    rows = []
+    prev = bytearray(stride)
+    for y in range(height):
+        start = y * (1 + stride)
+        kind = data[start]
+        row = bytearray(data[start + 1 : start + 1 + stride])
+        if kind == 1:  # Sub
+            for i in range(4, stride):
+                row[i] = (row[i] + row[i - 4]) & 0xFF
+        elif kind == 2:  # Up
+            row = bytearray((a + b) & 0xFF for a, b in zip(row, prev))
+        elif kind == 3:  # Average
+            for i in range(stride):
+                left = row[i - 4] if i >= 4 else 0
+                row[i] = (row[i] + ((left + prev[i]) >> 1)) & 0xFF
+        elif kind == 4:  # Paeth
+            for i in range(stride):
+                a = row[i - 4] if i >= 4 else 0
+                b = prev[i]
+                c = prev[i - 4] if i >= 4 else 0
+                pa, pb, pc = abs(b - c), abs(a - c), abs(a + b - 2 * c)
+                pred = a if pa <= pb and pa <= pc else b if pb <= pc else c
+                row[i] = (row[i] + pred) & 0xFF
+        else:
+            assert kind == 0, f"unknown PNG filter {kind}"
+        rows.append(row)
+        prev = row
+
+    return width, height, rows
+
+
+def test_tiled_png():
+    """
+    a bitmap too large for one cairo surface should be drawn in tiles at its
+    full size, rather than scaled down
+    """
+
+    # a long, flat graph wider than cairo allows an image surface to be
+    source = (
+        "digraph { rankdir=LR; dpi=960; "
+        + " -> ".join(f"n{i}" for i in range(30))
+        + " }"
+    )
+
+    png = dot("png:cairo", source=source)
+    width, _, rows = _png_decode(png)
+    assert width > 32767, "image was scaled down"
+    assert any(any(row) for row in rows), "image is empty"
+
+
+def test_tiled_png_pixels():
+    """
+    a bitmap drawn in tiles should look like one drawn whole
+    """
+
+    # a long, flat graph whose image is just wider than the size at which
+    # bitmaps are drawn in tiles, drawn at full and at half resolution, where
+    # the half is small enough to be drawn whole
+    def source(dpi: int) -> str:
+        return (
+            f"digraph {{ rankdir=LR; dpi={dpi}; pad=0; ranksep=0.25; "
+            "node [shape=box, style=filled, fillcolor=black, label=\"\", "
+            "width=0.5, height=0.1, fixedsize=true]; "
+            + " -> ".join(f"n{i}" for i in range(74))
+            + " }"
+        )
+
+    tiled_width, tiled_height, tiled = _png_decode(
+        dot("png:cairo", source=source(300))
+    )
+    assert tiled_width > 16384, "image too small to be tiled"
+    width, height, whole = _png_decode(dot("png:cairo", source=source(150)))
+    assert width < 16384 and width * height < 4096 * 4096, "image too large"
+
+    # compare the halved tiled image with the whole one, a tile column at a time
+    tile = 1024 // 2
+    for x0 in range(0, min(width, tiled_width // 2), tile):
+        x1 = min(x0 + tile, width, tiled_width // 2)
+        diff = 0
+        count = 0
+        for y in range(min(height, tiled_height // 2)):
+            top, bottom = tiled[2 * y], tiled[2 * y + 1]
+            for x in range(x0, x1):
+                for c in range(3):
+                    i = 8 * x + c
+                    halved = (top[i] + top[i + 4] + bottom[i] + bottom[i + 4]) / 4
+                    diff += abs(halved - whole[y][4 * x + c])
+                    count += 1
+        assert (
+            diff / count < 16
+        ), f"tiled image differs from the whole one at pixels {2 * x0}-{2 * x1}"
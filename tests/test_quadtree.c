@@ -0,0 +1,236 @@
+/// @file
+/// @brief Supporting file for test_misc.py::test_quadtree
+
+#ifdef NDEBUG
+#error this is not intended to be compiled with assertions off
+#endif
+
+#include <assert.h>
+#include <math.h>
+#include <sparse/QuadTree.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+extern double distance_cropped(double *x, int dim, int i, int j);
+
+enum { N = 2000, DIM = 2, MAX_LEVEL = 10 };
+
+/// the p = -1 repulsive force sfdp uses
+static const double KP = 1;
+
+/// the Barnes-Hut and multipole acceptance parameters sfdp uses
+static const double BH = 0.6;
+static const double FMM_THETA = 0.9;
+
+/// some clustered points, so the tree is uneven
+static void points(double *x) {
+  for (int i = 0; i < N; ++i) {
+    const double cx = i % 3 == 0 ? 0 : 50;
+    const double spread = i % 3 == 0 ? 100 : 10;
+    x[i * DIM] = cx + spread * rand() / RAND_MAX;
+    x[i * DIM + 1] = cx + spread * rand() / RAND_MAX;
+  }
+}
+
+/// sum the force between every pair of nodes
+static void exact_force(double *x, double *force) {
+  for (int i = 0; i < N * DIM; ++i)
+    force[i] = 0;
+  for (int i = 0; i < N; ++i) {
+    for (int j = i + 1; j < N; ++j) {
+      const double dist = distance_cropped(x, DIM, i, j);
+      for (int k = 0; k < DIM; ++k) {
+        const double f = KP * (x[i * DIM + k] - x[j * DIM + k]) / (dist * dist);
+        force[i * DIM + k] += f;
+        force[j * DIM + k] -= f;
+      }
+    }
+  }
+}
+
+/// ‖force - expected‖ ÷ ‖expected‖
+static double error(const double *force, const double *expected) {
+  double diff = 0, norm = 0;
+  for (int i = 0; i < N * DIM; ++i) {
+    diff += (force[i] - expected[i]) * (force[i] - expected[i]);
+    norm += expected[i] * expected[i];
+  }
+  return sqrt(diff / norm);
+}
+
+/// error of the multipole forces with acceptance parameter `theta`
+static double fmm_error(double *x, const double *exact, double theta) {
+  double *fmm = calloc(N * DIM, sizeof(double));
+  double *again = calloc(N * DIM, sizeof(double));
+  assert(fmm != NULL && again != NULL);
+  double counts[4];
+
+  QuadTree qt = QuadTree_new_from_point_list(DIM, N, MAX_LEVEL, x);
+  QuadTree_get_repulsive_force_fmm(qt, fmm, x, theta, -1, KP, counts);
+
+  // the expansions kept from the first evaluation should not leak into the
+  // second one
+  QuadTree_get_repulsive_force_fmm(qt, again, x, theta, -1, KP, counts);
+  for (int i = 0; i < N * DIM; ++i)
+    assert(again[i] == fmm[i]);
+  QuadTree_delete(qt);
+
+  const double err = error(fmm, exact);
+  free(again);
+  free(fmm);
+  return err;
+}
+
+static void test_fmm(void) {
+  double *x = calloc(N * DIM, sizeof(double));
+  double *exact = calloc(N * DIM, sizeof(double));
+  double *bh = calloc(N * DIM, sizeof(double));
+  assert(x != NULL && exact != NULL && bh != NULL);
+  double counts[4];
+
+  points(x);
+  exact_force(x, exact);
+
+  QuadTree qt = QuadTree_new_from_point_list(DIM, N, MAX_LEVEL, x);
+  QuadTree_get_repulsive_force(qt, bh, x, BH, -1, KP, counts);
+  QuadTree_delete(qt);
+  const double bh_error = error(bh, exact);
+
+  // at the parameter sfdp uses, multipoles should be well ahead of Barnes-Hut
+  const double err = fmm_error(x, exact, FMM_THETA);
+  fprintf(stderr, "Barnes-Hut error %g, multipole error %g\n", bh_error, err);
+  assert(err < 1e-2);
+  assert(err < bh_error / 10);
+
+  // and the error should fall quickly as cells need to be further apart
+  const double close = fmm_error(x, exact, 0.5);
+  fprintf(stderr, "multipole error %g with theta = 0.5\n", close);
+  assert(close < 1e-4);
+
+  free(bh);
+  free(exact);
+  free(x);
+}
+
+/// move every point a little, and every tenth point a lot, staying within the
+/// bounding box of the points so they stay within the root cell
+static void jiggle(double *x) {
+  double lo[DIM], hi[DIM];
+  for (int k = 0; k < DIM; ++k) {
+    lo[k] = hi[k] = x[k];
+    for (int i = 0; i < N; ++i) {
+      lo[k] = fmin(lo[k], x[i * DIM + k]);
+      hi[k] = fmax(hi[k], x[i * DIM + k]);
+    }
+  }
+  for (int i = 0; i < N; ++i) {
+    const double scale = i % 10 == 0 ? 20 : 0.5;
+    for (int k = 0; k < DIM; ++k) {
+      const double moved =
+          x[i * DIM + k] + scale * (2.0 * rand() / RAND_MAX - 1);
+      x[i * DIM + k] = fmin(fmax(moved, lo[k]), hi[k]);
+    }
+  }
+}
+
+/// check the counts, weights and averages of a cell, and that its nodes lie
+/// within it, marking each node seen
+static void check_cell(QuadTree qt, const double *x, bool *seen) {
+  int n = 0;
+  double weight = 0;
+  double sum[DIM] = {0};
+
+  for (node_data l = qt->l; l; l = l->next) {
+    assert(!seen[l->id] && "node in more than one cell");
+    seen[l->id] = true;
+    for (int k = 0; k < DIM; ++k) {
+      assert(l->coord[k] == x[l->id * DIM + k] && "stale node position");
+      assert(fabs(l->coord[k] - qt->center[k]) <= qt->width &&
+             "node outside its cell");
+      sum[k] += l->coord[k];
+    }
+    ++n;
+    weight += l->node_weight;
+  }
+
+  if (qt->qts) {
+    for (int i = 0; i < 1 << DIM; ++i) {
+      const QuadTree child = qt->qts[i];
+      if (!child)
+        continue;
+      assert(child->n > 0 && "empty cell kept");
+      assert(child->width == qt->width / 2);
+      check_cell(child, x, seen);
+      n += child->n;
+      weight += child->total_weight;
+      for (int k = 0; k < DIM; ++k)
+        sum[k] += child->average[k] * child->n;
+    }
+  }
+
+  assert(qt->n == n);
+  assert(fabs(qt->total_weight - weight) < 1e-9);
+  for (int k = 0; k < DIM; ++k)
+    assert(fabs(qt->average[k] - sum[k] / n) < 1e-9);
+}
+
+static void test_refit(void) {
+  double *x = calloc(N * DIM, sizeof(double));
+  double *exact = calloc(N * DIM, sizeof(double));
+  double *refit = calloc(N * DIM, sizeof(double));
+  double *fresh = calloc(N * DIM, sizeof(double));
+  bool *seen = calloc(N, sizeof(bool));
+  assert(x != NULL && exact != NULL && refit != NULL && fresh != NULL &&
+         seen != NULL);
+  double counts[4];
+
+  points(x);
+  QuadTree qt = QuadTree_new_from_point_list(DIM, N, MAX_LEVEL, x);
+  // leave forces in the cells, as sfdp does before refitting
+  QuadTree_get_repulsive_force(qt, refit, x, BH, -1, KP, counts);
+
+  jiggle(x);
+  assert(QuadTree_refit(qt, x));
+  check_cell(qt, x, seen);
+  for (int i = 0; i < N; ++i)
+    assert(seen[i] && "node lost by refit");
+
+  // the refit tree should be as good as one built from scratch
+  QuadTree built = QuadTree_new_from_point_list(DIM, N, MAX_LEVEL, x);
+  for (int i = 0; i < N; ++i)
+    seen[i] = false;
+  check_cell(built, x, seen);
+  assert(built->n == qt->n);
+  assert(fabs(built->total_weight - qt->total_weight) < 1e-9);
+  for (int k = 0; k < DIM; ++k)
+    assert(fabs(built->average[k] - qt->average[k]) < 1e-9);
+
+  exact_force(x, exact);
+  QuadTree_get_repulsive_force(qt, refit, x, BH, -1, KP, counts);
+  QuadTree_get_repulsive_force(built, fresh, x, BH, -1, KP, counts);
+  const double refit_error = error(refit, exact);
+  const double fresh_error = error(fresh, exact);
+  fprintf(stderr, "Barnes-Hut error %g after refit, %g after rebuild\n",
+          refit_error, fresh_error);
+  assert(refit_error < 2 * fresh_error);
+  QuadTree_delete(built);
+
+  // a node leaving the root cell cannot be refit
+  x[0] = 1000;
+  assert(!QuadTree_refit(qt, x));
+  QuadTree_delete(qt);
+
+  free(seen);
+  free(fresh);
+  free(refit);
+  free(exact);
+  free(x);
+}
+
+int main(void) {
+  srand(1);
+  test_fmm();
+  test_refit();
+  return 0;
+}
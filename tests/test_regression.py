@@ -1380,6 +1380,7 @@ def test_1648(fmt: str, layerselect: int):
         "eps",
         "fig",
         "gv",
+        "gvb",
         pytest.param(
             "ico",
             marks=pytest.mark.skipif(
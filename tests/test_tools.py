@@ -6,6 +6,7 @@ Graphviz suite. A failure of one of these indicates that some basic functional
 property of one of the tools has been broken.
 """
 
+import math
 import os
 import platform
 import re
@@ -65,6 +66,7 @@ from gvtest import (  # pylint: disable=wrong-import-position
         "prune",
         "sccmap",
         "sfdp",
+        "sfdpstream",
         "smyrna",
         "tred",
         "twopi",
@@ -218,3 +220,72 @@ def test_sandbox_write_2(tmp_path: Path):
     assert (
         proc.returncode != 0
     ), "failed file writing did not cause a non-zero exit status"
+
+
+@pytest.mark.skipif(which("sfdpstream") is None, reason="sfdpstream not available")
+@pytest.mark.parametrize(
+    "source",
+    (
+        "# a comment\na b\nb c 2.5\nc a\nd\n",
+        'graph { edge [weight=2]; a -- b -- c; "c" -- a [weight=1]; d; }',
+    ),
+)
+def test_sfdpstream(source: str):
+    """
+    sfdpstream should lay out both edge lists and flat DOT graphs
+    """
+    output = subprocess.check_output(["sfdpstream", "-p"], input=source, text=True)
+    positions = {}
+    for line in output.splitlines():
+        name, x, y = line.split()
+        positions[name] = (float(x), float(y))
+    assert sorted(positions) == ["a", "b", "c", "d"], "incorrect nodes in output"
+    assert all(
+        math.isfinite(x) and math.isfinite(y) for x, y in positions.values()
+    ), "non-finite node positions"
+
+    # the default output should be a DOT graph with positions on every node
+    output = subprocess.check_output(["sfdpstream"], input=source, text=True)
+    assert output.count("pos=") == 4, "missing node positions in DOT output"
+
+
+@pytest.mark.skipif(which("sfdpstream") is None, reason="sfdpstream not available")
+@pytest.mark.parametrize("source", ("x", "digraphs", "a_long_node_name"))
+def test_sfdpstream_single_word(source: str):
+    """
+    sfdpstream should read a lone node name with no trailing newline intact
+    """
+    output = subprocess.check_output(["sfdpstream", "-p"], input=source, text=True)
+    names = [line.split()[0] for line in output.splitlines()]
+    assert names == [source], "node name read incorrectly"
+
+
+@pytest.mark.skipif(which("sfdpstream") is None, reason="sfdpstream not available")
+def test_sfdpstream_windows():
+    """
+    sfdpstream should read tokens and comments that cross the boundary between
+    one read of its input and the next
+    """
+    statement = '/* c */ "a\\"b" -> <h> -> 1.5 [w="x", weight=2] // d\n'
+    window = 65536
+    for offset in range(len(statement) + 1):
+        # pad the input so that the statement starts `offset` bytes before the
+        # end of the first read
+        header = "digraph {\n"
+        padding = " " * (window - len(header) - offset)
+        source = f"{header}{padding}{statement}}}\n"
+        output = subprocess.check_output(
+            ["sfdpstream", "-p"], input=source, text=True
+        )
+        got = [line.rsplit(" ", 2)[0] for line in output.splitlines()]
+        assert got == ['a"b', "h", "1.5"], f"nodes read incorrectly at {offset}"
+
+
+@pytest.mark.skipif(which("sfdpstream") is None, reason="sfdpstream not available")
+def test_sfdpstream_backslash():
+    """
+    node names containing backslashes and quotes should be written as valid DOT
+    """
+    output = subprocess.check_output(["sfdpstream"], input='a\\ b"\n', text=True)
+    canon = subprocess.check_output(["dot", "-Tcanon"], input=output, text=True)
+    assert canon.count("pos=") == 2, "sfdpstream output could not be parsed"
@@ -0,0 +1,76 @@
+/// @file
+/// @brief Accompanying test code for test_usershape_stale
+
+#include <assert.h>
+#include <graphviz/cgraph.h>
+#include <graphviz/gvc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef NDEBUG
+#error "this code is not intended to be compiled with assertions disabled"
+#endif
+
+/// write the start of a PNG file, enough to give its size
+static void write_png(const char *path, unsigned width, unsigned height,
+                      size_t padding) {
+  FILE *f = fopen(path, "wb");
+  assert(f != NULL);
+  const unsigned char header[] = {
+      0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n', 0, 0, 0, 13, 'I', 'H', 'D',
+      'R'};
+  fwrite(header, 1, sizeof(header), f);
+  const unsigned dims[] = {width, height};
+  for (size_t i = 0; i < sizeof(dims) / sizeof(dims[0]); ++i) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+      fputc((int)((dims[i] >> shift) & 0xff), f);
+    }
+  }
+  for (size_t i = 0; i < padding; ++i) {
+    fputc(0, f);
+  }
+  assert(fclose(f) == 0);
+}
+
+/// lay out a graph with one node showing the image, and return its width
+static double width_of(GVC_t *gvc, const char *path) {
+  Agraph_t *g = agopen("G", Agdirected, NULL);
+  assert(g != NULL);
+  Agnode_t *n = agnode(g, "a", 1);
+  agsafeset(n, "shape", "none", "");
+  agsafeset(n, "label", "", "");
+  agsafeset(n, "image", (char *)path, "");
+  assert(gvLayout(gvc, g, "dot") == 0);
+
+  // rendering to DOT sets the layout attributes
+  char *data = NULL;
+  size_t size = 0;
+  assert(gvRenderData(gvc, g, "dot", &data, &size) == 0);
+  gvFreeRenderData(data);
+
+  const double width = atof(agget(n, "width"));
+  gvFreeLayout(gvc, g);
+  agclose(g);
+  return width;
+}
+
+int main(int argc, char **argv) {
+  assert(argc == 2);
+  const char *path = argv[1];
+
+  GVC_t *gvc = gvContext();
+  assert(gvc != NULL);
+
+  write_png(path, 100, 50, 0);
+  const double small = width_of(gvc, path);
+  assert(width_of(gvc, path) == small);
+
+  // a changed image should be read again rather than taken from the cache
+  write_png(path, 400, 200, 16);
+  const double large = width_of(gvc, path);
+  assert(large > small);
+
+  gvFreeContext(gvc);
+  return 0;
+}